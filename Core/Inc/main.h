@@ -53,6 +53,7 @@ bool loop(void);
 void Error_Handler(void);
 
 /* USER CODE BEGIN EFP */
+uint32_t sbrk_get_calls(void);
 
 /* USER CODE END EFP */
 
@@ -2,57 +2,63 @@
 #include "main.h"
 
 #include "i2c_bus.hpp"
-#include "i2c_device.hpp"
+#include "ads1115.hpp"
 
 #include "queue.hpp"
 
-#define I2C_BUFFER_SIZE 10
+#define I2C_BUFFER_SIZE 16
 
-void postReadCallback(void* params)
-{
-    bool *transactionInProgress = reinterpret_cast<bool*>(params);
-    *transactionInProgress = false;
-}
+// AIN0 against GND, converted continuously at 128 SPS and read 100 times per second.
+#define ADC_SAMPLES_PER_SECOND 100
 
-bool loop(void)
-{
-    try
-    {
-        uint8_t txBuffer[2];
+// Fast mode, exact with duty cycle 2 from the 42 MHz PCLK1 of SystemClock_Config.
+#define I2C_CLOCK_SPEED 400000
 
-        StaticQueue<I2cTransaction, I2C_BUFFER_SIZE> i2cBuffer;
+static I2cStatus run(void)
+{
+    // The driver never allocates, from its construction on: the heap must not grow.
+    uint32_t heapCalls = sbrk_get_calls();
 
-        I2cBus i2cBus("Bus number 1", &i2cBuffer, I2C_BUS_1, 10000);
-        I2cDevice i2cAdc(0x48, &i2cBus, "ADC_1");
+    SpscQueue<I2cTransaction, I2C_BUFFER_SIZE> i2cBuffer;
 
-        //I2C_HandleTypeDef* handleI2c = i2cBus.getHandle();
+    I2cBus i2cBus("Bus number 1", &i2cBuffer, I2C_BUS_1, I2C_CLOCK_SPEED);
+    if(i2cBus.getStatus() != I2C_OK)
+        return i2cBus.getStatus();
 
-        txBuffer[0] = 0xC4;  // MSB (0xC483 -> MSB = 0xC4)
-        txBuffer[1] = 0x83;  // LSB (0xC483 -> LSB = 0x83)
-        I2cTransaction configAdc(TRANSACTION_TX, txBuffer, 2, &i2cAdc, 0x01, REGISTER_8_BITS);
-        configAdc.send();
+    Ads1115 adc(&i2cBus, ADS1115_DEFAULT_ADDRESS, "ADC_1");
 
+    //I2C_HandleTypeDef* handleI2c = i2cBus.getHandle();
 
-        bool transactionInProgress = true;
-        uint16_t data = 0;
-        uint8_t rxBuffer[2] = {0, 0};
-        while(true)
-        {
-            I2cTransaction transactionRead2 = I2cTransaction::I2cRxTransaction(&i2cAdc, rxBuffer, 2, 0x00, REGISTER_8_BITS);
+    I2cStatus status = adc.startContinuous(ADS1115_MUX_AIN0_GND, ADS1115_RANGE_2_048V, ADC_SAMPLES_PER_SECOND);
+    if(status != I2C_OK)
+        return status;
 
-            transactionRead2.setPostCallback(postReadCallback, &transactionInProgress);
+    while(true)
+    {
+        if(sbrk_get_calls() != heapCalls)
+            Error_Handler();
 
-            transactionInProgress = true;
-            transactionRead2.send();
+        // Timeouts and NACK retries of the bus.
+        i2cBus.poll();
 
-            // Wait until transaction finishes.
-            while(transactionInProgress);
+        adc.poll();
+    }
+}
 
-            data = (rxBuffer[0] << 8) | rxBuffer[1];
-        }
+bool loop(void)
+{
+#if I2C_DRIVER_EXCEPTIONS
+    try
+    {
+        run();
     }
     catch(I2cException& e)
     {
         while(true);
     }
+#else
+    run();
+#endif
+
+    while(true);
 }
\ No newline at end of file
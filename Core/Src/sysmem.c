@@ -29,6 +29,11 @@
  */
 static uint8_t *__sbrk_heap_end = NULL;
 
+/**
+ * Calls of _sbrk(), see sbrk_get_calls()
+ */
+static volatile uint32_t __sbrk_calls = 0;
+
 /**
  * @brief _sbrk() allocates memory to the newlib heap and is used by malloc
  *        and others from the C library
@@ -59,6 +64,8 @@ void *_sbrk(ptrdiff_t incr)
   const uint8_t *max_heap = (uint8_t *)stack_limit;
   uint8_t *prev_heap_end;
 
+  __sbrk_calls++;
+
   /* Initialize heap end at first call */
   if (NULL == __sbrk_heap_end)
   {
@@ -77,3 +84,17 @@ void *_sbrk(ptrdiff_t incr)
 
   return (void *)prev_heap_end;
 }
+
+/**
+ * @brief Number of _sbrk() calls so far. Compared before and after a code path, tells whether it
+ *        allocated from the heap, e.g. constructing the buses or running transactions.
+ *
+ * malloc() only calls _sbrk() when the heap must grow: a block freed earlier is reused without it.
+ * The check holds as long as nothing was freed before the code path runs.
+ *
+ * @return Calls, including the ones that failed
+ */
+uint32_t sbrk_get_calls(void)
+{
+  return __sbrk_calls;
+}
@@ -0,0 +1,344 @@
+#include "ads1115.hpp"
+
+#define ADS1115_REGISTER_CONVERSION 0x00
+#define ADS1115_REGISTER_CONFIG     0x01
+
+#define ADS1115_CONFIG_RESET        0x8583
+
+#define ADS1115_CONFIG_OS           0x8000
+#define ADS1115_CONFIG_MUX_SHIFT    12
+#define ADS1115_CONFIG_PGA_SHIFT    9
+#define ADS1115_CONFIG_MODE_SHIFT   8
+#define ADS1115_CONFIG_DR_SHIFT     5
+// COMP_QUE = 11: comparator disabled, ALERT/RDY high impedance.
+#define ADS1115_CONFIG_COMP_DISABLE 0x0003
+
+// START, address, pointer and 2 data bytes to start a conversion, then START, address, pointer,
+// repeated START, address and 2 data bytes to read it: about 90 SCL periods.
+#define ADS1115_SAMPLE_BITS 90
+
+static const uint32_t dataRates[8] = {8, 16, 32, 64, 128, 250, 475, 860};
+
+// Full scale range in microvolts.
+static const int32_t fullScaleRanges[6] = {6144000, 4096000, 2048000, 1024000, 512000, 256000};
+
+
+Ads1115::Ads1115(I2cBus *bus, uint16_t address, const char* name)
+    : I2cDevice(address, bus, name), configShadow(REGISTER_8_BITS, 2)
+{
+    configShadow.track(ADS1115_REGISTER_CONFIG, ADS1115_CONFIG_RESET);
+    setShadow(&configShadow);
+}
+
+uint16_t Ads1115::encode(const Ads1115Config &config)
+{
+    return (config.mux << ADS1115_CONFIG_MUX_SHIFT) |
+           (config.range << ADS1115_CONFIG_PGA_SHIFT) |
+           (config.mode << ADS1115_CONFIG_MODE_SHIFT) |
+           (config.dataRate << ADS1115_CONFIG_DR_SHIFT) |
+           ADS1115_CONFIG_COMP_DISABLE;
+}
+
+uint32_t Ads1115::getConversionCycles(Ads1115DataRate dataRate)
+{
+    uint32_t cycles = HAL_RCC_GetHCLKFreq() / dataRates[dataRate];
+    return cycles + cycles / 10;
+}
+
+uint32_t Ads1115::getTransferCycles(void)
+{
+    return ADS1115_SAMPLE_BITS * (HAL_RCC_GetHCLKFreq() / bus->getSclFrequency());
+}
+
+bool Ads1115::selectDataRate(uint32_t conversionsPerSecond, Ads1115DataRate &dataRate)
+{
+    for(uint8_t rate = ADS1115_RATE_8_SPS; rate <= ADS1115_RATE_860_SPS; rate++)
+    {
+        if(dataRates[rate] - dataRates[rate] / 10 >= conversionsPerSecond)
+        {
+            dataRate = static_cast<Ads1115DataRate>(rate);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int32_t Ads1115::toMicrovolts(int16_t value, Ads1115Range range)
+{
+    return static_cast<int32_t>(static_cast<int64_t>(value) * fullScaleRanges[range] / 32768);
+}
+
+I2cStatus Ads1115::configure(const Ads1115Config &config)
+{
+    this->config = config;
+
+    return writeRegister(ADS1115_REGISTER_CONFIG, encode(config));
+}
+
+const Ads1115Config& Ads1115::getConfig(void)
+{
+    return config;
+}
+
+I2cStatus Ads1115::startContinuous(Ads1115Mux mux, Ads1115Range range, uint32_t samplesPerSecond)
+{
+    Ads1115DataRate dataRate;
+    if(samplesPerSecond == 0 || !selectDataRate(samplesPerSecond, dataRate))
+    {
+        return i2cRaise(I2C_ERROR_INVALID_PERIOD);
+    }
+
+    channels = {};
+    channels[0].mux = mux;
+    channelCount = 1;
+
+    I2cStatus status = configure({mux, range, dataRate, ADS1115_MODE_CONTINUOUS});
+    if(status != I2C_OK)
+    {
+        return status;
+    }
+
+    return startSampling(samplesPerSecond);
+}
+
+I2cStatus Ads1115::startSequence(const Ads1115Mux *muxes, size_t count, Ads1115Range range, uint32_t samplesPerSecond)
+{
+    if(!muxes || count == 0 || count > channels.size())
+    {
+        return i2cRaise(I2C_ERROR_INVALID_REGISTER);
+    }
+
+    if(samplesPerSecond == 0 || !bus)
+    {
+        return i2cRaise(samplesPerSecond == 0 ? I2C_ERROR_INVALID_PERIOD : I2C_ERROR_NO_BUS);
+    }
+
+    // Slowest (least noisy) rate whose conversion and transactions fit in the slot of a sample.
+    uint32_t slot = HAL_RCC_GetHCLKFreq() / (count * samplesPerSecond);
+    uint32_t transfer = getTransferCycles();
+    uint8_t rate = ADS1115_RATE_8_SPS;
+    while(rate <= ADS1115_RATE_860_SPS && getConversionCycles(static_cast<Ads1115DataRate>(rate)) + transfer > slot)
+    {
+        rate++;
+    }
+
+    if(rate > ADS1115_RATE_860_SPS)
+    {
+        return i2cRaise(I2C_ERROR_INVALID_PERIOD);
+    }
+
+    channels = {};
+    for(size_t i = 0; i < count; i++)
+    {
+        channels[i].mux = muxes[i];
+    }
+    channelCount = count;
+
+    // Power down until the first conversion is started.
+    I2cStatus status = configure({muxes[0], range, static_cast<Ads1115DataRate>(rate), ADS1115_MODE_SINGLE_SHOT});
+    if(status != I2C_OK)
+    {
+        return status;
+    }
+
+    return startSampling(count * samplesPerSecond);
+}
+
+I2cStatus Ads1115::startSampling(uint32_t samplesPerSecond)
+{
+    i2cStartCycleClock();
+
+    slotCycles = HAL_RCC_GetHCLKFreq() / samplesPerSecond;
+    conversionCycles = getConversionCycles(config.dataRate);
+    channel = 0;
+    overruns = 0;
+    sampling = true;
+
+    // The first continuous result is ready one conversion after the config write.
+    slotStart = i2cGetCycles();
+    if(config.mode == ADS1115_MODE_CONTINUOUS)
+    {
+        slotStart += conversionCycles;
+    }
+
+    // A transaction of the previous sampling may still be in flight, it's waited for first.
+    if(state != ADS1115_STATE_STARTING && state != ADS1115_STATE_READING)
+    {
+        state = ADS1115_STATE_WAIT_SLOT;
+    }
+
+    return I2C_OK;
+}
+
+void Ads1115::stop(void)
+{
+    if(state != ADS1115_STATE_STARTING && state != ADS1115_STATE_READING)
+    {
+        state = ADS1115_STATE_IDLE;
+    }
+
+    sampling = false;
+}
+
+bool Ads1115::isSampling(void)
+{
+    return sampling;
+}
+
+void Ads1115::transferComplete(void* parameters)
+{
+    Ads1115 *adc = static_cast<Ads1115*>(parameters);
+
+    adc->transferCycles = i2cGetCycles();
+    adc->transferDone = true;
+}
+
+bool Ads1115::queueTransfer(TransactionDirection direction, uint8_t* data, uint16_t deviceRegister)
+{
+    if(isQueueFull())
+    {
+        return false;
+    }
+
+    I2cTransaction *transaction = emplaceTransaction(direction, data, 2, deviceRegister, REGISTER_8_BITS);
+    if(!transaction)
+    {
+        return false;
+    }
+
+    transaction->setStatusOutput(&transferStatus);
+    transaction->setPostCallback(transferComplete, this);
+    // Only flags the sample, no need to defer it.
+    transaction->setImmediateCallback(true);
+
+    transferDone = false;
+
+    return commitTransaction() == I2C_OK;
+}
+
+void Ads1115::nextSample(void)
+{
+    channel = (channel + 1) % channelCount;
+    slotStart += slotCycles;
+
+    // More than a slot behind: drop the missed slots instead of sampling in a burst.
+    if(static_cast<int32_t>(i2cGetCycles() - slotStart) > static_cast<int32_t>(slotCycles))
+    {
+        slotStart = i2cGetCycles();
+        overruns++;
+    }
+
+    state = ADS1115_STATE_WAIT_SLOT;
+}
+
+void Ads1115::poll(void)
+{
+    switch(state)
+    {
+        case ADS1115_STATE_IDLE:
+            break;
+
+        case ADS1115_STATE_WAIT_SLOT:
+            if(!sampling)
+            {
+                state = ADS1115_STATE_IDLE;
+                break;
+            }
+
+            if(static_cast<int32_t>(i2cGetCycles() - slotStart) < 0)
+                break;
+
+            // Continuous conversions are always ready, single shots are started first.
+            if(config.mode == ADS1115_MODE_CONTINUOUS)
+            {
+                if(queueTransfer(TRANSACTION_RX, resultBuffer, ADS1115_REGISTER_CONVERSION))
+                    state = ADS1115_STATE_READING;
+            }
+            else
+            {
+                Ads1115Config start = config;
+                start.mux = channels[channel].mux;
+
+                uint16_t value = encode(start) | ADS1115_CONFIG_OS;
+                startBuffer[0] = value >> 8;
+                startBuffer[1] = value & 0xFF;
+
+                if(queueTransfer(TRANSACTION_TX, startBuffer, ADS1115_REGISTER_CONFIG))
+                    state = ADS1115_STATE_STARTING;
+            }
+            break;
+
+        case ADS1115_STATE_STARTING:
+            if(!transferDone)
+                break;
+
+            if(!sampling)
+            {
+                state = ADS1115_STATE_IDLE;
+            }
+            else if(transferStatus != I2C_OK)
+            {
+                channels[channel].errors++;
+                nextSample();
+            }
+            else
+            {
+                conversionStart = transferCycles;
+                state = ADS1115_STATE_CONVERTING;
+            }
+            break;
+
+        case ADS1115_STATE_CONVERTING:
+            if(!sampling)
+            {
+                state = ADS1115_STATE_IDLE;
+                break;
+            }
+
+            if(i2cGetCycles() - conversionStart < conversionCycles)
+                break;
+
+            if(queueTransfer(TRANSACTION_RX, resultBuffer, ADS1115_REGISTER_CONVERSION))
+                state = ADS1115_STATE_READING;
+            break;
+
+        case ADS1115_STATE_READING:
+            if(!transferDone)
+                break;
+
+            if(!sampling)
+            {
+                state = ADS1115_STATE_IDLE;
+                break;
+            }
+
+            if(transferStatus != I2C_OK)
+            {
+                channels[channel].errors++;
+            }
+            else
+            {
+                channels[channel].value = static_cast<int16_t>((resultBuffer[0] << 8) | resultBuffer[1]);
+                channels[channel].samples++;
+            }
+
+            nextSample();
+            break;
+    }
+}
+
+const Ads1115Channel* Ads1115::getChannel(size_t index)
+{
+    if(index >= channelCount)
+    {
+        return nullptr;
+    }
+
+    return &channels[index];
+}
+
+uint32_t Ads1115::getOverruns(void)
+{
+    return overruns;
+}
\ No newline at end of file
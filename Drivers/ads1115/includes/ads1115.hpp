@@ -0,0 +1,244 @@
+#pragma once
+
+#include <stdint.h>
+#include <array>
+
+#include "i2c_device.hpp"
+
+#define ADS1115_DEFAULT_ADDRESS 0x48
+
+// Inputs a sequence can go through.
+#ifndef ADS1115_MAX_CHANNELS
+#define ADS1115_MAX_CHANNELS 4
+#endif
+
+/*
+ *  Input multiplexer: differential pairs first, then each input against GND.
+ */
+typedef enum
+{
+    ADS1115_MUX_AIN0_AIN1,
+    ADS1115_MUX_AIN0_AIN3,
+    ADS1115_MUX_AIN1_AIN3,
+    ADS1115_MUX_AIN2_AIN3,
+    ADS1115_MUX_AIN0_GND,
+    ADS1115_MUX_AIN1_GND,
+    ADS1115_MUX_AIN2_GND,
+    ADS1115_MUX_AIN3_GND
+}
+Ads1115Mux;
+
+/*
+ *  Full scale range of the programmable gain amplifier.
+ */
+typedef enum
+{
+    ADS1115_RANGE_6_144V,
+    ADS1115_RANGE_4_096V,
+    ADS1115_RANGE_2_048V,
+    ADS1115_RANGE_1_024V,
+    ADS1115_RANGE_0_512V,
+    ADS1115_RANGE_0_256V
+}
+Ads1115Range;
+
+typedef enum
+{
+    ADS1115_RATE_8_SPS,
+    ADS1115_RATE_16_SPS,
+    ADS1115_RATE_32_SPS,
+    ADS1115_RATE_64_SPS,
+    ADS1115_RATE_128_SPS,
+    ADS1115_RATE_250_SPS,
+    ADS1115_RATE_475_SPS,
+    ADS1115_RATE_860_SPS
+}
+Ads1115DataRate;
+
+typedef enum
+{
+    ADS1115_MODE_CONTINUOUS,
+    ADS1115_MODE_SINGLE_SHOT
+}
+Ads1115Mode;
+
+/*
+ *  Contents of the config register. The comparator is always left disabled.
+ */
+typedef struct
+{
+    Ads1115Mux mux;
+    Ads1115Range range;
+    Ads1115DataRate dataRate;
+    Ads1115Mode mode;
+}
+Ads1115Config;
+
+/*
+ *  value: last conversion result of the channel.
+ *  samples: results read since the sampling started.
+ *  errors: samples lost to a failed transaction.
+ */
+typedef struct
+{
+    Ads1115Mux mux;
+    int16_t value;
+    uint32_t samples;
+    uint32_t errors;
+}
+Ads1115Channel;
+
+typedef enum
+{
+    ADS1115_STATE_IDLE,
+    // Waiting for the slot of the next sample.
+    ADS1115_STATE_WAIT_SLOT,
+    // Single shot conversion being started.
+    ADS1115_STATE_STARTING,
+    ADS1115_STATE_CONVERTING,
+    ADS1115_STATE_READING
+}
+Ads1115State;
+
+/*
+ *  @brief ADS1115 16 bit ADC.
+ *
+ *  Samples one input continuously or a sequence of inputs, paced to a target rate per channel by
+ *  poll() from the main loop. A single input runs in continuous conversion mode and costs one read
+ *  per sample. A sequence runs single shot conversions: one write selects the input and starts the
+ *  conversion, one read fetches the result once the conversion time has elapsed.
+ *
+ *  The config register is shadowed (see I2cRegisterShadow), so configure() only writes what
+ *  changed. Timing uses the cycle clock (see i2cSetCycleClock).
+ */
+class Ads1115 : public I2cDevice
+{
+    protected:
+        I2cRegisterShadow configShadow;
+
+        Ads1115Config config = {ADS1115_MUX_AIN0_AIN1, ADS1115_RANGE_2_048V, ADS1115_RATE_128_SPS, ADS1115_MODE_SINGLE_SHOT};
+
+        std::array<Ads1115Channel, ADS1115_MAX_CHANNELS> channels = {};
+
+        size_t channelCount = 0;
+
+        bool sampling = false;
+
+        // Channel of the sample in progress.
+        size_t channel = 0;
+
+        Ads1115State state = ADS1115_STATE_IDLE;
+
+        // Cycles between samples, and between the start of a conversion and its result.
+        uint32_t slotCycles = 0;
+        uint32_t conversionCycles = 0;
+
+        // Cycle clock when the current sample is due, and when its conversion started.
+        uint32_t slotStart = 0;
+        uint32_t conversionStart = 0;
+
+        // Samples started late by more than a slot, the pace restarts from them.
+        uint32_t overruns = 0;
+
+        uint8_t startBuffer[2] = {};
+        uint8_t resultBuffer[2] = {};
+
+        // Written by the completion callback of the transaction in flight.
+        volatile bool transferDone = false;
+        volatile uint32_t transferCycles = 0;
+        I2cStatus transferStatus = I2C_OK;
+
+        static void transferComplete(void* parameters);
+
+        static uint16_t encode(const Ads1115Config &config);
+
+        /*
+         *  @brief Worst case cycles of a conversion at the data rate, with the tolerance of the
+         *  internal oscillator.
+         */
+        static uint32_t getConversionCycles(Ads1115DataRate dataRate);
+
+        /*
+         *  @brief Cycles the bus takes for the transactions of one sample.
+         */
+        uint32_t getTransferCycles(void);
+
+        /*
+         *  @brief Queues a transaction whose completion is reported through transferDone.
+         *
+         *  @return False if the bus queue is full, the sample is retried on the next poll().
+         */
+        bool queueTransfer(TransactionDirection direction, uint8_t* data, uint16_t deviceRegister);
+
+        /*
+         *  @brief Starts pacing the samples of the channels, samplesPerSecond in total.
+         */
+        I2cStatus startSampling(uint32_t samplesPerSecond);
+
+        void nextSample(void);
+
+    public:
+        Ads1115(I2cBus *bus, uint16_t address = ADS1115_DEFAULT_ADDRESS, const char* name = "ADS1115");
+
+        /*
+         *  @brief Writes the config register, unless it already holds the configuration. Doesn't
+         *  start a single shot conversion.
+         *
+         *  @throws I2cException: If the device has no bus or the bus queue is full (only when
+         *  built with exceptions, the status is returned otherwise).
+         */
+        I2cStatus configure(const Ads1115Config &config);
+
+        const Ads1115Config& getConfig(void);
+
+        /*
+         *  @brief Samples the input continuously at samplesPerSecond, from the slowest data rate
+         *  that keeps up with it.
+         *
+         *  @throws I2cException: If the ADS1115 can't convert that fast or configure() fails (only
+         *  when built with exceptions, the status is returned otherwise).
+         */
+        I2cStatus startContinuous(Ads1115Mux mux, Ads1115Range range, uint32_t samplesPerSecond);
+
+        /*
+         *  @brief Samples the inputs in turn, each one at samplesPerSecond, from the slowest data
+         *  rate whose conversions and transactions fit in the slot of a sample.
+         *
+         *  @throws I2cException: If there are no inputs or more than ADS1115_MAX_CHANNELS, the
+         *  ADS1115 can't convert that fast or configure() fails (only when built with exceptions,
+         *  the status is returned otherwise).
+         */
+        I2cStatus startSequence(const Ads1115Mux *muxes, size_t count, Ads1115Range range, uint32_t samplesPerSecond);
+
+        /*
+         *  @brief Stops sampling once the transaction in flight, if any, completes.
+         */
+        void stop(void);
+
+        /*
+         *  @brief Advances the sampling, from the main loop. Never throws.
+         */
+        void poll(void);
+
+        bool isSampling(void);
+
+        /*
+         *  @return nullptr if there's no channel with the index.
+         */
+        const Ads1115Channel* getChannel(size_t index);
+
+        uint32_t getOverruns(void);
+
+        /*
+         *  @brief Converts a result to microvolts at the full scale range.
+         */
+        static int32_t toMicrovolts(int16_t value, Ads1115Range range);
+
+        /*
+         *  @brief Returns the slowest data rate with at least conversionsPerSecond, also with the
+         *  internal oscillator 10% slow.
+         *
+         *  @return False if even the fastest one is too slow.
+         */
+        static bool selectDataRate(uint32_t conversionsPerSecond, Ads1115DataRate &dataRate);
+};
\ No newline at end of file
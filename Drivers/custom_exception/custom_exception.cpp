@@ -1,12 +1,12 @@
 #include "custom_exception.hpp"
 
 
-CustomException::CustomException(const std::string& msg) : message(msg)
+CustomException::CustomException(const char* msg) : message(msg)
 {
 
 }
 
 const char* CustomException::what() const noexcept
 {
-    return message.c_str();
+    return message;
 }
\ No newline at end of file
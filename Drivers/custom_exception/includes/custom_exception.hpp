@@ -1,14 +1,17 @@
 #pragma once
 
 #include <exception>
-#include <string>
 
 class CustomException : public std::exception
 {
     protected:
-        std::string message = "An exception has occurred";
+        // Not copied: throwing must not allocate from the heap.
+        const char* message = "An exception has occurred";
     public:
-        explicit CustomException(const std::string& msg);
+        /*
+         *  @param msg String with static storage duration, e.g. a literal that stays in flash.
+         */
+        explicit CustomException(const char* msg);
 
         const char* what() const noexcept override;
 };
\ No newline at end of file
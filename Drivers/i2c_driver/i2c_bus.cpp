@@ -1,10 +1,12 @@
 #include "i2c_bus.hpp"
 
-#include <algorithm>
-
+#include "i2c_device.hpp"
 #include "stm32f4xx_it.h"
 
-#define I2C_FAST_MODE_CUTOFF_FREQUENCY 100000
+#define I2C_DMA_MINIMUM_BYTES 2
+
+// A slave can be holding SDA for at most the 8 bits left of a byte plus its ACK.
+#define I2C_RECOVERY_PULSES 9
 
 
 // Initialize with empty drivers array.
@@ -15,54 +17,643 @@ I2C_HandleTypeDef* I2cBus::getHandle(void)
     return &handle;
 }
 
-void I2cBus::transactionCompleteCallback(I2C_HandleTypeDef *handle)
+const char* I2cBus::getName(void)
+{
+    return name.c_str();
+}
+
+I2cBus* I2cBus::getBus(I2C_HandleTypeDef *handle)
+{
+    return reinterpret_cast<I2cBus*>(
+        reinterpret_cast<uint8_t*>(handle) - offsetof(I2cBus, handle)
+    );
+}
+
+void I2cBus::transactionCompleteCallback(I2C_HandleTypeDef *handle)
+{
+    I2cBus *bus = getBus(handle);
+    (bus->*bus->completeFunction)();
+}
+
+void I2cBus::directTransferCallback(I2cDirectResult result)
+{
+    if(result == I2C_DIRECT_COMPLETE)
+    {
+        (this->*completeFunction)();
+    }
+    else if(result == I2C_DIRECT_FAILED)
+    {
+        failTransaction(classifyError(directTransfer.getError()));
+    }
+}
+
+void I2cBus::transactionErrorCallback(I2C_HandleTypeDef *handle)
+{
+    I2cBus* bus = getBus(handle);
+
+    // In slave mode every error is one of a host transfer.
+    if(bus->registerFile)
+    {
+        bus->registerFile->transferEnded(handle, HAL_I2C_GetError(handle));
+        bus->listen();
+        return;
+    }
+
+    bus->failTransaction(classifyError(HAL_I2C_GetError(handle)));
+}
+
+void I2cBus::slaveAddressCallback(I2C_HandleTypeDef *handle, uint8_t direction, uint16_t addressMatchCode)
+{
+    (void)addressMatchCode;
+
+    I2cBus* bus = getBus(handle);
+    if(bus->registerFile)
+    {
+        bus->registerFile->addressMatched(handle, direction);
+    }
+}
+
+void I2cBus::slaveReceiveCallback(I2C_HandleTypeDef *handle)
+{
+    I2cBus* bus = getBus(handle);
+    if(bus->registerFile)
+    {
+        bus->registerFile->receiveComplete(handle);
+    }
+}
+
+void I2cBus::slaveTransmitCallback(I2C_HandleTypeDef *handle)
+{
+    I2cBus* bus = getBus(handle);
+    if(bus->registerFile)
+    {
+        bus->registerFile->transmitComplete(handle);
+    }
+}
+
+void I2cBus::listenCompleteCallback(I2C_HandleTypeDef *handle)
+{
+    I2cBus* bus = getBus(handle);
+    if(bus->registerFile)
+    {
+        bus->registerFile->transferEnded(handle, HAL_I2C_ERROR_NONE);
+        bus->listen();
+    }
+}
+
+I2cStatus I2cBus::listen(void)
+{
+    if(HAL_I2C_GetState(&handle) == HAL_I2C_STATE_LISTEN)
+    {
+        HAL_I2C_DisableListen_IT(&handle);
+    }
+
+    if(HAL_I2C_EnableListen_IT(&handle) != HAL_OK)
+    {
+        return I2C_ERROR_HAL;
+    }
+
+    return I2C_OK;
+}
+
+I2cStatus I2cBus::setRegisterFile(I2cRegisterFile *registerFile)
+{
+    if(masterOnly)
+    {
+        return i2cRaise(I2C_ERROR_MASTER_ONLY);
+    }
+
+    if(registerFile && registerFile->getStatus() != I2C_OK)
+    {
+        return i2cRaise(registerFile->getStatus());
+    }
+
+    if(currentTransaction != nullptr)
+    {
+        return i2cRaise(I2C_ERROR_BUS_IN_USE);
+    }
+
+    uint32_t mask = i2cMaskInterrupts();
+
+    // A host transfer in progress is cut short, the peripheral stops acknowledging right away.
+    if(this->registerFile)
+    {
+        this->registerFile->reset();
+        HAL_I2C_DeInit(&handle);
+        if(HAL_I2C_Init(&handle) != HAL_OK || registerCallbacks() != I2C_OK)
+        {
+            this->registerFile = nullptr;
+            i2cRestoreInterrupts(mask);
+            return i2cRaise(I2C_ERROR_HAL);
+        }
+    }
+
+    this->registerFile = registerFile;
+
+    I2cStatus listenStatus = I2C_OK;
+    if(registerFile)
+    {
+        registerFile->reset();
+        listenStatus = listen();
+    }
+
+    i2cRestoreInterrupts(mask);
+
+    return i2cRaise(listenStatus);
+}
+
+I2cRegisterFile* I2cBus::getRegisterFile(void)
+{
+    return registerFile;
+}
+
+I2cStatus I2cBus::classifyError(uint32_t halError)
+{
+    // A bus error or a lost arbitration aborts the byte in flight, check them before the rest.
+    if(halError & HAL_I2C_ERROR_BERR)
+        return I2C_ERROR_BUS_FAULT;
+
+    if(halError & HAL_I2C_ERROR_ARLO)
+        return I2C_ERROR_ARBITRATION_LOST;
+
+    if(halError & HAL_I2C_ERROR_AF)
+        return I2C_ERROR_NACK;
+
+    if(halError & HAL_I2C_ERROR_OVR)
+        return I2C_ERROR_OVERRUN;
+
+    if(halError & HAL_I2C_ERROR_TIMEOUT)
+        return I2C_ERROR_TIMEOUT;
+
+    return I2C_ERROR_HAL;
+}
+
+void I2cBus::failTransaction(I2cStatus status)
+{
+    // Clocking SCL by hand takes far too long for an interrupt: the failed transaction holds the
+    // bus until runRecovery() recovers it from the main loop (or PendSV) and completes it.
+    if(status != I2C_ERROR_NACK)
+    {
+        recoveryError = status;
+        recoveryPending = true;
+
+#ifndef I2C_DRIVER_HOST_SIM
+        if(completionsPendSv)
+        {
+            SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+        }
+#endif
+        return;
+    }
+
+    finishFailure(status);
+}
+
+bool I2cBus::runRecovery(void)
+{
+    if(!recoveryPending)
+    {
+        return false;
+    }
+
+    // Masked like the transfers it interrupts, the bus interrupts must not see it half done.
+    uint32_t mask = i2cMaskInterrupts();
+
+    I2cStatus status = recoverBus();
+    if(status == I2C_OK)
+    {
+        status = recoveryError;
+    }
+
+    recoveryPending = false;
+    finishFailure(status);
+
+    i2cRestoreInterrupts(mask);
+
+    return true;
+}
+
+void I2cBus::finishFailure(I2cStatus status)
+{
+    I2cTransaction *transaction = currentTransaction;
+    if(!transaction)
+    {
+        sendNextTransaction();
+        return;
+    }
+
+    // Their first attempt was spent on the burst, so the reads are never merged again: each one
+    // goes out on its own, under the retry policy of its device.
+    if(burstReads)
+    {
+        burstReads = 0;
+        currentTransaction = nullptr;
+        sendNextTransaction();
+        return;
+    }
+
+    // A busy device: try again after the backoff, the other devices keep the bus meanwhile.
+    if(status == I2C_ERROR_NACK && retryTransaction(*transaction))
+    {
+        sendNextTransaction();
+        return;
+    }
+
+    transaction->finish(status);
+
+    // The bus was released, the rest of a broken sequence can't follow.
+    I2cStatus sequenceStatus = transaction->continuesSequence() ? status : I2C_OK;
+
+    bool immediate;
+    I2cCompletion completion = releaseTransaction(immediate);
+
+    sendNextTransaction(sequenceStatus);
+    deliverCompletion(completion, immediate);
+}
+
+bool I2cBus::retryTransaction(I2cTransaction &transaction)
+{
+    I2cDevice *device = transaction.getDevice();
+    if(!device || transaction.getSequenceFrame() != I2C_FRAME_SINGLE)
+    {
+        return false;
+    }
+
+    const I2cRetryPolicy &policy = device->getRetryPolicy();
+    if(transaction.getAttempts() >= policy.maxAttempts)
+    {
+        return false;
+    }
+
+    I2cRetrySlot *slot = nullptr;
+    if(!currentQueue)
+    {
+        // Already a retry, it keeps its slot.
+        slot = reinterpret_cast<I2cRetrySlot*>(reinterpret_cast<uint8_t*>(&transaction) - offsetof(I2cRetrySlot, transaction));
+    }
+    else
+    {
+        for(I2cRetrySlot &retry : retries)
+        {
+            if(!retry.used)
+            {
+                slot = &retry;
+                break;
+            }
+        }
+
+        if(!slot)
+        {
+            return false;
+        }
+
+        slot->transaction = transaction;
+        slot->origin = currentQueue->holdsReferences() ? &transaction : nullptr;
+        slot->used = true;
+        currentQueue->pop();
+    }
+
+    slot->dueTick = HAL_GetTick() + policy.backoffMs;
+    currentTransaction = nullptr;
+
+    return true;
+}
+
+I2cTransaction* I2cBus::takeDueRetry(void)
+{
+    uint32_t now = HAL_GetTick();
+    I2cRetrySlot *due = nullptr;
+
+    for(I2cRetrySlot &retry : retries)
+    {
+        // Signed difference, correct across a wrap of the tick.
+        int32_t late = static_cast<int32_t>(now - retry.dueTick);
+        if(retry.used && late >= 0 && (!due || late > static_cast<int32_t>(now - due->dueTick)))
+            due = &retry;
+    }
+
+    return due ? &due->transaction : nullptr;
+}
+
+I2cStatus I2cBus::recoverBus(void)
+{
+#if I2C_DRIVER_STATS
+    uint32_t startCycles = i2cGetCycles();
+#endif
+
+    if(dmaEnabled)
+    {
+        if(HAL_DMA_GetState(&dmaRxHandle) == HAL_DMA_STATE_BUSY)
+            HAL_DMA_Abort(&dmaRxHandle);
+        if(HAL_DMA_GetState(&dmaTxHandle) == HAL_DMA_STATE_BUSY)
+            HAL_DMA_Abort(&dmaTxHandle);
+    }
+
+    directTransfer.reset();
+    HAL_I2C_DeInit(&handle);
+
+    bool released = releaseBus();
+    initGpio();
+
+    // Initializing from the reset state also resets the callbacks to the HAL defaults.
+    I2cStatus recoveryStatus = I2C_ERROR_HAL;
+    if(HAL_I2C_Init(&handle) == HAL_OK)
+    {
+        recoveryStatus = registerCallbacks();
+    }
+
+#if I2C_DRIVER_STATS
+    recoveryStats.record(i2cGetCycles() - startCycles);
+#endif
+
+    if(recoveryStatus == I2C_OK && !released)
+    {
+        recoveryStatus = I2C_ERROR_BUS_STUCK;
+    }
+
+    return recoveryStatus;
+}
+
+bool I2cBus::releaseBus(void)
+{
+    const I2cBusConfig &config = getConfig();
+    GPIO_TypeDef *sclPort = reinterpret_cast<GPIO_TypeDef*>(config.sclPort);
+    GPIO_TypeDef *sdaPort = reinterpret_cast<GPIO_TypeDef*>(config.sdaPort);
+
+    // Released (high) before switching to GPIO, so no edge is generated.
+    HAL_GPIO_WritePin(sclPort, config.sclPin, GPIO_PIN_SET);
+    HAL_GPIO_WritePin(sdaPort, config.sdaPin, GPIO_PIN_SET);
+
+    GPIO_InitTypeDef GPIO_InitStruct = {
+        .Pin = config.sclPin,
+        .Mode = GPIO_MODE_OUTPUT_OD,
+        .Pull = GPIO_NOPULL,
+        .Speed = GPIO_SPEED_FREQ_VERY_HIGH,
+        .Alternate = 0
+    };
+
+    HAL_GPIO_Init(sclPort, &GPIO_InitStruct);
+
+    GPIO_InitStruct.Pin = config.sdaPin;
+    HAL_GPIO_Init(sdaPort, &GPIO_InitStruct);
+
+    waitHalfBit();
+
+    for(uint8_t pulse = 0; pulse < I2C_RECOVERY_PULSES && HAL_GPIO_ReadPin(sdaPort, config.sdaPin) == GPIO_PIN_RESET; pulse++)
+    {
+        HAL_GPIO_WritePin(sclPort, config.sclPin, GPIO_PIN_RESET);
+        waitHalfBit();
+        HAL_GPIO_WritePin(sclPort, config.sclPin, GPIO_PIN_SET);
+        waitHalfBit();
+    }
+
+    // STOP: SDA rising while SCL is high.
+    HAL_GPIO_WritePin(sclPort, config.sclPin, GPIO_PIN_RESET);
+    waitHalfBit();
+    HAL_GPIO_WritePin(sdaPort, config.sdaPin, GPIO_PIN_RESET);
+    waitHalfBit();
+    HAL_GPIO_WritePin(sclPort, config.sclPin, GPIO_PIN_SET);
+    waitHalfBit();
+    HAL_GPIO_WritePin(sdaPort, config.sdaPin, GPIO_PIN_SET);
+    waitHalfBit();
+
+    return HAL_GPIO_ReadPin(sdaPort, config.sdaPin) == GPIO_PIN_SET;
+}
+
+void I2cBus::waitHalfBit(void)
+{
+#ifndef I2C_DRIVER_HOST_SIM
+    // About 4 cycles per iteration. Erring long only slows the recovery down.
+    for(volatile uint32_t loops = SystemCoreClock / (8 * timing.sclFrequency); loops > 0; loops--);
+#endif
+}
+
+bool I2cBus::checkTimeout(void)
+{
+    if(timeout == 0)
+    {
+        return false;
+    }
+
+    // The transfer may still complete while we look at it.
+    uint32_t mask = i2cMaskInterrupts();
+
+    // A failed transfer waiting for its recovery holds the bus, it has not stalled.
+    bool stalled = currentTransaction != nullptr && !recoveryPending && HAL_GetTick() - transferStartTick >= timeout;
+    if(stalled)
+    {
+        failTransaction(I2C_ERROR_TIMEOUT);
+    }
+
+    i2cRestoreInterrupts(mask);
+
+    if(stalled)
+    {
+        runRecovery();
+    }
+
+    return stalled;
+}
+
+void I2cBus::poll(void)
+{
+    if(runRecovery() || checkTimeout())
+    {
+        return;
+    }
+
+    uint32_t mask = i2cMaskInterrupts();
+
+    if(currentTransaction == nullptr)
+    {
+        sendNextTransaction();
+    }
+
+    i2cRestoreInterrupts(mask);
+}
+
+void I2cBus::setTimeout(uint32_t milliseconds)
+{
+    timeout = milliseconds;
+}
+
+void I2cBus::startAttempt(I2cTransaction &transaction)
+{
+    // Retries reuse what the pre-transaction callback prepared for the first attempt.
+    if(transaction.getAttempts() == 0)
+        transaction.preCallback();
+
+    transaction.addAttempt();
+
+#if I2C_DRIVER_STATS
+    transaction.startedCycles = i2cGetCycles();
+#endif
+}
+
+bool I2cBus::isCoalescable(I2cTransaction &transaction, uint8_t registerWidth)
+{
+    return transaction.getDirection() == TRANSACTION_RX &&
+           transaction.getRegisterBytes() != REGISTER_NULL &&
+           transaction.getSequenceFrame() == I2C_FRAME_SINGLE &&
+           transaction.getAttempts() == 0 &&
+           transaction.getDataLenthBytes() != 0 &&
+           transaction.getDataLenthBytes() % registerWidth == 0;
+}
+
+uint8_t I2cBus::getBurstRegisterWidth(I2cTransaction &transaction)
+{
+    I2cDevice *device = transaction.getDevice();
+    uint8_t registerWidth = device ? device->getCoalescingWidth() : 0;
+    if(registerWidth == 0 || !isCoalescable(transaction, registerWidth))
+    {
+        return 0;
+    }
+
+    return registerWidth;
+}
+
+void I2cBus::deliverCompletion(I2cCompletion completion, bool immediate)
+{
+    if(!completion)
+    {
+        return;
+    }
+
+    if(immediate || !completions || !completions->enqueue(completion))
+    {
+        completion();
+        return;
+    }
+
+#ifndef I2C_DRIVER_HOST_SIM
+    if(completionsPendSv)
+    {
+        SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+    }
+#endif
+}
+
+size_t I2cBus::runCompletions(void)
 {
-    // Get the bus object
-    I2cBus* bus = reinterpret_cast<I2cBus*>(
-        reinterpret_cast<uint8_t*>(handle) - offsetof(I2cBus, handle)
-    );
+    if(!completions)
+    {
+        return 0;
+    }
 
-    // Dequeues and calls the post-transaction callback once it's complete.
-    I2cTransaction transaction = bus->queue->dequeue();
-    transaction.postCallback();    
+    size_t count = 0;
+    I2cCompletion completion;
+    while(completions->dequeue(completion))
+    {
+        completion();
+        count++;
+    }
 
-    bus->sendNextTransaction();
+    return count;
 }
 
-void I2cBus::sendNextTransaction(void)
+size_t I2cBus::runPendSvCompletions(void)
 {
-    currentTransaction = queue->peek();
-    if(!currentTransaction)
+    size_t count = 0;
+    for(I2cBus *driver : drivers)
     {
-        return;
+        // The others are drained by the main loop, their queue has a single consumer.
+        if(driver && driver->completionsPendSv)
+        {
+            driver->runRecovery();
+            count += driver->runCompletions();
+        }
     }
 
-    currentTransaction->preCallback();
+    return count;
+}
+
+Queue<I2cTransaction>* I2cBus::getQueue(I2cPriority priority)
+{
+    if(priority >= I2C_PRIORITY_CLASSES)
+    {
+        return nullptr;
+    }
 
-    sendTransaction(*currentTransaction);
+    return queues[priority];
 }
 
-void I2cBus::sendTransaction(I2cTransaction &transaction)
+I2cStatus I2cBus::sendTransaction(I2cTransaction &transaction)
 {
+    if(registerFile)
+    {
+        return I2C_ERROR_SLAVE_MODE;
+    }
+
+    I2cTransferMode mode = resolveTransferMode(transaction);
+    if(mode == I2C_TRANSFER_DIRECT)
+    {
+        return directTransfer.start(handle.Instance, transaction);
+    }
+
     HAL_StatusTypeDef error;
     TransactionDirection direction = transaction.getDirection();
+    bool useDma = mode == I2C_TRANSFER_DMA;
 
     uint16_t address = transaction.getAddress();
     uint8_t* data = transaction.getDataPointer();
     uint16_t dataSize = transaction.getDataLenthBytes();
-    uint8_t deviceRegister = transaction.getRegister();
+    uint16_t deviceRegister = transaction.getRegister();
     RegisterLength deviceRegisterBytes = transaction.getRegisterBytes();
+    I2cSequenceFrame sequenceFrame = transaction.getSequenceFrame();
+
+    if(sequenceFrame != I2C_FRAME_SINGLE)
+    {
+        if(deviceRegisterBytes != REGISTER_NULL)
+        {
+            return I2C_ERROR_INVALID_REGISTER;
+        }
+
+        uint32_t options;
+        switch(sequenceFrame)
+        {
+            case I2C_FRAME_FIRST:
+                options = I2C_FIRST_FRAME;
+                break;
+            case I2C_FRAME_NEXT:
+                options = I2C_NEXT_FRAME;
+                break;
+            default:
+                options = I2C_LAST_FRAME;
+                break;
+        }
 
-    if(deviceRegisterBytes != REGISTER_NULL)
+        switch(direction)
+        {
+            case TRANSACTION_RX:
+                if(useDma)
+                    error = HAL_I2C_Master_Seq_Receive_DMA(&handle, address << 1, data, dataSize, options);
+                else
+                    error = HAL_I2C_Master_Seq_Receive_IT(&handle, address << 1, data, dataSize, options);
+                break;
+            case TRANSACTION_TX:
+                if(useDma)
+                    error = HAL_I2C_Master_Seq_Transmit_DMA(&handle, address << 1, data, dataSize, options);
+                else
+                    error = HAL_I2C_Master_Seq_Transmit_IT(&handle, address << 1, data, dataSize, options);
+                break;
+        }
+    }
+    else if(deviceRegisterBytes != REGISTER_NULL)
     {
         uint8_t deviceRegisterSize = (deviceRegisterBytes == REGISTER_8_BITS ? I2C_MEMADD_SIZE_8BIT : I2C_MEMADD_SIZE_16BIT);
         switch(direction)
         {
             case TRANSACTION_RX:
-                error = HAL_I2C_Mem_Read_IT(&handle, address << 1, deviceRegister, deviceRegisterSize, data, dataSize);
+                if(useDma)
+                    error = HAL_I2C_Mem_Read_DMA(&handle, address << 1, deviceRegister, deviceRegisterSize, data, dataSize);
+                else
+                    error = HAL_I2C_Mem_Read_IT(&handle, address << 1, deviceRegister, deviceRegisterSize, data, dataSize);
                 break;
             case TRANSACTION_TX:
-                error = HAL_I2C_Mem_Write_IT(&handle, address << 1, deviceRegister, deviceRegisterSize, data, dataSize);
+                if(useDma)
+                    error = HAL_I2C_Mem_Write_DMA(&handle, address << 1, deviceRegister, deviceRegisterSize, data, dataSize);
+                else
+                    error = HAL_I2C_Mem_Write_IT(&handle, address << 1, deviceRegister, deviceRegisterSize, data, dataSize);
                 break;
         }
     }
@@ -71,49 +662,172 @@ void I2cBus::sendTransaction(I2cTransaction &transaction)
         switch(direction)
         {
             case TRANSACTION_RX:
-                error = HAL_I2C_Master_Receive_IT(&handle, address << 1, data, dataSize);
+                if(useDma)
+                    error = HAL_I2C_Master_Receive_DMA(&handle, address << 1, data, dataSize);
+                else
+                    error = HAL_I2C_Master_Receive_IT(&handle, address << 1, data, dataSize);
                 break;
             case TRANSACTION_TX:
-                error = HAL_I2C_Master_Transmit_IT(&handle, address << 1, data, dataSize);
+                if(useDma)
+                    error = HAL_I2C_Master_Transmit_DMA(&handle, address << 1, data, dataSize);
+                else
+                    error = HAL_I2C_Master_Transmit_IT(&handle, address << 1, data, dataSize);
                 break;
         }
     }
 
     if(error != HAL_OK)
     {
-        throw I2cException("There was an error setting up the transaction.");
+        return I2C_ERROR_HAL;
     }
+
+    return I2C_OK;
 }
 
-void I2cBus::setTransaction(I2cTransaction &transaction)
+I2cTransferMode I2cBus::resolveTransferMode(I2cTransaction &transaction)
 {
-    queue->enqueue(transaction);
+    I2cTransferMode mode = transaction.getTransferMode();
+    if(mode == I2C_TRANSFER_DEFAULT)
+    {
+        mode = transferMode;
+    }
 
-    if(queue->size() == 1 && HAL_I2C_GetState(&handle) == HAL_I2C_STATE_READY)
+    // A single byte completes with one event interrupt anyway, DMA only adds the stream setup.
+    if(mode == I2C_TRANSFER_DMA && (!dmaEnabled || transaction.getDataLenthBytes() < I2C_DMA_MINIMUM_BYTES))
     {
-        sendNextTransaction();
+        mode = I2C_TRANSFER_INTERRUPT;
+    }
+
+    // The direct engine only runs single 7 bit master transfers, and reads of at least a byte.
+    if(mode == I2C_TRANSFER_DIRECT && (
+        handle.Init.AddressingMode != I2C_ADDRESSINGMODE_7BIT ||
+        transaction.getSequenceFrame() != I2C_FRAME_SINGLE ||
+        (transaction.getDirection() == TRANSACTION_RX && transaction.getDataLenthBytes() == 0)))
+    {
+        mode = I2C_TRANSFER_INTERRUPT;
+    }
+
+    return mode;
+}
+
+I2cStatus I2cBus::setTransaction(I2cTransaction &transaction)
+{
+    return setTransactions(&transaction, 1);
+}
+
+I2cStatus I2cBus::setTransactions(I2cTransaction *transactions, size_t count)
+{
+    return i2cRaise(queueTransactions(transactions, count));
+}
+
+I2cStatus I2cBus::queueTransactions(I2cTransaction *transactions, size_t count)
+{
+    Queue<I2cTransaction> *classQueue = getQueue(transactions[0].getPriority());
+    if(!classQueue)
+    {
+        return I2C_ERROR_INVALID_PRIORITY;
+    }
+
+    // The periodic timer queues from its interrupt too: only one of us may find the bus idle and start it.
+    uint32_t mask = i2cMaskInterrupts();
+
+    // All or nothing: a sequence must never be queued partially.
+    bool fits = classQueue->capacity() - classQueue->size() >= count;
+    if(fits)
+    {
+        for(size_t i = 0; i < count; i++)
+        {
+#if I2C_DRIVER_STATS
+            transactions[i].queuedCycles = i2cGetCycles();
+#endif
+            // A transaction queued again by reference starts over.
+            transactions[i].resetAttempts();
+            classQueue->link(transactions[i]);
+        }
+
+        // Idle bus: nothing in flight that would pick the new transactions up on completion.
+        if(currentTransaction == nullptr)
+        {
+            sendNextTransaction();
+        }
+    }
+
+    i2cRestoreInterrupts(mask);
+
+    return fits ? I2C_OK : I2C_ERROR_QUEUE_FULL;
+}
+
+I2cTransaction* I2cBus::acquireTransaction(I2cPriority priority, I2cStatus &status)
+{
+    Queue<I2cTransaction> *classQueue = getQueue(priority);
+    if(!classQueue)
+    {
+        status = I2C_ERROR_INVALID_PRIORITY;
+        return nullptr;
+    }
+
+    // Masked until the slot is published: a producer in an interrupt would get the same slot.
+    uint32_t mask = i2cMaskInterrupts();
+
+    I2cTransaction *transaction = classQueue->acquire();
+    if(!transaction)
+    {
+        i2cRestoreInterrupts(mask);
+
+        status = classQueue->holdsReferences() ? I2C_ERROR_REFERENCE_QUEUE : I2C_ERROR_QUEUE_FULL;
+        return nullptr;
     }
+
+    acquireMask = mask;
+    acquired = true;
+    status = I2C_OK;
+
+    return transaction;
 }
 
-void I2cBus::handleInterrupt(I2cBusSelection bus, I2cInterruptType type)
+I2cStatus I2cBus::publishTransaction(I2cPriority priority)
 {
-    I2cBus *driver = I2cBus::drivers[bus];
-    if(driver)
+    uint32_t mask = acquired ? acquireMask : i2cMaskInterrupts();
+    acquired = false;
+
+    I2cStatus result = I2C_OK;
+    Queue<I2cTransaction> *classQueue = getQueue(priority);
+    // Acquiring again returns the same slot until it is published.
+    I2cTransaction *transaction = classQueue ? classQueue->acquire() : nullptr;
+
+    if(!classQueue)
+    {
+        result = I2C_ERROR_INVALID_PRIORITY;
+    }
+    else if(!transaction)
+    {
+        result = classQueue->holdsReferences() ? I2C_ERROR_REFERENCE_QUEUE : I2C_ERROR_QUEUE_FULL;
+    }
+    else if(transaction->getStatus() != I2C_OK)
     {
-        switch(type)
+        result = transaction->getStatus();
+    }
+    else
+    {
+#if I2C_DRIVER_STATS
+        transaction->queuedCycles = i2cGetCycles();
+#endif
+
+        classQueue->publish();
+
+        if(currentTransaction == nullptr)
         {
-        case I2C_EVENT:
-            HAL_I2C_EV_IRQHandler(&driver->handle);
-            break;
-        case I2C_ERROR:
-            HAL_I2C_ER_IRQHandler(&driver->handle);
-            break;
+            sendNextTransaction();
         }
     }
+
+    i2cRestoreInterrupts(mask);
+
+    return result;
 }
 
 I2cBus::I2cBus(
-    std::string name,
+    const char* name,
     Queue<I2cTransaction> *queue,
     I2cBusSelection bus,
     uint32_t clockSpeed,
@@ -124,34 +838,259 @@ I2cBus::I2cBus(
     uint16_t ownAddress1,
     uint16_t ownAddress2,
     bool clockStretching,
-    bool generalCall
-) : name(name), queue(queue), bus(bus)
+    bool generalCall,
+    I2cTransferMode transferMode
+) : queue(queue), bus(bus), transferMode(transferMode), masterOnly(masterOnly), name(name)
 {
-    registerDriver(bus);
+    queues.fill(queue);
 
-    if(clockSpeed <= I2C_FAST_MODE_CUTOFF_FREQUENCY)
+    status = registerDriver(bus);
+    if(status != I2C_OK)
     {
-        this->fastMode = false;
+        i2cRaise(status);
+        return;
     }
 
     if(masterOnly)
     {
-        clockStretching = false;
+        // Only applies to slave mode, left at its reset value.
+        clockStretching = true;
         generalCall = false;
         dualAddress = false;
         ownAddress1 = 0x0;
         ownAddress2 = 0x0;
     }
 
-    if(!masterOnly)
+    if(!masterOnly && !areAddressesValid(ownAddress1, ownAddress2, dualAddress, addressing7Bit))
     {
-        areAddressesValid(ownAddress1, ownAddress2, dualAddress, addressing7Bit);
+        status = I2C_ERROR_INVALID_ADDRESS;
     }
 
-    initHandle(clockSpeed, addressing7Bit, dutyCycle, dualAddress, generalCall, clockStretching, ownAddress1, ownAddress2);
+    if(status == I2C_OK)
+    {
+        status = i2cComputeTiming(HAL_RCC_GetPCLK1Freq(), clockSpeed, dutyCycle, timing);
+    }
 
-    initGpio();
-    initNvic();
+    if(status == I2C_OK)
+    {
+        status = initHandle(clockSpeed, addressing7Bit, dutyCycle, generalCall, clockStretching, dualAddress, ownAddress1, ownAddress2);
+    }
+
+    if(status == I2C_OK)
+    {
+        initGpio();
+        initNvic();
+
+#if I2C_DRIVER_STATS
+        i2cStartCycleClock();
+#endif
+
+        if(transferMode == I2C_TRANSFER_DMA)
+        {
+            status = initDma();
+        }
+    }
+
+    if(status != I2C_OK)
+    {
+        // Release the bus so it can be constructed again with a valid configuration.
+        drivers[bus] = nullptr;
+        i2cRaise(status);
+    }
+}
+
+I2cBus::~I2cBus()
+{
+    // Nothing was claimed by a bus whose construction failed.
+    if(bus >= I2C_BUS_MAX || drivers[bus] != this)
+    {
+        return;
+    }
+
+    const I2cBusConfig &config = getConfig();
+
+    HAL_NVIC_DisableIRQ(config.eventInterrupt);
+    HAL_NVIC_DisableIRQ(config.errorInterrupt);
+
+    if(dmaEnabled)
+    {
+        HAL_NVIC_DisableIRQ(config.dmaRxInterrupt);
+        HAL_NVIC_DisableIRQ(config.dmaTxInterrupt);
+        HAL_DMA_Abort(&dmaRxHandle);
+        HAL_DMA_Abort(&dmaTxHandle);
+    }
+
+    HAL_I2C_DeInit(&handle);
+
+    // An interrupt already pending finds no driver and returns.
+    drivers[bus] = nullptr;
+}
+
+I2cStatus I2cBus::getStatus(void)
+{
+    return status;
+}
+
+#if I2C_DRIVER_STATS
+I2cDeviceStats* I2cBus::findDeviceStats(uint16_t address)
+{
+    for(size_t i = 0; i < deviceStatsCount; i++)
+    {
+        if(deviceStats[i].address == address)
+            return &deviceStats[i];
+    }
+
+    if(deviceStatsCount == deviceStats.size())
+        return nullptr;
+
+    I2cDeviceStats *stats = &deviceStats[deviceStatsCount++];
+    stats->address = address;
+
+    return stats;
+}
+
+void I2cBus::recordStats(I2cTransaction &transaction, uint32_t completedCycles)
+{
+    I2cDeviceStats *stats = findDeviceStats(transaction.getAddress());
+
+    // A burst records the queue wait of each of its reads, and its wire time once.
+    size_t reads = burstReads ? burstReads : 1;
+    for(size_t read = 0; read < reads; read++)
+    {
+        I2cTransaction &queued = burstReads ? *currentQueue->peek(read) : transaction;
+
+        // Unsigned differences stay correct across a wrap of the cycle counter.
+        uint32_t queueWait = queued.startedCycles - queued.queuedCycles;
+
+        if(queued.getPriority() < I2C_PRIORITY_CLASSES)
+            priorityStats[queued.getPriority()].record(queueWait);
+
+        if(stats)
+            stats->queueWait.record(queueWait);
+    }
+
+    if(!stats)
+        return;
+
+    stats->wireTime.record(completedCycles - transaction.startedCycles);
+    stats->coalescedReads += reads - 1;
+}
+
+const I2cDeviceStats* I2cBus::getDeviceStats(uint16_t address)
+{
+    for(size_t i = 0; i < deviceStatsCount; i++)
+    {
+        if(deviceStats[i].address == address)
+            return &deviceStats[i];
+    }
+
+    return nullptr;
+}
+
+const I2cLatencyStats* I2cBus::getPriorityStats(I2cPriority priority)
+{
+    if(priority >= I2C_PRIORITY_CLASSES)
+        return nullptr;
+
+    return &priorityStats[priority];
+}
+
+void I2cBus::resetStats(void)
+{
+    deviceStats = {};
+    deviceStatsCount = 0;
+    priorityStats = {};
+    recoveryStats.reset();
+    interruptStats.reset();
+}
+
+const I2cLatencyStats& I2cBus::getRecoveryStats(void)
+{
+    return recoveryStats;
+}
+
+const I2cLatencyStats& I2cBus::getInterruptStats(void)
+{
+    return interruptStats;
+}
+#endif
+
+I2cStatus I2cBus::setTransferMode(I2cTransferMode transferMode)
+{
+    if(transferMode == I2C_TRANSFER_DEFAULT)
+    {
+        transferMode = I2C_TRANSFER_INTERRUPT;
+    }
+
+    if(transferMode == I2C_TRANSFER_DMA && !dmaEnabled)
+    {
+        I2cStatus dmaStatus = initDma();
+        if(dmaStatus != I2C_OK)
+        {
+            return i2cRaise(dmaStatus);
+        }
+    }
+
+    this->transferMode = transferMode;
+
+    return I2C_OK;
+}
+
+I2cTransferMode I2cBus::getTransferMode(void)
+{
+    return transferMode;
+}
+
+const I2cTiming& I2cBus::getTiming(void)
+{
+    return timing;
+}
+
+uint32_t I2cBus::getSclFrequency(void)
+{
+    return timing.sclFrequency;
+}
+
+I2cStatus I2cBus::setDeferredCompletions(Queue<I2cCompletion> *completions, bool pendSv)
+{
+    if(currentTransaction != nullptr)
+    {
+        return i2cRaise(I2C_ERROR_BUS_IN_USE);
+    }
+
+    this->completions = completions;
+    completionsPendSv = pendSv;
+
+    // PendSV resets to priority 0, above the bus interrupts: the callbacks would preempt them.
+    if(pendSv)
+    {
+        HAL_NVIC_SetPriority(PendSV_IRQn, (1UL << __NVIC_PRIO_BITS) - 1, 0);
+    }
+
+    return I2C_OK;
+}
+
+I2cStatus I2cBus::setPriorityQueue(I2cPriority priority, Queue<I2cTransaction> *queue)
+{
+    if(priority >= I2C_PRIORITY_CLASSES)
+    {
+        return i2cRaise(I2C_ERROR_INVALID_PRIORITY);
+    }
+
+    if(currentTransaction != nullptr)
+    {
+        return i2cRaise(I2C_ERROR_BUS_IN_USE);
+    }
+
+    queues[priority] = queue ? queue : this->queue;
+
+    // The queue may be of another type than the others (see I2cQueuedBus).
+    if(queue)
+    {
+        completeFunction = &I2cBus::completeTransaction<Queue<I2cTransaction>>;
+    }
+
+    return I2C_OK;
 }
 
 bool I2cBus::areAddressesValid(uint16_t ownAddress1, uint16_t ownAddress2, bool dualAddress, bool addressing7bit)
@@ -171,7 +1110,7 @@ bool I2cBus::areAddressesValid(uint16_t ownAddress1, uint16_t ownAddress2, bool
         }
     }
 
-    throw I2cException("The provided I2C addresses are not valid");
+    return false;
 }
 
 bool I2cBus::checkAddressValidity(uint16_t address, bool addressing7bit)
@@ -196,32 +1135,25 @@ I2cBusSelection I2cBus::getBusNumber(void)
     return bus;
 }
 
-void I2cBus::registerDriver(I2cBusSelection bus)
+I2cStatus I2cBus::registerDriver(I2cBusSelection bus)
 {
-    uint8_t i;
-
-    switch(bus)
-    {
-        case I2C_BUS_1:
-            i = 0;
-            break;
-        case I2C_BUS_2:
-            i = 1;
-            break;
-        case I2C_BUS_3:
-            i = 2;
-            break;
-        default:
-            throw I2cException();
-    }
+    if(bus >= I2C_BUS_MAX)
+        return I2C_ERROR_INVALID_BUS;
     
-    if(drivers[i] != nullptr)
-        throw I2cException("Bus already in use");
+    if(drivers[bus] != nullptr)
+        return I2C_ERROR_BUS_IN_USE;
+
+    drivers[bus] = this;
+
+    return I2C_OK;
+}
 
-    drivers[i] = this;
+const I2cBusConfig& I2cBus::getConfig(void)
+{
+    return i2cBusConfigs[bus];
 }
 
-void I2cBus::initHandle(
+I2cStatus I2cBus::initHandle(
     uint32_t clockSpeed,
     bool addressing7Bit,
     I2cDutyCycle dutyCycle,
@@ -232,159 +1164,168 @@ void I2cBus::initHandle(
     uint16_t ownAddress2
 )
 {
-    I2C_TypeDef *i2cInstance;
-    switch(bus)
-    {
-        case I2C_BUS_1:
-            i2cInstance = I2C1;
-            break;
-        case I2C_BUS_2:
-            i2cInstance = I2C2;
-            break;
-        case I2C_BUS_3:
-            i2cInstance = I2C3;
-            break;
-        default:
-            throw I2cException();
-    }
-
-    handle.Instance = i2cInstance;
+    handle.Instance = reinterpret_cast<I2C_TypeDef*>(getConfig().instance);
     handle.Init.ClockSpeed = clockSpeed;
     handle.Init.AddressingMode = addressing7Bit ? I2C_ADDRESSINGMODE_7BIT : I2C_ADDRESSINGMODE_10BIT;
     // Duty cycle configuration is only taken into account when fast mode is used.
-    handle.Init.DutyCycle = dutyCycle;
+    handle.Init.DutyCycle = dutyCycle == I2C_DUTY_CYCLE_16_9 ? I2C_DUTYCYCLE_16_9 : I2C_DUTYCYCLE_2;
 
     // Slave configurations
     handle.Init.GeneralCallMode = generalCall ? I2C_GENERALCALL_ENABLE : I2C_GENERALCALL_DISABLE;
-    handle.Init.NoStretchMode = clockStretching ? I2C_NOSTRETCH_ENABLE : I2C_NOSTRETCH_DISABLE;
+    handle.Init.NoStretchMode = clockStretching ? I2C_NOSTRETCH_DISABLE : I2C_NOSTRETCH_ENABLE;
 
     handle.Init.DualAddressMode = dualAddress ? I2C_DUALADDRESS_ENABLE : I2C_DUALADDRESS_DISABLE;
-    handle.Init.OwnAddress1 = ownAddress1;
-    handle.Init.OwnAddress2 = ownAddress2;
+    // OAR1 and OAR2 hold 7 bit addresses in bits 7:1.
+    handle.Init.OwnAddress1 = addressing7Bit ? ownAddress1 << 1 : ownAddress1;
+    handle.Init.OwnAddress2 = ownAddress2 << 1;
 
     handle.MspInitCallback = nullptr;
     
     if(HAL_I2C_Init(&handle) != HAL_OK)
     {
-        throw I2cException("There was an error initializing the I2C driver.");
+        return I2C_ERROR_HAL;
     }
 
-    registerCallbacks();
+    return registerCallbacks();
 }
 
 
-void I2cBus::registerCallbacks(void)
+I2cStatus I2cBus::registerCallbacks(void)
 {
     if(HAL_I2C_RegisterCallback(&handle, HAL_I2C_MASTER_TX_COMPLETE_CB_ID, transactionCompleteCallback) != HAL_OK)
     {
-        throw I2cException("There was an error registering the callback.");
+        return I2C_ERROR_HAL;
     }
 
     if(HAL_I2C_RegisterCallback(&handle, HAL_I2C_MASTER_RX_COMPLETE_CB_ID, transactionCompleteCallback) != HAL_OK)
     {
-        throw I2cException("There was an error registering the callback.");
+        return I2C_ERROR_HAL;
     }
 
     if(HAL_I2C_RegisterCallback(&handle, HAL_I2C_MEM_TX_COMPLETE_CB_ID, transactionCompleteCallback) != HAL_OK)
     {
-        throw I2cException("There was an error registering the callback.");
+        return I2C_ERROR_HAL;
     }
 
     if(HAL_I2C_RegisterCallback(&handle, HAL_I2C_MEM_RX_COMPLETE_CB_ID, transactionCompleteCallback) != HAL_OK)
     {
-        throw I2cException("There was an error registering the callback.");
+        return I2C_ERROR_HAL;
     }
 
     if(HAL_I2C_RegisterCallback(&handle, HAL_I2C_MASTER_RX_COMPLETE_CB_ID, transactionCompleteCallback) != HAL_OK)
     {
-        throw I2cException("There was an error registering the callback.");
+        return I2C_ERROR_HAL;
     }
 
-    // if(HAL_I2C_RegisterCallback(&handle, HAL_I2C_ERROR_CB_ID, transactionCompleteCallback) != HAL_OK)
-    // {
-    //     throw I2cException("There was an error registering the callback.");
-    // }
+    if(HAL_I2C_RegisterCallback(&handle, HAL_I2C_ERROR_CB_ID, transactionErrorCallback) != HAL_OK)
+    {
+        return I2C_ERROR_HAL;
+    }
 
     if(HAL_I2C_RegisterCallback(&handle, HAL_I2C_ABORT_CB_ID, transactionCompleteCallback) != HAL_OK)
     {
-        throw I2cException("There was an error registering the callback.");
+        return I2C_ERROR_HAL;
     }
-}
 
-void I2cBus::initGpio(void)
-{
-    uint32_t pinMaskA = 0;
-    uint32_t pinMaskB = 0;
+    if(HAL_I2C_RegisterCallback(&handle, HAL_I2C_SLAVE_RX_COMPLETE_CB_ID, slaveReceiveCallback) != HAL_OK)
+    {
+        return I2C_ERROR_HAL;
+    }
 
-    uint32_t alternateFunction = 0;
+    if(HAL_I2C_RegisterCallback(&handle, HAL_I2C_SLAVE_TX_COMPLETE_CB_ID, slaveTransmitCallback) != HAL_OK)
+    {
+        return I2C_ERROR_HAL;
+    }
 
-    switch(bus)
+    if(HAL_I2C_RegisterCallback(&handle, HAL_I2C_LISTEN_COMPLETE_CB_ID, listenCompleteCallback) != HAL_OK)
     {
-        case I2C_BUS_1:
-            __HAL_RCC_I2C1_CLK_ENABLE();
+        return I2C_ERROR_HAL;
+    }
 
-            pinMaskB = GPIO_PIN_6 | GPIO_PIN_7;
-            alternateFunction = GPIO_AF4_I2C1;
-            break;
-        case I2C_BUS_2:
-            __HAL_RCC_I2C2_CLK_ENABLE();
+    if(HAL_I2C_RegisterAddrCallback(&handle, slaveAddressCallback) != HAL_OK)
+    {
+        return I2C_ERROR_HAL;
+    }
 
-            pinMaskB = GPIO_PIN_3 | GPIO_PIN_10;
-            alternateFunction = GPIO_AF4_I2C2;
-            break;
-        case I2C_BUS_3:
-            __HAL_RCC_I2C3_CLK_ENABLE();
+    return I2C_OK;
+}
 
-            pinMaskA = GPIO_PIN_8;
-            pinMaskB = GPIO_PIN_4;
-            alternateFunction = GPIO_AF4_I2C3;
-            break;
-    }
+void I2cBus::initGpio(void)
+{
+    const I2cBusConfig &config = getConfig();
 
-    __HAL_RCC_GPIOB_CLK_ENABLE();
+    config.enableClock();
+    config.enableSclPortClock();
+    config.enableSdaPortClock();
 
     GPIO_InitTypeDef GPIO_InitStruct = {
-        .Pin = pinMaskB,
+        .Pin = config.sclPin,
         .Mode = GPIO_MODE_AF_OD,
         .Pull = GPIO_NOPULL,
         .Speed = GPIO_SPEED_FREQ_VERY_HIGH,
-        .Alternate = alternateFunction
+        .Alternate = config.sclAlternateFunction
     };
 
-    HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
-
-    if(pinMaskA)
-    {
-        __HAL_RCC_GPIOA_CLK_ENABLE();
+    HAL_GPIO_Init(reinterpret_cast<GPIO_TypeDef*>(config.sclPort), &GPIO_InitStruct);
 
-        GPIO_InitStruct.Pin = pinMaskA;
-        HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
-    }
+    GPIO_InitStruct.Pin = config.sdaPin;
+    GPIO_InitStruct.Alternate = config.sdaAlternateFunction;
+    HAL_GPIO_Init(reinterpret_cast<GPIO_TypeDef*>(config.sdaPort), &GPIO_InitStruct);
 }
 
 void I2cBus::initNvic(void)
 {
-    IRQn_Type eventInterrupt;
-    IRQn_Type errorInterrupt;
-
-    switch(bus)
-    {
-        case I2C_BUS_1:
-            eventInterrupt = I2C1_EV_IRQn;
-            errorInterrupt = I2C1_ER_IRQn;
-            break;
-        case I2C_BUS_2:
-            eventInterrupt = I2C2_EV_IRQn;
-            errorInterrupt = I2C2_ER_IRQn;
-            break;
-        case I2C_BUS_3:
-            eventInterrupt = I2C3_EV_IRQn;
-            errorInterrupt = I2C3_ER_IRQn;
-            break;
-    }
-
-    HAL_NVIC_SetPriority(eventInterrupt, 1, 1);
-    HAL_NVIC_EnableIRQ(eventInterrupt);
-    HAL_NVIC_SetPriority(errorInterrupt, 1, 1);
-    HAL_NVIC_EnableIRQ(errorInterrupt);
+    const I2cBusConfig &config = getConfig();
+
+    HAL_NVIC_SetPriority(config.eventInterrupt, I2C_INTERRUPT_PRIORITY, 1);
+    HAL_NVIC_EnableIRQ(config.eventInterrupt);
+    HAL_NVIC_SetPriority(config.errorInterrupt, I2C_INTERRUPT_PRIORITY, 1);
+    HAL_NVIC_EnableIRQ(config.errorInterrupt);
+}
+
+I2cStatus I2cBus::initDma(void)
+{
+    const I2cBusConfig &config = getConfig();
+
+    __HAL_RCC_DMA1_CLK_ENABLE();
+
+    DMA_InitTypeDef dmaInit = {
+        .Channel = config.dmaChannel,
+        .Direction = DMA_PERIPH_TO_MEMORY,
+        .PeriphInc = DMA_PINC_DISABLE,
+        .MemInc = DMA_MINC_ENABLE,
+        .PeriphDataAlignment = DMA_PDATAALIGN_BYTE,
+        .MemDataAlignment = DMA_MDATAALIGN_BYTE,
+        .Mode = DMA_NORMAL,
+        .Priority = DMA_PRIORITY_HIGH,
+        .FIFOMode = DMA_FIFOMODE_DISABLE,
+        .FIFOThreshold = DMA_FIFO_THRESHOLD_FULL,
+        .MemBurst = DMA_MBURST_SINGLE,
+        .PeriphBurst = DMA_PBURST_SINGLE
+    };
+
+    dmaRxHandle.Instance = reinterpret_cast<DMA_Stream_TypeDef*>(config.dmaRxStream);
+    dmaRxHandle.Init = dmaInit;
+
+    dmaInit.Direction = DMA_MEMORY_TO_PERIPH;
+    dmaTxHandle.Instance = reinterpret_cast<DMA_Stream_TypeDef*>(config.dmaTxStream);
+    dmaTxHandle.Init = dmaInit;
+
+    if(HAL_DMA_Init(&dmaRxHandle) != HAL_OK || HAL_DMA_Init(&dmaTxHandle) != HAL_OK)
+    {
+        return I2C_ERROR_HAL;
+    }
+
+    __HAL_LINKDMA(&handle, hdmarx, dmaRxHandle);
+    __HAL_LINKDMA(&handle, hdmatx, dmaTxHandle);
+
+    // Same priority as the I2C event interrupt so the completion callbacks never preempt each other.
+    HAL_NVIC_SetPriority(config.dmaRxInterrupt, I2C_INTERRUPT_PRIORITY, 1);
+    HAL_NVIC_EnableIRQ(config.dmaRxInterrupt);
+    HAL_NVIC_SetPriority(config.dmaTxInterrupt, I2C_INTERRUPT_PRIORITY, 1);
+    HAL_NVIC_EnableIRQ(config.dmaTxInterrupt);
+
+    dmaEnabled = true;
+
+    return I2C_OK;
 }
\ No newline at end of file
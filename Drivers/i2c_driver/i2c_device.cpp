@@ -1,7 +1,9 @@
 #include "i2c_device.hpp"
 
+#include <new>
 
-I2cDevice::I2cDevice(uint16_t address, I2cBus* bus, std::string name)
+
+I2cDevice::I2cDevice(uint16_t address, I2cBus* bus, const char* name)
     : address(address), bus(bus), name(name)
 {
 
@@ -12,14 +14,26 @@ uint16_t I2cDevice::getAddress(void)
     return address;
 }
 
-void I2cDevice::attachBus(I2cBus* bus)
+const char* I2cDevice::getName(void)
+{
+    return name.c_str();
+}
+
+I2cBus* I2cDevice::getBus(void)
+{
+    return bus;
+}
+
+I2cStatus I2cDevice::attachBus(I2cBus* bus)
 {
     if(this->bus != nullptr)
     {
-        throw I2cException("Device already attached to a bus");
+        return i2cRaise(I2C_ERROR_DEVICE_ATTACHED);
     }
 
     this->bus = bus;
+
+    return I2C_OK;
 }
 
 void I2cDevice::detachBus()
@@ -27,7 +41,200 @@ void I2cDevice::detachBus()
     this->bus = nullptr;
 }
 
-void I2cDevice::setTransaction(I2cTransaction &transaction)
+void I2cDevice::setPriority(I2cPriority priority)
+{
+    this->priority = priority;
+}
+
+I2cPriority I2cDevice::getPriority(void)
+{
+    return priority;
+}
+
+void I2cDevice::setRetryPolicy(uint8_t maxAttempts, uint16_t backoffMs)
+{
+    retryPolicy.maxAttempts = maxAttempts ? maxAttempts : 1;
+    retryPolicy.backoffMs = backoffMs;
+}
+
+const I2cRetryPolicy& I2cDevice::getRetryPolicy(void)
+{
+    return retryPolicy;
+}
+
+void I2cDevice::setReadCoalescing(bool enabled, uint8_t registerWidth)
+{
+    coalescingWidth = enabled ? registerWidth : 0;
+}
+
+uint8_t I2cDevice::getCoalescingWidth(void)
+{
+    return coalescingWidth;
+}
+
+bool I2cDevice::isQueueFull(void)
+{
+    Queue<I2cTransaction> *queue = bus ? bus->getQueue(priority) : nullptr;
+
+    return !queue || queue->isFull();
+}
+
+I2cStatus I2cDevice::setTransaction(I2cTransaction &transaction)
+{
+    if(!bus)
+    {
+        return i2cRaise(I2C_ERROR_NO_BUS);
+    }
+
+    return bus->setTransaction(transaction);
+}
+
+I2cStatus I2cDevice::setTransactions(I2cTransaction *transactions, size_t count)
+{
+    if(!bus)
+    {
+        return i2cRaise(I2C_ERROR_NO_BUS);
+    }
+
+    return bus->setTransactions(transactions, count);
+}
+
+I2cTransaction* I2cDevice::acquireTransaction(TransactionDirection direction, uint8_t* data, uint16_t dataBytes, uint16_t deviceRegister, RegisterLength deviceRegisterBytes, I2cStatus &status)
+{
+    if(!bus)
+    {
+        status = I2C_ERROR_NO_BUS;
+        return nullptr;
+    }
+
+    // Checked up front, the transaction constructor would raise it.
+    if(deviceRegisterBytes == REGISTER_NULL && deviceRegister != 0)
+    {
+        status = I2C_ERROR_INVALID_REGISTER;
+        return nullptr;
+    }
+
+    I2cTransaction *transaction = bus->acquireTransaction(priority, status);
+    if(!transaction)
+    {
+        return nullptr;
+    }
+
+    return new (transaction) I2cTransaction(direction, data, dataBytes, this, deviceRegister, deviceRegisterBytes);
+}
+
+I2cStatus I2cDevice::publishTransaction(void)
+{
+    if(!bus)
+    {
+        return I2C_ERROR_NO_BUS;
+    }
+
+    return bus->publishTransaction(priority);
+}
+
+I2cTransaction* I2cDevice::emplaceTransaction(TransactionDirection direction, uint8_t* data, uint16_t dataBytes, uint16_t deviceRegister, RegisterLength deviceRegisterBytes)
+{
+    I2cStatus status;
+    I2cTransaction *transaction = acquireTransaction(direction, data, dataBytes, deviceRegister, deviceRegisterBytes, status);
+    if(!transaction)
+    {
+        i2cRaise(status);
+    }
+
+    return transaction;
+}
+
+I2cStatus I2cDevice::commitTransaction(void)
+{
+    return i2cRaise(publishTransaction());
+}
+
+I2cTransactionAwaiter I2cDevice::read(uint8_t* data, uint16_t dataBytes, uint16_t deviceRegister, RegisterLength deviceRegisterBytes)
+{
+    return I2cTransactionAwaiter(this, TRANSACTION_RX, data, dataBytes, deviceRegister, deviceRegisterBytes);
+}
+
+I2cTransactionAwaiter I2cDevice::write(uint8_t* data, uint16_t dataBytes, uint16_t deviceRegister, RegisterLength deviceRegisterBytes)
+{
+    return I2cTransactionAwaiter(this, TRANSACTION_TX, data, dataBytes, deviceRegister, deviceRegisterBytes);
+}
+
+I2cTransactionAwaiter I2cDevice::waitReady(void)
+{
+    return I2cTransactionAwaiter(this, TRANSACTION_TX, nullptr, 0, 0, REGISTER_NULL);
+}
+
+void I2cDevice::setShadow(I2cRegisterShadow *shadow)
+{
+    this->shadow = shadow;
+}
+
+I2cRegisterShadow* I2cDevice::getShadow(void)
+{
+    return shadow;
+}
+
+I2cStatus I2cDevice::writeRegister(uint16_t deviceRegister, uint32_t value)
+{
+    if(!shadow)
+    {
+        return i2cRaise(I2C_ERROR_NOT_SHADOWED);
+    }
+
+    if(!bus)
+    {
+        return i2cRaise(I2C_ERROR_NO_BUS);
+    }
+
+    I2cStatus status;
+    I2cTransaction *transaction = shadow->prepareWrite(this, deviceRegister, value, status);
+    if(!transaction)
+    {
+        return status == I2C_OK ? I2C_OK : i2cRaise(status);
+    }
+
+    shadow->commitWrite(*transaction, value);
+
+    // Raised once the shadow is undone. A queue of references keeps the transaction of the shadow.
+    status = bus->queueTransactions(transaction, 1);
+    if(status != I2C_OK)
+    {
+        shadow->cancelWrite(*transaction);
+    }
+
+    return i2cRaise(status);
+}
+
+I2cStatus I2cDevice::modifyBits(uint16_t deviceRegister, uint32_t mask, uint32_t value)
 {
-    bus->setTransaction(transaction);
+    uint32_t current;
+    if(!shadow || shadow->read(deviceRegister, current) != I2C_OK)
+    {
+        return i2cRaise(I2C_ERROR_NOT_SHADOWED);
+    }
+
+    shadow->countAvoidedRead();
+
+    return writeRegister(deviceRegister, (current & ~mask) | (value & mask));
+}
+
+I2cStatus I2cDevice::readShadow(uint16_t deviceRegister, uint32_t &value)
+{
+    if(!shadow || shadow->read(deviceRegister, value) != I2C_OK)
+    {
+        return I2C_ERROR_NOT_SHADOWED;
+    }
+
+    shadow->countAvoidedRead();
+
+    return I2C_OK;
+}
+
+void I2cDevice::recordTransaction(I2cTransaction &transaction)
+{
+    if(shadow)
+    {
+        shadow->record(transaction);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,268 @@
+#include "i2c_direct_transfer.hpp"
+
+#define I2C_DIRECT_ERROR_FLAGS (I2C_SR1_BERR | I2C_SR1_ARLO | I2C_SR1_AF | I2C_SR1_OVR)
+
+
+I2cStatus I2cDirectTransfer::start(I2C_TypeDef *instance, I2cTransaction &transaction)
+{
+    uint16_t deviceRegister = transaction.getRegister();
+
+    this->instance = instance;
+    address = transaction.getAddress() << 1;
+    registerAddress[0] = deviceRegister >> 8;
+    registerAddress[1] = deviceRegister;
+    registerBytes = transaction.getRegisterBytes() == REGISTER_NULL ? 0 : (transaction.getRegisterBytes() == REGISTER_8_BITS ? 1 : 2);
+    receive = transaction.getDirection() == TRANSACTION_RX;
+    data = transaction.getDataPointer();
+    remaining = transaction.getDataLenthBytes();
+    error = HAL_I2C_ERROR_NONE;
+
+    // A read without register goes straight to the address with the read bit.
+    phase = receive && registerBytes == 0 ? I2C_DIRECT_RECEIVE : I2C_DIRECT_TRANSMIT;
+
+    // No wait for BUSY: the peripheral holds the START until the STOP of the previous transfer is
+    // on the wire (RM0368). A bus that never gets free leaves SB unset, the timeout recovers it.
+    uint32_t control = i2cReadRegister(instance->CR1) & ~I2C_CR1_POS;
+    i2cWriteRegister(instance->CR1, control | I2C_CR1_ACK | I2C_CR1_START);
+    i2cWriteRegister(instance->CR2, i2cReadRegister(instance->CR2) | I2C_CR2_ITEVTEN | I2C_CR2_ITBUFEN | I2C_CR2_ITERREN);
+
+    return I2C_OK;
+}
+
+I2cDirectResult I2cDirectTransfer::handleEvent(void)
+{
+    uint32_t status = i2cReadRegister(instance->SR1);
+
+    // Reading SR1, then writing DR clears SB.
+    if(status & I2C_SR1_SB)
+    {
+        i2cWriteRegister(instance->DR, address | (phase == I2C_DIRECT_RECEIVE ? 1 : 0));
+        return I2C_DIRECT_PENDING;
+    }
+
+    if(status & I2C_SR1_ADDR)
+    {
+        return addressed();
+    }
+
+    if(phase == I2C_DIRECT_RECEIVE)
+    {
+        return receiveEvent(status);
+    }
+
+    return transmitEvent(status);
+}
+
+I2cDirectResult I2cDirectTransfer::addressed(void)
+{
+    // Reading SR2 after SR1 clears ADDR, which releases SCL.
+    if(phase == I2C_DIRECT_TRANSMIT)
+    {
+        i2cReadRegister(instance->SR2);
+
+        if(!hasTransmitBytes())
+        {
+            i2cWriteRegister(instance->CR1, i2cReadRegister(instance->CR1) | I2C_CR1_STOP);
+            return finish(I2C_DIRECT_COMPLETE);
+        }
+
+        // DR is empty now, no need to wait for TXE.
+        transmitByte();
+        return I2C_DIRECT_PENDING;
+    }
+
+    uint32_t control = i2cReadRegister(instance->CR1);
+
+    if(remaining == 1)
+    {
+        // NACK the only byte before it starts, STOP follows it.
+        i2cWriteRegister(instance->CR1, control & ~I2C_CR1_ACK);
+        i2cReadRegister(instance->SR2);
+        i2cWriteRegister(instance->CR1, (control & ~I2C_CR1_ACK) | I2C_CR1_STOP);
+        return I2C_DIRECT_PENDING;
+    }
+
+    if(remaining == 2)
+    {
+        // POS moves the NACK to the second byte. Both are read together once BTF holds them.
+        i2cWriteRegister(instance->CR1, (control & ~I2C_CR1_ACK) | I2C_CR1_POS);
+        i2cReadRegister(instance->SR2);
+        i2cWriteRegister(instance->CR2, i2cReadRegister(instance->CR2) & ~I2C_CR2_ITBUFEN);
+        return I2C_DIRECT_PENDING;
+    }
+
+    i2cReadRegister(instance->SR2);
+
+    if(remaining == 3)
+    {
+        i2cWriteRegister(instance->CR2, i2cReadRegister(instance->CR2) & ~I2C_CR2_ITBUFEN);
+    }
+
+    return I2C_DIRECT_PENDING;
+}
+
+I2cDirectResult I2cDirectTransfer::transmitEvent(uint32_t status)
+{
+    if(hasTransmitBytes())
+    {
+        // Writing DR also clears a BTF raised by a late interrupt.
+        if(status & I2C_SR1_TXE)
+        {
+            transmitByte();
+        }
+
+        return I2C_DIRECT_PENDING;
+    }
+
+    // Only BTF is unmasked now: the last byte was sent and acknowledged.
+    if(!(status & I2C_SR1_BTF))
+    {
+        return I2C_DIRECT_PENDING;
+    }
+
+    if(receive)
+    {
+        // Register address sent, turn around with a repeated START. START clears BTF.
+        phase = I2C_DIRECT_RECEIVE;
+        i2cWriteRegister(instance->CR2, i2cReadRegister(instance->CR2) | I2C_CR2_ITBUFEN);
+        i2cWriteRegister(instance->CR1, i2cReadRegister(instance->CR1) | I2C_CR1_START);
+        return I2C_DIRECT_PENDING;
+    }
+
+    i2cWriteRegister(instance->CR1, i2cReadRegister(instance->CR1) | I2C_CR1_STOP);
+
+    return finish(I2C_DIRECT_COMPLETE);
+}
+
+I2cDirectResult I2cDirectTransfer::receiveEvent(uint32_t status)
+{
+    if(remaining > 3)
+    {
+        if(status & I2C_SR1_RXNE)
+        {
+            *data++ = i2cReadRegister(instance->DR);
+            remaining--;
+
+            // The last three are taken on BTF, to NACK the last one in time.
+            if(remaining == 3)
+            {
+                i2cWriteRegister(instance->CR2, i2cReadRegister(instance->CR2) & ~I2C_CR2_ITBUFEN);
+            }
+        }
+
+        return I2C_DIRECT_PENDING;
+    }
+
+    if(remaining == 1)
+    {
+        if(!(status & I2C_SR1_RXNE))
+        {
+            return I2C_DIRECT_PENDING;
+        }
+
+        *data++ = i2cReadRegister(instance->DR);
+        remaining = 0;
+
+        return finish(I2C_DIRECT_COMPLETE);
+    }
+
+    // 2 or 3 left: wait until two of them are held, in DR and in the shift register.
+    if(!(status & I2C_SR1_BTF))
+    {
+        return I2C_DIRECT_PENDING;
+    }
+
+    if(remaining == 3)
+    {
+        // The last byte is the next one the shift register takes, NACK it.
+        i2cWriteRegister(instance->CR1, i2cReadRegister(instance->CR1) & ~I2C_CR1_ACK);
+        *data++ = i2cReadRegister(instance->DR);
+        remaining--;
+
+        return I2C_DIRECT_PENDING;
+    }
+
+    i2cWriteRegister(instance->CR1, i2cReadRegister(instance->CR1) | I2C_CR1_STOP);
+    *data++ = i2cReadRegister(instance->DR);
+    *data++ = i2cReadRegister(instance->DR);
+    remaining = 0;
+
+    return finish(I2C_DIRECT_COMPLETE);
+}
+
+void I2cDirectTransfer::transmitByte(void)
+{
+    uint8_t byte;
+    if(registerBytes)
+    {
+        byte = registerAddress[2 - registerBytes];
+        registerBytes--;
+    }
+    else
+    {
+        byte = *data++;
+        remaining--;
+    }
+
+    i2cWriteRegister(instance->DR, byte);
+
+    // Nothing else to send: only BTF, the end of this byte, is left to wait for.
+    if(!hasTransmitBytes())
+    {
+        i2cWriteRegister(instance->CR2, i2cReadRegister(instance->CR2) & ~I2C_CR2_ITBUFEN);
+    }
+}
+
+bool I2cDirectTransfer::hasTransmitBytes(void)
+{
+    return registerBytes != 0 || (!receive && remaining != 0);
+}
+
+I2cDirectResult I2cDirectTransfer::handleError(void)
+{
+    uint32_t status = i2cReadRegister(instance->SR1);
+    uint32_t flags = status & I2C_DIRECT_ERROR_FLAGS;
+    if(!flags)
+    {
+        return I2C_DIRECT_PENDING;
+    }
+
+    error = HAL_I2C_ERROR_NONE;
+    if(flags & I2C_SR1_BERR)
+        error |= HAL_I2C_ERROR_BERR;
+    if(flags & I2C_SR1_ARLO)
+        error |= HAL_I2C_ERROR_ARLO;
+    if(flags & I2C_SR1_AF)
+        error |= HAL_I2C_ERROR_AF;
+    if(flags & I2C_SR1_OVR)
+        error |= HAL_I2C_ERROR_OVR;
+
+    // The error flags are cleared by writing 0 to them, the other bits ignore the write.
+    i2cWriteRegister(instance->SR1, ~flags & 0xFFFF);
+
+    // A NACKed master still holds the bus.
+    if(flags & I2C_SR1_AF)
+    {
+        i2cWriteRegister(instance->CR1, i2cReadRegister(instance->CR1) | I2C_CR1_STOP);
+    }
+
+    return finish(I2C_DIRECT_FAILED);
+}
+
+I2cDirectResult I2cDirectTransfer::finish(I2cDirectResult result)
+{
+    i2cWriteRegister(instance->CR2, i2cReadRegister(instance->CR2) & ~(I2C_CR2_ITEVTEN | I2C_CR2_ITBUFEN | I2C_CR2_ITERREN));
+    phase = I2C_DIRECT_IDLE;
+
+    return result;
+}
+
+void I2cDirectTransfer::reset(void)
+{
+    phase = I2C_DIRECT_IDLE;
+}
+
+uint32_t I2cDirectTransfer::getError(void)
+{
+    return error;
+}
\ No newline at end of file
@@ -1,6 +1,11 @@
 #include "i2c_driver_exceptions.hpp"
 
-I2cException::I2cException(const std::string& message) : CustomException(message)
+I2cException::I2cException(const char* message) : CustomException(message)
+{
+
+}
+
+I2cException::I2cException(I2cStatus status) : CustomException(i2cStatusMessage(status)), status(status)
 {
 
 }
@@ -8,4 +13,98 @@ I2cException::I2cException(const std::string& message) : CustomException(message
 I2cException::I2cException(void) : CustomException("A I2C driver exception has occurred")
 {
 
+}
+
+I2cStatus I2cException::getStatus(void) const
+{
+    return status;
+}
+
+const char* i2cStatusMessage(I2cStatus status)
+{
+    switch(status)
+    {
+        case I2C_OK:
+            return "No error";
+        case I2C_ERROR_HAL:
+            return "There was a HAL error";
+        case I2C_ERROR_INVALID_BUS:
+            return "Invalid I2C bus";
+        case I2C_ERROR_BUS_IN_USE:
+            return "Bus already in use";
+        case I2C_ERROR_INVALID_ADDRESS:
+            return "The provided I2C addresses are not valid";
+        case I2C_ERROR_INVALID_REGISTER:
+            return "Configured register but not register length";
+        case I2C_ERROR_NO_DEVICE:
+            return "Device for the I2cTransaction not set";
+        case I2C_ERROR_NO_BUS:
+            return "Device not attached to a bus";
+        case I2C_ERROR_DEVICE_ATTACHED:
+            return "Device already attached to a bus";
+        case I2C_ERROR_QUEUE_FULL:
+            return "The transaction queue is full";
+        case I2C_ERROR_CHAIN_FULL:
+            return "The transaction chain is full";
+        case I2C_ERROR_CHAIN_EMPTY:
+            return "The transaction chain has no frames";
+        case I2C_ERROR_SEQUENCE_ABORTED:
+            return "A previous frame of the sequence failed";
+        case I2C_ERROR_NO_TASK_FRAME:
+            return "No free coroutine frame in the task pool";
+        case I2C_ERROR_INVALID_PRIORITY:
+            return "Invalid transaction priority class";
+        case I2C_ERROR_NACK:
+            return "The device did not acknowledge";
+        case I2C_ERROR_BUS_FAULT:
+            return "Misplaced START or STOP on the bus";
+        case I2C_ERROR_ARBITRATION_LOST:
+            return "Arbitration lost to another master";
+        case I2C_ERROR_OVERRUN:
+            return "Data overrun or underrun";
+        case I2C_ERROR_TIMEOUT:
+            return "The transaction did not complete in time";
+        case I2C_ERROR_BUS_STUCK:
+            return "SDA still held low after the bus recovery";
+        case I2C_ERROR_TABLE_FULL:
+            return "The periodic table is full";
+        case I2C_ERROR_INVALID_PERIOD:
+            return "Invalid sampling period or tick rate";
+        case I2C_ERROR_TIMER_IN_USE:
+            return "The timer already ticks another periodic table";
+        case I2C_ERROR_NOT_SHADOWED:
+            return "The register value is not shadowed";
+        case I2C_ERROR_SHADOW_FULL:
+            return "No free register shadow entry or write buffer";
+        case I2C_ERROR_GROUP_FULL:
+            return "The transaction group is full";
+        case I2C_ERROR_GROUP_EMPTY:
+            return "The transaction group is empty";
+        case I2C_ERROR_GROUP_BUSY:
+            return "The transaction group is still running";
+        case I2C_ERROR_MASTER_ONLY:
+            return "The bus has no slave address";
+        case I2C_ERROR_SLAVE_MODE:
+            return "The bus serves a register file in slave mode";
+        case I2C_ERROR_INVALID_CLOCK:
+            return "The SCL frequency can't be reached from PCLK1";
+        case I2C_ERROR_INVALID_ARGUMENT:
+            return "Invalid argument";
+        case I2C_ERROR_REFERENCE_QUEUE:
+            return "The queue only links caller-owned transactions, it has no slot to build one in";
+    }
+
+    return "A I2C driver exception has occurred";
+}
+
+I2cStatus i2cRaise(I2cStatus status)
+{
+#if I2C_DRIVER_EXCEPTIONS
+    if(status != I2C_OK)
+    {
+        throw I2cException(status);
+    }
+#endif
+
+    return status;
 }
\ No newline at end of file
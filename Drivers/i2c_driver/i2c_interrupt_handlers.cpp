@@ -1,34 +1,84 @@
 #include "i2c_bus.hpp"
+#include "i2c_periodic.hpp"
 
 /*
  *  Interrupt handlers by driver
  */
 extern "C" void I2C1_EV_IRQHandler(void)
 {
-    I2cBus::handleInterrupt(I2C_BUS_1, I2C_EVENT);
+    I2cBus::handleInterrupt<I2C_BUS_1, I2C_EVENT>();
 }
 
 extern "C" void I2C2_EV_IRQHandler(void)
 {
-    I2cBus::handleInterrupt(I2C_BUS_2, I2C_EVENT);
+    I2cBus::handleInterrupt<I2C_BUS_2, I2C_EVENT>();
 }
 
 extern "C" void I2C3_EV_IRQHandler(void)
 {
-    I2cBus::handleInterrupt(I2C_BUS_3, I2C_EVENT);
+    I2cBus::handleInterrupt<I2C_BUS_3, I2C_EVENT>();
 }
 
 extern "C" void I2C1_ER_IRQHandler(void)
 {
-    I2cBus::handleInterrupt(I2C_BUS_1, I2C_ERROR);
+    I2cBus::handleInterrupt<I2C_BUS_1, I2C_ERROR>();
 }
 
 extern "C" void I2C2_ER_IRQHandler(void)
 {
-    I2cBus::handleInterrupt(I2C_BUS_2, I2C_ERROR);
+    I2cBus::handleInterrupt<I2C_BUS_2, I2C_ERROR>();
 }
 
 extern "C" void I2C3_ER_IRQHandler(void)
 {
-    I2cBus::handleInterrupt(I2C_BUS_3, I2C_ERROR);
+    I2cBus::handleInterrupt<I2C_BUS_3, I2C_ERROR>();
+}
+
+/*
+ *  DMA stream interrupt handlers by driver, as assigned in I2cBusTraits
+ */
+extern "C" void DMA1_Stream0_IRQHandler(void)
+{
+    I2cBus::handleInterrupt<I2C_BUS_1, I2C_DMA_RX>();
+}
+
+extern "C" void DMA1_Stream6_IRQHandler(void)
+{
+    I2cBus::handleInterrupt<I2C_BUS_1, I2C_DMA_TX>();
+}
+
+extern "C" void DMA1_Stream3_IRQHandler(void)
+{
+    I2cBus::handleInterrupt<I2C_BUS_2, I2C_DMA_RX>();
+}
+
+extern "C" void DMA1_Stream7_IRQHandler(void)
+{
+    I2cBus::handleInterrupt<I2C_BUS_2, I2C_DMA_TX>();
+}
+
+extern "C" void DMA1_Stream2_IRQHandler(void)
+{
+    I2cBus::handleInterrupt<I2C_BUS_3, I2C_DMA_RX>();
+}
+
+extern "C" void DMA1_Stream4_IRQHandler(void)
+{
+    I2cBus::handleInterrupt<I2C_BUS_3, I2C_DMA_TX>();
+}
+
+/*
+ *  Timer of the periodic table (see I2cPeriodicTable)
+ */
+extern "C" void TIM2_IRQHandler(void)
+{
+    I2cPeriodicTable::handleInterrupt();
+}
+
+/*
+ *  Deferred completions (see I2cBus::setDeferredCompletions), called from PendSV_Handler
+ */
+extern "C" void I2C_DeferredCompletionHandler(void)
+{
+    I2cBus::runPendSvCompletions();
 }
\ No newline at end of file
@@ -0,0 +1,229 @@
+#include "i2c_periodic.hpp"
+
+#include <algorithm>
+
+// TIM2 counts at 1 MHz, so any tick rate dividing it is exact.
+#define I2C_PERIODIC_TIMER_CLOCK 1000000
+
+
+I2cPeriodicTable* I2cPeriodicTable::timerTable = nullptr;
+
+void I2cPeriodicTable::handleInterrupt(void)
+{
+    if(timerTable)
+    {
+        HAL_TIM_IRQHandler(&timerTable->timerHandle);
+    }
+}
+
+void I2cPeriodicTable::timerCallback(TIM_HandleTypeDef *handle)
+{
+    I2cPeriodicTable* table = reinterpret_cast<I2cPeriodicTable*>(
+        reinterpret_cast<uint8_t*>(handle) - offsetof(I2cPeriodicTable, timerHandle)
+    );
+
+    table->tick();
+}
+
+void I2cPeriodicTable::tick(void)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        I2cPeriodicEntry &entry = entries[i];
+        if(--entry.countdown != 0)
+        {
+            continue;
+        }
+
+        entry.countdown = entry.periodTicks;
+
+        // Nothing may raise in the interrupt: a sample that can't be queued is an overrun.
+        I2cBus *bus = entry.transaction.getDevice()->getBus();
+        if(entry.pending || !bus)
+        {
+            entry.stats.overruns++;
+            continue;
+        }
+
+        entry.pending = true;
+        if(bus->queueTransactions(&entry.transaction, 1) != I2C_OK)
+        {
+            entry.pending = false;
+            entry.stats.overruns++;
+        }
+    }
+}
+
+void I2cPeriodicTable::complete(void* parameters)
+{
+    I2cPeriodicEntry *entry = static_cast<I2cPeriodicEntry*>(parameters);
+    uint32_t cycles = i2cGetCycles();
+
+    if(entry->status != I2C_OK)
+    {
+        entry->stats.errors++;
+    }
+    else
+    {
+        if(entry->sampled)
+        {
+            uint32_t period = cycles - entry->lastCycles;
+            uint32_t deviation = period > entry->periodCycles ? period - entry->periodCycles : entry->periodCycles - period;
+
+            entry->stats.period.record(period);
+            entry->stats.jitter = std::max(entry->stats.jitter, deviation);
+        }
+
+        entry->lastCycles = cycles;
+        entry->sampled = true;
+    }
+
+    entry->pending = false;
+}
+
+I2cPeriodicTable::I2cPeriodicTable(uint32_t tickHz, I2cPriority priority)
+    : tickHz(tickHz), priority(priority)
+{
+
+}
+
+I2cStatus I2cPeriodicTable::add(I2cDevice *device, uint16_t deviceRegister, RegisterLength deviceRegisterBytes, uint8_t* data, uint16_t dataBytes, uint32_t periodTicks)
+{
+    if(count == entries.size())
+    {
+        return i2cRaise(I2C_ERROR_TABLE_FULL);
+    }
+
+    if(periodTicks == 0 || priority >= I2C_PRIORITY_CLASSES)
+    {
+        return i2cRaise(periodTicks == 0 ? I2C_ERROR_INVALID_PERIOD : I2C_ERROR_INVALID_PRIORITY);
+    }
+
+    if(!device)
+    {
+        return i2cRaise(I2C_ERROR_NO_DEVICE);
+    }
+
+    if(!device->getBus())
+    {
+        return i2cRaise(I2C_ERROR_NO_BUS);
+    }
+
+    I2cPeriodicEntry &entry = entries[count];
+
+    entry.transaction = I2cTransaction(TRANSACTION_RX, data, dataBytes, device, deviceRegister, deviceRegisterBytes);
+    if(entry.transaction.getStatus() != I2C_OK)
+    {
+        return i2cRaise(entry.transaction.getStatus());
+    }
+
+    entry.transaction.setPriority(priority);
+    entry.transaction.setStatusOutput(&entry.status);
+    entry.transaction.setPostCallback(complete, &entry);
+    // Only bookkeeping, no need to defer it.
+    entry.transaction.setImmediateCallback(true);
+
+    entry.periodTicks = periodTicks;
+    entry.countdown = periodTicks;
+    entry.periodCycles = periodTicks * (HAL_RCC_GetHCLKFreq() / tickHz);
+    entry.sampled = false;
+    entry.pending = false;
+    entry.status = I2C_OK;
+    entry.stats = {};
+
+    // The timer interrupt only sees the entry from here on.
+    count = count + 1;
+
+    return I2C_OK;
+}
+
+I2cStatus I2cPeriodicTable::start(void)
+{
+    if(timerTable && timerTable != this)
+    {
+        return i2cRaise(I2C_ERROR_TIMER_IN_USE);
+    }
+
+    if(tickHz == 0 || tickHz > I2C_PERIODIC_TIMER_CLOCK)
+    {
+        return i2cRaise(I2C_ERROR_INVALID_PERIOD);
+    }
+
+    // APB1 timers run at twice PCLK1 unless APB1 is undivided.
+    uint32_t timerClock = HAL_RCC_GetPCLK1Freq();
+    if(timerClock != HAL_RCC_GetHCLKFreq())
+    {
+        timerClock *= 2;
+    }
+
+    __HAL_RCC_TIM2_CLK_ENABLE();
+
+    timerHandle.Instance = TIM2;
+    timerHandle.Init.Prescaler = timerClock / I2C_PERIODIC_TIMER_CLOCK - 1;
+    timerHandle.Init.CounterMode = TIM_COUNTERMODE_UP;
+    timerHandle.Init.Period = I2C_PERIODIC_TIMER_CLOCK / tickHz - 1;
+    timerHandle.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    timerHandle.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+
+    if(HAL_TIM_Base_Init(&timerHandle) != HAL_OK)
+    {
+        return i2cRaise(I2C_ERROR_HAL);
+    }
+
+    if(HAL_TIM_RegisterCallback(&timerHandle, HAL_TIM_PERIOD_ELAPSED_CB_ID, timerCallback) != HAL_OK)
+    {
+        return i2cRaise(I2C_ERROR_HAL);
+    }
+
+    i2cStartCycleClock();
+    timerTable = this;
+
+    // Same priority as the bus interrupts: queuing a sample never preempts a completion.
+    HAL_NVIC_SetPriority(TIM2_IRQn, I2C_INTERRUPT_PRIORITY, 1);
+    HAL_NVIC_EnableIRQ(TIM2_IRQn);
+
+    if(HAL_TIM_Base_Start_IT(&timerHandle) != HAL_OK)
+    {
+        timerTable = nullptr;
+        return i2cRaise(I2C_ERROR_HAL);
+    }
+
+    return I2C_OK;
+}
+
+void I2cPeriodicTable::stop(void)
+{
+    if(timerTable != this)
+    {
+        return;
+    }
+
+    HAL_TIM_Base_Stop_IT(&timerHandle);
+    HAL_NVIC_DisableIRQ(TIM2_IRQn);
+    timerTable = nullptr;
+}
+
+size_t I2cPeriodicTable::size(void)
+{
+    return count;
+}
+
+const I2cPeriodicStats* I2cPeriodicTable::getStats(size_t index)
+{
+    if(index >= count)
+    {
+        return nullptr;
+    }
+
+    return &entries[index].stats;
+}
+
+I2cStatus I2cPeriodicTable::getStatus(size_t index)
+{
+    if(index >= count)
+    {
+        return I2C_ERROR_NO_DEVICE;
+    }
+
+    return entries[index].status;
+}
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include "i2c_register_file.hpp"
+
+#include "i2c_driver_exceptions.hpp"
+
+
+I2cRegisterFile::I2cRegisterFile(uint8_t* memory, uint16_t size, RegisterLength pointerBytes)
+    : memory(memory), size(size), pointerBytes(pointerBytes)
+{
+    // The pointer wraps modulo the size.
+    if(!memory || size == 0)
+    {
+        status = i2cRaise(I2C_ERROR_INVALID_ARGUMENT);
+    }
+}
+
+void I2cRegisterFile::reset(void)
+{
+    phase = I2C_REGISTER_FILE_IDLE;
+    writeBytes = 0;
+}
+
+void I2cRegisterFile::receiveData(I2C_HandleTypeDef *handle, uint32_t options)
+{
+    phase = I2C_REGISTER_FILE_WRITE;
+    writeStart = pointer;
+    writeBytes = size - pointer;
+
+    HAL_I2C_Slave_Seq_Receive_IT(handle, memory + writeStart, writeBytes, options);
+}
+
+void I2cRegisterFile::finishWrite(I2C_HandleTypeDef *handle)
+{
+    // The HAL counts down the bytes still expected, what's missing was received.
+    uint16_t received = writeBytes - handle->XferCount;
+    phase = I2C_REGISTER_FILE_IDLE;
+    writeBytes = 0;
+
+    if(received == 0)
+    {
+        return;
+    }
+
+    pointer = (writeStart + received) % size;
+
+    lastWriteStart = writeStart;
+    lastWriteBytes = received;
+    stats.writes++;
+    stats.bytesWritten += received;
+
+    if(writeFunction)
+    {
+        writeFunction(writeParameters);
+    }
+}
+
+void I2cRegisterFile::addressMatched(I2C_HandleTypeDef *handle, uint8_t direction)
+{
+    // A repeated START ends the write in progress, the HAL doesn't report it otherwise.
+    if(phase == I2C_REGISTER_FILE_WRITE)
+    {
+        finishWrite(handle);
+    }
+
+    // I2C_DIRECTION_TRANSMIT: the host transmits, so the slave receives.
+    if(direction == I2C_DIRECTION_TRANSMIT)
+    {
+        if(pointerBytes == REGISTER_NULL)
+        {
+            pointer = 0;
+            receiveData(handle, I2C_FIRST_FRAME);
+            return;
+        }
+
+        phase = I2C_REGISTER_FILE_POINTER;
+        HAL_I2C_Slave_Seq_Receive_IT(handle, pointerBuffer, pointerBytes == REGISTER_8_BITS ? 1 : 2, I2C_FIRST_FRAME);
+        return;
+    }
+
+    if(pointerBytes == REGISTER_NULL)
+    {
+        pointer = 0;
+    }
+
+    phase = I2C_REGISTER_FILE_READ;
+    stats.reads++;
+    HAL_I2C_Slave_Seq_Transmit_IT(handle, memory + pointer, size - pointer, I2C_LAST_FRAME);
+}
+
+void I2cRegisterFile::receiveComplete(I2C_HandleTypeDef *handle)
+{
+    if(phase == I2C_REGISTER_FILE_POINTER)
+    {
+        uint16_t value = pointerBytes == REGISTER_8_BITS ? pointerBuffer[0] : (pointerBuffer[0] << 8) | pointerBuffer[1];
+        pointer = value % size;
+        receiveData(handle, I2C_NEXT_FRAME);
+        return;
+    }
+
+    // Written up to the end of the memory: the rest of the write goes on from register 0.
+    if(phase == I2C_REGISTER_FILE_WRITE)
+    {
+        finishWrite(handle);
+        receiveData(handle, I2C_NEXT_FRAME);
+    }
+}
+
+void I2cRegisterFile::transmitComplete(I2C_HandleTypeDef *handle)
+{
+    // Read up to the end of the memory, the host goes on from register 0.
+    if(phase == I2C_REGISTER_FILE_READ)
+    {
+        HAL_I2C_Slave_Seq_Transmit_IT(handle, memory, size, I2C_LAST_FRAME);
+    }
+}
+
+void I2cRegisterFile::transferEnded(I2C_HandleTypeDef *handle, uint32_t halError)
+{
+    // A NACK is how a host ends a read, and a STOP before the end of the memory ends a write with
+    // HAL_I2C_ERROR_AF: neither is a failure.
+    if(halError & (HAL_I2C_ERROR_BERR | HAL_I2C_ERROR_ARLO | HAL_I2C_ERROR_OVR))
+    {
+        stats.errors++;
+    }
+
+    if(phase == I2C_REGISTER_FILE_WRITE)
+    {
+        finishWrite(handle);
+    }
+
+    phase = I2C_REGISTER_FILE_IDLE;
+}
+
+void I2cRegisterFile::setWriteCallback(Callback callback, void* parameters)
+{
+    writeFunction = callback;
+    writeParameters = parameters;
+}
+
+void I2cRegisterFile::getLastWrite(uint16_t &start, uint16_t &bytes)
+{
+    start = lastWriteStart;
+    bytes = lastWriteBytes;
+}
+
+uint16_t I2cRegisterFile::getPointer(void)
+{
+    return pointer;
+}
+
+uint8_t* I2cRegisterFile::getMemory(void)
+{
+    return memory;
+}
+
+uint16_t I2cRegisterFile::getSize(void)
+{
+    return size;
+}
+
+const I2cRegisterFileStats& I2cRegisterFile::getStats(void)
+{
+    return stats;
+}
+
+I2cStatus I2cRegisterFile::getStatus(void)
+{
+    return status;
+}
\ No newline at end of file
@@ -0,0 +1,235 @@
+#include "i2c_register_shadow.hpp"
+
+#include "i2c_driver_exceptions.hpp"
+
+
+I2cRegisterShadow::I2cRegisterShadow(RegisterLength registerBytes, uint8_t valueBytes)
+    : registerBytes(registerBytes), valueBytes(valueBytes)
+{
+
+}
+
+I2cShadowRegister* I2cRegisterShadow::find(uint16_t deviceRegister)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        if(registers[i].deviceRegister == deviceRegister)
+            return &registers[i];
+    }
+
+    return nullptr;
+}
+
+uint32_t I2cRegisterShadow::decode(const uint8_t* data)
+{
+    uint32_t value = 0;
+    for(uint8_t i = 0; i < valueBytes; i++)
+    {
+        value = (value << 8) | data[i];
+    }
+
+    return value;
+}
+
+I2cStatus I2cRegisterShadow::track(uint16_t deviceRegister)
+{
+    if(registerBytes == REGISTER_NULL || valueBytes == 0 || valueBytes > I2C_SHADOW_MAX_BYTES)
+    {
+        return i2cRaise(I2C_ERROR_INVALID_REGISTER);
+    }
+
+    if(find(deviceRegister))
+    {
+        return I2C_OK;
+    }
+
+    if(count == registers.size())
+    {
+        return i2cRaise(I2C_ERROR_SHADOW_FULL);
+    }
+
+    registers[count].deviceRegister = deviceRegister;
+    registers[count].valid = false;
+    registers[count].pendingWrites = 0;
+    count++;
+
+    return I2C_OK;
+}
+
+I2cStatus I2cRegisterShadow::track(uint16_t deviceRegister, uint32_t value)
+{
+    I2cStatus status = track(deviceRegister);
+    if(status != I2C_OK)
+    {
+        return status;
+    }
+
+    I2cShadowRegister *shadowRegister = find(deviceRegister);
+    shadowRegister->value = value;
+    shadowRegister->valid = true;
+
+    return I2C_OK;
+}
+
+I2cStatus I2cRegisterShadow::read(uint16_t deviceRegister, uint32_t &value)
+{
+    I2cShadowRegister *shadowRegister = find(deviceRegister);
+    if(!shadowRegister || !shadowRegister->valid)
+    {
+        return I2C_ERROR_NOT_SHADOWED;
+    }
+
+    value = shadowRegister->value;
+
+    return I2C_OK;
+}
+
+I2cTransaction* I2cRegisterShadow::prepareWrite(I2cDevice *device, uint16_t deviceRegister, uint32_t value, I2cStatus &status)
+{
+    status = I2C_OK;
+
+    I2cShadowRegister *shadowRegister = find(deviceRegister);
+    if(shadowRegister && shadowRegister->valid && shadowRegister->value == value)
+    {
+        stats.suppressedWrites++;
+        return nullptr;
+    }
+
+    for(size_t i = 0; i < writeBuffers.size(); i++)
+    {
+        if(writeBuffersUsed[i])
+            continue;
+
+        uint8_t *buffer = writeBuffers[i].data();
+        for(uint8_t byte = 0; byte < valueBytes; byte++)
+        {
+            buffer[byte] = static_cast<uint8_t>(value >> (8 * (valueBytes - 1 - byte)));
+        }
+
+        writeTransactions[i] = I2cTransaction(TRANSACTION_TX, buffer, valueBytes, device, deviceRegister, registerBytes);
+
+        return &writeTransactions[i];
+    }
+
+    status = I2C_ERROR_SHADOW_FULL;
+
+    return nullptr;
+}
+
+void I2cRegisterShadow::commitWrite(I2cTransaction &transaction, uint32_t value)
+{
+    for(size_t i = 0; i < writeBuffers.size(); i++)
+    {
+        if(writeBuffers[i].data() == transaction.getDataPointer())
+            writeBuffersUsed[i] = true;
+    }
+
+    // Known from now on, so that the next modification builds on it.
+    I2cShadowRegister *shadowRegister = find(transaction.getRegister());
+    if(shadowRegister)
+    {
+        // Counted first: a completion of the register running meanwhile is ignored.
+        shadowRegister->pendingWrites++;
+        shadowRegister->value = value;
+        shadowRegister->valid = true;
+    }
+
+    stats.writes++;
+}
+
+bool I2cRegisterShadow::releaseWrite(uint8_t* buffer)
+{
+    for(size_t i = 0; i < writeBuffers.size(); i++)
+    {
+        if(writeBuffers[i].data() == buffer)
+        {
+            writeBuffersUsed[i] = false;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void I2cRegisterShadow::cancelWrite(I2cTransaction &transaction)
+{
+    releaseWrite(transaction.getDataPointer());
+
+    I2cShadowRegister *shadowRegister = find(transaction.getRegister());
+    if(shadowRegister)
+    {
+        shadowRegister->pendingWrites--;
+        shadowRegister->valid = false;
+    }
+
+    stats.writes--;
+}
+
+void I2cRegisterShadow::record(I2cTransaction &transaction)
+{
+    uint8_t *data = transaction.getDataPointer();
+    bool write = transaction.getDirection() == TRANSACTION_TX;
+
+    if(transaction.getRegisterBytes() != registerBytes || valueBytes == 0)
+    {
+        if(write)
+            releaseWrite(data);
+
+        return;
+    }
+
+    // Written by the bus or not, the bytes of a shadowed write aren't needed anymore.
+    if(write && releaseWrite(data))
+    {
+        I2cShadowRegister *shadowRegister = find(transaction.getRegister());
+        if(shadowRegister)
+            shadowRegister->pendingWrites--;
+    }
+
+    uint16_t first = transaction.getRegister();
+    uint16_t registersCovered = (transaction.getDataLenthBytes() + valueBytes - 1) / valueBytes;
+    bool single = transaction.getDataLenthBytes() == valueBytes;
+    bool succeeded = transaction.getStatus() == I2C_OK;
+
+    for(size_t i = 0; i < count; i++)
+    {
+        I2cShadowRegister &shadowRegister = registers[i];
+        if(shadowRegister.deviceRegister < first || shadowRegister.deviceRegister >= first + registersCovered)
+            continue;
+
+        // A newer write is still queued, its value is already in the shadow.
+        if(shadowRegister.pendingWrites != 0)
+            continue;
+
+        if(single && succeeded)
+        {
+            shadowRegister.value = decode(data);
+            shadowRegister.valid = true;
+        }
+        // A failed read leaves the register as it was, anything else leaves it unknown.
+        else if(write || succeeded)
+        {
+            shadowRegister.valid = false;
+        }
+    }
+}
+
+void I2cRegisterShadow::countAvoidedRead(void)
+{
+    stats.avoidedReads++;
+}
+
+RegisterLength I2cRegisterShadow::getRegisterBytes(void)
+{
+    return registerBytes;
+}
+
+uint8_t I2cRegisterShadow::getValueBytes(void)
+{
+    return valueBytes;
+}
+
+const I2cShadowStats& I2cRegisterShadow::getStats(void)
+{
+    return stats;
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "i2c_stats.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#include "i2c_hal.hpp"
+
+
+#ifdef I2C_DRIVER_HOST_SIM
+static I2cCycleClock cycleClock = nullptr;
+#else
+static uint32_t readCycleCounter(void)
+{
+    return DWT->CYCCNT;
+}
+
+static I2cCycleClock cycleClock = readCycleCounter;
+#endif
+
+void i2cSetCycleClock(I2cCycleClock clock)
+{
+    cycleClock = clock;
+}
+
+void i2cStartCycleClock(void)
+{
+#ifndef I2C_DRIVER_HOST_SIM
+    if(cycleClock != readCycleCounter)
+        return;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+uint32_t i2cGetCycles(void)
+{
+    return cycleClock ? cycleClock() : 0;
+}
+
+void I2cLatencyStats::record(uint32_t cycles)
+{
+    count++;
+    total += cycles;
+    min = std::min(min, cycles);
+    max = std::max(max, cycles);
+    histogram[std::bit_width(cycles)]++;
+}
+
+void I2cLatencyStats::reset(void)
+{
+    *this = I2cLatencyStats();
+}
+
+uint32_t I2cLatencyStats::getCount(void) const
+{
+    return count;
+}
+
+uint32_t I2cLatencyStats::getMin(void) const
+{
+    return count ? min : 0;
+}
+
+uint32_t I2cLatencyStats::getMax(void) const
+{
+    return max;
+}
+
+uint32_t I2cLatencyStats::getMean(void) const
+{
+    return count ? static_cast<uint32_t>(total / count) : 0;
+}
+
+const std::array<uint32_t, I2C_STATS_HISTOGRAM_BINS>& I2cLatencyStats::getHistogram(void) const
+{
+    return histogram;
+}
\ No newline at end of file
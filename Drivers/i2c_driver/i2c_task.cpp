@@ -0,0 +1,225 @@
+#include "i2c_task.hpp"
+
+#include <exception>
+
+#include "i2c_device.hpp"
+
+
+static_assert(I2C_TASK_MAX_FRAMES <= 32, "The frame pool is tracked with a 32 bit mask");
+
+alignas(std::max_align_t) static uint8_t framePool[I2C_TASK_MAX_FRAMES][I2C_TASK_FRAME_BYTES];
+
+// Bit n set: frame n in use. Only touched from the main loop.
+static uint32_t usedFrames = 0;
+
+std::atomic<I2cRunNode*> I2cScheduler::ready = nullptr;
+
+I2cTask I2cTask::promise_type::get_return_object(void)
+{
+    return I2cTask(std::coroutine_handle<promise_type>::from_promise(*this));
+}
+
+I2cTask I2cTask::promise_type::get_return_object_on_allocation_failure(void)
+{
+    return I2cTask();
+}
+
+std::suspend_always I2cTask::promise_type::initial_suspend(void) noexcept
+{
+    return {};
+}
+
+std::suspend_never I2cTask::promise_type::final_suspend(void) noexcept
+{
+    return {};
+}
+
+void I2cTask::promise_type::return_void(void)
+{
+
+}
+
+void I2cTask::promise_type::unhandled_exception(void)
+{
+    // Nobody is waiting on a task to rethrow to.
+    std::terminate();
+}
+
+void* I2cTask::promise_type::operator new(size_t size) noexcept
+{
+    if(size > I2C_TASK_FRAME_BYTES)
+    {
+        return nullptr;
+    }
+
+    for(size_t i = 0; i < I2C_TASK_MAX_FRAMES; i++)
+    {
+        if(!(usedFrames & (1UL << i)))
+        {
+            usedFrames |= (1UL << i);
+            return framePool[i];
+        }
+    }
+
+    return nullptr;
+}
+
+void I2cTask::promise_type::operator delete(void* frame)
+{
+    size_t index = (static_cast<uint8_t*>(frame) - &framePool[0][0]) / I2C_TASK_FRAME_BYTES;
+    usedFrames &= ~(1UL << index);
+}
+
+I2cTask::I2cTask(std::coroutine_handle<promise_type> handle) : handle(handle)
+{
+
+}
+
+I2cTask::I2cTask(I2cTask&& task) : handle(task.handle)
+{
+    task.handle = nullptr;
+}
+
+I2cTask::~I2cTask()
+{
+    if(handle)
+    {
+        handle.destroy();
+    }
+}
+
+bool I2cTask::isValid(void)
+{
+    return handle != nullptr;
+}
+
+I2cStatus I2cScheduler::spawn(I2cTask task)
+{
+    if(!task.isValid())
+    {
+        return i2cRaise(I2C_ERROR_NO_TASK_FRAME);
+    }
+
+    I2cRunNode &node = task.handle.promise().node;
+    node.handle = task.handle;
+    task.handle = nullptr;
+
+    schedule(node);
+
+    return I2C_OK;
+}
+
+void I2cScheduler::schedule(I2cRunNode &node)
+{
+    // Lock-free push; the order is restored by run().
+    I2cRunNode *head = ready.load(std::memory_order_relaxed);
+    do
+    {
+        node.next = head;
+    }
+    while(!ready.compare_exchange_weak(head, &node, std::memory_order_release, std::memory_order_relaxed));
+}
+
+size_t I2cScheduler::run(void)
+{
+    size_t resumed = 0;
+
+    // Resuming may schedule again, those coroutines wait for the next call.
+    I2cRunNode *node = ready.exchange(nullptr, std::memory_order_acquire);
+
+    I2cRunNode *ordered = nullptr;
+    while(node)
+    {
+        I2cRunNode *next = node->next;
+        node->next = ordered;
+        ordered = node;
+        node = next;
+    }
+
+    while(ordered)
+    {
+        // The node may be reused (or its frame released) as soon as the coroutine runs.
+        I2cRunNode *next = ordered->next;
+        ordered->handle.resume();
+        ordered = next;
+        resumed++;
+    }
+
+    return resumed;
+}
+
+size_t I2cScheduler::getFreeFrames(void)
+{
+    size_t freeFrames = 0;
+    for(size_t i = 0; i < I2C_TASK_MAX_FRAMES; i++)
+    {
+        if(!(usedFrames & (1UL << i)))
+            freeFrames++;
+    }
+
+    return freeFrames;
+}
+
+I2cTransactionAwaiter::I2cTransactionAwaiter(
+    I2cDevice *device,
+    TransactionDirection direction,
+    uint8_t* data,
+    uint16_t dataBytes,
+    uint16_t deviceRegister,
+    RegisterLength deviceRegisterBytes
+) : device(device),
+    direction(direction),
+    data(data),
+    dataBytes(dataBytes),
+    deviceRegister(deviceRegister),
+    deviceRegisterBytes(deviceRegisterBytes)
+{
+
+}
+
+void I2cTransactionAwaiter::complete(void* parameters)
+{
+    // Runs in the completion interrupt, the status was already written by the bus.
+    I2cTransactionAwaiter *awaiter = static_cast<I2cTransactionAwaiter*>(parameters);
+
+    I2cScheduler::schedule(*awaiter->node);
+}
+
+bool I2cTransactionAwaiter::await_ready(void)
+{
+    return false;
+}
+
+bool I2cTransactionAwaiter::await_suspend(std::coroutine_handle<I2cTask::promise_type> handle)
+{
+    node = &handle.promise().node;
+    node->handle = handle;
+
+    // Nothing here may raise: the exception would reach unhandled_exception and terminate. A
+    // failure resumes the coroutine right away with the status instead.
+    I2cTransaction *transaction = device->acquireTransaction(direction, data, dataBytes, deviceRegister, deviceRegisterBytes, status);
+    if(!transaction)
+    {
+        return false;
+    }
+
+    transaction->setPostCallback(complete, this);
+    transaction->setStatusOutput(&status);
+    // Only pushes the coroutine to the run queue, no need to defer it.
+    transaction->setImmediateCallback(true);
+
+    // Once published, the completion callback resumes the coroutine (and sets the status).
+    I2cStatus publishStatus = device->publishTransaction();
+    if(publishStatus != I2C_OK)
+    {
+        status = publishStatus;
+        return false;
+    }
+
+    return true;
+}
+
+I2cStatus I2cTransactionAwaiter::await_resume(void)
+{
+    return status;
+}
\ No newline at end of file
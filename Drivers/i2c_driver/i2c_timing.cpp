@@ -0,0 +1,54 @@
+#include "i2c_timing.hpp"
+
+// CCR field: 12 bits, at least 4 in standard mode and 1 in fast mode.
+#define I2C_CCR_MAX              0xFFF
+#define I2C_CCR_MIN_STANDARD     4
+#define I2C_CCR_MIN_FAST         1
+
+// Longest SCL rise time allowed by the mode, in ns.
+#define I2C_RISE_TIME_STANDARD   1000
+#define I2C_RISE_TIME_FAST       300
+
+
+I2cStatus i2cComputeTiming(uint32_t pclk1, uint32_t clockSpeed, I2cDutyCycle dutyCycle, I2cTiming &timing)
+{
+    if(clockSpeed == 0 || clockSpeed > I2C_FAST_MODE_MAX_FREQUENCY)
+    {
+        return I2C_ERROR_INVALID_CLOCK;
+    }
+
+    bool fastMode = clockSpeed > I2C_STANDARD_MODE_MAX_FREQUENCY;
+    if(pclk1 < (fastMode ? I2C_PCLK1_MIN_FAST : I2C_PCLK1_MIN_STANDARD) || pclk1 > I2C_PCLK1_MAX)
+    {
+        return I2C_ERROR_INVALID_CLOCK;
+    }
+
+    // PCLK1 cycles per unit of CCR: high and low time of SCL are CCR each in standard mode, 1:2 or
+    // 9:16 units of CCR in fast mode.
+    uint32_t coefficient = !fastMode ? 2 : (dutyCycle == I2C_DUTY_CYCLE_16_9 ? 25 : 3);
+
+    // Same rounding as HAL_I2C_Init(), up to the next slower SCL.
+    uint32_t ccr = (pclk1 - 1) / (clockSpeed * coefficient) + 1;
+    uint32_t ccrMin = fastMode ? I2C_CCR_MIN_FAST : I2C_CCR_MIN_STANDARD;
+    if(ccr < ccrMin)
+    {
+        ccr = ccrMin;
+    }
+
+    if(ccr > I2C_CCR_MAX)
+    {
+        return I2C_ERROR_INVALID_CLOCK;
+    }
+
+    uint32_t pclk1Mhz = pclk1 / 1000000;
+
+    timing.pclk1 = pclk1;
+    timing.ccr = ccr;
+    timing.trise = pclk1Mhz * (fastMode ? I2C_RISE_TIME_FAST : I2C_RISE_TIME_STANDARD) / 1000 + 1;
+    timing.fastMode = fastMode;
+    timing.dutyCycle = fastMode ? dutyCycle : I2C_DUTY_CYCLE_2;
+    timing.sclFrequency = pclk1 / (ccr * coefficient);
+    timing.exact = pclk1 % (ccr * coefficient) == 0 && timing.sclFrequency == clockSpeed;
+
+    return I2C_OK;
+}
\ No newline at end of file
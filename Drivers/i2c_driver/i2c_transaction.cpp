@@ -4,7 +4,7 @@
 
 
 I2cTransaction::I2cTransaction()
-    : data(nullptr), dataBytes(0), device(nullptr)
+    : data(nullptr), device(nullptr), dataBytes(0)
 {
 
 }
@@ -20,10 +20,13 @@ I2cTransaction I2cTransaction::I2cRxTransaction(I2cDevice *device, uint8_t* data
 }
 
 I2cTransaction::I2cTransaction(TransactionDirection direction, uint8_t* data, uint16_t dataBytes, I2cDevice *device, uint16_t address, uint16_t deviceRegister, RegisterLength deviceRegisterBytes)
-    : direction(direction), address(address), data(data), dataBytes(dataBytes), device(device), deviceRegister(deviceRegister), deviceRegisterBytes(deviceRegisterBytes)
+    : data(data), device(device), address(address), dataBytes(dataBytes), deviceRegister(deviceRegister), direction(direction), deviceRegisterBytes(deviceRegisterBytes)
 {
+    if(device)
+        priority = device->getPriority();
+
     if(deviceRegisterBytes == REGISTER_NULL && deviceRegister != 0)
-        throw I2cException("Configured register but not register length");
+        status = i2cRaise(I2C_ERROR_INVALID_REGISTER);
 }
 
 I2cTransaction::I2cTransaction(TransactionDirection direction, uint8_t* data, uint16_t dataBytes, uint16_t address, uint16_t deviceRegister, RegisterLength deviceRegisterBytes)
@@ -39,15 +42,28 @@ I2cTransaction::I2cTransaction(TransactionDirection direction, uint8_t* data, ui
 }
 
 void I2cTransaction::setPreCallback(Callback callback, void* parameters)
+{
+    preCallbackFunction = I2cCallback(callback, parameters);
+}
+
+void I2cTransaction::setPreCallback(I2cCallback callback)
 {
     preCallbackFunction = callback;
-    preCallbackParameters = parameters;
 }
 
 void I2cTransaction::setPostCallback(Callback callback, void* parameters)
+{
+    postCallbackFunction = I2cCallback(callback, parameters);
+}
+
+void I2cTransaction::setPostCallback(I2cCallback callback)
 {
     postCallbackFunction = callback;
-    postCallbackParameters = parameters;
+}
+
+void I2cTransaction::setTransferMode(I2cTransferMode transferMode)
+{
+    this->transferMode = transferMode;
 }
 
 uint16_t I2cTransaction::getAddress(void)
@@ -55,6 +71,11 @@ uint16_t I2cTransaction::getAddress(void)
     return address;
 }
 
+I2cDevice* I2cTransaction::getDevice(void)
+{
+    return device;
+}
+
 uint8_t* I2cTransaction::getDataPointer(void)
 {
     return data;
@@ -80,22 +101,111 @@ TransactionDirection I2cTransaction::getDirection(void)
     return direction;
 }
 
-void I2cTransaction::send(void)
+I2cTransferMode I2cTransaction::getTransferMode(void)
+{
+    return transferMode;
+}
+
+void I2cTransaction::setPriority(I2cPriority priority)
 {
+    this->priority = priority;
+}
+
+I2cPriority I2cTransaction::getPriority(void)
+{
+    return priority;
+}
+
+void I2cTransaction::setSequenceFrame(I2cSequenceFrame sequenceFrame)
+{
+    this->sequenceFrame = sequenceFrame;
+}
+
+I2cSequenceFrame I2cTransaction::getSequenceFrame(void)
+{
+    return sequenceFrame;
+}
+
+bool I2cTransaction::continuesSequence(void)
+{
+    return sequenceFrame == I2C_FRAME_FIRST || sequenceFrame == I2C_FRAME_NEXT;
+}
+
+I2cStatus I2cTransaction::getStatus(void)
+{
+    return status;
+}
+
+void I2cTransaction::setStatus(I2cStatus status)
+{
+    this->status = status;
+}
+
+void I2cTransaction::setStatusOutput(I2cStatus *output)
+{
+    statusOutput = output;
+}
+
+void I2cTransaction::setImmediateCallback(bool immediate)
+{
+    immediateCallback = immediate;
+}
+
+bool I2cTransaction::isCallbackImmediate(void)
+{
+    return immediateCallback;
+}
+
+uint8_t I2cTransaction::getAttempts(void)
+{
+    return attempts;
+}
+
+void I2cTransaction::addAttempt(void)
+{
+    if(attempts < UINT8_MAX)
+        attempts++;
+}
+
+void I2cTransaction::resetAttempts(void)
+{
+    attempts = 0;
+}
+
+void I2cTransaction::finish(I2cStatus status)
+{
+    this->status = status;
+    if(statusOutput)
+        *statusOutput = status;
+
+    if(device)
+        device->recordTransaction(*this);
+}
+
+I2cCompletion I2cTransaction::getCompletion(void)
+{
+    return postCallbackFunction;
+}
+
+I2cStatus I2cTransaction::send(void)
+{
+    if(status != I2C_OK)
+        return i2cRaise(status);
+
     if(!device)
-        throw I2cException("Device for the I2cTransaction not set");
+        return i2cRaise(I2C_ERROR_NO_DEVICE);
 
-    device->setTransaction(*this);
+    return device->setTransaction(*this);
 }
 
 void I2cTransaction::preCallback()
 {
     if(preCallbackFunction)
-        preCallbackFunction(preCallbackParameters);
+        preCallbackFunction();
 }
 
 void I2cTransaction::postCallback()
 {
     if(postCallbackFunction)
-        postCallbackFunction(postCallbackParameters);
+        postCallbackFunction();
 }
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "i2c_transaction_chain.hpp"
+#include "i2c_device.hpp"
+
+
+I2cTransactionChain::I2cTransactionChain(I2cDevice *device)
+    : device(device), priority(device ? device->getPriority() : I2C_PRIORITY_NORMAL)
+{
+
+}
+
+I2cStatus I2cTransactionChain::addFrame(TransactionDirection direction, uint8_t* data, uint16_t dataBytes)
+{
+    if(!device)
+    {
+        return i2cRaise(I2C_ERROR_NO_DEVICE);
+    }
+
+    if(frameCount >= frames.size())
+    {
+        return i2cRaise(I2C_ERROR_CHAIN_FULL);
+    }
+
+    frames[frameCount++] = I2cTransaction(direction, data, dataBytes, device);
+
+    return I2C_OK;
+}
+
+I2cStatus I2cTransactionChain::addWrite(uint8_t* data, uint16_t dataBytes)
+{
+    return addFrame(TRANSACTION_TX, data, dataBytes);
+}
+
+I2cStatus I2cTransactionChain::addRead(uint8_t* data, uint16_t dataBytes)
+{
+    return addFrame(TRANSACTION_RX, data, dataBytes);
+}
+
+void I2cTransactionChain::setPreCallback(Callback callback, void* parameters)
+{
+    preCallbackFunction = I2cCallback(callback, parameters);
+}
+
+void I2cTransactionChain::setPreCallback(I2cCallback callback)
+{
+    preCallbackFunction = callback;
+}
+
+void I2cTransactionChain::setPostCallback(Callback callback, void* parameters)
+{
+    postCallbackFunction = I2cCallback(callback, parameters);
+}
+
+void I2cTransactionChain::setPostCallback(I2cCallback callback)
+{
+    postCallbackFunction = callback;
+}
+
+void I2cTransactionChain::setStatusOutput(I2cStatus *output)
+{
+    statusOutput = output;
+}
+
+void I2cTransactionChain::complete(void* parameters)
+{
+    I2cTransactionChain *chain = static_cast<I2cTransactionChain*>(parameters);
+
+    if(chain->statusOutput)
+    {
+        *chain->statusOutput = chain->getStatus();
+    }
+
+    if(chain->postCallbackFunction)
+    {
+        chain->postCallbackFunction();
+    }
+}
+
+void I2cTransactionChain::setPriority(I2cPriority priority)
+{
+    this->priority = priority;
+}
+
+uint8_t I2cTransactionChain::getFrameCount(void)
+{
+    return frameCount;
+}
+
+I2cStatus I2cTransactionChain::getStatus(void)
+{
+    uint8_t failedFrame = getFailedFrame();
+
+    return failedFrame < frameCount ? frameStatus[failedFrame] : I2C_OK;
+}
+
+uint8_t I2cTransactionChain::getFailedFrame(void)
+{
+    // The frames after the failing one only report the abort.
+    for(uint8_t i = 0; i < frameCount; i++)
+    {
+        if(frameStatus[i] != I2C_OK)
+            return i;
+    }
+
+    return frameCount;
+}
+
+void I2cTransactionChain::clear(void)
+{
+    frameCount = 0;
+}
+
+I2cStatus I2cTransactionChain::send(void)
+{
+    if(frameCount == 0)
+    {
+        return i2cRaise(I2C_ERROR_CHAIN_EMPTY);
+    }
+
+    for(uint8_t i = 0; i < frameCount; i++)
+    {
+        I2cSequenceFrame sequenceFrame = I2C_FRAME_NEXT;
+        if(frameCount == 1)
+            sequenceFrame = I2C_FRAME_SINGLE;
+        else if(i == 0)
+            sequenceFrame = I2C_FRAME_FIRST;
+        else if(i == frameCount - 1)
+            sequenceFrame = I2C_FRAME_LAST;
+
+        frames[i].setSequenceFrame(sequenceFrame);
+        frames[i].setPriority(priority);
+        frames[i].setPreCallback(I2cCallback());
+        frames[i].setPostCallback(I2cCallback());
+
+        frameStatus[i] = I2C_OK;
+        frames[i].setStatusOutput(&frameStatus[i]);
+    }
+
+    frames[0].setPreCallback(preCallbackFunction);
+    frames[frameCount - 1].setPostCallback(complete, this);
+
+    return device->setTransactions(frames.data(), frameCount);
+}
\ No newline at end of file
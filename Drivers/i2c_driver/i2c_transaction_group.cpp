@@ -0,0 +1,158 @@
+#include "i2c_transaction_group.hpp"
+
+#include "i2c_bus.hpp"
+#include "i2c_device.hpp"
+
+
+void I2cTransactionGroup::memberComplete(void* parameters)
+{
+    I2cGroupMember *member = static_cast<I2cGroupMember*>(parameters);
+
+    if(member->completion)
+    {
+        member->completion();
+    }
+
+    member->group->finishMember(*member);
+}
+
+void I2cTransactionGroup::finishMember(I2cGroupMember &member)
+{
+    I2cStatus firstStatus = I2C_OK;
+    if(member.status != I2C_OK)
+    {
+        status.compare_exchange_strong(firstStatus, member.status, std::memory_order_acq_rel);
+    }
+
+    // Only the last member to finish sees 1, whichever bus it's on.
+    if(remaining.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    {
+        return;
+    }
+
+    completedCycles = i2cGetCycles() - startedCycles;
+
+    if(completionFunction)
+    {
+        completionFunction(completionParameters);
+    }
+}
+
+I2cStatus I2cTransactionGroup::add(const I2cTransaction &transaction)
+{
+    if(count == members.size())
+    {
+        return i2cRaise(I2C_ERROR_GROUP_FULL);
+    }
+
+    if(!isComplete())
+    {
+        return i2cRaise(I2C_ERROR_GROUP_BUSY);
+    }
+
+    I2cGroupMember &member = members[count];
+    member.transaction = transaction;
+    if(!member.transaction.getDevice())
+    {
+        return i2cRaise(I2C_ERROR_NO_DEVICE);
+    }
+
+    member.completion = member.transaction.getCompletion();
+    member.status = I2C_OK;
+    member.group = this;
+
+    member.transaction.setStatusOutput(&member.status);
+    member.transaction.setPostCallback(memberComplete, &member);
+
+    count++;
+
+    return I2C_OK;
+}
+
+void I2cTransactionGroup::setCompletionCallback(Callback callback, void* parameters)
+{
+    completionFunction = callback;
+    completionParameters = parameters;
+}
+
+I2cStatus I2cTransactionGroup::start(void)
+{
+    if(count == 0)
+    {
+        return i2cRaise(I2C_ERROR_GROUP_EMPTY);
+    }
+
+    if(!isComplete())
+    {
+        return i2cRaise(I2C_ERROR_GROUP_BUSY);
+    }
+
+    status.store(I2C_OK, std::memory_order_relaxed);
+    completedCycles = 0;
+    startedCycles = i2cGetCycles();
+
+    // Counted before anything is queued: an idle bus may finish its member right away.
+    remaining = count;
+
+    for(size_t i = 0; i < count; i++)
+    {
+        I2cGroupMember &member = members[i];
+        member.status = I2C_OK;
+
+        // Nothing may raise halfway, the members already queued would never be counted. The queue
+        // is only checked by queueing: an interrupt may fill it after any earlier check.
+        I2cBus *bus = member.transaction.getDevice()->getBus();
+
+        I2cStatus memberStatus = member.transaction.getStatus();
+        if(!bus)
+            memberStatus = I2C_ERROR_NO_BUS;
+        else if(memberStatus == I2C_OK)
+            memberStatus = bus->queueTransactions(&member.transaction, 1);
+
+        if(memberStatus != I2C_OK)
+        {
+            member.status = memberStatus;
+            memberComplete(&member);
+        }
+    }
+
+    return I2C_OK;
+}
+
+bool I2cTransactionGroup::isComplete(void)
+{
+    return remaining.load(std::memory_order_acquire) == 0;
+}
+
+I2cStatus I2cTransactionGroup::getStatus(void)
+{
+    return status.load(std::memory_order_acquire);
+}
+
+I2cStatus I2cTransactionGroup::getStatus(size_t index)
+{
+    if(index >= count)
+    {
+        return I2C_ERROR_NO_DEVICE;
+    }
+
+    return members[index].status;
+}
+
+uint32_t I2cTransactionGroup::getDuration(void)
+{
+    return completedCycles;
+}
+
+size_t I2cTransactionGroup::size(void)
+{
+    return count;
+}
+
+void I2cTransactionGroup::clear(void)
+{
+    if(isComplete())
+    {
+        count = 0;
+    }
+}
\ No newline at end of file
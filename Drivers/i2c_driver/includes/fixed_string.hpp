@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+
+// Characters kept of the name of a bus or device, longer names are cut.
+#ifndef I2C_NAME_LENGTH
+#define I2C_NAME_LENGTH 15
+#endif
+
+/*
+ *  @brief String stored inline, in place of std::string for names that must not touch the heap.
+ *  Holds up to Capacity characters, longer strings are truncated.
+ */
+template <size_t Capacity>
+class FixedString
+{
+    protected:
+        char characters[Capacity + 1] = {};
+
+        size_t count = 0;
+
+    public:
+        FixedString(void) = default;
+
+        FixedString(const char* string)
+        {
+            assign(string);
+        }
+
+        /*
+         *  @brief Copies the string, up to Capacity characters. nullptr empties it.
+         */
+        void assign(const char* string)
+        {
+            count = 0;
+            while(string != nullptr && count < Capacity && string[count] != '\0')
+            {
+                characters[count] = string[count];
+                count++;
+            }
+
+            characters[count] = '\0';
+        }
+
+        const char* c_str(void) const
+        {
+            return characters;
+        }
+
+        size_t length(void) const
+        {
+            return count;
+        }
+
+        bool empty(void) const
+        {
+            return count == 0;
+        }
+
+        static constexpr size_t capacity(void)
+        {
+            return Capacity;
+        }
+};
\ No newline at end of file
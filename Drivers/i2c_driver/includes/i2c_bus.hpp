@@ -2,37 +2,45 @@
 
 #include <stdint.h>
 #include <array>
-#include "stm32f4xx_hal.h"
+#include <type_traits>
+#include "i2c_hal.hpp"
 
+#include "i2c_bus_traits.hpp"
+#include "i2c_direct_transfer.hpp"
 #include "i2c_driver_exceptions.hpp"
+#include "fixed_string.hpp"
+#include "i2c_register_file.hpp"
+#include "i2c_stats.hpp"
+#include "i2c_timing.hpp"
 #include "i2c_transaction.hpp"
 
 #include "queue.hpp"
 
-#define I2C_BUS_MAX 3
-
-typedef enum
-{
-    I2C_BUS_1,
-    I2C_BUS_2,
-    I2C_BUS_3
-}
-I2cBusSelection;
-
 typedef enum
 {
     I2C_EVENT,
-    I2C_ERROR
+    I2C_ERROR,
+    I2C_DMA_RX,
+    I2C_DMA_TX
 }
 I2cInterruptType;
 
-typedef enum
-{
-    I2C_DUTY_CYCLE_2,
-    I2C_DUTY_CYCLE_16_9
+// SMBus tTIMEOUT: no transfer of the driver takes this long on a healthy bus.
+#define I2C_DEFAULT_TIMEOUT_MS 25
 
-}
-I2cDutyCycle;
+// NACKed transactions that can wait for a retry at the same time, per bus.
+#ifndef I2C_RETRY_SLOTS
+#define I2C_RETRY_SLOTS 4
+#endif
+
+// Longest burst of coalesced reads and reads merged into one (see I2cDevice::setReadCoalescing).
+#ifndef I2C_BURST_MAX_BYTES
+#define I2C_BURST_MAX_BYTES 32
+#endif
+
+#ifndef I2C_BURST_MAX_READS
+#define I2C_BURST_MAX_READS 8
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -43,30 +51,153 @@ void I2C2_ER_IRQHandler(void);
 void I2C2_EV_IRQHandler(void);
 void I2C3_ER_IRQHandler(void);
 void I2C3_EV_IRQHandler(void);
+void DMA1_Stream0_IRQHandler(void);
+void DMA1_Stream2_IRQHandler(void);
+void DMA1_Stream3_IRQHandler(void);
+void DMA1_Stream4_IRQHandler(void);
+void DMA1_Stream6_IRQHandler(void);
+void DMA1_Stream7_IRQHandler(void);
+void I2C_DeferredCompletionHandler(void);
 #ifdef __cplusplus
 }
 #endif
 
 class I2cDevice;
 
+/*
+ *  NACKed transaction waiting out the backoff of its device before the next attempt.
+ */
+typedef struct
+{
+    I2cTransaction transaction;
+    // Transaction linked by a queue of references, which gets the outcome of the retries back.
+    // nullptr if the queue held a copy.
+    I2cTransaction *origin;
+    uint32_t dueTick;
+    bool used;
+}
+I2cRetrySlot;
+
 class I2cBus
 {
     protected:
         static std::array<I2cBus*, I2C_BUS_MAX> drivers;
 
-        static void handleInterrupt(I2cBusSelection bus, I2cInterruptType type);
+        /*
+         *  @brief Forwards an interrupt to the HAL handler of the bus, or to the direct engine while
+         *  it has a transfer in progress. Bus and interrupt type are resolved at compile time, so
+         *  each IRQ handler inlines to a load of its driver and a direct call.
+         */
+        template <I2cBusSelection Bus, I2cInterruptType Type>
+        static void handleInterrupt(void);
 
+        // Queue given on construction, used by every priority class without a queue of its own.
         Queue<I2cTransaction> *queue;
 
-        I2cTransaction* currentTransaction;
+        std::array<Queue<I2cTransaction>*, I2C_PRIORITY_CLASSES> queues;
+
+        // Transaction being transferred, nullptr while the bus is idle. Shared with the ISR.
+        I2cTransaction* volatile currentTransaction = nullptr;
+
+        // Queue the current transaction was taken from, nullptr if it's a retry.
+        Queue<I2cTransaction> *currentQueue = nullptr;
+
+        std::array<I2cRetrySlot, I2C_RETRY_SLOTS> retries = {};
+
+        // Burst read standing in for the coalesced reads at the front of currentQueue.
+        I2cTransaction burstTransaction;
+
+        std::array<uint8_t, I2C_BURST_MAX_BYTES> burstBuffer = {};
+
+        // Reads merged into the burst in flight, 0 if the current transaction isn't a burst.
+        size_t burstReads = 0;
+
+        // Queue of the sequence in progress, its remaining frames are sent before anything else.
+        Queue<I2cTransaction> *sequenceQueue = nullptr;
+
+        // Interrupt mask taken by acquireTransaction(), restored by publishTransaction().
+        uint32_t acquireMask = 0;
+
+        // A slot was acquired and interrupts stay masked until it is published.
+        bool acquired = false;
+
+        // Completion path for the type of the queues (see I2cQueuedBus), through the virtual
+        // interface of Queue unless every priority class uses the same final queue type.
+        void (I2cBus::*completeFunction)(void) = &I2cBus::completeTransaction<Queue<I2cTransaction>>;
+
+        // Post callbacks waiting to run outside the interrupt. nullptr: they run in the interrupt.
+        Queue<I2cCompletion> *completions = nullptr;
+
+        // Pend PendSV when a completion is deferred, so it is drained from there.
+        bool completionsPendSv = false;
 
         I2C_HandleTypeDef handle = {};
 
+        DMA_HandleTypeDef dmaRxHandle = {};
+
+        DMA_HandleTypeDef dmaTxHandle = {};
+
         I2cBusSelection bus;
 
-        bool fastMode;
+        I2cTransferMode transferMode;
+
+        bool dmaEnabled = false;
+
+        // Engine of the I2C_TRANSFER_DIRECT transactions.
+        I2cDirectTransfer directTransfer;
+
+        // Clock control derived from PCLK1 on construction.
+        I2cTiming timing = {};
+
+        // Constructed without slave addresses, it can't serve a register file.
+        bool masterOnly;
+
+        // Registers served to the hosts, nullptr while the bus isn't in slave mode.
+        I2cRegisterFile *registerFile = nullptr;
+
+        // Result of the construction, I2C_OK if the bus is ready to be used.
+        I2cStatus status = I2C_OK;
+
+        // Longest a transfer may take before checkTimeout() recovers the bus, 0 disables it.
+        uint32_t timeout = I2C_DEFAULT_TIMEOUT_MS;
+
+        // HAL tick when the current transaction was handed to the HAL.
+        uint32_t transferStartTick = 0;
+
+        // A transfer failed in a way that needs the bus recovered (see runRecovery). Set by the
+        // error interrupt, nothing is sent until then.
+        volatile bool recoveryPending = false;
+
+        // Status the failed transaction is completed with if the recovery succeeds.
+        I2cStatus recoveryError = I2C_OK;
+
+        FixedString<I2C_NAME_LENGTH> name;
+
+#if I2C_DRIVER_STATS
+        std::array<I2cDeviceStats, I2C_STATS_MAX_DEVICES> deviceStats = {};
+
+        // Queue wait per priority class.
+        std::array<I2cLatencyStats, I2C_PRIORITY_CLASSES> priorityStats = {};
+
+        size_t deviceStatsCount = 0;
+
+        // Duration of the bus recoveries.
+        I2cLatencyStats recoveryStats = {};
 
-        std::string name;
+        // Duration of the event and error interrupts.
+        I2cLatencyStats interruptStats = {};
+
+        /*
+         *  @brief Returns the statistics of the address, taking a free entry the first time it is
+         *  seen. nullptr if every entry is used by other addresses.
+         */
+        I2cDeviceStats* findDeviceStats(uint16_t address);
+
+        /*
+         *  @brief Records the queue wait and wire time of a completed transaction.
+         */
+        void recordStats(I2cTransaction &transaction, uint32_t completedCycles);
+#endif
 
         /*
          *  @brief Initializes the I2C handle with the given parameters
@@ -77,12 +208,12 @@ class I2cBus
          *	@param generalCall Configure if the bus should accept general calls.
          *	@param clockStretching Configure if the bus should use clock stretching.
          *	@param dualAddress Configure if the bus should use dual addresses in slave mode.
-         *	@param ownAddress1 Configure address 1 for the bus in slave mode.
-         *	@param ownAddress2 Configure address 2 for the bus in slave mode.
+         *	@param ownAddress1 Configure address 1 for the bus in slave mode (not shifted).
+         *	@param ownAddress2 Configure address 2 for the bus in slave mode (not shifted).
          *
-         *  @throws I2cException: If there's a HAL error.
+         *  @return I2C_ERROR_HAL: If there's a HAL error.
          */
-        void initHandle(
+        I2cStatus initHandle(
             uint32_t clockSpeed,
             bool addressing7Bit,
             I2cDutyCycle dutyCycle,
@@ -96,16 +227,49 @@ class I2cBus
         /*
          *  @brief Registers the interrupt callbacks to the HAL handle.
          *
-         *  @throws I2cException: If there's a HAL error.
+         *  @return I2C_ERROR_HAL: If there's a HAL error.
          */
-        void registerCallbacks(void);
+        I2cStatus registerCallbacks(void);
+
+        I2cStatus registerDriver(I2cBusSelection bus);
 
-        void registerDriver(I2cBusSelection bus);
+        const I2cBusConfig& getConfig(void);
 
         void initGpio(void);
 
         void initNvic(void);
 
+        /*
+         *  @brief Claims the DMA1 RX and TX streams of the bus (see I2cBusTraits) and links them to
+         *  the I2C handle.
+         *
+         *  @return I2C_ERROR_HAL: If there's a HAL error.
+         */
+        I2cStatus initDma(void);
+
+        /*
+         *  @brief Resolves the engine to be used for a transaction, falling back to interrupts when
+         *  DMA is not enabled on the bus or the transfer is too short to benefit from it, and when
+         *  the direct engine doesn't handle the transfer (see I2cDirectTransfer).
+         */
+        I2cTransferMode resolveTransferMode(I2cTransaction &transaction);
+
+        /*
+         *  @brief Returns the queue of the priority class, nullptr if the priority is invalid.
+         */
+        Queue<I2cTransaction>* getQueue(I2cPriority priority);
+
+        /*
+         *  @brief Picks the queue to take the next transaction from: the one of the sequence in
+         *  progress, otherwise the highest priority class with pending transactions.
+         *
+         *  The completion path is templated on the type of the queues: Queue<I2cTransaction> calls
+         *  them through their virtual interface, a final queue type directly so the calls inline.
+         *  Every queue of the bus must be a QueueType.
+         */
+        template <typename QueueType = Queue<I2cTransaction>>
+        QueueType* selectQueue(void);
+
         /*
          *  @brief Checks whether the addresses are valid, taking into account the addressing mode
          *  (7 bit or 10 bit) and the dual or single address configuration
@@ -114,23 +278,206 @@ class I2cBus
          *	@param ownAddress2 Address 2 to be checked
          *	@param dualAddress Whether dual slave addresses mode is used.
          *	@param addressing7bit Addressing mode to consider (false: 10 bit- true: 7 bit)
-         *
-         *  @throws I2cException: When the provided parameters are not in a valid state.
          */
         bool areAddressesValid(uint16_t ownAddress1, uint16_t ownAddress2, bool dualAddress, bool addressing7bit);
 
-        void sendTransaction(I2cTransaction &transaction);
+        /*
+         *  @brief Hands the transaction to the HAL. Never throws, it may run in interrupt context.
+         */
+        I2cStatus sendTransaction(I2cTransaction &transaction);
+
+        /*
+         *  @brief Starts the next transaction (see selectQueue). Transactions that can't be
+         *  started are completed right away with the failing status, so the queue never stalls.
+         *
+         *  @param sequenceStatus Status of the previous frame when it broke a sequence: the
+         *  remaining frames are completed with I2C_ERROR_SEQUENCE_ABORTED.
+         */
+        template <typename QueueType = Queue<I2cTransaction>>
+        void sendNextTransaction(I2cStatus sequenceStatus = I2C_OK);
+
+        /*
+         *  @brief Completes the current transaction and starts the next one.
+         */
+        template <typename QueueType = Queue<I2cTransaction>>
+        void completeTransaction(void);
+
+        /*
+         *  @brief Completes or fails the current transaction once the direct engine is done with it.
+         */
+        void directTransferCallback(I2cDirectResult result);
+
+        /*
+         *  @brief Calls the pre-transaction callback on the first attempt and counts the attempt.
+         */
+        void startAttempt(I2cTransaction &transaction);
+
+        /*
+         *  @brief Merges the register reads following the current transaction in its queue into
+         *  burstTransaction, while they read the next registers of the same device (see
+         *  I2cDevice::setReadCoalescing) and fit in the burst buffer.
+         *
+         *  @return The reads merged, 0 if there's nothing to merge with.
+         */
+        template <typename QueueType = Queue<I2cTransaction>>
+        size_t coalesceReads(void);
+
+        /*
+         *  @brief Whether the transaction can be part of a burst of the register width.
+         */
+        static bool isCoalescable(I2cTransaction &transaction, uint8_t registerWidth);
+
+        /*
+         *  @brief Register width the reads of the device of the transaction are coalesced at, 0 if
+         *  they aren't or the transaction can't start a burst.
+         */
+        static uint8_t getBurstRegisterWidth(I2cTransaction &transaction);
+
+        /*
+         *  @brief Scatters the burst into the buffers of its reads, completes and removes them, and
+         *  starts the next transfer before their post callbacks are delivered.
+         */
+        template <typename QueueType = Queue<I2cTransaction>>
+        void completeBurst(void);
+
+        /*
+         *  @brief Takes the finished transaction out of its queue and hands its post callback to
+         *  deliverCompletion().
+         */
+        template <typename QueueType = Queue<I2cTransaction>>
+        I2cCompletion releaseTransaction(bool &immediate);
+
+        /*
+         *  @brief Runs the post callback right away if it's immediate, completions aren't deferred
+         *  or the deferred queue is full. Defers it otherwise.
+         */
+        void deliverCompletion(I2cCompletion completion, bool immediate);
+
+        /*
+         *  @brief Maps the HAL error code of a failed transfer to the status it is completed with.
+         */
+        static I2cStatus classifyError(uint32_t halError);
+
+        /*
+         *  @brief Completes the current transaction with the error and resumes the queue. Every
+         *  error but a NACK, which the HAL already ended with STOP, needs the bus recovered first:
+         *  it is only flagged here, the transaction is completed by runRecovery().
+         */
+        void failTransaction(I2cStatus status);
+
+        /*
+         *  @brief Completes the current transaction with the error, after the recovery if there
+         *  was one, and resumes the queue. The reads of a failed burst stay queued and are sent
+         *  one by one.
+         */
+        void finishFailure(I2cStatus status);
+
+        /*
+         *  @brief Moves the NACKed current transaction out of its queue into a retry slot, if the
+         *  retry policy of its device allows another attempt.
+         *
+         *  @return False if it has to be completed: no attempts left or no free slot.
+         */
+        bool retryTransaction(I2cTransaction &transaction);
+
+        /*
+         *  @brief Returns the retry whose backoff expired first, nullptr if none is due.
+         */
+        I2cTransaction* takeDueRetry(void);
+
+        /*
+         *  @brief Brings the peripheral back to a known state: stops the DMA streams, releases the
+         *  bus (see releaseBus) and initializes the peripheral again.
+         *
+         *  @return I2C_ERROR_BUS_STUCK: If SDA is still held low.
+         *  @return I2C_ERROR_HAL: If there's a HAL error.
+         */
+        I2cStatus recoverBus(void);
+
+        /*
+         *  @brief Takes the pins as GPIO and clocks SCL, up to 9 pulses, until the slave holding
+         *  SDA low lets go of it, then generates a STOP.
+         *
+         *  @return False if SDA is still held low.
+         */
+        bool releaseBus(void);
+
+        /*
+         *  @brief Busy waits half an SCL period at the configured clock speed.
+         */
+        void waitHalfBit(void);
+
+        I2cStatus setTransaction( I2cTransaction &transaction);
 
-        void sendNextTransaction(void);
+        /*
+         *  @brief Queues consecutive transactions, either all of them or none, so that no other
+         *  transaction can end up between them. Queues of references keep the transactions
+         *  themselves instead of a copy. All of them go to the priority class of the first one.
+         */
+        I2cStatus setTransactions(I2cTransaction *transactions, size_t count);
 
-        void setTransaction( I2cTransaction &transaction);
+        /*
+         *  @brief setTransactions() without raising, for callers that must undo their own state
+         *  when queuing fails.
+         */
+        I2cStatus queueTransactions(I2cTransaction *transactions, size_t count);
+
+        /*
+         *  @brief Returns the free slot of the priority class queue so a transaction can be built in
+         *  place, nullptr if the queue is full or only holds references (see ReferenceQueue). Never
+         *  raises, the reason is left in status.
+         *
+         *  Interrupts stay masked from a successful acquire until publishTransaction(), so a
+         *  producer running in an interrupt (see I2cPeriodicTable) can't take the same slot while
+         *  it is built. Keep that window short and always publish the slot.
+         */
+        I2cTransaction* acquireTransaction(I2cPriority priority, I2cStatus &status);
+
+        /*
+         *  @brief Queues the transaction built in the slot returned by acquireTransaction() and
+         *  restores the interrupts. Never raises.
+         */
+        I2cStatus publishTransaction(I2cPriority priority);
+
+        /*
+         *  @brief (Re)starts listening for the slave addresses. An error can leave the handle
+         *  listening with its interrupts masked, so it is started over from the ready state.
+         */
+        I2cStatus listen(void);
+
+        /*
+         *  @brief Returns the bus the HAL handle belongs to.
+         */
+        static I2cBus* getBus(I2C_HandleTypeDef *handle);
 
         static void transactionCompleteCallback(I2C_HandleTypeDef *handle);
 
+        static void transactionErrorCallback(I2C_HandleTypeDef *handle);
+
+        static void slaveAddressCallback(I2C_HandleTypeDef *handle, uint8_t direction, uint16_t addressMatchCode);
+
+        static void slaveReceiveCallback(I2C_HandleTypeDef *handle);
+
+        static void slaveTransmitCallback(I2C_HandleTypeDef *handle);
+
+        static void listenCompleteCallback(I2C_HandleTypeDef *handle);
+
     public:
         I2C_HandleTypeDef* getHandle(void);
+
+        const char* getName(void);
+
+        /*
+         *  @param name Copied into the bus, up to I2C_NAME_LENGTH characters.
+         *  @param clockSpeed SCL frequency, up to 400 kHz. Rounded down to what PCLK1 can divide
+         *  to, see getTiming().
+         *
+         *  @throws I2cException: If the configuration is invalid, the SCL frequency can't be
+         *  reached from PCLK1, the bus is already in use or there's a HAL error (only when built
+         *  with exceptions, check getStatus() otherwise).
+         */
         I2cBus(
-            std::string name,
+            const char* name,
             Queue<I2cTransaction> *queue,
             I2cBusSelection bus,
             uint32_t clockSpeed,
@@ -141,9 +488,117 @@ class I2cBus
             uint16_t ownAddress1 = 0,
             uint16_t ownAddress2 = 0,
             bool clockStretching = false,
-            bool generalCall = false
+            bool generalCall = false,
+            I2cTransferMode transferMode = I2C_TRANSFER_INTERRUPT
         );
 
+        /*
+         *  @brief Releases the peripheral: masks its interrupts, stops its DMA streams and
+         *  de-initializes it, so no interrupt reaches the bus anymore. Transactions still queued
+         *  are dropped without completing. The bus can then be constructed again.
+         */
+        ~I2cBus();
+
+        /*
+         *  @brief Sets the default transfer engine for the transactions of the bus. Selecting
+         *  I2C_TRANSFER_DMA claims the DMA streams of the bus if they weren't already.
+         *  I2C_TRANSFER_DIRECT runs the transfers straight from the peripheral registers, bypassing
+         *  the HAL state machine (see I2cDirectTransfer).
+         *
+         *  @throws I2cException: If there's a HAL error (only when built with exceptions, the
+         *  status is returned otherwise).
+         */
+        I2cStatus setTransferMode(I2cTransferMode transferMode);
+
+        I2cTransferMode getTransferMode(void);
+
+        /*
+         *  @brief CCR and TRISE the peripheral runs with, and the SCL frequency they give.
+         */
+        const I2cTiming& getTiming(void);
+
+        uint32_t getSclFrequency(void);
+
+        /*
+         *  @brief Puts the bus in slave mode, serving the register file to the hosts that address
+         *  it at its own addresses, from its interrupts. The bus can't send transactions meanwhile,
+         *  they complete with I2C_ERROR_SLAVE_MODE. nullptr stops answering the hosts.
+         *
+         *  @throws I2cException: If the bus is master only or has transactions pending, the register
+         *  file is invalid, or there's a HAL error (only when built with exceptions, the status is
+         *  returned otherwise).
+         */
+        I2cStatus setRegisterFile(I2cRegisterFile *registerFile);
+
+        I2cRegisterFile* getRegisterFile(void);
+
+        /*
+         *  @brief Gives a priority class its own bounded queue, so its transactions never wait
+         *  behind the ones of lower classes. nullptr returns the class to the construction queue.
+         *
+         *  @throws I2cException: If the priority is invalid or the bus has transactions pending
+         *  (only when built with exceptions, the status is returned otherwise).
+         */
+        I2cStatus setPriorityQueue(I2cPriority priority, Queue<I2cTransaction> *queue);
+
+        /*
+         *  @brief Moves the post callbacks out of the completion interrupt: the next transfer is
+         *  started first and the callbacks are queued, to be run by runCompletions() from the main
+         *  loop or, with pendSv, from the PendSV handler (I2C_DeferredCompletionHandler). PendSV is
+         *  then set to the lowest priority, so the callbacks never preempt an interrupt. Only one
+         *  of the two may drain the queue. nullptr runs the callbacks in the interrupt again.
+         *
+         *  @throws I2cException: If the bus has transactions pending (only when built with
+         *  exceptions, the status is returned otherwise).
+         */
+        I2cStatus setDeferredCompletions(Queue<I2cCompletion> *completions, bool pendSv = false);
+
+        /*
+         *  @brief Runs the deferred post callbacks of the bus.
+         *
+         *  @return The number of callbacks run.
+         */
+        size_t runCompletions(void);
+
+        /*
+         *  @brief Runs the pending recovery and the deferred post callbacks of every bus drained
+         *  from PendSV (see setDeferredCompletions), from I2C_DeferredCompletionHandler.
+         */
+        static size_t runPendSvCompletions(void);
+
+        /*
+         *  @brief Sets how long a transfer may take before checkTimeout() gives up on it. 0
+         *  disables the timeout.
+         */
+        void setTimeout(uint32_t milliseconds);
+
+        /*
+         *  @brief Detects a stalled bus, e.g. a slave stretching SCL forever: if the current
+         *  transfer is older than the timeout, completes it with I2C_ERROR_TIMEOUT, recovers the bus
+         *  and resumes the queue. Meant to be called periodically from the main loop, never from
+         *  an interrupt that can preempt the bus interrupts.
+         *
+         *  @return True if the bus had stalled.
+         */
+        bool checkTimeout(void);
+
+        /*
+         *  @brief Recovers the bus after a failed transfer (see recoverBus), completes the failed
+         *  transaction and resumes the queue. Called by poll() or, for the buses that defer their
+         *  completions to PendSV, from I2C_DeferredCompletionHandler; never from an interrupt
+         *  that can preempt the bus interrupts.
+         *
+         *  @return False if no recovery was pending.
+         */
+        bool runRecovery(void);
+
+        /*
+         *  @brief Periodic service of the bus, from the main loop: runs a pending recovery, checks
+         *  the timeout and starts the retries due on an idle bus. Busy buses start them as
+         *  transfers complete.
+         */
+        void poll(void);
+
         /*
          *  @brief Checks whether the address is valid, taking into account the addressing mode
          *  (7 bit or 10 bit)
@@ -155,8 +610,47 @@ class I2cBus
 
         I2cBusSelection getBusNumber(void);
 
+        /*
+         *  @brief Returns the result of the construction of the bus.
+         */
+        I2cStatus getStatus(void);
+
+#if I2C_DRIVER_STATS
+        /*
+         *  @brief Latency statistics of the transactions to the device address, in cycles of the
+         *  cycle clock (see i2cSetCycleClock).
+         *
+         *  @return nullptr if nothing was recorded for the address.
+         */
+        const I2cDeviceStats* getDeviceStats(uint16_t address);
+
+        /*
+         *  @brief Queue wait of the transactions of a priority class, nullptr if the priority is
+         *  invalid.
+         */
+        const I2cLatencyStats* getPriorityStats(I2cPriority priority);
+
+        /*
+         *  @brief Duration of the bus recoveries, in cycles of the cycle clock.
+         */
+        const I2cLatencyStats& getRecoveryStats(void);
+
+        /*
+         *  @brief Duration of the event and error interrupts of the bus, in cycles of the cycle
+         *  clock: what each transfer engine costs per interrupt. Post callbacks run in the interrupt
+         *  are included, defer them (see setDeferredCompletions) to time the engine alone.
+         */
+        const I2cLatencyStats& getInterruptStats(void);
+
+        void resetStats(void);
+#endif
+
     friend class I2cDevice;
 
+    friend class I2cPeriodicTable;
+
+    friend class I2cTransactionGroup;
+
     // Interrupt handlers declared as friends
     friend void I2C1_EV_IRQHandler(void);
 
@@ -169,4 +663,117 @@ class I2cBus
     friend void I2C2_ER_IRQHandler(void);
 
     friend void I2C3_ER_IRQHandler(void);
-};
\ No newline at end of file
+
+    friend void DMA1_Stream0_IRQHandler(void);
+
+    friend void DMA1_Stream2_IRQHandler(void);
+
+    friend void DMA1_Stream3_IRQHandler(void);
+
+    friend void DMA1_Stream4_IRQHandler(void);
+
+    friend void DMA1_Stream6_IRQHandler(void);
+
+    friend void DMA1_Stream7_IRQHandler(void);
+};
+
+template <I2cBusSelection Bus, I2cInterruptType Type>
+inline void I2cBus::handleInterrupt(void)
+{
+    I2cBus *driver = drivers[Bus];
+    if(!driver)
+    {
+        return;
+    }
+
+#if I2C_DRIVER_STATS
+    uint32_t startCycles = i2cGetCycles();
+#endif
+
+    if constexpr(Type == I2C_EVENT)
+    {
+        if(driver->directTransfer.isActive())
+            driver->directTransferCallback(driver->directTransfer.handleEvent());
+        else
+            HAL_I2C_EV_IRQHandler(&driver->handle);
+    }
+    else if constexpr(Type == I2C_ERROR)
+    {
+        if(driver->directTransfer.isActive())
+            driver->directTransferCallback(driver->directTransfer.handleError());
+        else
+            HAL_I2C_ER_IRQHandler(&driver->handle);
+    }
+    else if constexpr(Type == I2C_DMA_RX)
+    {
+        HAL_DMA_IRQHandler(&driver->dmaRxHandle);
+    }
+    else if constexpr(Type == I2C_DMA_TX)
+    {
+        HAL_DMA_IRQHandler(&driver->dmaTxHandle);
+    }
+
+#if I2C_DRIVER_STATS
+    if constexpr(Type == I2C_EVENT || Type == I2C_ERROR)
+    {
+        driver->interruptStats.record(i2cGetCycles() - startCycles);
+    }
+#endif
+}
+
+/*
+ *  @brief Bus whose priority classes all queue in a QueueType, e.g. SpscQueue<I2cTransaction, 16>.
+ *
+ *  The completion interrupt calls the queues through their own type instead of the virtual
+ *  interface of Queue: the queue classes are final, so hasData(), peek() and pop() inline into it.
+ *  A queue of another type given through I2cBus::setPriorityQueue() switches the bus back to the
+ *  virtual calls. I2cQueuedBus<Queue<I2cTransaction>> is the same as I2cBus.
+ */
+template <typename QueueType>
+class I2cQueuedBus : public I2cBus
+{
+    static_assert(std::is_base_of_v<Queue<I2cTransaction>, QueueType>, "QueueType must be a queue of I2cTransaction");
+
+    protected:
+        // Queue of each priority class, as far as it was given with its type.
+        std::array<QueueType*, I2C_PRIORITY_CLASSES> typedQueues;
+
+    public:
+        template <typename... Arguments>
+        I2cQueuedBus(const char* name, QueueType *queue, I2cBusSelection bus, uint32_t clockSpeed, Arguments... arguments)
+            : I2cBus(name, queue, bus, clockSpeed, arguments...)
+        {
+            typedQueues.fill(queue);
+            completeFunction = &I2cQueuedBus::template completeTransaction<QueueType>;
+        }
+
+        /*
+         *  @brief Gives a priority class its own queue of the same type (see
+         *  I2cBus::setPriorityQueue). The completion interrupt keeps calling the queues directly
+         *  once every class has a queue of the type again.
+         */
+        I2cStatus setPriorityQueue(I2cPriority priority, QueueType *queue)
+        {
+            I2cStatus status = I2cBus::setPriorityQueue(priority, queue);
+            if(status != I2C_OK)
+            {
+                return status;
+            }
+
+            typedQueues[priority] = queue ? queue : static_cast<QueueType*>(this->queue);
+
+            for(size_t priorityClass = 0; priorityClass < I2C_PRIORITY_CLASSES; priorityClass++)
+            {
+                if(queues[priorityClass] != typedQueues[priorityClass])
+                {
+                    return I2C_OK;
+                }
+            }
+
+            completeFunction = &I2cQueuedBus::template completeTransaction<QueueType>;
+
+            return I2C_OK;
+        }
+};
+
+#include "i2c_bus.tpp"
\ No newline at end of file
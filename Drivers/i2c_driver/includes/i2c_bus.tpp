@@ -0,0 +1,241 @@
+#include "i2c_bus.hpp"
+
+#include <algorithm>
+
+template <typename QueueType>
+void I2cBus::completeTransaction(void)
+{
+#if I2C_DRIVER_STATS
+    uint32_t completedCycles = i2cGetCycles();
+#endif
+
+    I2cTransaction *transaction = currentTransaction;
+    if(!transaction)
+    {
+        sendNextTransaction<QueueType>();
+        return;
+    }
+
+#if I2C_DRIVER_STATS
+    recordStats(*transaction, completedCycles);
+#endif
+
+    if(burstReads)
+    {
+        completeBurst<QueueType>();
+        return;
+    }
+
+    transaction->finish(I2C_OK);
+
+    bool immediate;
+    I2cCompletion completion = releaseTransaction<QueueType>(immediate);
+
+    // Keep the bus busy first, the callback of the finished transaction can wait.
+    sendNextTransaction<QueueType>();
+    deliverCompletion(completion, immediate);
+}
+
+template <typename QueueType>
+void I2cBus::sendNextTransaction(I2cStatus sequenceStatus)
+{
+    // The peripheral is left as the error left it until runRecovery(), which resumes the queue.
+    if(recoveryPending)
+        return;
+
+    while(true)
+    {
+        // Due retries are older than anything queued, but never cut into a sequence.
+        QueueType *nextQueue = nullptr;
+        currentQueue = nullptr;
+        currentTransaction = sequenceQueue ? nullptr : takeDueRetry();
+        if(currentTransaction == nullptr)
+        {
+            currentQueue = nextQueue = selectQueue<QueueType>();
+            currentTransaction = nextQueue ? nextQueue->peek() : nullptr;
+        }
+
+        if(currentTransaction == nullptr)
+            break;
+
+        // Keep taking frames from this queue until the sequence is over.
+        sequenceQueue = currentTransaction->continuesSequence() ? currentQueue : nullptr;
+
+        I2cStatus transactionStatus;
+
+        // The rest of a broken sequence can't be sent on its own: the bus was never released.
+        if(sequenceStatus != I2C_OK && currentTransaction->getSequenceFrame() != I2C_FRAME_SINGLE)
+        {
+            transactionStatus = I2C_ERROR_SEQUENCE_ABORTED;
+        }
+        else
+        {
+            // Contiguous register reads of the device behind this one go out as a single burst.
+            burstReads = nextQueue && !sequenceQueue ? coalesceReads<QueueType>() : 0;
+            if(burstReads)
+            {
+                for(size_t read = 0; read < burstReads; read++)
+                    startAttempt(*nextQueue->peek(read));
+
+#if I2C_DRIVER_STATS
+                burstTransaction.startedCycles = nextQueue->peek()->startedCycles;
+#endif
+                currentTransaction = &burstTransaction;
+            }
+            else
+            {
+                startAttempt(*currentTransaction);
+            }
+
+            transferStartTick = HAL_GetTick();
+            transactionStatus = sendTransaction(*currentTransaction);
+            if(transactionStatus == I2C_OK)
+            {
+                return;
+            }
+
+            // The first read takes the failure, the others are sent one by one.
+            if(burstReads)
+            {
+                burstReads = 0;
+                currentTransaction = nextQueue->peek();
+            }
+        }
+
+        // The transaction never reached the bus: complete it with the error and go on.
+        currentTransaction->finish(transactionStatus);
+        sequenceStatus = currentTransaction->continuesSequence() ? transactionStatus : I2C_OK;
+
+        bool immediate;
+        I2cCompletion completion = releaseTransaction<QueueType>(immediate);
+        deliverCompletion(completion, immediate);
+    }
+}
+
+template <typename QueueType>
+size_t I2cBus::coalesceReads(void)
+{
+    I2cTransaction &first = *currentTransaction;
+    uint8_t registerWidth = getBurstRegisterWidth(first);
+    if(registerWidth == 0)
+    {
+        return 0;
+    }
+
+    QueueType *burstQueue = static_cast<QueueType*>(currentQueue);
+    I2cDevice *device = first.getDevice();
+    size_t reads = 1;
+    uint32_t bytes = first.getDataLenthBytes();
+    uint32_t nextRegister = first.getRegister() + bytes / registerWidth;
+
+    for(; reads < I2C_BURST_MAX_READS; reads++)
+    {
+        I2cTransaction *next = burstQueue->peek(reads);
+        if(!next || next->getDevice() != device || !isCoalescable(*next, registerWidth))
+            break;
+
+        if(next->getRegister() != nextRegister || next->getRegisterBytes() != first.getRegisterBytes())
+            break;
+
+        if(next->getTransferMode() != first.getTransferMode() || bytes + next->getDataLenthBytes() > burstBuffer.size())
+            break;
+
+        bytes += next->getDataLenthBytes();
+        nextRegister += next->getDataLenthBytes() / registerWidth;
+    }
+
+    if(reads < 2)
+    {
+        return 0;
+    }
+
+    burstTransaction = I2cTransaction(TRANSACTION_RX, burstBuffer.data(), bytes, device, first.getRegister(), first.getRegisterBytes());
+    burstTransaction.setTransferMode(first.getTransferMode());
+    burstTransaction.setPriority(first.getPriority());
+
+    return reads;
+}
+
+template <typename QueueType>
+void I2cBus::completeBurst(void)
+{
+    std::array<I2cCompletion, I2C_BURST_MAX_READS> burstCompletions;
+    std::array<bool, I2C_BURST_MAX_READS> immediate;
+    QueueType *burstQueue = static_cast<QueueType*>(currentQueue);
+    size_t reads = burstReads;
+    const uint8_t *burstData = burstBuffer.data();
+
+    for(size_t read = 0; read < reads; read++)
+    {
+        I2cTransaction *transaction = burstQueue->peek();
+        uint16_t dataBytes = transaction->getDataLenthBytes();
+
+        std::copy_n(burstData, dataBytes, transaction->getDataPointer());
+        burstData += dataBytes;
+
+        transaction->finish(I2C_OK);
+        burstCompletions[read] = transaction->getCompletion();
+        immediate[read] = transaction->isCallbackImmediate();
+
+        burstQueue->pop();
+    }
+
+    burstReads = 0;
+    currentTransaction = nullptr;
+
+    // Keep the bus busy first, like any other completion.
+    sendNextTransaction<QueueType>();
+
+    for(size_t read = 0; read < reads; read++)
+    {
+        deliverCompletion(burstCompletions[read], immediate[read]);
+    }
+}
+
+template <typename QueueType>
+I2cCompletion I2cBus::releaseTransaction(bool &immediate)
+{
+    I2cCompletion completion = currentTransaction->getCompletion();
+    immediate = currentTransaction->isCallbackImmediate();
+
+    if(currentQueue)
+    {
+        currentTransaction = nullptr;
+        static_cast<QueueType*>(currentQueue)->pop();
+    }
+    else
+    {
+        I2cRetrySlot *slot = reinterpret_cast<I2cRetrySlot*>(
+            reinterpret_cast<uint8_t*>(currentTransaction) - offsetof(I2cRetrySlot, transaction)
+        );
+        currentTransaction = nullptr;
+        slot->used = false;
+
+        // The caller only sees the transaction it linked: final status and attempts included.
+        if(slot->origin)
+        {
+            *slot->origin = slot->transaction;
+        }
+    }
+
+    return completion;
+}
+
+template <typename QueueType>
+QueueType* I2cBus::selectQueue(void)
+{
+    if(sequenceQueue)
+    {
+        return static_cast<QueueType*>(sequenceQueue);
+    }
+
+    for(Queue<I2cTransaction> *classQueue : queues)
+    {
+        if(static_cast<QueueType*>(classQueue)->hasData())
+        {
+            return static_cast<QueueType*>(classQueue);
+        }
+    }
+
+    return nullptr;
+}
\ No newline at end of file
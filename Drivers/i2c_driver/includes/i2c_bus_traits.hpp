@@ -0,0 +1,135 @@
+#pragma once
+
+#include <stdint.h>
+#include <array>
+
+#include "i2c_hal.hpp"
+
+#define I2C_BUS_MAX 3
+
+typedef enum
+{
+    I2C_BUS_1,
+    I2C_BUS_2,
+    I2C_BUS_3
+}
+I2cBusSelection;
+
+typedef void (*I2cClockEnable)(void);
+
+/*
+ *  @brief Hardware resources of an I2C peripheral: instance, pins, alternate functions, interrupts
+ *  and the DMA1 streams claimed by the driver.
+ *
+ *  Peripherals are stored as base addresses so the whole description can be constexpr.
+ */
+typedef struct
+{
+    uintptr_t instance;
+    I2cClockEnable enableClock;
+    IRQn_Type eventInterrupt;
+    IRQn_Type errorInterrupt;
+
+    uintptr_t sclPort;
+    I2cClockEnable enableSclPortClock;
+    uint16_t sclPin;
+    uint8_t sclAlternateFunction;
+
+    uintptr_t sdaPort;
+    I2cClockEnable enableSdaPortClock;
+    uint16_t sdaPin;
+    uint8_t sdaAlternateFunction;
+
+    uintptr_t dmaRxStream;
+    uintptr_t dmaTxStream;
+    uint32_t dmaChannel;
+    IRQn_Type dmaRxInterrupt;
+    IRQn_Type dmaTxInterrupt;
+}
+I2cBusConfig;
+
+template <I2cBusSelection Bus>
+struct I2cBusTraits;
+
+template <>
+struct I2cBusTraits<I2C_BUS_1>
+{
+    static constexpr I2cBusConfig config = {
+        .instance = I2C1_BASE,
+        .enableClock = []() { __HAL_RCC_I2C1_CLK_ENABLE(); },
+        .eventInterrupt = I2C1_EV_IRQn,
+        .errorInterrupt = I2C1_ER_IRQn,
+        .sclPort = GPIOB_BASE,
+        .enableSclPortClock = []() { __HAL_RCC_GPIOB_CLK_ENABLE(); },
+        .sclPin = GPIO_PIN_6,
+        .sclAlternateFunction = GPIO_AF4_I2C1,
+        .sdaPort = GPIOB_BASE,
+        .enableSdaPortClock = []() { __HAL_RCC_GPIOB_CLK_ENABLE(); },
+        .sdaPin = GPIO_PIN_7,
+        .sdaAlternateFunction = GPIO_AF4_I2C1,
+        .dmaRxStream = DMA1_Stream0_BASE,
+        .dmaTxStream = DMA1_Stream6_BASE,
+        .dmaChannel = DMA_CHANNEL_1,
+        .dmaRxInterrupt = DMA1_Stream0_IRQn,
+        .dmaTxInterrupt = DMA1_Stream6_IRQn
+    };
+};
+
+template <>
+struct I2cBusTraits<I2C_BUS_2>
+{
+    static constexpr I2cBusConfig config = {
+        .instance = I2C2_BASE,
+        .enableClock = []() { __HAL_RCC_I2C2_CLK_ENABLE(); },
+        .eventInterrupt = I2C2_EV_IRQn,
+        .errorInterrupt = I2C2_ER_IRQn,
+        .sclPort = GPIOB_BASE,
+        .enableSclPortClock = []() { __HAL_RCC_GPIOB_CLK_ENABLE(); },
+        .sclPin = GPIO_PIN_10,
+        .sclAlternateFunction = GPIO_AF4_I2C2,
+        .sdaPort = GPIOB_BASE,
+        .enableSdaPortClock = []() { __HAL_RCC_GPIOB_CLK_ENABLE(); },
+        .sdaPin = GPIO_PIN_3,
+        // PB3 carries I2C2_SDA on AF9, not AF4.
+        .sdaAlternateFunction = GPIO_AF9_I2C2,
+        .dmaRxStream = DMA1_Stream3_BASE,
+        .dmaTxStream = DMA1_Stream7_BASE,
+        .dmaChannel = DMA_CHANNEL_7,
+        .dmaRxInterrupt = DMA1_Stream3_IRQn,
+        .dmaTxInterrupt = DMA1_Stream7_IRQn
+    };
+};
+
+template <>
+struct I2cBusTraits<I2C_BUS_3>
+{
+    static constexpr I2cBusConfig config = {
+        .instance = I2C3_BASE,
+        .enableClock = []() { __HAL_RCC_I2C3_CLK_ENABLE(); },
+        .eventInterrupt = I2C3_EV_IRQn,
+        .errorInterrupt = I2C3_ER_IRQn,
+        .sclPort = GPIOA_BASE,
+        .enableSclPortClock = []() { __HAL_RCC_GPIOA_CLK_ENABLE(); },
+        .sclPin = GPIO_PIN_8,
+        .sclAlternateFunction = GPIO_AF4_I2C3,
+        .sdaPort = GPIOB_BASE,
+        .enableSdaPortClock = []() { __HAL_RCC_GPIOB_CLK_ENABLE(); },
+        .sdaPin = GPIO_PIN_4,
+        // PB4 carries I2C3_SDA on AF9, not AF4.
+        .sdaAlternateFunction = GPIO_AF9_I2C3,
+        .dmaRxStream = DMA1_Stream2_BASE,
+        .dmaTxStream = DMA1_Stream4_BASE,
+        .dmaChannel = DMA_CHANNEL_3,
+        .dmaRxInterrupt = DMA1_Stream2_IRQn,
+        .dmaTxInterrupt = DMA1_Stream4_IRQn
+    };
+};
+
+/*
+ *  @brief Runtime view of the traits, indexed by I2cBusSelection.
+ */
+inline constexpr std::array<I2cBusConfig, I2C_BUS_MAX> i2cBusConfigs = {
+    I2cBusTraits<I2C_BUS_1>::config,
+    I2cBusTraits<I2C_BUS_2>::config,
+    I2cBusTraits<I2C_BUS_3>::config
+};
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+typedef void (*Callback)(void*);
+
+/*
+ *  @brief Callback of a transaction: a function with its parameters, or a callable such as a
+ *  lambda with captures. The captures are stored inline, in place of the parameters, so nothing is
+ *  allocated and calling it is a single indirect call either way.
+ *
+ *  The captures of a callable must be trivially copyable and fit in a pointer: this, one pointer
+ *  or reference, or a small value. Capture a pointer to a struct to pass more.
+ */
+class I2cCallback
+{
+    protected:
+        Callback function = nullptr;
+        void* parameters = nullptr;
+
+        /*
+         *  @brief Calls the callable stored in the parameters.
+         */
+        template <typename Function>
+        static void invoke(void* parameters)
+        {
+            alignas(Function) unsigned char storage[sizeof(Function)];
+            std::memcpy(storage, &parameters, sizeof(Function));
+            (*std::launder(reinterpret_cast<Function*>(storage)))();
+        }
+
+    public:
+        I2cCallback(void) = default;
+
+        I2cCallback(Callback function, void* parameters) : function(function), parameters(parameters)
+        {
+
+        }
+
+        template <typename Function, typename = std::enable_if_t<!std::is_same_v<Function, I2cCallback> && std::is_invocable_v<Function&>>>
+        I2cCallback(Function callable)
+        {
+            static_assert(sizeof(Function) <= sizeof(void*) && alignof(Function) <= alignof(void*), "The captures of the callback don't fit in a pointer");
+            static_assert(std::is_trivially_copyable_v<Function>, "The captures of the callback must be trivially copyable");
+
+            std::memcpy(&parameters, &callable, sizeof(Function));
+            function = invoke<Function>;
+        }
+
+        /*
+         *  @brief Calls the callback, which must be set.
+         */
+        void operator()(void) const
+        {
+            function(parameters);
+        }
+
+        explicit operator bool(void) const
+        {
+            return function != nullptr;
+        }
+};
\ No newline at end of file
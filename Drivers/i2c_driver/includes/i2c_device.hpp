@@ -1,22 +1,197 @@
 #pragma once
 
 #include "i2c_bus.hpp"
+#include "i2c_register_shadow.hpp"
+#include "i2c_task.hpp"
+
+/*
+ *  How the bus retries the transactions of a device that NACKs them, e.g. while it is busy with an
+ *  internal write cycle or conversion.
+ */
+typedef struct
+{
+    // Attempts in total, 1 never retries.
+    uint8_t maxAttempts;
+    // Time a NACKed transaction waits out of the queue before the next attempt.
+    uint16_t backoffMs;
+}
+I2cRetryPolicy;
 
 class I2cDevice
 {
     protected:
         uint16_t address;
         I2cBus *bus;
-        std::string name;
+        FixedString<I2C_NAME_LENGTH> name;
+        I2cPriority priority = I2C_PRIORITY_NORMAL;
+        I2cRetryPolicy retryPolicy = {1, 0};
+        I2cRegisterShadow *shadow = nullptr;
+        // Bytes per register address step of coalesced reads, 0 if reads aren't coalesced.
+        uint8_t coalescingWidth = 0;
+
+        /*
+         *  @brief Whether the bus queue of the device priority can't take another transaction,
+         *  for callers that must not raise (a device without bus counts as full).
+         */
+        bool isQueueFull(void);
+
+        /*
+         *  @brief emplaceTransaction() and commitTransaction() without raising, for the awaiters:
+         *  an exception must not leave await_suspend. acquireTransaction leaves the reason of a
+         *  nullptr in status.
+         */
+        I2cTransaction* acquireTransaction(TransactionDirection direction, uint8_t* data, uint16_t dataBytes, uint16_t deviceRegister, RegisterLength deviceRegisterBytes, I2cStatus &status);
+
+        I2cStatus publishTransaction(void);
 
     public:
-        I2cDevice(uint16_t address, I2cBus* bus = nullptr, std::string name = "");
+        /*
+         *  @param name Copied into the device, up to I2C_NAME_LENGTH characters.
+         */
+        I2cDevice(uint16_t address, I2cBus* bus = nullptr, const char* name = "");
 
         uint16_t getAddress(void);
 
-        void attachBus(I2cBus* bus);
+        const char* getName(void);
+
+        I2cBus* getBus(void);
+
+        /*
+         *  @throws I2cException: If the device is already attached to a bus (only when built with
+         *  exceptions, the status is returned otherwise).
+         */
+        I2cStatus attachBus(I2cBus* bus);
 
         void detachBus();
 
-        void setTransaction(I2cTransaction &transaction);
+        /*
+         *  @brief Sets the priority class of the transactions built for the device from now on
+         *  (constructed, emplaced or awaited).
+         */
+        void setPriority(I2cPriority priority);
+
+        I2cPriority getPriority(void);
+
+        /*
+         *  @brief Retries NACKed transactions of the device up to maxAttempts in total, each one
+         *  backoffMs after the previous. The transactions of other devices keep flowing during the
+         *  backoff. Frames of a sequence are never retried on their own.
+         */
+        void setRetryPolicy(uint8_t maxAttempts, uint16_t backoffMs);
+
+        const I2cRetryPolicy& getRetryPolicy(void);
+
+        /*
+         *  @brief Lets the bus merge queued register reads of the device into one burst read when
+         *  each one starts at the register following the previous one. Only for devices that
+         *  auto-increment the register address: registerWidth is the bytes read per register.
+         *  Each read still gets its own data, status and post callback.
+         */
+        void setReadCoalescing(bool enabled, uint8_t registerWidth = 1);
+
+        /*
+         *  @return The bytes per register of coalesced reads, 0 if reads aren't coalesced.
+         */
+        uint8_t getCoalescingWidth(void);
+
+        /*
+         *  @throws I2cException: If the device has no bus or the bus queue is full (only when built
+         *  with exceptions, the status is returned otherwise).
+         */
+        I2cStatus setTransaction(I2cTransaction &transaction);
+
+        /*
+         *  @brief Queues consecutive transactions as a block (see I2cBus::setTransactions).
+         *
+         *  @throws I2cException: If the device has no bus or the bus queue can't hold all of them
+         *  (only when built with exceptions, the status is returned otherwise).
+         */
+        I2cStatus setTransactions(I2cTransaction *transactions, size_t count);
+
+        /*
+         *  @brief Builds a transaction for the device directly in the bus queue of the device
+         *  priority, without copying it. The transaction can still be configured (callbacks,
+         *  transfer mode) through the returned pointer, and is only queued by commitTransaction().
+         *  Interrupts stay masked in between (see I2cBus::acquireTransaction), commit right away.
+         *
+         *  @return nullptr if the device has no bus, the bus queue is full or it only holds
+         *  references (I2C_ERROR_REFERENCE_QUEUE).
+         *
+         *  @throws I2cException: In the same cases (only when built with exceptions).
+         */
+        I2cTransaction* emplaceTransaction(TransactionDirection direction, uint8_t* data, uint16_t dataBytes, uint16_t deviceRegister = 0, RegisterLength deviceRegisterBytes = REGISTER_NULL);
+
+        /*
+         *  @brief Queues the transaction built by emplaceTransaction().
+         *
+         *  @throws I2cException: If the device has no bus or the transaction is invalid (only when
+         *  built with exceptions, the status is returned otherwise).
+         */
+        I2cStatus commitTransaction(void);
+
+        /*
+         *  @brief Reads from the device inside an I2cTask: co_await device.read(...) suspends the
+         *  coroutine until the transaction completes and returns its status. Never raises, a
+         *  transaction that can't be queued (no bus, queue full) returns its error right away.
+         */
+        I2cTransactionAwaiter read(uint8_t* data, uint16_t dataBytes, uint16_t deviceRegister = 0, RegisterLength deviceRegisterBytes = REGISTER_NULL);
+
+        /*
+         *  @brief Writes to the device inside an I2cTask, see read().
+         */
+        I2cTransactionAwaiter write(uint8_t* data, uint16_t dataBytes, uint16_t deviceRegister = 0, RegisterLength deviceRegisterBytes = REGISTER_NULL);
+
+        /*
+         *  @brief ACK polling inside an I2cTask: co_await device.waitReady() addresses the device
+         *  with no data until it acknowledges, under the retry policy of the device. Each poll
+         *  only takes START, the address and STOP on the wire, the backoff between them leaves the
+         *  bus to other devices.
+         *
+         *  @return I2C_ERROR_NACK: If the device was still busy after the last attempt.
+         */
+        I2cTransactionAwaiter waitReady(void);
+
+        /*
+         *  @brief Keeps the last known value of the registers tracked by the shadow, from every
+         *  register access of the device that completes. nullptr stops shadowing.
+         */
+        void setShadow(I2cRegisterShadow *shadow);
+
+        I2cRegisterShadow* getShadow(void);
+
+        /*
+         *  @brief Queues a write of the value to a shadowed register, unless the register already
+         *  holds it. The bytes and the transaction are kept by the shadow, the caller has nothing
+         *  to keep alive, so queues of references (ReferenceQueue) work as well.
+         *
+         *  @throws I2cException: If the device has no shadow or bus, every shadow write buffer is
+         *  in flight or the bus queue is full (only when built with exceptions, the status is
+         *  returned otherwise).
+         */
+        I2cStatus writeRegister(uint16_t deviceRegister, uint32_t value);
+
+        /*
+         *  @brief Read-modify-write of the bits in mask as a single write: the current value comes
+         *  from the shadow instead of the device. Nothing is sent if the bits already hold value.
+         *
+         *  @throws I2cException: If the register value isn't shadowed yet (read or write it once,
+         *  or track it with its reset value), or in the cases of writeRegister() (only when built
+         *  with exceptions, the status is returned otherwise).
+         */
+        I2cStatus modifyBits(uint16_t deviceRegister, uint32_t mask, uint32_t value);
+
+        /*
+         *  @brief Returns the shadowed value of the register without a transaction.
+         *
+         *  @return I2C_ERROR_NOT_SHADOWED: If the register value isn't shadowed.
+         */
+        I2cStatus readShadow(uint16_t deviceRegister, uint32_t &value);
+
+        /*
+         *  @brief Updates the shadow with a finished transaction of the device. Runs in the
+         *  completion interrupt.
+         */
+        void recordTransaction(I2cTransaction &transaction);
+
+    friend class I2cTransactionAwaiter;
 };
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <stdint.h>
+#include "i2c_hal.hpp"
+
+#include "i2c_status.hpp"
+#include "i2c_transaction.hpp"
+
+typedef enum
+{
+    I2C_DIRECT_IDLE,
+    // START, address and the bytes sent: register address, then the data of a write.
+    I2C_DIRECT_TRANSMIT,
+    // (Repeated) START, address with the read bit and the bytes received.
+    I2C_DIRECT_RECEIVE
+}
+I2cDirectPhase;
+
+typedef enum
+{
+    I2C_DIRECT_PENDING,
+    I2C_DIRECT_COMPLETE,
+    // Ended by an error flag, see getError().
+    I2C_DIRECT_FAILED
+}
+I2cDirectResult;
+
+/*
+ *  @brief Transfer engine driving the registers of the peripheral straight from its interrupts
+ *  (I2C_TRANSFER_DIRECT), in place of the HAL state machine.
+ *
+ *  Each event interrupt reads SR1 once and handles the one step the transfer is at: write, read and
+ *  register read (write, repeated START, read) in master mode with 7 bit addresses. Reception ends
+ *  the way the reference manual prescribes for 1, 2 and more bytes, so the last byte is NACKed
+ *  before STOP without racing the bus. Sequence frames, 10 bit addresses and slave mode are left to
+ *  the HAL (see I2cBus::resolveTransferMode).
+ */
+class I2cDirectTransfer
+{
+    protected:
+        I2C_TypeDef *instance = nullptr;
+
+        I2cDirectPhase phase = I2C_DIRECT_IDLE;
+
+        // Address of the device, shifted, without the read bit.
+        uint8_t address = 0;
+
+        // Register address bytes, MSB first, and how many are left to send.
+        uint8_t registerAddress[2] = {};
+        uint8_t registerBytes = 0;
+
+        // A read: the data follows a (repeated) START with the read bit.
+        bool receive = false;
+
+        uint8_t *data = nullptr;
+        uint16_t remaining = 0;
+
+        // HAL error code (HAL_I2C_ERROR_*) of the failed transfer.
+        uint32_t error = 0;
+
+        /*
+         *  @brief The address was acknowledged: clears ADDR, set up for the bytes to come.
+         */
+        I2cDirectResult addressed(void);
+
+        I2cDirectResult transmitEvent(uint32_t status);
+
+        I2cDirectResult receiveEvent(uint32_t status);
+
+        /*
+         *  @brief Writes the next register address or data byte to DR.
+         */
+        void transmitByte(void);
+
+        bool hasTransmitBytes(void);
+
+        /*
+         *  @brief Masks the interrupts of the peripheral and goes back to idle.
+         */
+        I2cDirectResult finish(I2cDirectResult result);
+
+    public:
+        /*
+         *  @brief Starts the transaction on the peripheral. Never throws or waits, it may run in
+         *  interrupt context. The START goes out once the bus is free: while another master or a
+         *  slave holding SDA keeps it busy, the transaction is pending like any other and the
+         *  timeout of the bus ends it (see I2cBus::checkTimeout).
+         */
+        I2cStatus start(I2C_TypeDef *instance, I2cTransaction &transaction);
+
+        /*
+         *  @brief Event interrupt of the peripheral.
+         */
+        I2cDirectResult handleEvent(void);
+
+        /*
+         *  @brief Error interrupt of the peripheral: clears the error flags and ends the transfer,
+         *  with a STOP after a NACK. Other errors leave the bus to the recovery.
+         */
+        I2cDirectResult handleError(void);
+
+        /*
+         *  @brief Forgets the transfer in progress, e.g. when the peripheral is reset.
+         */
+        void reset(void);
+
+        /*
+         *  @brief Whether a transfer is in progress: the interrupts of the bus belong to the engine.
+         */
+        bool isActive(void);
+
+        uint32_t getError(void);
+};
+
+inline bool I2cDirectTransfer::isActive(void)
+{
+    return phase != I2C_DIRECT_IDLE;
+}
\ No newline at end of file
@@ -1,10 +1,27 @@
 #pragma once
 
 #include "custom_exception.hpp"
+#include "i2c_status.hpp"
 
 class I2cException : public CustomException {
+    protected:
+        I2cStatus status = I2C_ERROR_HAL;
+
     public:
-        explicit I2cException(const std::string& message);
+        explicit I2cException(const char* message);
+
+        explicit I2cException(I2cStatus status);
 
         explicit I2cException(void);
-};
\ No newline at end of file
+
+        I2cStatus getStatus(void) const;
+};
+
+/*
+ *  @brief Reports a failed status as an I2cException when the driver is built with exceptions.
+ *
+ *  @return The given status, so it can also be returned to the caller.
+ *
+ *  @throws I2cException: If the status is not I2C_OK and exceptions are enabled.
+ */
+I2cStatus i2cRaise(I2cStatus status);
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+/*
+ *  HAL entry point of the driver: the real HAL on target, the simulated one on host builds.
+ *
+ *  Registers of the I2C peripherals are accessed through i2cReadRegister and i2cWriteRegister
+ *  (see I2cDirectTransfer): plain volatile accesses on target, the register model of the simulator
+ *  on host builds.
+ *
+ *  i2cMaskInterrupts masks the bus, DMA and timer interrupts of the driver (BASEPRI on target) for
+ *  thread code that races them, i2cRestoreInterrupts puts back what it returned.
+ */
+
+/*
+ *  Preemption priority of the I2C, DMA and periodic timer interrupts. They share it so they never
+ *  preempt each other, and anything that queues transactions must not run above it. Priority 0
+ *  can't be masked by BASEPRI.
+ */
+#ifndef I2C_INTERRUPT_PRIORITY
+#define I2C_INTERRUPT_PRIORITY 1
+#endif
+
+static_assert(I2C_INTERRUPT_PRIORITY > 0, "BASEPRI can't mask the driver interrupts at priority 0");
+
+#ifdef I2C_DRIVER_HOST_SIM
+#include "i2c_sim_hal.hpp"
+#else
+#include "stm32f4xx_hal.h"
+
+inline uint32_t i2cReadRegister(volatile uint32_t &reg)
+{
+    return reg;
+}
+
+inline void i2cWriteRegister(volatile uint32_t &reg, uint32_t value)
+{
+    reg = value;
+}
+
+inline uint32_t i2cMaskInterrupts(void)
+{
+    uint32_t basePriority = __get_BASEPRI();
+
+    // Only ever raises the mask, a caller already running masked keeps its level.
+    __set_BASEPRI_MAX(I2C_INTERRUPT_PRIORITY << (8U - __NVIC_PRIO_BITS));
+
+    return basePriority;
+}
+
+inline void i2cRestoreInterrupts(uint32_t basePriority)
+{
+    __set_BASEPRI(basePriority);
+}
+#endif
\ No newline at end of file
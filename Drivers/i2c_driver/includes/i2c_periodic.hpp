@@ -0,0 +1,134 @@
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include "i2c_hal.hpp"
+
+#include "i2c_bus.hpp"
+#include "i2c_device.hpp"
+
+// Entries of a periodic table.
+#ifndef I2C_PERIODIC_MAX_ENTRIES
+#define I2C_PERIODIC_MAX_ENTRIES 8
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+void TIM2_IRQHandler(void);
+#ifdef __cplusplus
+}
+#endif
+
+/*
+ *  @brief Sampling statistics of a periodic entry, in cycles of the cycle clock (see
+ *  i2cSetCycleClock).
+ *
+ *  period: between the completions of consecutive successful samples.
+ *  jitter: largest deviation of a period from the nominal one.
+ *  overruns: samples skipped because the previous one was still pending or the queue was full.
+ *  errors: samples completed with an error.
+ */
+typedef struct
+{
+    I2cLatencyStats period;
+    uint32_t jitter;
+    uint32_t overruns;
+    uint32_t errors;
+}
+I2cPeriodicStats;
+
+typedef struct
+{
+    I2cTransaction transaction;
+    uint32_t periodTicks;
+    uint32_t countdown;
+    // Nominal period in cycles of the cycle clock.
+    uint32_t periodCycles;
+    // Completion cycles of the last successful sample, valid once sampled.
+    uint32_t lastCycles;
+    bool sampled;
+    volatile bool pending;
+    I2cStatus status;
+    I2cPeriodicStats stats;
+}
+I2cPeriodicEntry;
+
+/*
+ *  @brief Table of register reads sampled at fixed rates.
+ *
+ *  TIM2 interrupts at tickHz and queues the reads that are due on the bus of their device, in the
+ *  priority class of the table. Give that class a queue of its own (I2cBus::setPriorityQueue):
+ *  the timer interrupt is one more producer for it. Anything else queuing in that class masks the
+ *  timer meanwhile, as I2cBus::setTransaction(s) and emplace/commit do. The data of an entry is
+ *  written to its buffer by the bus, a read of the buffer may see two samples mixed.
+ */
+class I2cPeriodicTable
+{
+    protected:
+        // Table ticked by TIM2, the table does not own any other timer.
+        static I2cPeriodicTable *timerTable;
+
+        static void handleInterrupt(void);
+
+        std::array<I2cPeriodicEntry, I2C_PERIODIC_MAX_ENTRIES> entries = {};
+
+        // Only entries below count are ticked, it's increased once the entry is complete.
+        volatile size_t count = 0;
+
+        uint32_t tickHz;
+
+        I2cPriority priority;
+
+        TIM_HandleTypeDef timerHandle = {};
+
+        static void timerCallback(TIM_HandleTypeDef *handle);
+
+        /*
+         *  @brief Records the period of the sample and frees the entry for the next one. Runs in
+         *  the completion interrupt.
+         */
+        static void complete(void* parameters);
+
+        /*
+         *  @brief Queues the reads that are due, from the timer interrupt.
+         */
+        void tick(void);
+
+    public:
+        I2cPeriodicTable(uint32_t tickHz = 1000, I2cPriority priority = I2C_PRIORITY_HIGH);
+
+        /*
+         *  @brief Samples the register of the device every periodTicks timer ticks into data.
+         *  Entries are numbered in the order they are added.
+         *
+         *  @throws I2cException: If the table is full, the period is 0, the device has no bus or
+         *  the register is invalid (only when built with exceptions, the status is returned
+         *  otherwise).
+         */
+        I2cStatus add(I2cDevice *device, uint16_t deviceRegister, RegisterLength deviceRegisterBytes, uint8_t* data, uint16_t dataBytes, uint32_t periodTicks);
+
+        /*
+         *  @brief Starts TIM2 at the tick rate of the table.
+         *
+         *  @throws I2cException: If TIM2 already ticks another table, the rate can't be reached or
+         *  there's a HAL error (only when built with exceptions, the status is returned otherwise).
+         */
+        I2cStatus start(void);
+
+        void stop(void);
+
+        size_t size(void);
+
+        /*
+         *  @return nullptr if there's no entry with the index.
+         */
+        const I2cPeriodicStats* getStats(size_t index);
+
+        /*
+         *  @brief Status of the last completed sample of the entry.
+         */
+        I2cStatus getStatus(size_t index);
+
+    friend void TIM2_IRQHandler(void);
+};
\ No newline at end of file
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <stdint.h>
+#include "i2c_hal.hpp"
+
+#include "i2c_transaction.hpp"
+
+typedef enum
+{
+    I2C_REGISTER_FILE_IDLE,
+    // Receiving the register pointer of a host write.
+    I2C_REGISTER_FILE_POINTER,
+    // Receiving the data of a host write, in place.
+    I2C_REGISTER_FILE_WRITE,
+    // Transmitting to a host read, straight from the registers.
+    I2C_REGISTER_FILE_READ
+}
+I2cRegisterFilePhase;
+
+/*
+ *  writes: host writes that changed at least one register.
+ *  reads: host reads started.
+ *  bytesWritten: register bytes written by the hosts.
+ *  errors: transfers ended by a bus error, arbitration loss or overrun.
+ */
+typedef struct
+{
+    uint32_t writes;
+    uint32_t reads;
+    uint32_t bytesWritten;
+    uint32_t errors;
+}
+I2cRegisterFileStats;
+
+/*
+ *  @brief Memory served to the hosts of a bus in slave mode (see I2cBus::setRegisterFile), like
+ *  the registers of an I2C device.
+ *
+ *  A host write starts with the register pointer, the bytes after it are received straight into
+ *  the memory from there. A host read transmits straight from the memory, starting at the pointer.
+ *  The pointer advances past the written bytes, reads don't move it. Both wrap around at the end of
+ *  the memory. Everything runs in the bus interrupts, nothing is copied and the main loop isn't
+ *  involved.
+ *
+ *  The memory changes under the main loop while a host writes: values wider than a byte should be
+ *  read from the write callback, or with the bus interrupts masked.
+ */
+class I2cRegisterFile
+{
+    protected:
+        uint8_t* memory;
+
+        uint16_t size;
+
+        RegisterLength pointerBytes;
+
+        volatile uint16_t pointer = 0;
+
+        uint8_t pointerBuffer[2] = {};
+
+        I2cRegisterFilePhase phase = I2C_REGISTER_FILE_IDLE;
+
+        // Register the receive in progress started at, and the bytes it was given.
+        uint16_t writeStart = 0;
+        uint16_t writeBytes = 0;
+
+        // Registers changed by the last host write.
+        volatile uint16_t lastWriteStart = 0;
+        volatile uint16_t lastWriteBytes = 0;
+
+        Callback writeFunction = nullptr;
+        void* writeParameters = nullptr;
+
+        I2cRegisterFileStats stats = {};
+
+        I2cStatus status = I2C_OK;
+
+        /*
+         *  @brief Receives the host bytes into the registers from the pointer to the end.
+         */
+        void receiveData(I2C_HandleTypeDef *handle, uint32_t options);
+
+        /*
+         *  @brief Accounts the bytes the receive in progress got and moves the pointer past them.
+         */
+        void finishWrite(I2C_HandleTypeDef *handle);
+
+        /*
+         *  @brief HAL slave events, forwarded by the bus.
+         */
+        void addressMatched(I2C_HandleTypeDef *handle, uint8_t direction);
+
+        void receiveComplete(I2C_HandleTypeDef *handle);
+
+        void transmitComplete(I2C_HandleTypeDef *handle);
+
+        /*
+         *  @brief The host released the bus (STOP or NACK) or the transfer failed.
+         */
+        void transferEnded(I2C_HandleTypeDef *handle, uint32_t halError);
+
+        void reset(void);
+
+    public:
+        /*
+         *  @param memory Registers served to the hosts, owned by the caller.
+         *  @param size Bytes of memory.
+         *  @param pointerBytes Length of the register pointer written by the hosts. REGISTER_NULL:
+         *  no pointer, every write and read starts at register 0.
+         *
+         *  @throws I2cException: If there's no memory or its size is 0 (only when built with
+         *  exceptions, check getStatus() otherwise).
+         */
+        I2cRegisterFile(uint8_t* memory, uint16_t size, RegisterLength pointerBytes = REGISTER_8_BITS);
+
+        /*
+         *  @brief Sets the callback called from the bus interrupt after a host write changed
+         *  registers (see getLastWrite). A write wrapping around the end of the memory is reported
+         *  in two parts.
+         */
+        void setWriteCallback(Callback callback, void* parameters);
+
+        /*
+         *  @brief Registers changed by the last host write.
+         */
+        void getLastWrite(uint16_t &start, uint16_t &bytes);
+
+        uint16_t getPointer(void);
+
+        uint8_t* getMemory(void);
+
+        uint16_t getSize(void);
+
+        const I2cRegisterFileStats& getStats(void);
+
+        /*
+         *  @brief Returns the result of the construction of the register file.
+         */
+        I2cStatus getStatus(void);
+
+    friend class I2cBus;
+};
\ No newline at end of file
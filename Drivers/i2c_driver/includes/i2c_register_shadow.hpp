@@ -0,0 +1,148 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <atomic>
+
+#include "i2c_transaction.hpp"
+
+// Registers tracked per shadow.
+#ifndef I2C_SHADOW_MAX_REGISTERS
+#define I2C_SHADOW_MAX_REGISTERS 8
+#endif
+
+// Shadowed writes that can be queued at the same time, each one needs its bytes until it is sent.
+#ifndef I2C_SHADOW_WRITE_BUFFERS
+#define I2C_SHADOW_WRITE_BUFFERS 4
+#endif
+
+// Widest register value, in bytes.
+#define I2C_SHADOW_MAX_BYTES 4
+
+/*
+ *  writes: register writes queued through the shadow.
+ *  suppressedWrites: writes not sent because the register already held the value.
+ *  avoidedReads: read-modify-writes and register reads served from the shadow.
+ */
+typedef struct
+{
+    uint32_t writes;
+    uint32_t suppressedWrites;
+    uint32_t avoidedReads;
+}
+I2cShadowStats;
+
+typedef struct
+{
+    uint16_t deviceRegister;
+    volatile bool valid;
+    volatile uint32_t value;
+    // Shadowed writes queued and not finished yet, the value is the one of the newest.
+    std::atomic<uint8_t> pendingWrites;
+}
+I2cShadowRegister;
+
+/*
+ *  @brief Last known value of the configuration registers of a device (see I2cDevice::setShadow).
+ *
+ *  Every register access of the device that completes updates the shadow: a single register read
+ *  or write stores the value, anything else overlapping a tracked register, or a failed write,
+ *  forgets it. While shadowed writes of a register are queued, completions of that register are
+ *  ignored until the last of them: reads and older writes would overwrite the newest value. Only
+ *  track registers that the device doesn't change on its own.
+ *
+ *  Values are transferred MSB first.
+ */
+class I2cRegisterShadow
+{
+    protected:
+        std::array<I2cShadowRegister, I2C_SHADOW_MAX_REGISTERS> registers = {};
+
+        size_t count = 0;
+
+        RegisterLength registerBytes;
+
+        uint8_t valueBytes;
+
+        std::array<std::array<uint8_t, I2C_SHADOW_MAX_BYTES>, I2C_SHADOW_WRITE_BUFFERS> writeBuffers = {};
+
+        // Write of each buffer, kept here for the queues that only hold references.
+        std::array<I2cTransaction, I2C_SHADOW_WRITE_BUFFERS> writeTransactions = {};
+
+        // Set by the main loop when a buffer is queued, cleared by the completion interrupt.
+        std::array<volatile bool, I2C_SHADOW_WRITE_BUFFERS> writeBuffersUsed = {};
+
+        I2cShadowStats stats = {};
+
+        I2cShadowRegister* find(uint16_t deviceRegister);
+
+        uint32_t decode(const uint8_t* data);
+
+        /*
+         *  @return False if the data isn't a write buffer of the shadow.
+         */
+        bool releaseWrite(uint8_t* buffer);
+
+    public:
+        /*
+         *  @param registerBytes Length of the register addresses of the device.
+         *  @param valueBytes Bytes per register, up to I2C_SHADOW_MAX_BYTES.
+         */
+        I2cRegisterShadow(RegisterLength registerBytes, uint8_t valueBytes);
+
+        /*
+         *  @brief Tracks the register, unknown until it is read or written.
+         *
+         *  @throws I2cException: If every entry is used or the shadow is invalid (only when built
+         *  with exceptions, the status is returned otherwise).
+         */
+        I2cStatus track(uint16_t deviceRegister);
+
+        /*
+         *  @brief Tracks the register with a known value, e.g. its reset value.
+         */
+        I2cStatus track(uint16_t deviceRegister, uint32_t value);
+
+        /*
+         *  @brief Returns the shadowed value of the register.
+         *
+         *  @return I2C_ERROR_NOT_SHADOWED: If the register isn't tracked or its value isn't known.
+         */
+        I2cStatus read(uint16_t deviceRegister, uint32_t &value);
+
+        /*
+         *  @brief Returns the write of the value to the register by the device, built in a free
+         *  buffer of the shadow. The buffer stays free until commitWrite().
+         *
+         *  @return nullptr if the register already holds the value (the write is suppressed, the
+         *  status is I2C_OK) or no buffer is free (I2C_ERROR_SHADOW_FULL).
+         */
+        I2cTransaction* prepareWrite(I2cDevice *device, uint16_t deviceRegister, uint32_t value, I2cStatus &status);
+
+        /*
+         *  @brief Holds the buffer until the write is finished and stores the value, call it right
+         *  before queuing the write.
+         */
+        void commitWrite(I2cTransaction &transaction, uint32_t value);
+
+        /*
+         *  @brief Undoes commitWrite() for a write that couldn't be queued, the register is unknown
+         *  afterwards.
+         */
+        void cancelWrite(I2cTransaction &transaction);
+
+        /*
+         *  @brief Updates the shadow with a finished transaction of the device. Runs in the
+         *  completion interrupt.
+         */
+        void record(I2cTransaction &transaction);
+
+        void countAvoidedRead(void);
+
+        RegisterLength getRegisterBytes(void);
+
+        uint8_t getValueBytes(void);
+
+        const I2cShadowStats& getStats(void);
+};
\ No newline at end of file
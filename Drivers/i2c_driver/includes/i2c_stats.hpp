@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+#include <array>
+
+/*
+ *  Whether the bus timestamps every transaction and keeps the latency statistics per device.
+ *  Disabled unless defined by the build (see the I2C_DRIVER_STATS CMake option).
+ */
+#ifndef I2C_DRIVER_STATS
+#define I2C_DRIVER_STATS 0
+#endif
+
+// Devices (addresses) tracked per bus, the transactions of any other address are not recorded.
+#ifndef I2C_STATS_MAX_DEVICES
+#define I2C_STATS_MAX_DEVICES 4
+#endif
+
+// One bin per power of two of cycles, bin n holds the samples in [2^(n-1), 2^n).
+#define I2C_STATS_HISTOGRAM_BINS 33
+
+typedef uint32_t (*I2cCycleClock)(void);
+
+/*
+ *  @brief Replaces the cycle counter used for the timestamps. The default reads DWT->CYCCNT on
+ *  target; host builds have no default and must provide one (the simulator does).
+ */
+void i2cSetCycleClock(I2cCycleClock clock);
+
+/*
+ *  @brief Enables the DWT cycle counter. Does nothing when another clock was set.
+ */
+void i2cStartCycleClock(void);
+
+uint32_t i2cGetCycles(void);
+
+/*
+ *  @brief Min, max, mean and log2 histogram of a latency in cycles.
+ */
+class I2cLatencyStats
+{
+    protected:
+        uint32_t count = 0;
+        uint32_t min = UINT32_MAX;
+        uint32_t max = 0;
+        uint64_t total = 0;
+        std::array<uint32_t, I2C_STATS_HISTOGRAM_BINS> histogram = {};
+
+    public:
+        void record(uint32_t cycles);
+
+        void reset(void);
+
+        uint32_t getCount(void) const;
+
+        /*
+         *  @brief Returns 0 if nothing was recorded.
+         */
+        uint32_t getMin(void) const;
+
+        uint32_t getMax(void) const;
+
+        uint32_t getMean(void) const;
+
+        const std::array<uint32_t, I2C_STATS_HISTOGRAM_BINS>& getHistogram(void) const;
+};
+
+/*
+ *  @brief Latencies of the transactions to one device address.
+ *
+ *  queueWait: from queuing the transaction to handing it to the HAL.
+ *  wireTime: from handing it to the HAL to the completion callback, once per burst for coalesced
+ *  reads.
+ *  coalescedReads: reads sent inside the burst of an earlier read, each one saved the START,
+ *  address and register bytes of a transfer of its own.
+ */
+typedef struct
+{
+    uint16_t address;
+    I2cLatencyStats queueWait;
+    I2cLatencyStats wireTime;
+    uint32_t coalescedReads;
+}
+I2cDeviceStats;
\ No newline at end of file
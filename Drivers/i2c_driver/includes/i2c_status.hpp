@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ *  Whether the driver reports errors by throwing I2cException on top of returning an I2cStatus.
+ *  Follows the compiler setting (-fexceptions / -fno-exceptions) unless defined by the build.
+ */
+#ifndef I2C_DRIVER_EXCEPTIONS
+#ifdef __cpp_exceptions
+#define I2C_DRIVER_EXCEPTIONS 1
+#else
+#define I2C_DRIVER_EXCEPTIONS 0
+#endif
+#endif
+
+// A byte wide, it is stored in every transaction.
+typedef enum : uint8_t
+{
+    I2C_OK,
+    I2C_ERROR_HAL,
+    I2C_ERROR_INVALID_BUS,
+    I2C_ERROR_BUS_IN_USE,
+    I2C_ERROR_INVALID_ADDRESS,
+    I2C_ERROR_INVALID_REGISTER,
+    I2C_ERROR_NO_DEVICE,
+    I2C_ERROR_NO_BUS,
+    I2C_ERROR_DEVICE_ATTACHED,
+    I2C_ERROR_QUEUE_FULL,
+    I2C_ERROR_CHAIN_FULL,
+    I2C_ERROR_CHAIN_EMPTY,
+    I2C_ERROR_SEQUENCE_ABORTED,
+    I2C_ERROR_NO_TASK_FRAME,
+    I2C_ERROR_INVALID_PRIORITY,
+    I2C_ERROR_NACK,
+    I2C_ERROR_BUS_FAULT,
+    I2C_ERROR_ARBITRATION_LOST,
+    I2C_ERROR_OVERRUN,
+    I2C_ERROR_TIMEOUT,
+    I2C_ERROR_BUS_STUCK,
+    I2C_ERROR_TABLE_FULL,
+    I2C_ERROR_INVALID_PERIOD,
+    I2C_ERROR_TIMER_IN_USE,
+    I2C_ERROR_NOT_SHADOWED,
+    I2C_ERROR_SHADOW_FULL,
+    I2C_ERROR_GROUP_FULL,
+    I2C_ERROR_GROUP_EMPTY,
+    I2C_ERROR_GROUP_BUSY,
+    I2C_ERROR_MASTER_ONLY,
+    I2C_ERROR_SLAVE_MODE,
+    I2C_ERROR_INVALID_CLOCK,
+    I2C_ERROR_INVALID_ARGUMENT,
+    I2C_ERROR_REFERENCE_QUEUE
+}
+I2cStatus;
+
+/*
+ *  @brief Returns a human readable description of the status.
+ */
+const char* i2cStatusMessage(I2cStatus status);
\ No newline at end of file
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <coroutine>
+
+#include "i2c_transaction.hpp"
+
+// Coroutine frames available to I2cTask, allocated from a static pool instead of the heap.
+#ifndef I2C_TASK_MAX_FRAMES
+#define I2C_TASK_MAX_FRAMES 8
+#endif
+
+// Size of each frame of the pool. A coroutine whose frame doesn't fit can't be created.
+#ifndef I2C_TASK_FRAME_BYTES
+#define I2C_TASK_FRAME_BYTES 256
+#endif
+
+/*
+ *  @brief Entry of the run queue: a suspended coroutine ready to be resumed.
+ */
+struct I2cRunNode
+{
+    I2cRunNode *next;
+    std::coroutine_handle<> handle;
+};
+
+/*
+ *  @brief Coroutine driven by the I2cScheduler run queue.
+ *
+ *  The coroutine doesn't start when called, it starts once spawned and then runs until it awaits
+ *  a transaction (see I2cDevice::read and I2cDevice::write). Its frame comes from a fixed pool and
+ *  is released when the coroutine returns.
+ */
+class I2cTask
+{
+    public:
+        class promise_type
+        {
+            public:
+                I2cRunNode node = {};
+
+                I2cTask get_return_object(void);
+
+                /*
+                 *  @brief Returned when the frame pool has no room, spawning it fails.
+                 */
+                static I2cTask get_return_object_on_allocation_failure(void);
+
+                std::suspend_always initial_suspend(void) noexcept;
+
+                std::suspend_never final_suspend(void) noexcept;
+
+                void return_void(void);
+
+                void unhandled_exception(void);
+
+                static void* operator new(size_t size) noexcept;
+
+                static void operator delete(void* frame);
+        };
+
+    protected:
+        std::coroutine_handle<promise_type> handle;
+
+    public:
+        explicit I2cTask(std::coroutine_handle<promise_type> handle = nullptr);
+
+        I2cTask(I2cTask&& task);
+
+        I2cTask(const I2cTask&) = delete;
+
+        I2cTask& operator=(const I2cTask&) = delete;
+
+        /*
+         *  @brief Releases the frame of a coroutine that was never spawned.
+         */
+        ~I2cTask();
+
+        bool isValid(void);
+
+    friend class I2cScheduler;
+};
+
+/*
+ *  @brief Run queue of the coroutines ready to continue.
+ *
+ *  Completion callbacks only push the coroutine to the queue, so it is never resumed from an
+ *  interrupt handler: run() resumes them from the main loop. Pushing is lock-free and can be done
+ *  from any context; spawning and running only from the main loop.
+ */
+class I2cScheduler
+{
+    protected:
+        static std::atomic<I2cRunNode*> ready;
+
+    public:
+        /*
+         *  @brief Queues a coroutine created by calling an I2cTask function. It starts on the
+         *  next run().
+         *
+         *  @throws I2cException: If the frame pool was exhausted when the task was created (only
+         *  when built with exceptions, the status is returned otherwise).
+         */
+        static I2cStatus spawn(I2cTask task);
+
+        static void schedule(I2cRunNode &node);
+
+        /*
+         *  @brief Resumes every coroutine that is ready, in the order they became ready.
+         *
+         *  @return The number of coroutines resumed.
+         */
+        static size_t run(void);
+
+        static size_t getFreeFrames(void);
+};
+
+/*
+ *  @brief Awaitable transaction, see I2cDevice::read and I2cDevice::write.
+ *
+ *  The transaction is built in the bus queue when the coroutine suspends and the coroutine is
+ *  queued on the scheduler when it completes. co_await returns the status of the transaction.
+ */
+class I2cTransactionAwaiter
+{
+    protected:
+        I2cDevice *device;
+        TransactionDirection direction;
+        uint8_t* data;
+        uint16_t dataBytes;
+        uint16_t deviceRegister;
+        RegisterLength deviceRegisterBytes;
+
+        I2cRunNode *node = nullptr;
+        I2cStatus status = I2C_OK;
+
+        static void complete(void* parameters);
+
+    public:
+        I2cTransactionAwaiter(
+            I2cDevice *device,
+            TransactionDirection direction,
+            uint8_t* data,
+            uint16_t dataBytes,
+            uint16_t deviceRegister,
+            RegisterLength deviceRegisterBytes
+        );
+
+        bool await_ready(void);
+
+        /*
+         *  @brief Queues the transaction. The coroutine isn't suspended if it can't be queued
+         *  (device without bus, queue full, invalid transaction): co_await returns the error
+         *  instead, it never raises.
+         */
+        bool await_suspend(std::coroutine_handle<I2cTask::promise_type> handle);
+
+        I2cStatus await_resume(void);
+};
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "i2c_status.hpp"
+
+// Fastest SCL of the peripheral (fast mode), and the fastest of standard mode.
+#define I2C_FAST_MODE_MAX_FREQUENCY     400000
+#define I2C_STANDARD_MODE_MAX_FREQUENCY 100000
+
+// PCLK1 range of the peripheral FREQ field. Fast mode needs at least 4 MHz.
+#define I2C_PCLK1_MIN_STANDARD 2000000
+#define I2C_PCLK1_MIN_FAST     4000000
+#define I2C_PCLK1_MAX          50000000
+
+typedef enum
+{
+    I2C_DUTY_CYCLE_2,
+    I2C_DUTY_CYCLE_16_9
+
+}
+I2cDutyCycle;
+
+/*
+ *  Clock control of the peripheral for a SCL frequency, as HAL_I2C_Init() programs it from PCLK1.
+ *
+ *  ccr: CCR field, SCL period in PCLK1 cycles divided by 2 (standard mode), 3 (fast mode, duty
+ *  cycle 2) or 25 (fast mode, duty cycle 16/9). Rounded up, so SCL never runs faster than asked.
+ *  trise: TRISE field, the longest rise time of the mode (1000 ns, 300 ns) in PCLK1 cycles plus 1.
+ *  sclFrequency: frequency SCL actually runs at. exact: whether it's the one asked for.
+ */
+typedef struct
+{
+    uint32_t pclk1;
+    uint32_t sclFrequency;
+    uint16_t ccr;
+    uint16_t trise;
+    bool fastMode;
+    I2cDutyCycle dutyCycle;
+    bool exact;
+}
+I2cTiming;
+
+/*
+ *  @brief Computes the CCR and TRISE fields for the SCL frequency at the PCLK1 frequency.
+ *
+ *  A 400 kHz SCL is exact when PCLK1 is a multiple of 1.2 MHz with duty cycle 2, or of 10 MHz with
+ *  duty cycle 16/9. 100 kHz needs a multiple of 200 kHz.
+ *
+ *  @return I2C_ERROR_INVALID_CLOCK: If the SCL frequency is 0 or above 400 kHz, or PCLK1 is out of
+ *  the range of the peripheral for the mode.
+ */
+I2cStatus i2cComputeTiming(uint32_t pclk1, uint32_t clockSpeed, I2cDutyCycle dutyCycle, I2cTiming &timing);
\ No newline at end of file
@@ -2,9 +2,11 @@
 
 #include <stdint.h>
 
-class I2cDevice;
+#include "i2c_callback.hpp"
+#include "i2c_stats.hpp"
+#include "i2c_status.hpp"
 
-typedef void (*Callback)(void*);
+class I2cDevice;
 
 typedef enum
 {
@@ -20,22 +22,82 @@ typedef enum
     REGISTER_16_BITS
 }
 RegisterLength;
+
+typedef enum
+{
+    I2C_TRANSFER_DEFAULT,
+    I2C_TRANSFER_INTERRUPT,
+    I2C_TRANSFER_DMA,
+    // Interrupts driving the peripheral registers, without the HAL (see I2cDirectTransfer).
+    I2C_TRANSFER_DIRECT
+}
+I2cTransferMode;
+
+#define I2C_PRIORITY_CLASSES 3
+
+/*
+ *  Priority class of a transaction. The bus always starts the oldest transaction of the highest
+ *  class with pending transactions.
+ */
+typedef enum
+{
+    I2C_PRIORITY_HIGH,
+    I2C_PRIORITY_NORMAL,
+    I2C_PRIORITY_LOW
+}
+I2cPriority;
+
+/*
+ *  What is left of a transaction once it is finished: its post-transaction callback.
+ */
+typedef I2cCallback I2cCompletion;
+
+/*
+ *  Position of a transaction inside a repeated START sequence (see I2cTransactionChain).
+ */
+typedef enum
+{
+    I2C_FRAME_SINGLE,
+    I2C_FRAME_FIRST,
+    I2C_FRAME_NEXT,
+    I2C_FRAME_LAST
+}
+I2cSequenceFrame;
  
 class I2cTransaction
 {
     protected:
-        TransactionDirection direction;
-        uint16_t address;
+        // Copied into every queue slot: widest fields first so nothing is padded (see the
+        // static_assert below the class).
         uint8_t* data;
-        uint16_t dataBytes;
         I2cDevice* device;
+        I2cStatus* statusOutput = nullptr;
+
+        I2cCallback preCallbackFunction;
+        I2cCallback postCallbackFunction;
+
+#if I2C_DRIVER_STATS
+        // Cycle counter when the transaction was queued and when it was handed to the HAL.
+        uint32_t queuedCycles = 0;
+        uint32_t startedCycles = 0;
+#endif
+
+        uint16_t address;
+        uint16_t dataBytes;
         uint16_t deviceRegister;
-        RegisterLength deviceRegisterBytes;
 
-        void* preCallbackParameters = nullptr;
-        void* postCallbackParameters = nullptr;
-        Callback preCallbackFunction = nullptr;
-        Callback postCallbackFunction = nullptr;
+        I2cStatus status = I2C_OK;
+
+        // Times the transaction was handed to the HAL (see I2cDevice::setRetryPolicy).
+        uint8_t attempts = 0;
+
+        // Set before the transaction is queued, never by the interrupts.
+        TransactionDirection direction : 1;
+        RegisterLength deviceRegisterBytes : 2;
+        I2cTransferMode transferMode : 2 = I2C_TRANSFER_DEFAULT;
+        I2cSequenceFrame sequenceFrame : 2 = I2C_FRAME_SINGLE;
+        I2cPriority priority : 2 = I2C_PRIORITY_NORMAL;
+        bool immediateCallback : 1 = false;
 
     public:
         I2cTransaction();
@@ -52,10 +114,26 @@ class I2cTransaction
 
         void setPreCallback(Callback callback, void* parameters);
 
+        /*
+         *  @brief Sets the pre-transaction callback, e.g. a lambda capturing a pointer (see
+         *  I2cCallback).
+         */
+        void setPreCallback(I2cCallback callback);
+
         void setPostCallback(Callback callback, void* parameters);
 
+        void setPostCallback(I2cCallback callback);
+
+        /*
+         *  @brief Selects the transfer engine for this transaction. I2C_TRANSFER_DEFAULT uses the one
+         *  configured on the bus.
+         */
+        void setTransferMode(I2cTransferMode transferMode);
+
         uint16_t getAddress(void);
 
+        I2cDevice* getDevice(void);
+
         uint8_t* getDataPointer(void);
 
         uint16_t getDataLenthBytes(void);
@@ -66,6 +144,67 @@ class I2cTransaction
 
         TransactionDirection getDirection();
 
+        I2cTransferMode getTransferMode(void);
+
+        /*
+         *  @brief Selects the priority class the transaction is queued in. Defaults to the
+         *  priority of its device.
+         */
+        void setPriority(I2cPriority priority);
+
+        I2cPriority getPriority(void);
+
+        /*
+         *  @brief Marks the transaction as part of a repeated START sequence. Only START is
+         *  generated before the first frame and only STOP after the last one; a direction change
+         *  between frames generates a repeated START. Frames can't have a register.
+         */
+        void setSequenceFrame(I2cSequenceFrame sequenceFrame);
+
+        I2cSequenceFrame getSequenceFrame(void);
+
+        /*
+         *  @brief Whether more frames of the same sequence follow this transaction.
+         */
+        bool continuesSequence(void);
+
+        /*
+         *  @brief Returns I2C_OK, or the reason why the transaction was rejected or could not be
+         *  started on the bus. Meant to be checked from the post-transaction callback.
+         */
+        I2cStatus getStatus(void);
+
+        void setStatus(I2cStatus status);
+
+        /*
+         *  @brief Sets where the final status is written when the transaction finishes, before the
+         *  post-transaction callback is called or deferred.
+         */
+        void setStatusOutput(I2cStatus *output);
+
+        /*
+         *  @brief Runs the post-transaction callback in the completion interrupt even when the bus
+         *  defers completions (see I2cBus::setDeferredCompletions). Only for short, interrupt safe
+         *  callbacks.
+         */
+        void setImmediateCallback(bool immediate);
+
+        bool isCallbackImmediate(void);
+
+        uint8_t getAttempts(void);
+
+        void addAttempt(void);
+
+        void resetAttempts(void);
+
+        /*
+         *  @brief Records the final status of the transaction, in the register shadow of its
+         *  device as well.
+         */
+        void finish(I2cStatus status);
+
+        I2cCompletion getCompletion(void);
+
         /*
          *  @brief Calls the pre-transaction callback before the transaction is set with the configured parameters.
          */
@@ -76,5 +215,36 @@ class I2cTransaction
          */
         void postCallback(void);
 
-        void send(void);
-};
\ No newline at end of file
+        /*
+         *  @brief Queues the transaction on the bus of its device.
+         *
+         *  @throws I2cException: If the transaction is invalid, has no device or the queue is full
+         *  (only when built with exceptions, the status is returned otherwise).
+         */
+        I2cStatus send(void);
+
+#if I2C_DRIVER_STATS
+    friend class I2cBus;
+#endif
+};
+
+/*
+ *  Seven pointers (data, device, status output and the two callbacks) and 12 bytes of fields
+ *  packed after them, 20 with I2C_DRIVER_STATS. Every queue slot holds one. Checked on the ABIs
+ *  the driver is built for: arm-none-eabi on target, LP64 for the host simulation.
+ */
+#if I2C_DRIVER_STATS
+#define I2C_TRANSACTION_TARGET_BYTES 48
+#define I2C_TRANSACTION_HOST_BYTES   80
+#else
+#define I2C_TRANSACTION_TARGET_BYTES 40
+#define I2C_TRANSACTION_HOST_BYTES   72
+#endif
+
+#if defined(__arm__)
+static_assert(sizeof(I2cTransaction) == I2C_TRANSACTION_TARGET_BYTES,
+    "I2cTransaction has padding or new fields, every queue slot holds one");
+#elif defined(__LP64__)
+static_assert(sizeof(I2cTransaction) == I2C_TRANSACTION_HOST_BYTES,
+    "I2cTransaction has padding or new fields, every queue slot holds one");
+#endif
\ No newline at end of file
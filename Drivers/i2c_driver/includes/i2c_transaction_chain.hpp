@@ -0,0 +1,112 @@
+#pragma once
+
+#include <stdint.h>
+#include <array>
+
+#include "i2c_transaction.hpp"
+
+#define I2C_TRANSACTION_CHAIN_MAX_FRAMES 4
+
+/*
+ *  @brief Sequence of plain transfers to one device, run back to back under a single bus ownership.
+ *
+ *  Frames are separated by repeated STARTs on direction changes instead of STOP + START, and no
+ *  transaction of another device can be sent in between. Typical use: write a command, read the
+ *  answer, write the acknowledge.
+ *
+ *  A failing frame aborts the rest of the chain. Its status and index are reported once the chain
+ *  is finished (see getStatus and getFailedFrame), so the chain must stay alive until its post
+ *  callback is called, whatever the queue of the bus.
+ */
+class I2cTransactionChain
+{
+    protected:
+        I2cDevice* device;
+        std::array<I2cTransaction, I2C_TRANSACTION_CHAIN_MAX_FRAMES> frames;
+        uint8_t frameCount = 0;
+        I2cPriority priority;
+
+        I2cCallback preCallbackFunction;
+        I2cCallback postCallbackFunction;
+
+        // Written by the bus as each frame finishes.
+        std::array<I2cStatus, I2C_TRANSACTION_CHAIN_MAX_FRAMES> frameStatus = {};
+        I2cStatus *statusOutput = nullptr;
+
+        I2cStatus addFrame(TransactionDirection direction, uint8_t* data, uint16_t dataBytes);
+
+        /*
+         *  @brief Post callback of the last frame: reports the first failure, then calls the post
+         *  callback of the chain.
+         */
+        static void complete(void* parameters);
+
+    public:
+        explicit I2cTransactionChain(I2cDevice *device);
+
+        /*
+         *  @throws I2cException: If the chain has no device or is full (only when built with
+         *  exceptions, the status is returned otherwise).
+         */
+        I2cStatus addWrite(uint8_t* data, uint16_t dataBytes);
+
+        /*
+         *  @throws I2cException: If the chain has no device or is full (only when built with
+         *  exceptions, the status is returned otherwise).
+         */
+        I2cStatus addRead(uint8_t* data, uint16_t dataBytes);
+
+        /*
+         *  @brief Sets the callback called before the first frame is sent.
+         */
+        void setPreCallback(Callback callback, void* parameters);
+
+        void setPreCallback(I2cCallback callback);
+
+        /*
+         *  @brief Sets the callback called once the last frame is finished.
+         */
+        void setPostCallback(Callback callback, void* parameters);
+
+        void setPostCallback(I2cCallback callback);
+
+        /*
+         *  @brief Sets where the status of the chain (see getStatus) is written when it finishes,
+         *  before the post callback is called.
+         */
+        void setStatusOutput(I2cStatus *output);
+
+        /*
+         *  @brief Sets the priority class of all the frames. Defaults to the priority of the device.
+         */
+        void setPriority(I2cPriority priority);
+
+        uint8_t getFrameCount(void);
+
+        /*
+         *  @brief Status of the first frame that failed, I2C_OK if the whole chain succeeded. Only
+         *  meaningful once the chain is finished.
+         */
+        I2cStatus getStatus(void);
+
+        /*
+         *  @brief Index of the first frame that failed, getFrameCount() if none did.
+         */
+        uint8_t getFailedFrame(void);
+
+        /*
+         *  @brief Removes all the frames.
+         */
+        void clear(void);
+
+        /*
+         *  @brief Queues all the frames on the bus of the device. If the bus queue holds references
+         *  (see ReferenceQueue) the frames are queued in place and the chain must stay untouched
+         *  until the post callback is called.
+         *
+         *  @throws I2cException: If the chain is empty, the device has no bus or the bus queue
+         *  can't hold all the frames (only when built with exceptions, the status is returned
+         *  otherwise).
+         */
+        I2cStatus send(void);
+};
\ No newline at end of file
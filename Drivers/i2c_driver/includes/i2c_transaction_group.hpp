@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <atomic>
+
+#include "i2c_transaction.hpp"
+
+// Transactions per group, on any mix of buses.
+#ifndef I2C_TRANSACTION_GROUP_MAX_MEMBERS
+#define I2C_TRANSACTION_GROUP_MAX_MEMBERS 8
+#endif
+
+class I2cTransactionGroup;
+
+typedef struct
+{
+    I2cTransaction transaction;
+    // Post callback the transaction was added with, called before the member is counted done.
+    I2cCompletion completion;
+    I2cStatus status;
+    I2cTransactionGroup *group;
+}
+I2cGroupMember;
+
+/*
+ *  @brief Transactions on several buses started together, with a single completion once all of
+ *  them are finished.
+ *
+ *  Each bus works through its own members while the others do the same, so a group spread over
+ *  the buses takes about as long as its busiest bus instead of the sum of all of them. The
+ *  completion callback runs where the last member completes: in its bus interrupt, or deferred
+ *  with the completions of that bus (see I2cBus::setDeferredCompletions).
+ */
+class I2cTransactionGroup
+{
+    protected:
+        std::array<I2cGroupMember, I2C_TRANSACTION_GROUP_MAX_MEMBERS> members = {};
+
+        size_t count = 0;
+
+        // Members not finished yet, decremented from the interrupts of every bus of the group.
+        std::atomic<size_t> remaining = 0;
+
+        // First failure of a member, I2C_OK if all of them succeeded. Members fail from start()
+        // and from the bus interrupts at the same time.
+        std::atomic<I2cStatus> status = I2C_OK;
+
+        Callback completionFunction = nullptr;
+        void* completionParameters = nullptr;
+
+        // Cycle clock at start() and when the last member finished.
+        uint32_t startedCycles = 0;
+        volatile uint32_t completedCycles = 0;
+
+        static void memberComplete(void* parameters);
+
+        /*
+         *  @brief Counts the member done and completes the group after the last one.
+         */
+        void finishMember(I2cGroupMember &member);
+
+    public:
+        /*
+         *  @brief Adds a copy of the transaction, which is queued on the bus of its device by
+         *  start(). The status of the member is read from the group, the status output of the
+         *  transaction isn't written. Its post callback is still called.
+         *
+         *  @throws I2cException: If the group is full or running, or the transaction has no device
+         *  (only when built with exceptions, the status is returned otherwise).
+         */
+        I2cStatus add(const I2cTransaction &transaction);
+
+        /*
+         *  @brief Sets the callback called once every member is finished.
+         */
+        void setCompletionCallback(Callback callback, void* parameters);
+
+        /*
+         *  @brief Queues every member on its bus. Members that can't be queued (no bus, full queue)
+         *  are finished right away with the error, the group still completes once the others do.
+         *
+         *  @throws I2cException: If the group is empty or still running (only when built with
+         *  exceptions, the status is returned otherwise).
+         */
+        I2cStatus start(void);
+
+        /*
+         *  @brief Whether every member of the last start() is finished.
+         */
+        bool isComplete(void);
+
+        /*
+         *  @brief First failure among the members, I2C_OK if all of them succeeded.
+         */
+        I2cStatus getStatus(void);
+
+        /*
+         *  @return I2C_ERROR_NO_DEVICE if there's no member with the index.
+         */
+        I2cStatus getStatus(size_t index);
+
+        /*
+         *  @brief Cycles of the cycle clock from start() to the completion of the last member (see
+         *  i2cSetCycleClock). 0 until the group is complete.
+         */
+        uint32_t getDuration(void);
+
+        size_t size(void);
+
+        /*
+         *  @brief Removes all the members, once the group is complete.
+         */
+        void clear(void);
+};
\ No newline at end of file
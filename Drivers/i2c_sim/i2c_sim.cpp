@@ -0,0 +1,1841 @@
+#include "i2c_sim.hpp"
+
+#include <algorithm>
+#include <array>
+
+#include "i2c_bus.hpp"
+#include "i2c_periodic.hpp"
+
+#define I2C_SIM_BITS_PER_BYTE 9
+
+// Private to the HAL source: marks a non sequential transfer.
+#define I2C_NO_OPTION_FRAME 0xFFFF0000U
+
+#define I2C_SIM_NANOSECONDS_PER_SECOND 1000000000ULL
+
+typedef enum
+{
+    SIM_MASTER_TX,
+    SIM_MASTER_RX,
+    SIM_MEM_TX,
+    SIM_MEM_RX,
+    // Transfer of an external master to the bus in slave mode (see I2cSim::hostTransfer).
+    SIM_HOST,
+    // Transfer driven through the registers of the peripheral (see I2cDirectTransfer).
+    SIM_REGISTER
+}
+I2cSimTransferType;
+
+typedef struct
+{
+    bool active;
+    I2cSimTransferType type;
+    bool dma;
+    bool acknowledged;
+    // HAL error code the transfer ends with, raised through the error interrupt.
+    uint32_t error;
+    uint16_t bytes;
+    uint64_t end;
+}
+I2cSimTransfer;
+
+typedef enum
+{
+    SIM_WIRE_NONE,
+    SIM_WIRE_START,
+    SIM_WIRE_ADDRESS,
+    SIM_WIRE_WRITE,
+    SIM_WIRE_READ,
+    SIM_WIRE_STOP
+}
+I2cSimWireAction;
+
+/*
+ *  Registers of the peripheral, laid out like I2C_TypeDef.
+ */
+typedef struct
+{
+    uint32_t CR1;
+    uint32_t CR2;
+    uint32_t OAR1;
+    uint32_t OAR2;
+    uint32_t DR;
+    uint32_t SR1;
+    uint32_t SR2;
+    uint32_t CCR;
+    uint32_t TRISE;
+    uint32_t FLTR;
+}
+I2cSimRegisters;
+
+static_assert(sizeof(I2cSimRegisters) == sizeof(I2C_TypeDef));
+
+/*
+ *  Register level model of the peripheral in master mode.
+ */
+typedef struct
+{
+    // What software sees: CR1, CR2, DR, SR1 and SR2 are modeled, the rest is only stored.
+    I2cSimRegisters registers;
+
+    // On the wire until the end of the transfer, SIM_WIRE_NONE while SCL is stretched or idle.
+    I2cSimWireAction action;
+    uint8_t shift;
+
+    // Transmitter: a byte waits in DR for the shift register.
+    bool dataPending;
+
+    // Receiver: a byte waits in the shift register for DR to be read (BTF), and the ACK of the last
+    // byte. With POS, the ACK of a byte is taken from CR1 when the previous one ends.
+    bool shiftFull;
+    bool lastAck;
+    bool posAck;
+
+    // START or STOP requested while a byte is on the wire, generated after it.
+    bool startPending;
+    bool stopPending;
+
+    // SR1 was read: the next access to SR2 or DR clears ADDR, SB or BTF.
+    bool statusRead;
+
+    I2cSimDevice *device;
+    bool read;
+
+    // The transfer was NACKed or ran into a fault.
+    bool failed;
+    I2cSimFault fault;
+}
+I2cSimPeripheral;
+
+typedef struct
+{
+    I2C_HandleTypeDef *handle;
+    std::array<I2cSimDevice*, I2C_SIM_MAX_DEVICES> devices;
+    I2cSimTransfer transfer;
+    I2cSimBusStats stats;
+
+    // Sequential transfer in progress (bus kept between frames) and its last direction.
+    I2cSimDevice *sequenceDevice;
+    bool sequenceRead;
+
+    // End of the last completed transfer, for the idle gap statistics.
+    bool transferred;
+    uint64_t lastEnd;
+
+    // Transfer of the external master: bytes written, then read after a repeated START.
+    uint16_t hostAddress;
+    std::array<uint8_t, I2C_SIM_HOST_MAX_BYTES> hostWrite;
+    uint16_t hostWriteBytes;
+    uint8_t *hostRead;
+    uint16_t hostReadBytes;
+
+    // Fault injected into the next transfer.
+    I2cSimFault fault;
+    uint8_t heldPulses;
+
+    // Line levels: SDA held by a slave, SCL and SDA driven low through GPIO.
+    bool sdaHeld;
+    bool sclLow;
+    bool sdaLow;
+
+    I2cSimPeripheral peripheral;
+}
+I2cSimBus;
+
+typedef struct
+{
+    TIM_HandleTypeDef *handle;
+    bool running;
+    uint64_t period;
+    uint64_t next;
+}
+I2cSimTimer;
+
+typedef void (*I2cSimInterruptHandler)(void);
+
+typedef struct
+{
+    I2cSimInterruptHandler event;
+    I2cSimInterruptHandler error;
+    I2cSimInterruptHandler dmaRx;
+    I2cSimInterruptHandler dmaTx;
+}
+I2cSimInterruptHandlers;
+
+// Same stream assignment as I2cBusTraits.
+static const std::array<I2cSimInterruptHandlers, I2C_SIM_BUS_MAX> interruptHandlers = {{
+    {I2C1_EV_IRQHandler, I2C1_ER_IRQHandler, DMA1_Stream0_IRQHandler, DMA1_Stream6_IRQHandler},
+    {I2C2_EV_IRQHandler, I2C2_ER_IRQHandler, DMA1_Stream3_IRQHandler, DMA1_Stream7_IRQHandler},
+    {I2C3_EV_IRQHandler, I2C3_ER_IRQHandler, DMA1_Stream2_IRQHandler, DMA1_Stream4_IRQHandler}
+}};
+
+static std::array<I2cSimBus, I2C_SIM_BUS_MAX> buses = {};
+
+// TIM2, the only timer used by the driver.
+static I2cSimTimer timer = {};
+
+static uint64_t now = 0;
+
+static uint32_t interruptMask = 0;
+
+static I2cSimBus* getBus(I2C_TypeDef *instance)
+{
+    if(instance == I2C1)
+        return &buses[0];
+    if(instance == I2C2)
+        return &buses[1];
+    if(instance == I2C3)
+        return &buses[2];
+
+    return nullptr;
+}
+
+static I2cSimDevice* findDevice(I2cSimBus *bus, uint16_t address)
+{
+    for(I2cSimDevice *device : bus->devices)
+    {
+        if(device && device->getAddress() == address)
+            return device;
+    }
+
+    return nullptr;
+}
+
+/*
+ *  Whether a transfer will complete, stalled transfers never do.
+ */
+static bool isTransferPending(void)
+{
+    for(I2cSimBus &bus : buses)
+    {
+        if(bus.transfer.active && bus.transfer.end != UINT64_MAX)
+            return true;
+    }
+
+    return false;
+}
+
+static uint64_t getBitTime(I2C_HandleTypeDef *handle)
+{
+    return I2C_SIM_NANOSECONDS_PER_SECOND / handle->Init.ClockSpeed;
+}
+
+/*
+ *  Returns the bus the pin belongs to, nullptr if it's not the SCL or SDA pin of any of them.
+ */
+static I2cSimBus* getPinBus(GPIO_TypeDef *port, uint16_t pin, bool &scl)
+{
+    for(size_t i = 0; i < I2C_SIM_BUS_MAX; i++)
+    {
+        const I2cBusConfig &config = i2cBusConfigs[i];
+        uintptr_t address = reinterpret_cast<uintptr_t>(port);
+
+        if(config.sclPort == address && config.sclPin == pin)
+        {
+            scl = true;
+            return &buses[i];
+        }
+
+        if(config.sdaPort == address && config.sdaPin == pin)
+        {
+            scl = false;
+            return &buses[i];
+        }
+    }
+
+    return nullptr;
+}
+
+/*
+ *  Register level model of the peripheral (see I2cSimPeripheral)
+ */
+#define I2C_SIM_ERROR_FLAGS (I2C_SR1_BERR | I2C_SR1_ARLO | I2C_SR1_AF | I2C_SR1_OVR | I2C_SR1_PECERR | I2C_SR1_TIMEOUT | I2C_SR1_SMBALERT)
+
+// Interrupts serviced in a row before an interrupt nobody clears is considered stuck.
+#define I2C_SIM_INTERRUPT_REPEATS 16
+
+static bool isEventRaised(const I2cSimRegisters &registers)
+{
+    if(!(registers.CR2 & I2C_CR2_ITEVTEN))
+        return false;
+
+    if(registers.SR1 & (I2C_SR1_SB | I2C_SR1_ADDR | I2C_SR1_BTF | I2C_SR1_ADD10 | I2C_SR1_STOPF))
+        return true;
+
+    return (registers.CR2 & I2C_CR2_ITBUFEN) && (registers.SR1 & (I2C_SR1_TXE | I2C_SR1_RXNE));
+}
+
+static bool isErrorRaised(const I2cSimRegisters &registers)
+{
+    return (registers.CR2 & I2C_CR2_ITERREN) && (registers.SR1 & I2C_SIM_ERROR_FLAGS);
+}
+
+/*
+ *  Keeps the bus transfer in line with the model: pending until the wire action ends, or right away
+ *  while an enabled flag is set. A master stretching SCL with nothing enabled waits for software.
+ */
+static void scheduleRegisters(I2cSimBus *bus)
+{
+    I2cSimPeripheral &peripheral = bus->peripheral;
+    if(peripheral.action != SIM_WIRE_NONE)
+        return;
+
+    const I2cSimRegisters &registers = peripheral.registers;
+    bool raised = isEventRaised(registers) || isErrorRaised(registers);
+    bool waiting = (registers.SR2 & I2C_SR2_MSL) || (registers.CR1 & I2C_CR1_START);
+
+    bus->transfer.active = raised || waiting;
+    bus->transfer.end = raised ? now : UINT64_MAX;
+}
+
+static void beginWireAction(I2cSimBus *bus, I2cSimWireAction action)
+{
+    uint64_t bits = (action == SIM_WIRE_START || action == SIM_WIRE_STOP) ? 1 : I2C_SIM_BITS_PER_BYTE;
+    uint64_t duration = bits * getBitTime(bus->handle);
+
+    bus->peripheral.action = action;
+    bus->transfer = {
+        .active = true,
+        .type = SIM_REGISTER,
+        .dma = false,
+        .acknowledged = true,
+        .error = HAL_I2C_ERROR_NONE,
+        .bytes = 0,
+        .end = now + duration
+    };
+
+    bus->stats.busyTime += duration;
+}
+
+/*
+ *  START on an idle bus: the fault injected into the next transfer is taken here.
+ */
+static void requestStart(I2cSimBus *bus)
+{
+    I2cSimPeripheral &peripheral = bus->peripheral;
+
+    if(!(peripheral.registers.SR2 & I2C_SR2_MSL))
+    {
+        peripheral.failed = false;
+        peripheral.fault = bus->fault;
+        bus->fault = I2C_SIM_FAULT_NONE;
+
+        if(bus->transferred)
+        {
+            bus->stats.gaps++;
+            bus->stats.gapTime += now - bus->lastEnd;
+        }
+
+        // The slave holds SDA from now on: START can't be generated, SB never comes.
+        if(peripheral.fault == I2C_SIM_FAULT_STUCK_SDA)
+        {
+            peripheral.fault = I2C_SIM_FAULT_NONE;
+            bus->sdaHeld = true;
+        }
+    }
+
+    if(bus->sdaHeld)
+        return;
+
+    peripheral.registers.SR1 &= ~(I2C_SR1_BTF | I2C_SR1_TXE);
+    beginWireAction(bus, SIM_WIRE_START);
+}
+
+static void requestStop(I2cSimBus *bus)
+{
+    bus->peripheral.registers.SR1 &= ~(I2C_SR1_BTF | I2C_SR1_TXE);
+    beginWireAction(bus, SIM_WIRE_STOP);
+}
+
+/*
+ *  Generates the START or STOP requested during the byte that just ended, or goes on receiving.
+ */
+static void continueWire(I2cSimBus *bus)
+{
+    I2cSimPeripheral &peripheral = bus->peripheral;
+
+    if(peripheral.stopPending)
+    {
+        peripheral.stopPending = false;
+        requestStop(bus);
+    }
+    else if(peripheral.startPending)
+    {
+        peripheral.startPending = false;
+        requestStart(bus);
+    }
+    else if(peripheral.read && peripheral.lastAck && !peripheral.shiftFull && !(peripheral.registers.CR1 & I2C_CR1_STOP))
+    {
+        beginWireAction(bus, SIM_WIRE_READ);
+    }
+}
+
+static void addressSent(I2cSimBus *bus)
+{
+    I2cSimPeripheral &peripheral = bus->peripheral;
+    I2cSimRegisters &registers = peripheral.registers;
+
+    peripheral.read = peripheral.shift & 1;
+    peripheral.device = nullptr;
+
+    if(peripheral.fault != I2C_SIM_FAULT_NONE)
+    {
+        switch(peripheral.fault)
+        {
+            case I2C_SIM_FAULT_BUS_ERROR:
+                registers.SR1 |= I2C_SR1_BERR;
+                break;
+            case I2C_SIM_FAULT_ARBITRATION_LOST:
+                // The peripheral drops back to slave mode.
+                registers.SR1 |= I2C_SR1_ARLO;
+                registers.SR2 &= ~(I2C_SR2_MSL | I2C_SR2_BUSY | I2C_SR2_TRA);
+                break;
+            default:
+                registers.SR1 |= I2C_SR1_OVR;
+                break;
+        }
+
+        peripheral.fault = I2C_SIM_FAULT_NONE;
+        peripheral.failed = true;
+        bus->stats.faults++;
+        return;
+    }
+
+    I2cSimDevice *device = findDevice(bus, peripheral.shift >> 1);
+    if(!device || !device->start(peripheral.read))
+    {
+        registers.SR1 |= I2C_SR1_AF;
+        peripheral.failed = true;
+        bus->stats.nacks++;
+        return;
+    }
+
+    peripheral.device = device;
+    registers.SR1 |= I2C_SR1_ADDR;
+    if(peripheral.read)
+        registers.SR2 &= ~I2C_SR2_TRA;
+    else
+        registers.SR2 |= I2C_SR2_TRA;
+}
+
+static void byteWritten(I2cSimBus *bus)
+{
+    I2cSimPeripheral &peripheral = bus->peripheral;
+    I2cSimRegisters &registers = peripheral.registers;
+
+    bus->stats.bytes++;
+    if(!peripheral.device->writeByte(peripheral.shift))
+    {
+        registers.SR1 |= I2C_SR1_AF;
+        peripheral.failed = true;
+        bus->stats.nacks++;
+        return;
+    }
+
+    if(peripheral.stopPending || peripheral.startPending)
+    {
+        continueWire(bus);
+        return;
+    }
+
+    if(peripheral.dataPending)
+    {
+        peripheral.dataPending = false;
+        peripheral.shift = registers.DR;
+        registers.SR1 |= I2C_SR1_TXE;
+        beginWireAction(bus, SIM_WIRE_WRITE);
+        return;
+    }
+
+    // Nothing to send: SCL is stretched until DR is written, or START or STOP requested.
+    registers.SR1 |= I2C_SR1_BTF;
+}
+
+static void byteRead(I2cSimBus *bus)
+{
+    I2cSimPeripheral &peripheral = bus->peripheral;
+    I2cSimRegisters &registers = peripheral.registers;
+
+    uint8_t byte = peripheral.device->readByte();
+    bool ack = (registers.CR1 & I2C_CR1_POS) ? peripheral.posAck : (registers.CR1 & I2C_CR1_ACK);
+    peripheral.posAck = registers.CR1 & I2C_CR1_ACK;
+    peripheral.lastAck = ack;
+    bus->stats.bytes++;
+
+    // DR still full: the byte stays in the shift register and SCL is stretched.
+    if(registers.SR1 & I2C_SR1_RXNE)
+    {
+        peripheral.shift = byte;
+        peripheral.shiftFull = true;
+        registers.SR1 |= I2C_SR1_BTF;
+    }
+    else
+    {
+        registers.DR = byte;
+        registers.SR1 |= I2C_SR1_RXNE;
+    }
+
+    continueWire(bus);
+}
+
+static void finishWireAction(I2cSimBus *bus)
+{
+    I2cSimPeripheral &peripheral = bus->peripheral;
+    I2cSimRegisters &registers = peripheral.registers;
+
+    I2cSimWireAction action = peripheral.action;
+    peripheral.action = SIM_WIRE_NONE;
+
+    switch(action)
+    {
+        case SIM_WIRE_START:
+            registers.CR1 &= ~I2C_CR1_START;
+            registers.SR1 |= I2C_SR1_SB;
+            registers.SR2 |= I2C_SR2_MSL | I2C_SR2_BUSY;
+            break;
+        case SIM_WIRE_ADDRESS:
+            addressSent(bus);
+            break;
+        case SIM_WIRE_WRITE:
+            byteWritten(bus);
+            break;
+        case SIM_WIRE_READ:
+            byteRead(bus);
+            break;
+        case SIM_WIRE_STOP:
+            registers.CR1 &= ~I2C_CR1_STOP;
+            registers.SR2 &= ~(I2C_SR2_MSL | I2C_SR2_BUSY | I2C_SR2_TRA);
+            if(peripheral.device)
+                peripheral.device->stop();
+            peripheral.device = nullptr;
+            peripheral.read = false;
+            if(!peripheral.failed)
+                bus->stats.transactions++;
+            bus->transferred = true;
+            bus->lastEnd = now;
+            // A START set during the STOP goes out once the bus is free.
+            if(peripheral.startPending)
+            {
+                peripheral.startPending = false;
+                requestStart(bus);
+            }
+            break;
+        case SIM_WIRE_NONE:
+            break;
+    }
+}
+
+/*
+ *  The hardware runs alongside the core: the wire actions ended by now take effect before the
+ *  access.
+ */
+static void settleRegisters(I2cSimBus *bus)
+{
+    while(bus->peripheral.action != SIM_WIRE_NONE && bus->transfer.end <= now)
+        finishWireAction(bus);
+}
+
+static I2cSimBus* getRegisterBus(volatile uint32_t &reg, uintptr_t &offset)
+{
+    uintptr_t address = reinterpret_cast<uintptr_t>(&reg);
+
+    for(size_t i = 0; i < I2C_SIM_BUS_MAX; i++)
+    {
+        uintptr_t base = i2cBusConfigs[i].instance;
+        if(address >= base && address < base + sizeof(I2C_TypeDef))
+        {
+            offset = address - base;
+            return buses[i].handle ? &buses[i] : nullptr;
+        }
+    }
+
+    return nullptr;
+}
+
+static uint32_t readStatus2(I2cSimBus *bus)
+{
+    I2cSimPeripheral &peripheral = bus->peripheral;
+    I2cSimRegisters &registers = peripheral.registers;
+
+    // The peripheral sees the bus busy while a slave holds SDA.
+    uint32_t value = registers.SR2 | (bus->sdaHeld ? I2C_SR2_BUSY : 0);
+
+    // SR1 then SR2 clears ADDR and releases SCL.
+    if(peripheral.statusRead && (registers.SR1 & I2C_SR1_ADDR))
+    {
+        registers.SR1 &= ~I2C_SR1_ADDR;
+
+        if(peripheral.read)
+        {
+            peripheral.posAck = true;
+            peripheral.lastAck = true;
+            beginWireAction(bus, SIM_WIRE_READ);
+        }
+        else
+        {
+            registers.SR1 |= I2C_SR1_TXE;
+        }
+    }
+
+    peripheral.statusRead = false;
+
+    return value;
+}
+
+static uint32_t readData(I2cSimBus *bus)
+{
+    I2cSimPeripheral &peripheral = bus->peripheral;
+    I2cSimRegisters &registers = peripheral.registers;
+    uint32_t value = registers.DR;
+
+    if(peripheral.read && (registers.SR1 & I2C_SR1_RXNE))
+    {
+        // SR1 then DR clears BTF: the held byte moves to DR and the next one can come.
+        if(peripheral.statusRead && peripheral.shiftFull)
+        {
+            registers.DR = peripheral.shift;
+            registers.SR1 &= ~I2C_SR1_BTF;
+            peripheral.shiftFull = false;
+
+            if(peripheral.action == SIM_WIRE_NONE)
+                continueWire(bus);
+        }
+        else
+        {
+            registers.SR1 &= ~I2C_SR1_RXNE;
+        }
+    }
+
+    peripheral.statusRead = false;
+
+    return value;
+}
+
+static void writeData(I2cSimBus *bus, uint32_t value)
+{
+    I2cSimPeripheral &peripheral = bus->peripheral;
+    I2cSimRegisters &registers = peripheral.registers;
+
+    // SR1 then DR clears SB: the address byte goes out.
+    if(peripheral.statusRead && (registers.SR1 & I2C_SR1_SB))
+    {
+        registers.SR1 &= ~I2C_SR1_SB;
+        peripheral.shift = value;
+        beginWireAction(bus, SIM_WIRE_ADDRESS);
+    }
+    else if((registers.SR2 & I2C_SR2_TRA) && (registers.SR1 & I2C_SR1_TXE))
+    {
+        registers.SR1 &= ~I2C_SR1_BTF;
+
+        // Straight to the shift register if it's free, DR is empty again.
+        if(peripheral.action == SIM_WIRE_NONE)
+        {
+            peripheral.shift = value;
+            beginWireAction(bus, SIM_WIRE_WRITE);
+        }
+        else
+        {
+            registers.DR = value;
+            registers.SR1 &= ~I2C_SR1_TXE;
+            peripheral.dataPending = true;
+        }
+    }
+    else
+    {
+        registers.DR = value;
+    }
+
+    peripheral.statusRead = false;
+}
+
+static void writeControl1(I2cSimBus *bus, uint32_t value)
+{
+    I2cSimPeripheral &peripheral = bus->peripheral;
+    I2cSimRegisters &registers = peripheral.registers;
+
+    bool startRequested = (registers.CR1 & I2C_CR1_START) || peripheral.startPending;
+    bool stopRequested = (registers.CR1 & I2C_CR1_STOP) || peripheral.stopPending;
+    registers.CR1 = value;
+
+    if((value & I2C_CR1_START) && !startRequested)
+    {
+        if(peripheral.action == SIM_WIRE_NONE)
+            requestStart(bus);
+        else
+            peripheral.startPending = true;
+    }
+
+    if((value & I2C_CR1_STOP) && !stopRequested)
+    {
+        if(!(registers.SR2 & I2C_SR2_MSL))
+            registers.CR1 &= ~I2C_CR1_STOP;
+        else if(peripheral.action == SIM_WIRE_NONE)
+            requestStop(bus);
+        else
+            peripheral.stopPending = true;
+    }
+}
+
+/*
+ *  Calls the interrupt handlers of the bus for as long as they leave an enabled flag set.
+ */
+static void serviceRegisters(I2cSimBus *bus, const I2cSimInterruptHandlers &handlers)
+{
+    settleRegisters(bus);
+
+    for(uint32_t repeat = 0; repeat < I2C_SIM_INTERRUPT_REPEATS; repeat++)
+    {
+        const I2cSimRegisters &registers = bus->peripheral.registers;
+        bool error = isErrorRaised(registers);
+        if(!error && !isEventRaised(registers))
+            break;
+
+        bus->stats.interrupts++;
+        (error ? handlers.error : handlers.event)();
+    }
+
+    scheduleRegisters(bus);
+
+    // An interrupt nobody clears would fire forever on target, the transfer is stalled instead.
+    if(bus->transfer.active && bus->transfer.end <= now && bus->peripheral.action == SIM_WIRE_NONE)
+        bus->transfer.end = UINT64_MAX;
+}
+
+/*
+ *  Books the START and address byte of a transfer that runs into the injected fault. Nothing
+ *  reaches the devices.
+ */
+static HAL_StatusTypeDef beginFaultyTransfer(I2C_HandleTypeDef *handle, I2cSimBus *bus, I2cSimTransferType type, bool dma, I2cSimFault fault)
+{
+    bool read = (type == SIM_MASTER_RX || type == SIM_MEM_RX);
+    bool memory = (type == SIM_MEM_TX || type == SIM_MEM_RX);
+
+    uint32_t error = HAL_I2C_ERROR_NONE;
+    switch(fault)
+    {
+        case I2C_SIM_FAULT_BUS_ERROR:
+            error = HAL_I2C_ERROR_BERR;
+            break;
+        case I2C_SIM_FAULT_ARBITRATION_LOST:
+            error = HAL_I2C_ERROR_ARLO;
+            break;
+        case I2C_SIM_FAULT_OVERRUN:
+            error = HAL_I2C_ERROR_OVR;
+            break;
+        default:
+            break;
+    }
+
+    handle->State = read ? HAL_I2C_STATE_BUSY_RX : HAL_I2C_STATE_BUSY_TX;
+    handle->Mode = memory ? HAL_I2C_MODE_MEM : HAL_I2C_MODE_MASTER;
+    handle->ErrorCode = HAL_I2C_ERROR_NONE;
+
+    uint64_t duration = (1 + I2C_SIM_BITS_PER_BYTE) * getBitTime(handle);
+
+    bus->sequenceDevice = nullptr;
+    bus->transfer = {
+        .active = true,
+        .type = type,
+        .dma = dma,
+        .acknowledged = true,
+        .error = error,
+        .bytes = 0,
+        .end = now + duration
+    };
+
+    if(fault == I2C_SIM_FAULT_STUCK_SDA)
+    {
+        // The peripheral waits for the slave forever: the transfer never ends.
+        bus->sdaHeld = true;
+        bus->transfer.end = UINT64_MAX;
+    }
+    else
+    {
+        bus->stats.busyTime += duration;
+        bus->stats.interrupts++;
+    }
+
+    return HAL_OK;
+}
+
+/*
+ *  Exchanges the data with the device model right away and books the bus for the time the transfer
+ *  takes on the wire. The completion interrupt is raised when the virtual clock reaches the end.
+ *
+ *  Sequential frames (options other than I2C_NO_OPTION_FRAME) only generate START on the first
+ *  frame or on a direction change, and STOP on the last frame.
+ */
+static HAL_StatusTypeDef beginTransfer(
+    I2C_HandleTypeDef *handle,
+    I2cSimTransferType type,
+    bool dma,
+    uint16_t devAddress,
+    uint16_t memAddress,
+    uint16_t memAddSize,
+    uint8_t *data,
+    uint16_t size,
+    uint32_t options = I2C_NO_OPTION_FRAME
+)
+{
+    I2cSimBus *bus = getBus(handle->Instance);
+    if(!bus)
+        return HAL_ERROR;
+
+    // The HAL waits for the BUSY flag: a STOP of the direct engine still on the wire is waited out.
+    if(bus->transfer.active && bus->transfer.type == SIM_REGISTER && bus->peripheral.action == SIM_WIRE_STOP)
+    {
+        now = std::max(now, bus->transfer.end);
+        settleRegisters(bus);
+        scheduleRegisters(bus);
+    }
+
+    // The peripheral sees the bus busy while SDA is held, the HAL gives up waiting for it.
+    if(handle->State != HAL_I2C_STATE_READY || bus->transfer.active || bus->sdaHeld)
+        return HAL_BUSY;
+
+    if(bus->fault != I2C_SIM_FAULT_NONE)
+    {
+        I2cSimFault fault = bus->fault;
+        bus->fault = I2C_SIM_FAULT_NONE;
+
+        return beginFaultyTransfer(handle, bus, type, dma, fault);
+    }
+
+    bool read = (type == SIM_MASTER_RX || type == SIM_MEM_RX);
+    bool memory = (type == SIM_MEM_TX || type == SIM_MEM_RX);
+    uint16_t registerBytes = memory ? (memAddSize == I2C_MEMADD_SIZE_16BIT ? 2 : 1) : 0;
+
+    I2cSimDevice *device = findDevice(bus, devAddress >> 1);
+
+    bool sequential = (options != I2C_NO_OPTION_FRAME);
+    bool continued = sequential && bus->sequenceDevice == device && device && options != I2C_FIRST_FRAME && options != I2C_FIRST_AND_LAST_FRAME;
+    bool generateStart = !continued || bus->sequenceRead != read;
+    bool generateStop = !sequential || options == I2C_LAST_FRAME || options == I2C_FIRST_AND_LAST_FRAME;
+
+    uint64_t bits = 0;
+    uint64_t interrupts = 0;
+    uint16_t transferred = 0;
+    bool acknowledged = true;
+
+    if(generateStart)
+    {
+        // (Repeated) START + address
+        bits += 1 + I2C_SIM_BITS_PER_BYTE;
+        interrupts += 2;
+        acknowledged = device && device->start(read && !memory);
+    }
+
+    if(acknowledged && memory)
+    {
+        uint8_t registerAddress[2] = {static_cast<uint8_t>(memAddress >> 8), static_cast<uint8_t>(memAddress)};
+        for(uint16_t i = 2 - registerBytes; i < 2 && acknowledged; i++)
+        {
+            acknowledged = device->writeByte(registerAddress[i]);
+            bits += I2C_SIM_BITS_PER_BYTE;
+            interrupts++;
+        }
+
+        if(acknowledged && read)
+        {
+            // Repeated START + address
+            acknowledged = device->start(true);
+            bits += 1 + I2C_SIM_BITS_PER_BYTE;
+            interrupts += 2;
+        }
+    }
+
+    for(uint16_t i = 0; i < size && acknowledged; i++)
+    {
+        if(read)
+            data[i] = device->readByte();
+        else
+            acknowledged = device->writeByte(data[i]);
+
+        bits += I2C_SIM_BITS_PER_BYTE;
+        transferred++;
+    }
+
+    if(generateStop || !acknowledged)
+    {
+        // STOP
+        bits += 1;
+        if(device)
+            device->stop();
+        bus->sequenceDevice = nullptr;
+    }
+    else
+    {
+        bus->sequenceDevice = device;
+        bus->sequenceRead = read;
+    }
+
+    if(dma)
+        interrupts = 1 + (read ? 0 : 1);
+    else
+        interrupts += transferred + 1;
+
+    handle->State = read ? HAL_I2C_STATE_BUSY_RX : HAL_I2C_STATE_BUSY_TX;
+    handle->Mode = memory ? HAL_I2C_MODE_MEM : HAL_I2C_MODE_MASTER;
+    handle->ErrorCode = HAL_I2C_ERROR_NONE;
+    handle->XferSize = size;
+    handle->XferCount = size - transferred;
+
+    uint64_t duration = bits * getBitTime(handle);
+
+    bus->transfer = {
+        .active = true,
+        .type = type,
+        .dma = dma,
+        .acknowledged = acknowledged,
+        .error = acknowledged ? HAL_I2C_ERROR_NONE : HAL_I2C_ERROR_AF,
+        .bytes = transferred,
+        .end = now + duration
+    };
+
+    bus->stats.busyTime += duration;
+    bus->stats.interrupts += interrupts;
+
+    if(bus->transferred)
+    {
+        bus->stats.gaps++;
+        bus->stats.gapTime += now - bus->lastEnd;
+    }
+
+    return HAL_OK;
+}
+
+/*
+ *  Error handling of the HAL in listen mode (I2C_ITError): the handle keeps listening for the error
+ *  callback, a NACK then completes the listen.
+ */
+static void slaveError(I2C_HandleTypeDef *handle, uint32_t error)
+{
+    handle->ErrorCode = handle->ErrorCode | error;
+    handle->State = HAL_I2C_STATE_LISTEN;
+
+    if(handle->ErrorCallback)
+        handle->ErrorCallback(handle);
+
+    if((handle->ErrorCode & HAL_I2C_ERROR_AF) && handle->State == HAL_I2C_STATE_LISTEN)
+    {
+        handle->State = HAL_I2C_STATE_READY;
+        handle->Mode = HAL_I2C_MODE_NONE;
+
+        if(handle->ListenCpltCallback)
+            handle->ListenCpltCallback(handle);
+    }
+}
+
+static bool isListening(I2C_HandleTypeDef *handle)
+{
+    return (handle->State & HAL_I2C_STATE_LISTEN) == HAL_I2C_STATE_LISTEN;
+}
+
+/*
+ *  Plays the transfer of the external master against the handle in listen mode, with the callbacks
+ *  the HAL raises byte by byte. The peripheral would stretch SCL while no buffer is given to it,
+ *  the host gives up instead (a NACK) so the simulation goes on.
+ */
+static bool serveHost(I2C_HandleTypeDef *handle, I2cSimBus *bus)
+{
+    uint16_t ownAddress1 = handle->Init.OwnAddress1 >> 1;
+    uint16_t ownAddress2 = handle->Init.OwnAddress2 >> 1;
+    bool dual = handle->Init.DualAddressMode == I2C_DUALADDRESS_ENABLE;
+    bool matched = bus->hostAddress == ownAddress1 || (dual && bus->hostAddress == ownAddress2);
+    uint16_t addressCode = bus->hostAddress == ownAddress1 ? handle->Init.OwnAddress1 : handle->Init.OwnAddress2;
+
+    if(!matched || !isListening(handle) || !handle->AddrCallback)
+        return false;
+
+    handle->Mode = HAL_I2C_MODE_SLAVE;
+
+    if(bus->hostWriteBytes)
+    {
+        handle->AddrCallback(handle, I2C_DIRECTION_TRANSMIT, addressCode);
+
+        for(uint16_t i = 0; i < bus->hostWriteBytes; i++)
+        {
+            if(handle->State != HAL_I2C_STATE_BUSY_RX_LISTEN || handle->XferCount == 0)
+                return false;
+
+            *handle->pBuffPtr++ = bus->hostWrite[i];
+            handle->XferCount = handle->XferCount - 1;
+            bus->stats.bytes++;
+
+            if(handle->XferCount == 0)
+            {
+                handle->State = HAL_I2C_STATE_LISTEN;
+                if(handle->SlaveRxCpltCallback)
+                    handle->SlaveRxCpltCallback(handle);
+            }
+        }
+    }
+
+    if(bus->hostReadBytes)
+    {
+        handle->AddrCallback(handle, I2C_DIRECTION_RECEIVE, addressCode);
+
+        for(uint16_t i = 0; i < bus->hostReadBytes; i++)
+        {
+            if(handle->State != HAL_I2C_STATE_BUSY_TX_LISTEN || handle->XferCount == 0)
+                return false;
+
+            bus->hostRead[i] = *handle->pBuffPtr++;
+            handle->XferCount = handle->XferCount - 1;
+            bus->stats.bytes++;
+
+            if(handle->XferCount == 0)
+            {
+                handle->State = HAL_I2C_STATE_LISTEN;
+                if(handle->SlaveTxCpltCallback)
+                    handle->SlaveTxCpltCallback(handle);
+            }
+        }
+
+        // The host NACKs its last byte, the next one was already loaded into DR.
+        if(handle->State == HAL_I2C_STATE_BUSY_TX_LISTEN && handle->XferCount != 0)
+        {
+            handle->pBuffPtr++;
+            handle->XferCount = handle->XferCount - 1;
+            slaveError(handle, HAL_I2C_ERROR_AF);
+        }
+        else if(handle->State == HAL_I2C_STATE_LISTEN)
+        {
+            handle->State = HAL_I2C_STATE_READY;
+            handle->Mode = HAL_I2C_MODE_NONE;
+            if(handle->ListenCpltCallback)
+                handle->ListenCpltCallback(handle);
+        }
+
+        return true;
+    }
+
+    // STOP after a write, with or without all the bytes the slave expected.
+    if(handle->State == HAL_I2C_STATE_BUSY_RX_LISTEN && handle->XferCount != 0)
+    {
+        slaveError(handle, HAL_I2C_ERROR_AF);
+    }
+    else if(isListening(handle))
+    {
+        handle->State = HAL_I2C_STATE_READY;
+        handle->Mode = HAL_I2C_MODE_NONE;
+        if(handle->ListenCpltCallback)
+            handle->ListenCpltCallback(handle);
+    }
+
+    return true;
+}
+
+static void completeTransfer(I2C_HandleTypeDef *handle)
+{
+    I2cSimBus *bus = getBus(handle->Instance);
+    if(!bus || !bus->transfer.active || bus->transfer.end > now || bus->transfer.type == SIM_REGISTER)
+        return;
+
+    I2cSimTransfer transfer = bus->transfer;
+    bus->transfer.active = false;
+    bus->transferred = true;
+    bus->lastEnd = transfer.end;
+
+    if(transfer.type == SIM_HOST)
+    {
+        if(serveHost(handle, bus))
+            bus->stats.transactions++;
+        else
+            bus->stats.nacks++;
+        return;
+    }
+
+    handle->State = HAL_I2C_STATE_READY;
+    handle->Mode = HAL_I2C_MODE_NONE;
+
+    if(transfer.error != HAL_I2C_ERROR_NONE)
+    {
+        if(transfer.acknowledged)
+            bus->stats.faults++;
+        else
+            bus->stats.nacks++;
+
+        handle->ErrorCode = handle->ErrorCode | transfer.error;
+        if(handle->ErrorCallback)
+            handle->ErrorCallback(handle);
+        return;
+    }
+
+    bus->stats.transactions++;
+    bus->stats.bytes += transfer.bytes;
+
+    pI2C_CallbackTypeDef callback = nullptr;
+    switch(transfer.type)
+    {
+        case SIM_MASTER_TX:
+            callback = handle->MasterTxCpltCallback;
+            break;
+        case SIM_MASTER_RX:
+            callback = handle->MasterRxCpltCallback;
+            break;
+        case SIM_MEM_TX:
+            callback = handle->MemTxCpltCallback;
+            break;
+        case SIM_MEM_RX:
+            callback = handle->MemRxCpltCallback;
+            break;
+        case SIM_HOST:
+        case SIM_REGISTER:
+            break;
+    }
+
+    if(callback)
+        callback(handle);
+}
+
+void I2cSim::reset(void)
+{
+    buses = {};
+    timer = {};
+    now = 0;
+    interruptMask = 0;
+
+    i2cSetCycleClock(getCycles);
+}
+
+void I2cSim::attachDevice(I2C_TypeDef *instance, I2cSimDevice *device)
+{
+    I2cSimBus *bus = getBus(instance);
+    if(!bus)
+        return;
+
+    for(I2cSimDevice *&slot : bus->devices)
+    {
+        if(!slot)
+        {
+            slot = device;
+            return;
+        }
+    }
+}
+
+void I2cSim::injectFault(I2C_TypeDef *instance, I2cSimFault fault, uint8_t heldPulses)
+{
+    I2cSimBus *bus = getBus(instance);
+    if(!bus)
+        return;
+
+    bus->fault = fault;
+    bus->heldPulses = heldPulses;
+}
+
+bool I2cSim::isSdaHeld(I2C_TypeDef *instance)
+{
+    I2cSimBus *bus = getBus(instance);
+    return bus && bus->sdaHeld;
+}
+
+void I2cSim::detachDevice(I2C_TypeDef *instance, I2cSimDevice *device)
+{
+    I2cSimBus *bus = getBus(instance);
+    if(!bus)
+        return;
+
+    for(I2cSimDevice *&slot : bus->devices)
+    {
+        if(slot == device)
+            slot = nullptr;
+    }
+}
+
+bool I2cSim::hostTransfer(I2C_TypeDef *instance, uint16_t address, const uint8_t *writeData, uint16_t writeBytes, uint8_t *readData, uint16_t readBytes)
+{
+    I2cSimBus *bus = getBus(instance);
+    if(!bus || !bus->handle || bus->transfer.active || bus->sdaHeld || writeBytes > bus->hostWrite.size())
+        return false;
+
+    if(writeBytes + readBytes == 0 || (readBytes && !readData))
+        return false;
+
+    bus->hostAddress = address;
+    std::copy_n(writeData, writeBytes, bus->hostWrite.data());
+    bus->hostWriteBytes = writeBytes;
+    bus->hostRead = readData;
+    bus->hostReadBytes = readBytes;
+
+    // START, address and data of each direction, STOP.
+    uint64_t bits = (writeBytes ? 1 + I2C_SIM_BITS_PER_BYTE * (1 + writeBytes) : 0) +
+                    (readBytes ? 1 + I2C_SIM_BITS_PER_BYTE * (1 + readBytes) : 0) + 1;
+    uint64_t duration = bits * getBitTime(bus->handle);
+
+    bus->transfer = {
+        .active = true,
+        .type = SIM_HOST,
+        .dma = false,
+        .acknowledged = true,
+        .error = HAL_I2C_ERROR_NONE,
+        .bytes = 0,
+        .end = now + duration
+    };
+
+    bus->stats.busyTime += duration;
+    bus->stats.interrupts += 2 * ((writeBytes ? 1 : 0) + (readBytes ? 1 : 0)) + writeBytes + readBytes + 1;
+
+    return true;
+}
+
+uint64_t I2cSim::getTime(void)
+{
+    return now;
+}
+
+uint32_t I2cSim::getCycles(void)
+{
+    // Cycles per microsecond first, so the product can not overflow.
+    return static_cast<uint32_t>(now * (I2C_SIM_CORE_CLOCK / 1000000) / 1000);
+}
+
+bool I2cSim::runNext(void)
+{
+    I2cSimBus *next = nullptr;
+    for(I2cSimBus &bus : buses)
+    {
+        if(bus.transfer.active && (!next || bus.transfer.end < next->transfer.end))
+            next = &bus;
+    }
+
+    // Stalled transfers never raise an interrupt.
+    if(next && next->transfer.end == UINT64_MAX)
+        next = nullptr;
+
+    if(timer.running && (!next || timer.next <= next->transfer.end))
+    {
+        if(timer.next > now)
+            now = timer.next;
+
+        timer.next += timer.period;
+        TIM2_IRQHandler();
+
+        return true;
+    }
+
+    if(!next)
+        return false;
+
+    if(next->transfer.end > now)
+        now = next->transfer.end;
+
+    uint64_t interruptStart = now;
+
+    const I2cSimInterruptHandlers &handlers = interruptHandlers[next - buses.data()];
+    if(next->transfer.type == SIM_REGISTER)
+    {
+        serviceRegisters(next, handlers);
+        next->stats.interruptTime += now - interruptStart;
+
+        return true;
+    }
+
+    if(next->transfer.error != HAL_I2C_ERROR_NONE)
+    {
+        handlers.error();
+    }
+    else if(next->transfer.dma)
+    {
+        bool read = (next->transfer.type == SIM_MASTER_RX || next->transfer.type == SIM_MEM_RX);
+        (read ? handlers.dmaRx : handlers.dmaTx)();
+    }
+    else
+    {
+        handlers.event();
+    }
+
+    // Nobody serviced the interrupt (no driver registered for the bus): finish it here.
+    if(next->transfer.active && next->transfer.end <= interruptStart)
+        completeTransfer(next->handle);
+
+    next->stats.interruptTime += now - interruptStart;
+
+    return true;
+}
+
+void I2cSim::advance(uint64_t nanoseconds)
+{
+    uint64_t target = now + nanoseconds;
+
+    while(true)
+    {
+        bool pending = false;
+        for(I2cSimBus &bus : buses)
+        {
+            pending |= bus.transfer.active && bus.transfer.end <= target;
+        }
+
+        pending |= timer.running && timer.next <= target;
+
+        if(!pending)
+            break;
+
+        runNext();
+    }
+
+    // Interrupt handlers may have consumed time past the target.
+    if(now < target)
+        now = target;
+}
+
+void I2cSim::consume(uint64_t nanoseconds)
+{
+    now += nanoseconds;
+}
+
+void I2cSim::runUntilIdle(void)
+{
+    while(isTransferPending())
+        runNext();
+}
+
+bool I2cSim::isBusy(I2C_TypeDef *instance)
+{
+    I2cSimBus *bus = getBus(instance);
+    return bus && bus->transfer.active;
+}
+
+bool I2cSim::areInterruptsMasked(void)
+{
+    return interruptMask != 0;
+}
+
+const I2cSimBusStats& I2cSim::getStats(I2C_TypeDef *instance)
+{
+    static const I2cSimBusStats empty = {};
+    I2cSimBus *bus = getBus(instance);
+
+    return bus ? bus->stats : empty;
+}
+
+double I2cSim::getUtilization(I2C_TypeDef *instance)
+{
+    if(now == 0)
+        return 0.0;
+
+    return static_cast<double>(getStats(instance).busyTime) / now;
+}
+
+double I2cSim::getTransactionsPerSecond(I2C_TypeDef *instance)
+{
+    if(now == 0)
+        return 0.0;
+
+    return static_cast<double>(getStats(instance).transactions) * I2C_SIM_NANOSECONDS_PER_SECOND / now;
+}
+
+uint64_t I2cSim::getTransferTime(uint32_t clockSpeed, uint16_t registerBytes, uint16_t dataBytes, bool registerRead)
+{
+    uint64_t bits = 1 + I2C_SIM_BITS_PER_BYTE * (1 + registerBytes + dataBytes) + 1;
+    if(registerBytes && registerRead)
+    {
+        bits += 1 + I2C_SIM_BITS_PER_BYTE;
+    }
+
+    return bits * I2C_SIM_NANOSECONDS_PER_SECOND / clockSpeed;
+}
+
+/*
+ *  HAL surface used by the driver
+ */
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c)
+{
+    I2cSimBus *bus = hi2c ? getBus(hi2c->Instance) : nullptr;
+    if(!bus || hi2c->Init.ClockSpeed == 0 || hi2c->Init.ClockSpeed > 400000)
+        return HAL_ERROR;
+
+    if(hi2c->State == HAL_I2C_STATE_RESET)
+    {
+        hi2c->Lock = HAL_UNLOCKED;
+        hi2c->MasterTxCpltCallback = nullptr;
+        hi2c->MasterRxCpltCallback = nullptr;
+        hi2c->SlaveTxCpltCallback = nullptr;
+        hi2c->SlaveRxCpltCallback = nullptr;
+        hi2c->ListenCpltCallback = nullptr;
+        hi2c->MemTxCpltCallback = nullptr;
+        hi2c->MemRxCpltCallback = nullptr;
+        hi2c->ErrorCallback = nullptr;
+        hi2c->AbortCpltCallback = nullptr;
+        hi2c->AddrCallback = nullptr;
+    }
+
+    bus->handle = hi2c;
+    bus->transfer.active = false;
+
+    // Software reset of the peripheral, then enabled.
+    bus->peripheral = {};
+    bus->peripheral.registers.CR1 = I2C_CR1_PE;
+
+    hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+    hi2c->State = HAL_I2C_STATE_READY;
+    hi2c->PreviousState = HAL_I2C_MODE_NONE;
+    hi2c->Mode = HAL_I2C_MODE_NONE;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c)
+{
+    I2cSimBus *bus = hi2c ? getBus(hi2c->Instance) : nullptr;
+    if(!bus)
+        return HAL_ERROR;
+
+    bus->transfer.active = false;
+    bus->peripheral = {};
+    hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+    hi2c->State = HAL_I2C_STATE_RESET;
+    hi2c->Mode = HAL_I2C_MODE_NONE;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_RegisterCallback(I2C_HandleTypeDef *hi2c, HAL_I2C_CallbackIDTypeDef CallbackID, pI2C_CallbackTypeDef pCallback)
+{
+    if(pCallback == nullptr || hi2c->State != HAL_I2C_STATE_READY)
+    {
+        hi2c->ErrorCode = hi2c->ErrorCode | HAL_I2C_ERROR_INVALID_CALLBACK;
+        return HAL_ERROR;
+    }
+
+    switch(CallbackID)
+    {
+        case HAL_I2C_MASTER_TX_COMPLETE_CB_ID:
+            hi2c->MasterTxCpltCallback = pCallback;
+            break;
+        case HAL_I2C_MASTER_RX_COMPLETE_CB_ID:
+            hi2c->MasterRxCpltCallback = pCallback;
+            break;
+        case HAL_I2C_SLAVE_TX_COMPLETE_CB_ID:
+            hi2c->SlaveTxCpltCallback = pCallback;
+            break;
+        case HAL_I2C_SLAVE_RX_COMPLETE_CB_ID:
+            hi2c->SlaveRxCpltCallback = pCallback;
+            break;
+        case HAL_I2C_LISTEN_COMPLETE_CB_ID:
+            hi2c->ListenCpltCallback = pCallback;
+            break;
+        case HAL_I2C_MEM_TX_COMPLETE_CB_ID:
+            hi2c->MemTxCpltCallback = pCallback;
+            break;
+        case HAL_I2C_MEM_RX_COMPLETE_CB_ID:
+            hi2c->MemRxCpltCallback = pCallback;
+            break;
+        case HAL_I2C_ERROR_CB_ID:
+            hi2c->ErrorCallback = pCallback;
+            break;
+        case HAL_I2C_ABORT_CB_ID:
+            hi2c->AbortCpltCallback = pCallback;
+            break;
+        case HAL_I2C_MSPINIT_CB_ID:
+            hi2c->MspInitCallback = pCallback;
+            break;
+        case HAL_I2C_MSPDEINIT_CB_ID:
+            hi2c->MspDeInitCallback = pCallback;
+            break;
+        default:
+            hi2c->ErrorCode = hi2c->ErrorCode | HAL_I2C_ERROR_INVALID_CALLBACK;
+            return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size)
+{
+    return beginTransfer(hi2c, SIM_MASTER_TX, false, DevAddress, 0, 0, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Receive_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size)
+{
+    return beginTransfer(hi2c, SIM_MASTER_RX, false, DevAddress, 0, 0, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    return beginTransfer(hi2c, SIM_MEM_TX, false, DevAddress, MemAddress, MemAddSize, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    return beginTransfer(hi2c, SIM_MEM_RX, false, DevAddress, MemAddress, MemAddSize, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size)
+{
+    return beginTransfer(hi2c, SIM_MASTER_TX, true, DevAddress, 0, 0, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Receive_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size)
+{
+    return beginTransfer(hi2c, SIM_MASTER_RX, true, DevAddress, 0, 0, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Transmit_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t XferOptions)
+{
+    return beginTransfer(hi2c, SIM_MASTER_TX, false, DevAddress, 0, 0, pData, Size, XferOptions);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Receive_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t XferOptions)
+{
+    return beginTransfer(hi2c, SIM_MASTER_RX, false, DevAddress, 0, 0, pData, Size, XferOptions);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Transmit_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t XferOptions)
+{
+    return beginTransfer(hi2c, SIM_MASTER_TX, true, DevAddress, 0, 0, pData, Size, XferOptions);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Receive_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t XferOptions)
+{
+    return beginTransfer(hi2c, SIM_MASTER_RX, true, DevAddress, 0, 0, pData, Size, XferOptions);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    return beginTransfer(hi2c, SIM_MEM_TX, true, DevAddress, MemAddress, MemAddSize, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    return beginTransfer(hi2c, SIM_MEM_RX, true, DevAddress, MemAddress, MemAddSize, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_RegisterAddrCallback(I2C_HandleTypeDef *hi2c, pI2C_AddrCallbackTypeDef pCallback)
+{
+    if(pCallback == nullptr || hi2c->State != HAL_I2C_STATE_READY)
+    {
+        hi2c->ErrorCode = hi2c->ErrorCode | HAL_I2C_ERROR_INVALID_CALLBACK;
+        return HAL_ERROR;
+    }
+
+    hi2c->AddrCallback = pCallback;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_EnableListen_IT(I2C_HandleTypeDef *hi2c)
+{
+    if(hi2c->State != HAL_I2C_STATE_READY)
+        return HAL_BUSY;
+
+    hi2c->State = HAL_I2C_STATE_LISTEN;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_DisableListen_IT(I2C_HandleTypeDef *hi2c)
+{
+    if(hi2c->State != HAL_I2C_STATE_LISTEN)
+        return HAL_BUSY;
+
+    hi2c->State = HAL_I2C_STATE_READY;
+    hi2c->Mode = HAL_I2C_MODE_NONE;
+
+    return HAL_OK;
+}
+
+/*
+ *  The slave transfers only arm the handle, the bytes move when the host transfer is played (see
+ *  serveHost).
+ */
+static HAL_StatusTypeDef armSlaveTransfer(I2C_HandleTypeDef *hi2c, HAL_I2C_StateTypeDef state, uint8_t *pData, uint16_t Size, uint32_t XferOptions)
+{
+    if(!isListening(hi2c))
+        return HAL_BUSY;
+
+    if(pData == nullptr || Size == 0)
+        return HAL_ERROR;
+
+    hi2c->State = state;
+    hi2c->Mode = HAL_I2C_MODE_SLAVE;
+    hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+    hi2c->pBuffPtr = pData;
+    hi2c->XferCount = Size;
+    hi2c->XferSize = Size;
+    hi2c->XferOptions = XferOptions;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Slave_Seq_Transmit_IT(I2C_HandleTypeDef *hi2c, uint8_t *pData, uint16_t Size, uint32_t XferOptions)
+{
+    return armSlaveTransfer(hi2c, HAL_I2C_STATE_BUSY_TX_LISTEN, pData, Size, XferOptions);
+}
+
+HAL_StatusTypeDef HAL_I2C_Slave_Seq_Receive_IT(I2C_HandleTypeDef *hi2c, uint8_t *pData, uint16_t Size, uint32_t XferOptions)
+{
+    return armSlaveTransfer(hi2c, HAL_I2C_STATE_BUSY_RX_LISTEN, pData, Size, XferOptions);
+}
+
+void HAL_I2C_EV_IRQHandler(I2C_HandleTypeDef *hi2c)
+{
+    completeTransfer(hi2c);
+}
+
+void HAL_I2C_ER_IRQHandler(I2C_HandleTypeDef *hi2c)
+{
+    completeTransfer(hi2c);
+}
+
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c)
+{
+    return hi2c->State;
+}
+
+HAL_I2C_ModeTypeDef HAL_I2C_GetMode(I2C_HandleTypeDef *hi2c)
+{
+    return hi2c->Mode;
+}
+
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef *hi2c)
+{
+    return hi2c->ErrorCode;
+}
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma)
+{
+    hdma->State = HAL_DMA_STATE_READY;
+    hdma->ErrorCode = HAL_DMA_ERROR_NONE;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma)
+{
+    hdma->State = HAL_DMA_STATE_READY;
+
+    return HAL_OK;
+}
+
+HAL_DMA_StateTypeDef HAL_DMA_GetState(DMA_HandleTypeDef *hdma)
+{
+    return hdma->State;
+}
+
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma)
+{
+    completeTransfer(reinterpret_cast<I2C_HandleTypeDef*>(hdma->Parent));
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+    (void)GPIOx;
+    (void)GPIO_Init;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim)
+{
+    if(!htim || htim->Instance != TIM2)
+        return HAL_ERROR;
+
+    if(htim->State == HAL_TIM_STATE_RESET)
+        htim->PeriodElapsedCallback = nullptr;
+
+    // Same timer clock as the driver computes from HAL_RCC_GetPCLK1Freq().
+    uint64_t counts = static_cast<uint64_t>(htim->Init.Prescaler + 1) * (htim->Init.Period + 1);
+
+    timer.handle = htim;
+    timer.running = false;
+    timer.period = counts * I2C_SIM_NANOSECONDS_PER_SECOND / I2C_SIM_CORE_CLOCK;
+
+    htim->State = HAL_TIM_STATE_READY;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_RegisterCallback(TIM_HandleTypeDef *htim, HAL_TIM_CallbackIDTypeDef CallbackID, pTIM_CallbackTypeDef pCallback)
+{
+    if(pCallback == nullptr || CallbackID != HAL_TIM_PERIOD_ELAPSED_CB_ID)
+        return HAL_ERROR;
+
+    htim->PeriodElapsedCallback = pCallback;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim)
+{
+    if(timer.handle != htim || timer.period == 0)
+        return HAL_ERROR;
+
+    timer.running = true;
+    timer.next = now + timer.period;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *htim)
+{
+    if(timer.handle == htim)
+        timer.running = false;
+
+    return HAL_OK;
+}
+
+void HAL_TIM_IRQHandler(TIM_HandleTypeDef *htim)
+{
+    if(htim->PeriodElapsedCallback)
+        htim->PeriodElapsedCallback(htim);
+}
+
+uint32_t HAL_RCC_GetHCLKFreq(void)
+{
+    return I2C_SIM_CORE_CLOCK;
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void)
+{
+    return I2C_SIM_CORE_CLOCK / 2;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+    bool scl;
+    I2cSimBus *bus = getPinBus(GPIOx, GPIO_Pin, scl);
+    if(!bus)
+        return;
+
+    bool low = (PinState == GPIO_PIN_RESET);
+    if(scl)
+    {
+        // Every rising edge clocks one bit out of the slave holding SDA.
+        if(bus->sclLow && !low)
+        {
+            bus->stats.sclPulses++;
+            if(bus->sdaHeld && bus->heldPulses != I2C_SIM_HELD_FOREVER)
+            {
+                if(bus->heldPulses > 1)
+                    bus->heldPulses--;
+                else
+                    bus->sdaHeld = false;
+            }
+        }
+
+        bus->sclLow = low;
+    }
+    else
+    {
+        bus->sdaLow = low;
+    }
+
+    if(bus->handle)
+        now += getBitTime(bus->handle) / 2;
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+    bool scl;
+    I2cSimBus *bus = getPinBus(GPIOx, GPIO_Pin, scl);
+    if(!bus)
+        return GPIO_PIN_SET;
+
+    bool low = scl ? bus->sclLow : (bus->sdaLow || bus->sdaHeld);
+
+    return low ? GPIO_PIN_RESET : GPIO_PIN_SET;
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority)
+{
+    (void)IRQn;
+    (void)PreemptPriority;
+    (void)SubPriority;
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+    (void)IRQn;
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+    (void)IRQn;
+}
+
+uint32_t i2cMaskInterrupts(void)
+{
+    uint32_t previous = interruptMask;
+    interruptMask = 1;
+
+    return previous;
+}
+
+void i2cRestoreInterrupts(uint32_t mask)
+{
+    interruptMask = mask;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    return static_cast<uint32_t>(now / 1000000ULL);
+}
+
+uint32_t i2cReadRegister(volatile uint32_t &reg)
+{
+    uintptr_t offset;
+    I2cSimBus *bus = getRegisterBus(reg, offset);
+    if(!bus)
+        return 0;
+
+    now += I2C_SIM_REGISTER_ACCESS_NS;
+    bus->stats.registerAccesses++;
+    settleRegisters(bus);
+
+    I2cSimPeripheral &peripheral = bus->peripheral;
+    uint32_t value;
+    switch(offset)
+    {
+        case offsetof(I2C_TypeDef, SR1):
+            peripheral.statusRead = true;
+            value = peripheral.registers.SR1;
+            break;
+        case offsetof(I2C_TypeDef, SR2):
+            value = readStatus2(bus);
+            break;
+        case offsetof(I2C_TypeDef, DR):
+            value = readData(bus);
+            break;
+        default:
+            value = reinterpret_cast<uint32_t*>(&peripheral.registers)[offset / sizeof(uint32_t)];
+            break;
+    }
+
+    scheduleRegisters(bus);
+
+    return value;
+}
+
+void i2cWriteRegister(volatile uint32_t &reg, uint32_t value)
+{
+    uintptr_t offset;
+    I2cSimBus *bus = getRegisterBus(reg, offset);
+    if(!bus)
+        return;
+
+    now += I2C_SIM_REGISTER_ACCESS_NS;
+    bus->stats.registerAccesses++;
+    settleRegisters(bus);
+
+    I2cSimPeripheral &peripheral = bus->peripheral;
+    switch(offset)
+    {
+        case offsetof(I2C_TypeDef, CR1):
+            writeControl1(bus, value);
+            break;
+        case offsetof(I2C_TypeDef, DR):
+            writeData(bus, value);
+            break;
+        case offsetof(I2C_TypeDef, SR1):
+            // The error flags are cleared by writing 0, the other bits are read only.
+            peripheral.registers.SR1 &= value | ~I2C_SIM_ERROR_FLAGS;
+            break;
+        case offsetof(I2C_TypeDef, SR2):
+            break;
+        default:
+            reinterpret_cast<uint32_t*>(&peripheral.registers)[offset / sizeof(uint32_t)] = value;
+            break;
+    }
+
+    scheduleRegisters(bus);
+}
\ No newline at end of file
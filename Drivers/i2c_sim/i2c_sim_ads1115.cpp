@@ -0,0 +1,142 @@
+#include "i2c_sim_ads1115.hpp"
+
+#include <cmath>
+
+#include "i2c_sim.hpp"
+
+#define ADS1115_REGISTER_CONVERSION 0x00
+#define ADS1115_REGISTER_CONFIG     0x01
+#define ADS1115_REGISTER_LO_THRESH  0x02
+#define ADS1115_REGISTER_HI_THRESH  0x03
+
+#define ADS1115_CONFIG_OS           0x8000
+#define ADS1115_CONFIG_MUX_SHIFT    12
+#define ADS1115_CONFIG_PGA_SHIFT    9
+#define ADS1115_CONFIG_MODE_SINGLE  0x0100
+#define ADS1115_CONFIG_DR_SHIFT     5
+
+#define ADS1115_CONFIG_DEFAULT      0x8583
+
+static const double fullScaleRanges[8] = {6.144, 4.096, 2.048, 1.024, 0.512, 0.256, 0.256, 0.256};
+
+static const uint32_t dataRates[8] = {8, 16, 32, 64, 128, 250, 475, 860};
+
+
+I2cSimAds1115::I2cSimAds1115(uint16_t address)
+    : I2cSimRegisterDevice(address, 4, 2, 1, false)
+{
+    setRegister(ADS1115_REGISTER_CONFIG, ADS1115_CONFIG_DEFAULT);
+    setRegister(ADS1115_REGISTER_LO_THRESH, 0x8000);
+    setRegister(ADS1115_REGISTER_HI_THRESH, 0x7FFF);
+}
+
+void I2cSimAds1115::setInputVoltage(uint8_t channel, double volts)
+{
+    if(channel < inputs.size())
+        inputs[channel] = volts;
+}
+
+uint32_t I2cSimAds1115::getConversions(void)
+{
+    return conversions;
+}
+
+bool I2cSimAds1115::isRegisterWritable(uint16_t deviceRegister)
+{
+    return deviceRegister != ADS1115_REGISTER_CONVERSION;
+}
+
+uint64_t I2cSimAds1115::getConversionTime(void)
+{
+    uint32_t config = getRegister(ADS1115_REGISTER_CONFIG);
+    return 1000000000ULL / dataRates[(config >> ADS1115_CONFIG_DR_SHIFT) & 0x7];
+}
+
+int16_t I2cSimAds1115::convert(void)
+{
+    uint32_t config = getRegister(ADS1115_REGISTER_CONFIG);
+    uint8_t mux = (config >> ADS1115_CONFIG_MUX_SHIFT) & 0x7;
+    double fullScale = fullScaleRanges[(config >> ADS1115_CONFIG_PGA_SHIFT) & 0x7];
+
+    double volts;
+    switch(mux)
+    {
+        case 0:
+            volts = inputs[0] - inputs[1];
+            break;
+        case 1:
+            volts = inputs[0] - inputs[3];
+            break;
+        case 2:
+            volts = inputs[1] - inputs[3];
+            break;
+        case 3:
+            volts = inputs[2] - inputs[3];
+            break;
+        default:
+            volts = inputs[mux - 4];
+            break;
+    }
+
+    double code = std::round(volts / fullScale * 32768.0);
+    code = std::fmax(-32768.0, std::fmin(32767.0, code));
+
+    return static_cast<int16_t>(code);
+}
+
+/*
+ *  Publishes the conversion result once the conversion time has elapsed.
+ */
+void I2cSimAds1115::update(void)
+{
+    if(!converting || I2cSim::getTime() < conversionEnd)
+        return;
+
+    setRegister(ADS1115_REGISTER_CONVERSION, static_cast<uint16_t>(convert()));
+    conversions++;
+
+    uint32_t config = getRegister(ADS1115_REGISTER_CONFIG);
+    if(config & ADS1115_CONFIG_MODE_SINGLE)
+    {
+        converting = false;
+        setRegister(ADS1115_REGISTER_CONFIG, config | ADS1115_CONFIG_OS);
+    }
+    else
+    {
+        // Continuous mode: skip the conversions nobody read.
+        uint64_t conversionTime = getConversionTime();
+        uint64_t elapsed = I2cSim::getTime() - conversionEnd;
+        conversionEnd += (elapsed / conversionTime + 1) * conversionTime;
+    }
+}
+
+void I2cSimAds1115::registerWritten(uint16_t deviceRegister)
+{
+    if(deviceRegister != ADS1115_REGISTER_CONFIG)
+        return;
+
+    uint32_t config = getRegister(ADS1115_REGISTER_CONFIG);
+    bool singleShot = config & ADS1115_CONFIG_MODE_SINGLE;
+
+    if(!singleShot || (config & ADS1115_CONFIG_OS))
+    {
+        converting = true;
+        conversionEnd = I2cSim::getTime() + getConversionTime();
+    }
+    else
+    {
+        converting = false;
+    }
+
+    // OS reads back as 0 while a single shot conversion is ongoing.
+    if(singleShot && converting)
+        setRegister(ADS1115_REGISTER_CONFIG, config & ~ADS1115_CONFIG_OS);
+    else
+        setRegister(ADS1115_REGISTER_CONFIG, config | ADS1115_CONFIG_OS);
+}
+
+void I2cSimAds1115::registerRead(uint16_t deviceRegister)
+{
+    (void)deviceRegister;
+    update();
+}
\ No newline at end of file
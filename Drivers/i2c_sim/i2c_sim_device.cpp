@@ -0,0 +1,136 @@
+#include "i2c_sim_device.hpp"
+
+
+I2cSimDevice::I2cSimDevice(uint16_t address) : address(address)
+{
+
+}
+
+uint16_t I2cSimDevice::getAddress(void)
+{
+    return address;
+}
+
+bool I2cSimDevice::start(bool read)
+{
+    (void)read;
+    return true;
+}
+
+void I2cSimDevice::stop(void)
+{
+
+}
+
+I2cSimRegisterDevice::I2cSimRegisterDevice(uint16_t address, uint16_t registerCount, uint8_t registerWidth, uint8_t pointerBytes, bool autoIncrement)
+    : I2cSimDevice(address),
+      registers(registerCount * registerWidth, 0),
+      registerCount(registerCount),
+      registerWidth(registerWidth),
+      pointerBytes(pointerBytes),
+      autoIncrement(autoIncrement)
+{
+
+}
+
+bool I2cSimRegisterDevice::start(bool read)
+{
+    reading = read;
+    byteOffset = 0;
+    pointerBytesReceived = 0;
+
+    return true;
+}
+
+void I2cSimRegisterDevice::advance(void)
+{
+    byteOffset++;
+    if(byteOffset < registerWidth)
+        return;
+
+    byteOffset = 0;
+    if(autoIncrement)
+        pointer = (pointer + 1) % registerCount;
+}
+
+bool I2cSimRegisterDevice::writeByte(uint8_t byte)
+{
+    if(pointerBytesReceived < pointerBytes)
+    {
+        pointer = static_cast<uint16_t>((pointer << 8) | byte);
+        pointerBytesReceived++;
+
+        if(pointerBytesReceived == pointerBytes)
+        {
+            // Only keep the bytes that were actually sent in this write.
+            pointer &= static_cast<uint16_t>((1U << (8 * pointerBytes)) - 1);
+            if(pointer >= registerCount)
+                return false;
+        }
+
+        return true;
+    }
+
+    uint16_t deviceRegister = pointer;
+    if(isRegisterWritable(deviceRegister))
+        registers[deviceRegister * registerWidth + byteOffset] = byte;
+
+    advance();
+
+    if(byteOffset == 0 && isRegisterWritable(deviceRegister))
+        registerWritten(deviceRegister);
+
+    return true;
+}
+
+uint8_t I2cSimRegisterDevice::readByte(void)
+{
+    if(byteOffset == 0)
+        registerRead(pointer);
+
+    uint8_t byte = registers[pointer * registerWidth + byteOffset];
+    advance();
+
+    return byte;
+}
+
+uint32_t I2cSimRegisterDevice::getRegister(uint16_t deviceRegister)
+{
+    uint32_t value = 0;
+    for(uint8_t i = 0; i < registerWidth; i++)
+    {
+        value = (value << 8) | registers[deviceRegister * registerWidth + i];
+    }
+
+    return value;
+}
+
+void I2cSimRegisterDevice::setRegister(uint16_t deviceRegister, uint32_t value)
+{
+    for(uint8_t i = registerWidth; i > 0; i--)
+    {
+        registers[deviceRegister * registerWidth + i - 1] = static_cast<uint8_t>(value);
+        value >>= 8;
+    }
+}
+
+uint16_t I2cSimRegisterDevice::getPointer(void)
+{
+    return pointer;
+}
+
+void I2cSimRegisterDevice::registerWritten(uint16_t deviceRegister)
+{
+    (void)deviceRegister;
+}
+
+void I2cSimRegisterDevice::registerRead(uint16_t deviceRegister)
+{
+    (void)deviceRegister;
+}
+
+bool I2cSimRegisterDevice::isRegisterWritable(uint16_t deviceRegister)
+{
+    (void)deviceRegister;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "i2c_sim_hal.hpp"
+#include "i2c_sim_device.hpp"
+
+#define I2C_SIM_BUS_MAX 3
+
+#define I2C_SIM_MAX_DEVICES 8
+
+// Core clock the simulated time is expressed in by getCycles().
+#define I2C_SIM_CORE_CLOCK 84000000ULL
+
+// Longest write of the external master (see I2cSim::hostTransfer).
+#define I2C_SIM_HOST_MAX_BYTES 64
+
+// Register access of the core to the peripheral, a few APB1 cycles.
+#define I2C_SIM_REGISTER_ACCESS_NS 50
+
+// SDA held low for good: no number of SCL pulses releases it.
+#define I2C_SIM_HELD_FOREVER 0xFF
+
+/*
+ *  Fault the next transfer started on a bus runs into (see I2cSim::injectFault).
+ */
+typedef enum
+{
+    I2C_SIM_FAULT_NONE,
+    // Misplaced START or STOP: BERR after the address byte.
+    I2C_SIM_FAULT_BUS_ERROR,
+    // Another master wins the address byte: ARLO.
+    I2C_SIM_FAULT_ARBITRATION_LOST,
+    // A byte is lost with clock stretching disabled: OVR after the address byte.
+    I2C_SIM_FAULT_OVERRUN,
+    // A slave holds SDA low: the transfer never completes and no interrupt is raised.
+    I2C_SIM_FAULT_STUCK_SDA
+}
+I2cSimFault;
+
+typedef struct
+{
+    uint64_t transactions;
+    uint64_t bytes;
+    uint64_t nacks;
+    // Transfers ended by an injected fault.
+    uint64_t faults;
+    // SCL pulses clocked through GPIO, e.g. by a bus recovery.
+    uint64_t sclPulses;
+    // Interrupts the real peripheral would raise for the completed transfers.
+    uint64_t interrupts;
+    // Simulated time (ns) the bus spent transferring.
+    uint64_t busyTime;
+    // Transfers started after a previous one ended, and the idle time (ns) before them.
+    uint64_t gaps;
+    uint64_t gapTime;
+    // Simulated time (ns) spent in the interrupt handlers of the bus (see consume()).
+    uint64_t interruptTime;
+    // Accesses to the peripheral registers (see I2cDirectTransfer).
+    uint64_t registerAccesses;
+}
+I2cSimBusStats;
+
+/*
+ *  @brief Host side replacement of the HAL I2C peripheral.
+ *
+ *  The HAL_I2C_* functions used by the driver are implemented by the simulator: a transfer started
+ *  through them occupies the bus for the real bit time at the configured ClockSpeed, and when the
+ *  virtual clock reaches its end the data is exchanged with the device models and the event (or DMA)
+ *  interrupt handler of the bus is called, exactly as the NVIC would.
+ *
+ *  Bit time accounting: 1 bit per START, repeated START and STOP, 9 bits per byte (data + ACK).
+ *  The SCL and SDA pins of the buses can be driven as GPIO: every write takes half a bit time, the
+ *  wait the driver does between edges.
+ *
+ *  TIM2 (see I2cPeriodicTable) counts in simulated time as well and calls TIM2_IRQHandler on every
+ *  update, in order with the transfer completions.
+ *
+ *  The direct engine (I2C_TRANSFER_DIRECT) runs against a register level model of the peripheral
+ *  in master mode instead: START, address, data bytes and STOP take their bit time on the wire and
+ *  raise the SR1 flags the reference manual describes, with the flag clearing sequences, POS and
+ *  clock stretching (BTF). The event and error interrupts are called for as long as an enabled flag
+ *  is set, like the level triggered NVIC lines. Every register access takes
+ *  I2C_SIM_REGISTER_ACCESS_NS.
+ */
+class I2cSim
+{
+    public:
+        /*
+         *  @brief Clears the virtual clock, statistics, pending transfers and attached devices.
+         */
+        static void reset(void);
+
+        static void attachDevice(I2C_TypeDef *instance, I2cSimDevice *device);
+
+        static void detachDevice(I2C_TypeDef *instance, I2cSimDevice *device);
+
+        /*
+         *  @brief Makes the next transfer started on the bus fail with the fault. Errors are
+         *  reported through the error interrupt of the bus, as the peripheral would.
+         *
+         *  @param heldPulses I2C_SIM_FAULT_STUCK_SDA only: SCL pulses it takes the slave to release
+         *  SDA, I2C_SIM_HELD_FOREVER if it never does. While SDA is held, transfers can't start.
+         */
+        static void injectFault(I2C_TypeDef *instance, I2cSimFault fault, uint8_t heldPulses = 0);
+
+        /*
+         *  @brief Whether a slave is holding SDA low on the bus.
+         */
+        static bool isSdaHeld(I2C_TypeDef *instance);
+
+        /*
+         *  @brief Has an external master address the bus in slave mode: it writes writeBytes, then
+         *  reads readBytes into readData after a repeated START, and ends with a STOP. Either part
+         *  can be empty. The slave side is played through the HAL callbacks when the transfer ends,
+         *  a host the bus doesn't answer counts as a NACK in the statistics.
+         *
+         *  @return False if the bus is busy or not initialized, or the transfer is invalid.
+         */
+        static bool hostTransfer(I2C_TypeDef *instance, uint16_t address, const uint8_t *writeData, uint16_t writeBytes, uint8_t *readData = nullptr, uint16_t readBytes = 0);
+
+        /*
+         *  @brief Current simulated time in nanoseconds.
+         */
+        static uint64_t getTime(void);
+
+        /*
+         *  @brief Current simulated time in cycles of a I2C_SIM_CORE_CLOCK core, wrapping like
+         *  DWT->CYCCNT. reset() installs it as the driver cycle clock (see i2cSetCycleClock).
+         */
+        static uint32_t getCycles(void);
+
+        /*
+         *  @brief Runs every transfer completion due within the next nanoseconds and moves the
+         *  virtual clock forward.
+         */
+        static void advance(uint64_t nanoseconds);
+
+        /*
+         *  @brief Models CPU time spent by the caller, e.g. inside a callback: moves the virtual
+         *  clock without servicing any interrupt. Transfers ending meanwhile are completed by the
+         *  next runNext() or advance(), as a pending interrupt would be.
+         */
+        static void consume(uint64_t nanoseconds);
+
+        /*
+         *  @brief Moves the virtual clock to the earliest pending transfer end or timer update and
+         *  runs its interrupt.
+         *
+         *  @return False if nothing was pending.
+         */
+        static bool runNext(void);
+
+        /*
+         *  @brief Completes transfers until every bus is idle. A running timer keeps interrupting
+         *  meanwhile, but is not waited for.
+         */
+        static void runUntilIdle(void);
+
+        static bool isBusy(I2C_TypeDef *instance);
+
+        /*
+         *  @brief True while the driver holds its interrupts masked (see i2cMaskInterrupts).
+         */
+        static bool areInterruptsMasked(void);
+
+        static const I2cSimBusStats& getStats(I2C_TypeDef *instance);
+
+        /*
+         *  @brief Fraction of the simulated time the bus was transferring.
+         */
+        static double getUtilization(I2C_TypeDef *instance);
+
+        static double getTransactionsPerSecond(I2C_TypeDef *instance);
+
+        /*
+         *  @brief Duration in nanoseconds of a transfer with the given shape at the clock speed.
+         */
+        static uint64_t getTransferTime(uint32_t clockSpeed, uint16_t registerBytes, uint16_t dataBytes, bool registerRead);
+};
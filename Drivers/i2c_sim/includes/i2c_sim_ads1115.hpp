@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+
+#include "i2c_sim_device.hpp"
+
+#define ADS1115_SIM_DEFAULT_ADDRESS 0x48
+
+/*
+ *  @brief Model of the ADS1115 16 bit ADC.
+ *
+ *  Conversion (0x00), config (0x01), low threshold (0x02) and high threshold (0x03) registers.
+ *  Conversions take 1/DR of simulated time. The comparator and ALERT pin are not modelled.
+ */
+class I2cSimAds1115 : public I2cSimRegisterDevice
+{
+    protected:
+        std::array<double, 4> inputs = {};
+
+        // Simulated time (ns) at which the ongoing conversion finishes.
+        uint64_t conversionEnd = 0;
+        bool converting = false;
+
+        uint32_t conversions = 0;
+
+        void registerWritten(uint16_t deviceRegister) override;
+
+        void registerRead(uint16_t deviceRegister) override;
+
+        bool isRegisterWritable(uint16_t deviceRegister) override;
+
+        uint64_t getConversionTime(void);
+
+        int16_t convert(void);
+
+        void update(void);
+
+    public:
+        explicit I2cSimAds1115(uint16_t address = ADS1115_SIM_DEFAULT_ADDRESS);
+
+        /*
+         *  @brief Sets the voltage applied to an analog input, referred to GND.
+         */
+        void setInputVoltage(uint8_t channel, double volts);
+
+        /*
+         *  @brief Number of conversion results made available to the master.
+         */
+        uint32_t getConversions(void);
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+/*
+ *  @brief Byte level model of a device attached to the simulated bus.
+ *
+ *  The simulator calls start() on every START or repeated START addressed to the device, then
+ *  writeByte() or readByte() once per data byte, and stop() when the master releases the bus.
+ */
+class I2cSimDevice
+{
+    protected:
+        uint16_t address;
+
+    public:
+        explicit I2cSimDevice(uint16_t address);
+
+        virtual ~I2cSimDevice() = default;
+
+        uint16_t getAddress(void);
+
+        /*
+         *  @brief Called when the device is addressed.
+         *
+         *  @param read True if the master is going to read from the device.
+         *
+         *  @return True to acknowledge the address, false to NACK it.
+         */
+        virtual bool start(bool read);
+
+        /*
+         *  @brief Called for every byte written by the master.
+         *
+         *  @return True to acknowledge the byte, false to NACK it.
+         */
+        virtual bool writeByte(uint8_t byte) = 0;
+
+        /*
+         *  @brief Called for every byte read by the master.
+         */
+        virtual uint8_t readByte(void) = 0;
+
+        virtual void stop(void);
+};
+
+/*
+ *  @brief Register file device: the first bytes of a write select the register pointer, the rest
+ *  are stored from that register on. Reads stream from the register pointer.
+ *
+ *  Registers are stored MSB first, as most I2C sensors transfer them.
+ */
+class I2cSimRegisterDevice : public I2cSimDevice
+{
+    protected:
+        std::vector<uint8_t> registers;
+        uint16_t registerCount;
+        uint8_t registerWidth;
+        uint8_t pointerBytes;
+        bool autoIncrement;
+
+        uint16_t pointer = 0;
+        uint8_t byteOffset = 0;
+        uint8_t pointerBytesReceived = 0;
+        bool reading = false;
+
+        void advance(void);
+
+        /*
+         *  @brief Called once all the bytes of a register were written by the master.
+         */
+        virtual void registerWritten(uint16_t deviceRegister);
+
+        /*
+         *  @brief Called before the first byte of a register is sent to the master.
+         */
+        virtual void registerRead(uint16_t deviceRegister);
+
+        virtual bool isRegisterWritable(uint16_t deviceRegister);
+
+    public:
+        /*
+         *	@param address 7 bit address of the device.
+         *	@param registerCount Number of registers.
+         *	@param registerWidth Bytes per register.
+         *	@param pointerBytes Bytes used to select a register.
+         *	@param autoIncrement Whether the pointer moves to the next register after a full register
+         *	is transferred. If false, the same register is transferred again.
+         */
+        I2cSimRegisterDevice(uint16_t address, uint16_t registerCount, uint8_t registerWidth = 1, uint8_t pointerBytes = 1, bool autoIncrement = true);
+
+        bool start(bool read) override;
+
+        bool writeByte(uint8_t byte) override;
+
+        uint8_t readByte(void) override;
+
+        uint32_t getRegister(uint16_t deviceRegister);
+
+        void setRegister(uint16_t deviceRegister, uint32_t value);
+
+        uint16_t getPointer(void);
+};
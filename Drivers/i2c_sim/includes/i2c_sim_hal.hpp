@@ -0,0 +1,43 @@
+#pragma once
+
+/*
+ *  HAL header used by the driver when it is built for the host simulation (I2C_DRIVER_HOST_SIM).
+ *
+ *  The HAL types and constants are the real ones, only the function implementations are replaced
+ *  by i2c_sim.cpp. The RCC clock gating macros write straight to the peripheral registers, so they
+ *  are turned into no-ops here.
+ */
+#include "stm32f4xx_hal.h"
+
+#undef __HAL_RCC_I2C1_CLK_ENABLE
+#undef __HAL_RCC_I2C2_CLK_ENABLE
+#undef __HAL_RCC_I2C3_CLK_ENABLE
+#undef __HAL_RCC_GPIOA_CLK_ENABLE
+#undef __HAL_RCC_GPIOB_CLK_ENABLE
+#undef __HAL_RCC_DMA1_CLK_ENABLE
+#undef __HAL_RCC_TIM2_CLK_ENABLE
+
+#define __HAL_RCC_I2C1_CLK_ENABLE()  do {} while(0U)
+#define __HAL_RCC_I2C2_CLK_ENABLE()  do {} while(0U)
+#define __HAL_RCC_I2C3_CLK_ENABLE()  do {} while(0U)
+#define __HAL_RCC_GPIOA_CLK_ENABLE() do {} while(0U)
+#define __HAL_RCC_GPIOB_CLK_ENABLE() do {} while(0U)
+#define __HAL_RCC_DMA1_CLK_ENABLE()  do {} while(0U)
+#define __HAL_RCC_TIM2_CLK_ENABLE()  do {} while(0U)
+
+
+/*
+ *  Registers of the simulated I2C peripherals. The address of the register in the block of the real
+ *  peripheral selects the bus and the register, it is never dereferenced.
+ */
+uint32_t i2cReadRegister(volatile uint32_t &reg);
+
+void i2cWriteRegister(volatile uint32_t &reg, uint32_t value);
+
+/*
+ *  Interrupts only run from I2cSim::advance() and I2cSim::runNext(), the mask is only tracked (see
+ *  I2cSim::areInterruptsMasked).
+ */
+uint32_t i2cMaskInterrupts(void);
+
+void i2cRestoreInterrupts(uint32_t mask);
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "i2c_driver_exceptions.hpp"
+
+/*
+ *  Checks of the host tests. A failed check is printed and counted, I2C_TEST_RESULT() turns the
+ *  count into the exit code of the test for ctest.
+ *
+ *  Each test is an executable of its own, running its cases one after the other on the buses it
+ *  constructs in main.
+ */
+inline int i2cTestFailures = 0;
+
+#define I2C_CHECK(condition) \
+    do \
+    { \
+        if(!(condition)) \
+        { \
+            i2cTestFailures++; \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        } \
+    } \
+    while(0)
+
+#define I2C_CHECK_EQUAL(actual, expected) \
+    do \
+    { \
+        long long actualValue = static_cast<long long>(actual); \
+        long long expectedValue = static_cast<long long>(expected); \
+        if(actualValue != expectedValue) \
+        { \
+            i2cTestFailures++; \
+            printf("%s:%d: check failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #actual, #expected, actualValue, expectedValue); \
+        } \
+    } \
+    while(0)
+
+#define I2C_TEST_RESULT() (i2cTestFailures == 0 ? 0 : 1)
+
+/*
+ *  Status of a driver call that raises (see i2cRaise), built with exceptions or not.
+ */
+#if I2C_DRIVER_EXCEPTIONS
+#define I2C_STATUS_OF(call) \
+    ([&]() -> I2cStatus \
+    { \
+        try \
+        { \
+            return (call); \
+        } \
+        catch(const I2cException &exception) \
+        { \
+            return exception.getStatus(); \
+        } \
+    }())
+#else
+#define I2C_STATUS_OF(call) (call)
+#endif
@@ -0,0 +1,135 @@
+#include "i2c_sim.hpp"
+#include "i2c_sim_ads1115.hpp"
+#include "i2c_bus.hpp"
+#include "ads1115.hpp"
+#include "queue.hpp"
+
+#include "i2c_test.hpp"
+
+/*
+ *  ADS1115 driver against the simulated ADC: continuous and sequenced sampling at the requested
+ *  rates, and the config register shadow.
+ */
+
+#define SAMPLING_TIME_NS 1000000000ULL
+
+static const double inputVolts[4] = {0.5, 1.0, 1.5, 0.25};
+
+// Full scale is 2.048 V: 32768 counts.
+static const int16_t expectedCounts[4] = {8000, 16000, 24000, 4000};
+
+static uint64_t sample(I2cBus &bus, Ads1115 &adc)
+{
+    uint64_t transfers = I2cSim::getStats(I2C1).transactions;
+    uint64_t start = I2cSim::getTime();
+
+    while(I2cSim::getTime() - start < SAMPLING_TIME_NS)
+    {
+        I2cSim::advance(20000);
+        bus.poll();
+        adc.poll();
+    }
+
+    adc.stop();
+    I2cSim::runUntilIdle();
+    adc.poll();
+
+    return I2cSim::getStats(I2C1).transactions - transfers;
+}
+
+static void testContinuous(I2cBus &bus, Ads1115 &adc)
+{
+    I2C_CHECK_EQUAL(adc.startContinuous(ADS1115_MUX_AIN0_GND, ADS1115_RANGE_2_048V, 100), I2C_OK);
+    I2C_CHECK_EQUAL(adc.getConfig().mode, ADS1115_MODE_CONTINUOUS);
+    I2C_CHECK_EQUAL(adc.getConfig().dataRate, ADS1115_RATE_128_SPS);
+
+    uint64_t transfers = sample(bus, adc);
+
+    const Ads1115Channel *channel = adc.getChannel(0);
+    I2C_CHECK(channel != nullptr);
+    I2C_CHECK(channel->samples >= 99 && channel->samples <= 101);
+    I2C_CHECK_EQUAL(channel->errors, 0);
+    I2C_CHECK_EQUAL(channel->value, expectedCounts[0]);
+    I2C_CHECK_EQUAL(Ads1115::toMicrovolts(channel->value, ADS1115_RANGE_2_048V), 500000);
+
+    // One read per sample, the config write came first.
+    I2C_CHECK(transfers <= channel->samples + 1);
+    I2C_CHECK_EQUAL(adc.getOverruns(), 0);
+}
+
+static void testSequence(I2cBus &bus, Ads1115 &adc)
+{
+    const Ads1115Mux muxes[4] = {ADS1115_MUX_AIN0_GND, ADS1115_MUX_AIN1_GND, ADS1115_MUX_AIN2_GND, ADS1115_MUX_AIN3_GND};
+
+    I2C_CHECK_EQUAL(adc.startSequence(muxes, 4, ADS1115_RANGE_2_048V, 50), I2C_OK);
+    I2C_CHECK_EQUAL(adc.getConfig().mode, ADS1115_MODE_SINGLE_SHOT);
+
+    uint64_t transfers = sample(bus, adc);
+
+    uint32_t samples = 0;
+    for(size_t i = 0; i < 4; i++)
+    {
+        const Ads1115Channel *channel = adc.getChannel(i);
+        I2C_CHECK(channel != nullptr);
+        I2C_CHECK_EQUAL(channel->mux, muxes[i]);
+        I2C_CHECK(channel->samples >= 49 && channel->samples <= 51);
+        I2C_CHECK_EQUAL(channel->errors, 0);
+        I2C_CHECK_EQUAL(channel->value, expectedCounts[i]);
+
+        samples += channel->samples;
+    }
+
+    I2C_CHECK(adc.getChannel(4) == nullptr);
+
+    // A write starting the conversion and a read of the result per sample.
+    I2C_CHECK(transfers >= 2 * samples && transfers <= 2 * samples + 2);
+    I2C_CHECK_EQUAL(adc.getOverruns(), 0);
+}
+
+static void testConfigShadow(Ads1115 &adc)
+{
+    Ads1115Config config = {ADS1115_MUX_AIN3_GND, ADS1115_RANGE_4_096V, ADS1115_RATE_250_SPS, ADS1115_MODE_SINGLE_SHOT};
+
+    uint64_t transfers = I2cSim::getStats(I2C1).transactions;
+    I2C_CHECK_EQUAL(adc.configure(config), I2C_OK);
+    I2cSim::runUntilIdle();
+    I2C_CHECK_EQUAL(I2cSim::getStats(I2C1).transactions - transfers, 1);
+
+    // The register already holds it.
+    I2C_CHECK_EQUAL(adc.configure(config), I2C_OK);
+    I2cSim::runUntilIdle();
+    I2C_CHECK_EQUAL(I2cSim::getStats(I2C1).transactions - transfers, 1);
+}
+
+static void testInvalid(Ads1115 &adc)
+{
+    const Ads1115Mux muxes[1] = {ADS1115_MUX_AIN0_GND};
+
+    // Faster than the 860 SPS data rate can convert.
+    I2C_CHECK_EQUAL(I2C_STATUS_OF(adc.startContinuous(ADS1115_MUX_AIN0_GND, ADS1115_RANGE_2_048V, 2000)), I2C_ERROR_INVALID_PERIOD);
+    I2C_CHECK_EQUAL(I2C_STATUS_OF(adc.startSequence(muxes, 0, ADS1115_RANGE_2_048V, 10)), I2C_ERROR_INVALID_REGISTER);
+    I2C_CHECK(!adc.isSampling());
+}
+
+int main(void)
+{
+    I2cSim::reset();
+
+    I2cSimAds1115 adcSim;
+    for(uint8_t i = 0; i < 4; i++)
+    {
+        adcSim.setInputVoltage(i, inputVolts[i]);
+    }
+    I2cSim::attachDevice(I2C1, &adcSim);
+
+    StaticQueue<I2cTransaction, 8> queue;
+    I2cBus bus("bus", &queue, I2C_BUS_1, 400000);
+    Ads1115 adc(&bus);
+
+    testContinuous(bus, adc);
+    testSequence(bus, adc);
+    testConfigShadow(adc);
+    testInvalid(adc);
+
+    return I2C_TEST_RESULT();
+}
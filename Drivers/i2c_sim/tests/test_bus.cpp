@@ -0,0 +1,250 @@
+#include "i2c_sim.hpp"
+#include "i2c_bus.hpp"
+#include "i2c_device.hpp"
+#include "queue.hpp"
+
+#include "i2c_test.hpp"
+
+/*
+ *  Transfers of the bus through the HAL interrupt and DMA engines, transactions built in place in
+ *  its queues, and the release of its peripheral.
+ */
+
+#define SENSOR_ADDRESS 0x48
+#define SENSOR_REGISTERS 32
+
+typedef struct
+{
+    size_t order[8];
+    size_t count;
+}
+CompletionLog;
+
+typedef struct
+{
+    CompletionLog *log;
+    size_t index;
+}
+CompletionEntry;
+
+static void logCompletion(void* parameters)
+{
+    CompletionEntry *entry = static_cast<CompletionEntry*>(parameters);
+    entry->log->order[entry->log->count++] = entry->index;
+}
+
+static void testOrdering(I2cDevice &sensor)
+{
+    CompletionLog log = {};
+    CompletionEntry entries[6];
+    uint8_t data[6][2] = {};
+    I2cStatus status[6];
+
+    // Queued back to back: the first one holds the bus while the others wait.
+    for(size_t i = 0; i < 6; i++)
+    {
+        entries[i] = {&log, i};
+        status[i] = I2C_ERROR_HAL;
+
+        I2cTransaction transaction(TRANSACTION_RX, data[i], 2, &sensor, (5 - i) * 4, REGISTER_8_BITS);
+        transaction.setStatusOutput(&status[i]);
+        transaction.setPostCallback(logCompletion, &entries[i]);
+        I2C_CHECK_EQUAL(transaction.send(), I2C_OK);
+    }
+
+    I2cSim::runUntilIdle();
+
+    I2C_CHECK_EQUAL(log.count, 6);
+    for(size_t i = 0; i < 6; i++)
+    {
+        I2C_CHECK_EQUAL(log.order[i], i);
+        I2C_CHECK_EQUAL(status[i], I2C_OK);
+        I2C_CHECK_EQUAL(data[i][0], 0x40 + (5 - i) * 4);
+        I2C_CHECK_EQUAL(data[i][1], 0x40 + (5 - i) * 4 + 1);
+    }
+}
+
+static uint64_t readBlock(I2cDevice &sensor, uint8_t* data, uint16_t bytes)
+{
+    uint64_t interrupts = I2cSim::getStats(I2C1).interrupts;
+    I2cStatus status = I2C_ERROR_HAL;
+
+    I2cTransaction transaction(TRANSACTION_RX, data, bytes, &sensor, 0, REGISTER_8_BITS);
+    transaction.setStatusOutput(&status);
+    transaction.send();
+    I2cSim::runUntilIdle();
+
+    I2C_CHECK_EQUAL(status, I2C_OK);
+    for(uint16_t i = 0; i < bytes; i++)
+    {
+        I2C_CHECK_EQUAL(data[i], 0x40 + i);
+    }
+
+    return I2cSim::getStats(I2C1).interrupts - interrupts;
+}
+
+static void testDma(I2cBus &bus, I2cDevice &sensor, I2cSimRegisterDevice &sensorSim)
+{
+    uint8_t data[16] = {};
+
+    I2C_CHECK_EQUAL(bus.getTransferMode(), I2C_TRANSFER_INTERRUPT);
+    uint64_t interruptTransfer = readBlock(sensor, data, sizeof(data));
+
+    I2C_CHECK_EQUAL(bus.setTransferMode(I2C_TRANSFER_DMA), I2C_OK);
+    uint64_t dmaTransfer = readBlock(sensor, data, sizeof(data));
+
+    // The stream moves the data, the CPU only sees the address phase and the end of the transfer.
+    I2C_CHECK(dmaTransfer < interruptTransfer);
+
+    // A single byte isn't worth the stream setup, it goes out through the interrupts.
+    readBlock(sensor, data, 1);
+
+    uint8_t written[4] = {0xA0, 0xA1, 0xA2, 0xA3};
+    I2cStatus status = I2C_ERROR_HAL;
+    I2cTransaction write(TRANSACTION_TX, written, sizeof(written), &sensor, 8, REGISTER_8_BITS);
+    write.setStatusOutput(&status);
+    write.send();
+    I2cSim::runUntilIdle();
+
+    I2C_CHECK_EQUAL(status, I2C_OK);
+    for(uint16_t i = 0; i < sizeof(written); i++)
+    {
+        I2C_CHECK_EQUAL(sensorSim.getRegister(8 + i), written[i]);
+    }
+
+    bus.setTransferMode(I2C_TRANSFER_INTERRUPT);
+}
+
+static void testQueueFull(I2cBus &bus, I2cDevice &sensor)
+{
+    uint8_t data[2];
+    I2cTransaction transaction(TRANSACTION_RX, data, 2, &sensor, 0, REGISTER_8_BITS);
+
+    // Nothing completes until the simulator runs: one in flight, the rest fill the queue.
+    size_t queued = 0;
+    while(I2C_STATUS_OF(transaction.send()) == I2C_OK && queued < 100)
+    {
+        queued++;
+    }
+
+    I2C_CHECK_EQUAL(queued, 8);
+    I2C_CHECK(!I2cSim::areInterruptsMasked());
+
+    I2cSim::runUntilIdle();
+    I2C_CHECK(!I2cSim::isBusy(bus.getHandle()->Instance));
+}
+
+/*
+ *  Exposes the non-raising emplace path.
+ */
+class I2cTestDevice : public I2cDevice
+{
+    public:
+        using I2cDevice::I2cDevice;
+        using I2cDevice::acquireTransaction;
+        using I2cDevice::publishTransaction;
+};
+
+static void testEmplace(I2cBus &bus)
+{
+    I2cTestDevice sensor(SENSOR_ADDRESS, &bus, "emplacing sensor");
+    uint8_t data[2] = {};
+    I2cStatus status = I2C_ERROR_HAL;
+
+    // The interrupts stay masked while the slot is built, a producer in an interrupt can't take it.
+    I2cTransaction *transaction = sensor.acquireTransaction(TRANSACTION_RX, data, sizeof(data), 6, REGISTER_8_BITS, status);
+    I2C_CHECK(transaction != nullptr);
+    I2C_CHECK_EQUAL(status, I2C_OK);
+    I2C_CHECK(I2cSim::areInterruptsMasked());
+
+    transaction->setStatusOutput(&status);
+    I2C_CHECK_EQUAL(sensor.publishTransaction(), I2C_OK);
+    I2C_CHECK(!I2cSim::areInterruptsMasked());
+
+    I2cSim::runUntilIdle();
+    I2C_CHECK_EQUAL(status, I2C_OK);
+    I2C_CHECK_EQUAL(data[0], 0x40 + 6);
+    I2C_CHECK_EQUAL(data[1], 0x40 + 7);
+
+    // A class queue of references has no slot: told apart from a full queue, nothing stays masked.
+    ReferenceQueue<I2cTransaction, 4> references;
+    I2C_CHECK_EQUAL(bus.setPriorityQueue(I2C_PRIORITY_HIGH, &references), I2C_OK);
+    sensor.setPriority(I2C_PRIORITY_HIGH);
+
+    transaction = sensor.acquireTransaction(TRANSACTION_RX, data, sizeof(data), 6, REGISTER_8_BITS, status);
+    I2C_CHECK(transaction == nullptr);
+    I2C_CHECK_EQUAL(status, I2C_ERROR_REFERENCE_QUEUE);
+    I2C_CHECK(!I2cSim::areInterruptsMasked());
+    I2C_CHECK_EQUAL(sensor.publishTransaction(), I2C_ERROR_REFERENCE_QUEUE);
+    I2C_CHECK(!I2cSim::areInterruptsMasked());
+
+    I2C_CHECK_EQUAL(bus.setPriorityQueue(I2C_PRIORITY_HIGH, nullptr), I2C_OK);
+}
+
+static void testDestruction(I2cBus &bus, I2cDevice &sensor, I2cSimRegisterDevice &sensorSim)
+{
+    I2cSim::attachDevice(I2C2, &sensorSim);
+
+    StaticQueue<I2cTransaction, 4> queue;
+    CompletionLog log = {};
+    CompletionEntry entry = {&log, 0};
+    uint8_t data[16] = {};
+
+    {
+        I2cBus other("other", &queue, I2C_BUS_2, 400000, true, I2C_DUTY_CYCLE_2, true, false, 0, 0, false, false, I2C_TRANSFER_DMA);
+        I2C_CHECK_EQUAL(other.getStatus(), I2C_OK);
+
+        I2cDevice otherSensor(SENSOR_ADDRESS, &other, "other sensor");
+        I2cTransaction transaction(TRANSACTION_RX, data, sizeof(data), &otherSensor, 0, REGISTER_8_BITS);
+        transaction.setPostCallback(logCompletion, &entry);
+        I2C_CHECK_EQUAL(transaction.send(), I2C_OK);
+        I2C_CHECK(I2cSim::isBusy(I2C2));
+    }
+
+    // Destroyed mid-transfer: the transfer is dropped and nothing calls into the destroyed bus.
+    I2C_CHECK(!I2cSim::isBusy(I2C2));
+    I2cSim::runUntilIdle();
+    I2C_CHECK_EQUAL(log.count, 0);
+
+    // The peripheral was released, a new bus can claim it.
+    I2cBus again("again", &queue, I2C_BUS_2, 100000);
+    I2C_CHECK_EQUAL(again.getStatus(), I2C_OK);
+
+    // A bus that couldn't claim its peripheral leaves the owner registered when it goes away.
+    I2cStatus inUse = I2C_STATUS_OF(([&]()
+    {
+        I2cBus duplicate("duplicate", &queue, I2C_BUS_1, 400000);
+        return duplicate.getStatus();
+    }()));
+    I2C_CHECK_EQUAL(inUse, I2C_ERROR_BUS_IN_USE);
+
+    uint8_t block[4] = {};
+    readBlock(sensor, block, sizeof(block));
+    I2C_CHECK(!I2cSim::isBusy(bus.getHandle()->Instance));
+}
+
+int main(void)
+{
+    I2cSim::reset();
+
+    I2cSimRegisterDevice sensorSim(SENSOR_ADDRESS, SENSOR_REGISTERS);
+    for(uint16_t i = 0; i < SENSOR_REGISTERS; i++)
+    {
+        sensorSim.setRegister(i, 0x40 + i);
+    }
+    I2cSim::attachDevice(I2C1, &sensorSim);
+
+    StaticQueue<I2cTransaction, 8> queue;
+    I2cBus bus("bus", &queue, I2C_BUS_1, 400000);
+    I2C_CHECK_EQUAL(bus.getStatus(), I2C_OK);
+
+    I2cDevice sensor(SENSOR_ADDRESS, &bus, "sensor");
+
+    testOrdering(sensor);
+    testDma(bus, sensor, sensorSim);
+    testQueueFull(bus, sensor);
+    testEmplace(bus);
+    testDestruction(bus, sensor, sensorSim);
+
+    return I2C_TEST_RESULT();
+}
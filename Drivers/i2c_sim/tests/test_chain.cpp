@@ -0,0 +1,250 @@
+#include "i2c_sim.hpp"
+#include "i2c_bus.hpp"
+#include "i2c_device.hpp"
+#include "i2c_transaction_chain.hpp"
+#include "queue.hpp"
+
+#include "i2c_test.hpp"
+
+/*
+ *  Repeated START chains: the FIRST/NEXT/LAST frames handed to the bus, one STOP for the whole
+ *  chain, and the status of every frame when one in the middle is NACKed or runs into a bus fault.
+ */
+
+#define SENSOR_ADDRESS 0x48
+#define SENSOR_REGISTERS 16
+
+/*
+ *  Register file that can NACK its address on a given START of the chain.
+ */
+class I2cSimChainDevice : public I2cSimRegisterDevice
+{
+    public:
+        uint32_t starts = 0;
+        uint32_t stops = 0;
+        // START (counted from 1) whose address is NACKed, 0 for none.
+        uint32_t nackStart = 0;
+
+        I2cSimChainDevice(void) : I2cSimRegisterDevice(SENSOR_ADDRESS, SENSOR_REGISTERS)
+        {
+
+        }
+
+        bool start(bool read) override
+        {
+            starts++;
+            if(starts == nackStart)
+                return false;
+
+            return I2cSimRegisterDevice::start(read);
+        }
+
+        void stop(void) override
+        {
+            stops++;
+            I2cSimRegisterDevice::stop();
+        }
+};
+
+/*
+ *  Exposes the frames and their status.
+ */
+class I2cTestChain : public I2cTransactionChain
+{
+    public:
+        using I2cTransactionChain::I2cTransactionChain;
+
+        I2cSequenceFrame getSequenceFrame(uint8_t frame)
+        {
+            return frames[frame].getSequenceFrame();
+        }
+
+        I2cStatus getFrameStatus(uint8_t frame)
+        {
+            return frameStatus[frame];
+        }
+};
+
+typedef struct
+{
+    uint8_t pointer[1];
+    uint8_t data[2];
+    uint8_t secondPointer[1];
+    uint8_t secondData[1];
+    I2cStatus status;
+    uint32_t completions;
+}
+ChainBuffers;
+
+static void chainDone(void* parameters)
+{
+    static_cast<ChainBuffers*>(parameters)->completions++;
+}
+
+/*
+ *  Write a pointer, read, write another pointer, read: every frame changes direction, so each one
+ *  starts with a (repeated) START the device sees.
+ */
+static void buildChain(I2cTestChain &chain, ChainBuffers &buffers)
+{
+    buffers = {};
+    buffers.pointer[0] = 2;
+    buffers.secondPointer[0] = 9;
+    buffers.status = I2C_ERROR_HAL;
+
+    I2C_CHECK_EQUAL(chain.addWrite(buffers.pointer, 1), I2C_OK);
+    I2C_CHECK_EQUAL(chain.addRead(buffers.data, 2), I2C_OK);
+    I2C_CHECK_EQUAL(chain.addWrite(buffers.secondPointer, 1), I2C_OK);
+    I2C_CHECK_EQUAL(chain.addRead(buffers.secondData, 1), I2C_OK);
+    chain.setStatusOutput(&buffers.status);
+    chain.setPostCallback(chainDone, &buffers);
+}
+
+static void testFrames(I2cDevice &sensor)
+{
+    ChainBuffers buffers;
+    uint8_t data[1];
+
+    I2cTestChain single(&sensor);
+    I2C_CHECK_EQUAL(single.addRead(data, 1), I2C_OK);
+    I2C_CHECK_EQUAL(single.send(), I2C_OK);
+    I2C_CHECK_EQUAL(single.getSequenceFrame(0), I2C_FRAME_SINGLE);
+    I2cSim::runUntilIdle();
+
+    I2cTestChain pair(&sensor);
+    I2C_CHECK_EQUAL(pair.addWrite(data, 1), I2C_OK);
+    I2C_CHECK_EQUAL(pair.addRead(data, 1), I2C_OK);
+    I2C_CHECK_EQUAL(pair.send(), I2C_OK);
+    I2C_CHECK_EQUAL(pair.getSequenceFrame(0), I2C_FRAME_FIRST);
+    I2C_CHECK_EQUAL(pair.getSequenceFrame(1), I2C_FRAME_LAST);
+    I2cSim::runUntilIdle();
+
+    I2cTestChain chain(&sensor);
+    buildChain(chain, buffers);
+    I2C_CHECK_EQUAL(chain.send(), I2C_OK);
+    I2C_CHECK_EQUAL(chain.getSequenceFrame(0), I2C_FRAME_FIRST);
+    I2C_CHECK_EQUAL(chain.getSequenceFrame(1), I2C_FRAME_NEXT);
+    I2C_CHECK_EQUAL(chain.getSequenceFrame(2), I2C_FRAME_NEXT);
+    I2C_CHECK_EQUAL(chain.getSequenceFrame(3), I2C_FRAME_LAST);
+    I2cSim::runUntilIdle();
+
+    I2C_CHECK_EQUAL(buffers.completions, 1);
+    I2C_CHECK_EQUAL(buffers.status, I2C_OK);
+    I2C_CHECK_EQUAL(chain.getFailedFrame(), 4);
+    for(uint8_t frame = 0; frame < 4; frame++)
+    {
+        I2C_CHECK_EQUAL(chain.getFrameStatus(frame), I2C_OK);
+    }
+
+    I2C_CHECK_EQUAL(buffers.data[0], 0x30 + 2);
+    I2C_CHECK_EQUAL(buffers.data[1], 0x30 + 3);
+    I2C_CHECK_EQUAL(buffers.secondData[0], 0x30 + 9);
+}
+
+static void testWire(I2cDevice &sensor, I2cSimChainDevice &sensorSim)
+{
+    ChainBuffers buffers;
+    I2cTestChain chain(&sensor);
+    buildChain(chain, buffers);
+
+    sensorSim.starts = 0;
+    sensorSim.stops = 0;
+
+    I2C_CHECK_EQUAL(chain.send(), I2C_OK);
+    I2cSim::runUntilIdle();
+
+    // Repeated STARTs between the frames, a single STOP at the end of the chain.
+    I2C_CHECK_EQUAL(sensorSim.starts, 4);
+    I2C_CHECK_EQUAL(sensorSim.stops, 1);
+    I2C_CHECK_EQUAL(buffers.status, I2C_OK);
+}
+
+static void testMidChainNack(I2cDevice &sensor, I2cSimChainDevice &sensorSim)
+{
+    ChainBuffers buffers;
+    I2cTestChain chain(&sensor);
+    buildChain(chain, buffers);
+
+    sensorSim.starts = 0;
+    sensorSim.nackStart = 3;
+
+    I2C_CHECK_EQUAL(chain.send(), I2C_OK);
+    I2cSim::runUntilIdle();
+    sensorSim.nackStart = 0;
+
+    // The third frame is NACKed, the last one never goes out.
+    I2C_CHECK_EQUAL(sensorSim.starts, 3);
+    I2C_CHECK_EQUAL(chain.getFrameStatus(0), I2C_OK);
+    I2C_CHECK_EQUAL(chain.getFrameStatus(1), I2C_OK);
+    I2C_CHECK_EQUAL(chain.getFrameStatus(2), I2C_ERROR_NACK);
+    I2C_CHECK_EQUAL(chain.getFrameStatus(3), I2C_ERROR_SEQUENCE_ABORTED);
+
+    I2C_CHECK_EQUAL(chain.getFailedFrame(), 2);
+    I2C_CHECK_EQUAL(chain.getStatus(), I2C_ERROR_NACK);
+    I2C_CHECK_EQUAL(buffers.status, I2C_ERROR_NACK);
+    I2C_CHECK_EQUAL(buffers.completions, 1);
+
+    // The frames before the failure got their data.
+    I2C_CHECK_EQUAL(buffers.data[0], 0x30 + 2);
+    I2C_CHECK_EQUAL(buffers.data[1], 0x30 + 3);
+}
+
+static void testMidChainFault(I2cDevice &sensor)
+{
+    ChainBuffers buffers;
+    I2cTestChain chain(&sensor);
+    buildChain(chain, buffers);
+
+    I2C_CHECK_EQUAL(chain.send(), I2C_OK);
+
+    // The end of the first frame starts the second one, the fault hits the third.
+    I2C_CHECK(I2cSim::runNext());
+    I2cSim::injectFault(I2C1, I2C_SIM_FAULT_BUS_ERROR);
+    I2cSim::runUntilIdle();
+
+    // The chain is completed once the main loop has recovered the bus.
+    I2C_CHECK_EQUAL(buffers.completions, 0);
+    sensor.getBus()->poll();
+    I2cSim::runUntilIdle();
+
+    I2C_CHECK_EQUAL(chain.getFrameStatus(0), I2C_OK);
+    I2C_CHECK_EQUAL(chain.getFrameStatus(1), I2C_OK);
+    I2C_CHECK_EQUAL(chain.getFrameStatus(2), I2C_ERROR_BUS_FAULT);
+    I2C_CHECK_EQUAL(chain.getFrameStatus(3), I2C_ERROR_SEQUENCE_ABORTED);
+    I2C_CHECK_EQUAL(chain.getFailedFrame(), 2);
+    I2C_CHECK_EQUAL(buffers.status, I2C_ERROR_BUS_FAULT);
+    I2C_CHECK_EQUAL(buffers.completions, 1);
+
+    // The bus was recovered, the next chain goes through.
+    chain.clear();
+    buildChain(chain, buffers);
+    I2C_CHECK_EQUAL(chain.send(), I2C_OK);
+    I2cSim::runUntilIdle();
+    I2C_CHECK_EQUAL(buffers.status, I2C_OK);
+    I2C_CHECK_EQUAL(chain.getFailedFrame(), 4);
+}
+
+int main(void)
+{
+    I2cSim::reset();
+
+    I2cSimChainDevice sensorSim;
+    for(uint16_t i = 0; i < SENSOR_REGISTERS; i++)
+    {
+        sensorSim.setRegister(i, 0x30 + i);
+    }
+    I2cSim::attachDevice(I2C1, &sensorSim);
+
+    StaticQueue<I2cTransaction, 8> queue;
+    I2cBus bus("bus", &queue, I2C_BUS_1, 400000);
+    I2C_CHECK_EQUAL(bus.getStatus(), I2C_OK);
+
+    I2cDevice sensor(SENSOR_ADDRESS, &bus, "sensor");
+
+    testFrames(sensor);
+    testWire(sensor, sensorSim);
+    testMidChainNack(sensor, sensorSim);
+    testMidChainFault(sensor);
+
+    return I2C_TEST_RESULT();
+}
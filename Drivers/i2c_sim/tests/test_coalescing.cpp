@@ -0,0 +1,121 @@
+#include "i2c_sim.hpp"
+#include "i2c_bus.hpp"
+#include "i2c_device.hpp"
+#include "queue.hpp"
+
+#include "i2c_test.hpp"
+
+/*
+ *  Contiguous register reads of a device merged into burst reads.
+ */
+
+#define SENSOR_ADDRESS 0x76
+#define SENSOR_REGISTERS 32
+
+typedef struct
+{
+    uint8_t data[2];
+    uint16_t deviceRegister;
+    uint16_t bytes;
+    I2cStatus status;
+}
+ReadResult;
+
+static size_t callbacks = 0;
+
+static void countCallback(void* parameters)
+{
+    (void)parameters;
+    callbacks++;
+}
+
+/*
+ *  Queues reads of registers 0-1, 2-3, 4 and 10 behind a read holding the bus, and returns the
+ *  transfers they took.
+ */
+static uint64_t readRegisters(I2cDevice &sensor, ReadResult (&reads)[4], bool fault)
+{
+    reads[0] = {{}, 0, 2, I2C_ERROR_HAL};
+    reads[1] = {{}, 2, 2, I2C_ERROR_HAL};
+    reads[2] = {{}, 4, 1, I2C_ERROR_HAL};
+    reads[3] = {{}, 10, 1, I2C_ERROR_HAL};
+    callbacks = 0;
+
+    uint8_t first;
+    I2cTransaction blocking(TRANSACTION_RX, &first, 1, &sensor, 20, REGISTER_8_BITS);
+    blocking.send();
+
+    if(fault)
+    {
+        I2cSim::injectFault(I2C1, I2C_SIM_FAULT_BUS_ERROR);
+    }
+
+    for(ReadResult &read : reads)
+    {
+        I2cTransaction transaction(TRANSACTION_RX, read.data, read.bytes, &sensor, read.deviceRegister, REGISTER_8_BITS);
+        transaction.setStatusOutput(&read.status);
+        transaction.setPostCallback(countCallback, nullptr);
+        transaction.send();
+    }
+
+    uint64_t transfers = I2cSim::getStats(I2C1).transactions;
+
+    // A failed burst waits for the main loop to recover the bus.
+    I2cSim::runUntilIdle();
+    I2C_CHECK_EQUAL(sensor.getBus()->runRecovery(), fault);
+    I2cSim::runUntilIdle();
+
+    transfers = I2cSim::getStats(I2C1).transactions - transfers;
+
+    // Each read gets its own data, status and callback whatever the bus did.
+    I2C_CHECK_EQUAL(callbacks, 4);
+    for(ReadResult &read : reads)
+    {
+        I2C_CHECK_EQUAL(read.status, I2C_OK);
+        for(uint16_t i = 0; i < read.bytes; i++)
+        {
+            I2C_CHECK_EQUAL(read.data[i], 0x40 + read.deviceRegister + i);
+        }
+    }
+
+    return transfers;
+}
+
+int main(void)
+{
+    I2cSim::reset();
+
+    I2cSimRegisterDevice sensorSim(SENSOR_ADDRESS, SENSOR_REGISTERS);
+    for(uint16_t i = 0; i < SENSOR_REGISTERS; i++)
+    {
+        sensorSim.setRegister(i, 0x40 + i);
+    }
+    I2cSim::attachDevice(I2C1, &sensorSim);
+
+    StaticQueue<I2cTransaction, 8> queue;
+    I2cBus bus("bus", &queue, I2C_BUS_1, 400000);
+    I2cDevice sensor(SENSOR_ADDRESS, &bus, "sensor");
+
+    ReadResult reads[4];
+
+    // The blocking read, then every read on its own.
+    I2C_CHECK_EQUAL(readRegisters(sensor, reads, false), 5);
+
+    // The blocking read, one burst for registers 0 to 4, and register 10.
+    sensor.setReadCoalescing(true);
+    I2C_CHECK_EQUAL(readRegisters(sensor, reads, false), 3);
+
+    // A failed burst is never merged again: its reads go out one by one.
+    uint64_t faults = I2cSim::getStats(I2C1).faults;
+    I2C_CHECK_EQUAL(readRegisters(sensor, reads, true), 5);
+    I2C_CHECK_EQUAL(I2cSim::getStats(I2C1).faults - faults, 1);
+
+#if I2C_DRIVER_STATS
+    const I2cDeviceStats *stats = bus.getDeviceStats(SENSOR_ADDRESS);
+    I2C_CHECK(stats != nullptr);
+    // Registers 2-3 and 4 rode along the read of 0-1 once, the failed burst saved nothing.
+    I2C_CHECK_EQUAL(stats->coalescedReads, 2);
+#endif
+
+    return I2C_TEST_RESULT();
+}
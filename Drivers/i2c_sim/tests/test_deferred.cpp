@@ -0,0 +1,191 @@
+#include "i2c_sim.hpp"
+#include "i2c_bus.hpp"
+#include "i2c_device.hpp"
+#include "queue.hpp"
+
+#include "i2c_test.hpp"
+
+/*
+ *  Deferred post callbacks: queued by the completion interrupt, run in order by runCompletions()
+ *  or the PendSV handler, and run in the interrupt after all when the ring is full.
+ */
+
+#define SENSOR_ADDRESS 0x48
+#define SENSOR_REGISTERS 16
+
+#define READS 4
+
+typedef struct
+{
+    size_t order[READS];
+    // Whether each callback ran while the test drained the ring, i.e. outside the interrupt.
+    bool drained[READS];
+    size_t count;
+}
+CompletionLog;
+
+typedef struct
+{
+    CompletionLog *log;
+    size_t index;
+}
+CompletionEntry;
+
+// Set while the test runs the deferred callbacks, everything else runs in the simulated interrupt.
+static bool draining = false;
+
+static void logCompletion(void* parameters)
+{
+    CompletionEntry *entry = static_cast<CompletionEntry*>(parameters);
+    entry->log->order[entry->log->count] = entry->index;
+    entry->log->drained[entry->log->count] = draining;
+    entry->log->count++;
+}
+
+static size_t drain(I2cBus &bus)
+{
+    draining = true;
+    size_t count = bus.runCompletions();
+    draining = false;
+
+    return count;
+}
+
+static void queueReads(I2cDevice &sensor, CompletionLog &log, CompletionEntry *entries, uint8_t (*data)[2], size_t count)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        entries[i] = {&log, i};
+        I2cTransaction transaction(TRANSACTION_RX, data[i], 2, &sensor, i, REGISTER_8_BITS);
+        transaction.setPostCallback(logCompletion, &entries[i]);
+        I2C_CHECK_EQUAL(transaction.send(), I2C_OK);
+    }
+}
+
+static void testDeferred(I2cBus &bus, I2cDevice &sensor)
+{
+    CompletionLog log = {};
+    CompletionEntry entries[READS];
+    uint8_t data[READS][2] = {};
+
+    queueReads(sensor, log, entries, data, 3);
+
+    // The first completion starts the next transfer and leaves its callback queued.
+    I2C_CHECK(I2cSim::runNext());
+    I2C_CHECK(I2cSim::isBusy(I2C1));
+    I2C_CHECK_EQUAL(log.count, 0);
+
+    I2cSim::runUntilIdle();
+    I2C_CHECK_EQUAL(log.count, 0);
+    I2C_CHECK_EQUAL(data[2][0], 0x50 + 2);
+
+    // Run outside the interrupt, in completion order.
+    I2C_CHECK_EQUAL(drain(bus), 3);
+    I2C_CHECK_EQUAL(log.count, 3);
+    for(size_t i = 0; i < 3; i++)
+    {
+        I2C_CHECK_EQUAL(log.order[i], i);
+        I2C_CHECK(log.drained[i]);
+    }
+
+    I2C_CHECK_EQUAL(drain(bus), 0);
+}
+
+static void testImmediate(I2cBus &bus, I2cDevice &sensor)
+{
+    CompletionLog log = {};
+    CompletionEntry entry = {&log, 0};
+    uint8_t data[2] = {};
+
+    // An immediate callback skips the ring.
+    I2cTransaction transaction(TRANSACTION_RX, data, 2, &sensor, 0, REGISTER_8_BITS);
+    transaction.setPostCallback(logCompletion, &entry);
+    transaction.setImmediateCallback(true);
+    I2C_CHECK_EQUAL(transaction.send(), I2C_OK);
+    I2cSim::runUntilIdle();
+
+    I2C_CHECK_EQUAL(log.count, 1);
+    I2C_CHECK(!log.drained[0]);
+    I2C_CHECK_EQUAL(drain(bus), 0);
+}
+
+static void testRingFull(I2cBus &bus, I2cDevice &sensor)
+{
+    CompletionLog log = {};
+    CompletionEntry entries[READS];
+    uint8_t data[READS][2] = {};
+
+    StaticQueue<I2cCompletion, 2> ring;
+    I2C_CHECK_EQUAL(bus.setDeferredCompletions(&ring), I2C_OK);
+
+    // Two callbacks fill the ring, the other two aren't dropped: they run in the interrupt.
+    queueReads(sensor, log, entries, data, READS);
+    I2cSim::runUntilIdle();
+
+    I2C_CHECK_EQUAL(log.count, 2);
+    I2C_CHECK_EQUAL(log.order[0], 2);
+    I2C_CHECK_EQUAL(log.order[1], 3);
+    I2C_CHECK(!log.drained[0] && !log.drained[1]);
+
+    I2C_CHECK_EQUAL(drain(bus), 2);
+    I2C_CHECK_EQUAL(log.count, READS);
+    I2C_CHECK_EQUAL(log.order[2], 0);
+    I2C_CHECK_EQUAL(log.order[3], 1);
+    I2C_CHECK(log.drained[2] && log.drained[3]);
+
+    I2C_CHECK_EQUAL(bus.setDeferredCompletions(nullptr), I2C_OK);
+}
+
+static void testPendSv(I2cBus &bus, I2cDevice &sensor)
+{
+    CompletionLog log = {};
+    CompletionEntry entries[READS];
+    uint8_t data[READS][2] = {};
+
+    StaticQueue<I2cCompletion, 4> ring;
+    I2C_CHECK_EQUAL(bus.setDeferredCompletions(&ring, true), I2C_OK);
+
+    queueReads(sensor, log, entries, data, 2);
+    I2cSim::runUntilIdle();
+    I2C_CHECK_EQUAL(log.count, 0);
+
+    // Drained by the PendSV handler, not by the main loop.
+    draining = true;
+    I2C_DeferredCompletionHandler();
+    draining = false;
+
+    I2C_CHECK_EQUAL(log.count, 2);
+    I2C_CHECK_EQUAL(log.order[0], 0);
+    I2C_CHECK_EQUAL(log.order[1], 1);
+    I2C_CHECK(log.drained[0] && log.drained[1]);
+
+    I2C_CHECK_EQUAL(bus.setDeferredCompletions(nullptr), I2C_OK);
+}
+
+int main(void)
+{
+    I2cSim::reset();
+
+    I2cSimRegisterDevice sensorSim(SENSOR_ADDRESS, SENSOR_REGISTERS);
+    for(uint16_t i = 0; i < SENSOR_REGISTERS; i++)
+    {
+        sensorSim.setRegister(i, 0x50 + i);
+    }
+    I2cSim::attachDevice(I2C1, &sensorSim);
+
+    StaticQueue<I2cTransaction, 8> queue;
+    I2cBus bus("bus", &queue, I2C_BUS_1, 400000);
+    I2C_CHECK_EQUAL(bus.getStatus(), I2C_OK);
+
+    I2cDevice sensor(SENSOR_ADDRESS, &bus, "sensor");
+
+    StaticQueue<I2cCompletion, 8> ring;
+    I2C_CHECK_EQUAL(bus.setDeferredCompletions(&ring), I2C_OK);
+
+    testDeferred(bus, sensor);
+    testImmediate(bus, sensor);
+    testRingFull(bus, sensor);
+    testPendSv(bus, sensor);
+
+    return I2C_TEST_RESULT();
+}
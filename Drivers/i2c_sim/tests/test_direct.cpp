@@ -0,0 +1,255 @@
+#include "i2c_sim.hpp"
+#include "i2c_bus.hpp"
+#include "i2c_device.hpp"
+#include "queue.hpp"
+
+#include <algorithm>
+
+#include "i2c_test.hpp"
+
+/*
+ *  The direct transfer engine against the register model of the peripheral: the endings of 1, 2,
+ *  3 and N byte receptions (ACK, POS and STOP set at the right byte), writes and NACKs, a bus
+ *  held busy, and what it costs next to the HAL interrupt engine for the same transfers.
+ */
+
+#define SENSOR_ADDRESS 0x48
+#define MISSING_ADDRESS 0x50
+#define READ_REGISTER 4
+#define WRITE_REGISTER 10
+
+typedef struct
+{
+    I2cStatus status;
+    uint64_t interrupts;
+    uint64_t registerAccesses;
+    uint64_t busyTime;
+}
+ReadCost;
+
+static uint8_t expectedRegister(uint16_t deviceRegister)
+{
+    return static_cast<uint8_t>(deviceRegister * 3);
+}
+
+static ReadCost readRegisters(I2cDevice &sensor, I2cTransferMode mode, uint8_t* data, uint16_t dataBytes)
+{
+    I2cSimBusStats before = I2cSim::getStats(I2C1);
+    ReadCost cost = {I2C_ERROR_HAL, 0, 0, 0};
+
+    I2cTransaction read(TRANSACTION_RX, data, dataBytes, &sensor, READ_REGISTER, REGISTER_8_BITS);
+    read.setTransferMode(mode);
+    read.setStatusOutput(&cost.status);
+    read.send();
+    I2cSim::runUntilIdle();
+
+    const I2cSimBusStats &after = I2cSim::getStats(I2C1);
+    cost.interrupts = after.interrupts - before.interrupts;
+    cost.registerAccesses = after.registerAccesses - before.registerAccesses;
+    cost.busyTime = after.busyTime - before.busyTime;
+
+    return cost;
+}
+
+/*
+ *  The master NACKs the last byte and stops: one more byte clocked out of the device would move its
+ *  pointer past the end of the read.
+ */
+static void testReceiveEndings(I2cDevice &sensor, I2cSimRegisterDevice &sensorSim)
+{
+    const uint16_t lengths[] = {1, 2, 3, 4, 5, 8, 16};
+    uint64_t accessesPerLength[sizeof(lengths) / sizeof(lengths[0])] = {};
+
+    for(size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+    {
+        uint16_t length = lengths[i];
+        // One byte more than the read, left untouched.
+        uint8_t data[17];
+        std::fill_n(data, sizeof(data), 0xEE);
+
+        ReadCost direct = readRegisters(sensor, I2C_TRANSFER_DIRECT, data, length);
+        accessesPerLength[i] = direct.registerAccesses;
+
+        I2C_CHECK_EQUAL(direct.status, I2C_OK);
+        I2C_CHECK_EQUAL(sensorSim.getPointer(), READ_REGISTER + length);
+        I2C_CHECK(!I2cSim::isBusy(I2C1));
+        for(uint16_t j = 0; j < length; j++)
+        {
+            I2C_CHECK_EQUAL(data[j], expectedRegister(READ_REGISTER + j));
+        }
+        I2C_CHECK_EQUAL(data[length], 0xEE);
+
+        // Same transfer through the HAL: same bytes on the wire, fewer interrupts for the engine.
+        uint8_t halData[16];
+        ReadCost hal = readRegisters(sensor, I2C_TRANSFER_INTERRUPT, halData, length);
+
+        I2C_CHECK_EQUAL(hal.status, I2C_OK);
+        I2C_CHECK(std::equal(data, data + length, halData));
+        I2C_CHECK_EQUAL(direct.busyTime, hal.busyTime);
+        I2C_CHECK(direct.interrupts < hal.interrupts);
+        I2C_CHECK(direct.interrupts > 0);
+    }
+
+    // Past the ending, each byte costs a read of SR1 and of DR.
+    I2C_CHECK(accessesPerLength[6] - accessesPerLength[5] <= 2 * (16 - 8));
+}
+
+static void testReadWithoutRegister(I2cDevice &sensor, I2cSimRegisterDevice &sensorSim)
+{
+    // Goes on from where the pointer was left.
+    uint8_t data[3] = {};
+    I2cStatus status = I2C_ERROR_HAL;
+    uint16_t pointer = sensorSim.getPointer();
+
+    I2cTransaction read(TRANSACTION_RX, data, sizeof(data), &sensor);
+    read.setTransferMode(I2C_TRANSFER_DIRECT);
+    read.setStatusOutput(&status);
+    read.send();
+    I2cSim::runUntilIdle();
+
+    I2C_CHECK_EQUAL(status, I2C_OK);
+    I2C_CHECK_EQUAL(data[0], expectedRegister(pointer));
+    I2C_CHECK_EQUAL(data[2], expectedRegister(pointer + 2));
+    I2C_CHECK_EQUAL(sensorSim.getPointer(), pointer + 3);
+}
+
+static void testWrite(I2cDevice &sensor, I2cSimRegisterDevice &sensorSim)
+{
+    uint8_t data[5] = {0xA1, 0xA2, 0xA3, 0xA4, 0xA5};
+    I2cStatus status = I2C_ERROR_HAL;
+
+    I2cTransaction write(TRANSACTION_TX, data, sizeof(data), &sensor, WRITE_REGISTER, REGISTER_8_BITS);
+    write.setTransferMode(I2C_TRANSFER_DIRECT);
+    write.setStatusOutput(&status);
+    write.send();
+    I2cSim::runUntilIdle();
+
+    I2C_CHECK_EQUAL(status, I2C_OK);
+    I2C_CHECK_EQUAL(sensorSim.getRegister(WRITE_REGISTER - 1), expectedRegister(WRITE_REGISTER - 1));
+    for(size_t i = 0; i < sizeof(data); i++)
+    {
+        I2C_CHECK_EQUAL(sensorSim.getRegister(WRITE_REGISTER + i), data[i]);
+    }
+    I2C_CHECK_EQUAL(sensorSim.getRegister(WRITE_REGISTER + sizeof(data)), expectedRegister(WRITE_REGISTER + sizeof(data)));
+}
+
+static void testNack(I2cDevice &sensor, I2cDevice &missing)
+{
+    uint8_t data[2] = {};
+    I2cStatus missingStatus = I2C_ERROR_HAL;
+    I2cStatus sensorStatus = I2C_ERROR_HAL;
+
+    I2cTransaction missed(TRANSACTION_RX, data, sizeof(data), &missing, 0, REGISTER_8_BITS);
+    missed.setTransferMode(I2C_TRANSFER_DIRECT);
+    missed.setStatusOutput(&missingStatus);
+    missed.send();
+
+    // The STOP after the NACK leaves the bus to the next transfer.
+    I2cTransaction read(TRANSACTION_RX, data, sizeof(data), &sensor, 0, REGISTER_8_BITS);
+    read.setTransferMode(I2C_TRANSFER_DIRECT);
+    read.setStatusOutput(&sensorStatus);
+    read.send();
+    I2cSim::runUntilIdle();
+
+    I2C_CHECK_EQUAL(missingStatus, I2C_ERROR_NACK);
+    I2C_CHECK_EQUAL(sensorStatus, I2C_OK);
+    I2C_CHECK_EQUAL(data[1], expectedRegister(1));
+}
+
+/*
+ *  Starts a direct read on the bus: it must not wait for the bus, not even a bit time.
+ */
+static void startRead(I2cDevice &sensor, uint8_t *data, I2cStatus &status)
+{
+    status = I2C_ERROR_HAL;
+
+    I2cTransaction read(TRANSACTION_RX, data, 2, &sensor, 2, REGISTER_8_BITS);
+    read.setTransferMode(I2C_TRANSFER_DIRECT);
+    read.setStatusOutput(&status);
+
+    uint64_t start = I2cSim::getTime();
+    I2C_CHECK_EQUAL(read.send(), I2C_OK);
+    I2C_CHECK(I2cSim::getTime() - start < 1000000000ULL / 400000);
+}
+
+/*
+ *  Nothing happens on the bus until its timeout ends the read.
+ */
+static void timeOut(I2cBus &bus, const I2cStatus &status, I2cStatus expected)
+{
+    I2cSim::runUntilIdle();
+    I2C_CHECK_EQUAL(status, I2C_ERROR_HAL);
+
+    I2cSim::advance(I2C_DEFAULT_TIMEOUT_MS * 1000000ULL);
+    bus.poll();
+    I2C_CHECK_EQUAL(status, expected);
+}
+
+static void testBusHeld(I2cBus &bus, I2cDevice &sensor)
+{
+    uint8_t data[2] = {};
+    I2cStatus status;
+
+    // A slave holds SDA until the recovery clocks it out: the START never goes out.
+    I2cSim::injectFault(I2C1, I2C_SIM_FAULT_STUCK_SDA, 3);
+    startRead(sensor, data, status);
+    I2C_CHECK(I2cSim::isSdaHeld(I2C1));
+
+    timeOut(bus, status, I2C_ERROR_TIMEOUT);
+    I2C_CHECK(!I2cSim::isSdaHeld(I2C1));
+
+    startRead(sensor, data, status);
+    I2cSim::runUntilIdle();
+    I2C_CHECK_EQUAL(status, I2C_OK);
+    I2C_CHECK_EQUAL(data[1], expectedRegister(3));
+}
+
+/*
+ *  Leaves SDA held for good, last.
+ */
+static void testBusStuck(I2cBus &bus, I2cDevice &sensor)
+{
+    uint8_t data[2] = {};
+    I2cStatus status;
+
+    I2cSim::injectFault(I2C1, I2C_SIM_FAULT_STUCK_SDA, I2C_SIM_HELD_FOREVER);
+    startRead(sensor, data, status);
+    timeOut(bus, status, I2C_ERROR_BUS_STUCK);
+
+    // Busy before the START is even set: started all the same, the timeout ends it again.
+    I2C_CHECK(I2cSim::isSdaHeld(I2C1));
+    startRead(sensor, data, status);
+    timeOut(bus, status, I2C_ERROR_BUS_STUCK);
+}
+
+int main(void)
+{
+    I2cSim::reset();
+
+    I2cSimRegisterDevice sensorSim(SENSOR_ADDRESS, 64);
+    for(uint16_t i = 0; i < 64; i++)
+    {
+        sensorSim.setRegister(i, expectedRegister(i));
+    }
+    I2cSim::attachDevice(I2C1, &sensorSim);
+
+    StaticQueue<I2cTransaction, 8> queue;
+    I2cBus bus("bus", &queue, I2C_BUS_1, 400000);
+
+    I2cDevice sensor(SENSOR_ADDRESS, &bus, "sensor");
+    I2cDevice missing(MISSING_ADDRESS, &bus, "missing");
+
+    testReceiveEndings(sensor, sensorSim);
+    testReadWithoutRegister(sensor, sensorSim);
+    testWrite(sensor, sensorSim);
+    testNack(sensor, missing);
+    testBusHeld(bus, sensor);
+    testBusStuck(bus, sensor);
+
+#if I2C_DRIVER_STATS
+    // The handlers were timed with the cycle clock, whichever engine ran.
+    I2C_CHECK(bus.getInterruptStats().getCount() > 0);
+#endif
+
+    return I2C_TEST_RESULT();
+}
@@ -0,0 +1,221 @@
+#include "i2c_sim.hpp"
+#include "i2c_bus.hpp"
+#include "i2c_device.hpp"
+#include "i2c_transaction_group.hpp"
+#include "queue.hpp"
+
+#include "i2c_test.hpp"
+
+/*
+ *  Transaction groups over the three buses: a single completion once the last member is done,
+ *  whichever bus finishes it, the first failure of the group and the status of each member.
+ */
+
+#define GROUP_READ_BYTES 6
+#define GROUP_READS 6
+
+static size_t groupCompletions = 0;
+static size_t memberCompletions = 0;
+
+static void groupDone(void* parameters)
+{
+    (void)parameters;
+    groupCompletions++;
+}
+
+static void memberDone(void* parameters)
+{
+    (void)parameters;
+    memberCompletions++;
+}
+
+/*
+ *  Reads register 0 of each device in turn, returns the simulated time the group took.
+ */
+static uint64_t runReads(I2cDevice* devices[], size_t deviceCount, uint8_t data[][GROUP_READ_BYTES])
+{
+    I2cTransactionGroup group;
+    group.setCompletionCallback(groupDone, nullptr);
+
+    for(size_t i = 0; i < GROUP_READS; i++)
+    {
+        I2cTransaction read(TRANSACTION_RX, data[i], GROUP_READ_BYTES, devices[i % deviceCount], 0, REGISTER_8_BITS);
+        read.setPostCallback(memberDone, nullptr);
+        I2C_CHECK_EQUAL(group.add(read), I2C_OK);
+    }
+
+    groupCompletions = 0;
+    memberCompletions = 0;
+
+    uint64_t start = I2cSim::getTime();
+    I2C_CHECK_EQUAL(group.start(), I2C_OK);
+    I2cSim::runUntilIdle();
+    uint64_t elapsed = I2cSim::getTime() - start;
+
+    I2C_CHECK(group.isComplete());
+    I2C_CHECK_EQUAL(group.getStatus(), I2C_OK);
+    I2C_CHECK_EQUAL(groupCompletions, 1);
+    I2C_CHECK_EQUAL(memberCompletions, GROUP_READS);
+    I2C_CHECK(group.getDuration() > 0);
+
+    for(size_t i = 0; i < GROUP_READS; i++)
+    {
+        I2C_CHECK_EQUAL(group.getStatus(i), I2C_OK);
+    }
+
+    return elapsed;
+}
+
+static void testAcrossBuses(I2cDevice* serial[], I2cDevice* spread[])
+{
+    uint8_t data[GROUP_READS][GROUP_READ_BYTES] = {};
+
+    uint64_t serialTime = runReads(serial, 3, data);
+    uint64_t spreadTime = runReads(spread, 3, data);
+
+    // Each bus reads its own device, two reads each instead of six in a row.
+    for(size_t i = 0; i < GROUP_READS; i++)
+    {
+        I2C_CHECK_EQUAL(data[i][0], 0x10 * (i % 3 + 1));
+    }
+
+    I2C_CHECK(spreadTime * 2 < serialTime);
+}
+
+static void testFailures(I2cDevice &first, I2cDevice &missing, I2cDevice &lone)
+{
+    uint8_t data[3];
+    I2cTransactionGroup group;
+    group.setCompletionCallback(groupDone, nullptr);
+
+    I2C_CHECK_EQUAL(group.add(I2cTransaction(TRANSACTION_RX, &data[0], 1, &first, 0, REGISTER_8_BITS)), I2C_OK);
+    I2C_CHECK_EQUAL(group.add(I2cTransaction(TRANSACTION_RX, &data[1], 1, &missing, 0, REGISTER_8_BITS)), I2C_OK);
+    I2C_CHECK_EQUAL(group.add(I2cTransaction(TRANSACTION_RX, &data[2], 1, &lone, 0, REGISTER_8_BITS)), I2C_OK);
+
+    groupCompletions = 0;
+    I2C_CHECK_EQUAL(group.start(), I2C_OK);
+
+    // The member without a bus is finished by start(), the others are still on their buses.
+    I2C_CHECK(!group.isComplete());
+    I2C_CHECK_EQUAL(group.getStatus(2), I2C_ERROR_NO_BUS);
+    I2C_CHECK_EQUAL(group.getStatus(), I2C_ERROR_NO_BUS);
+
+    I2cSim::runUntilIdle();
+
+    I2C_CHECK(group.isComplete());
+    I2C_CHECK_EQUAL(groupCompletions, 1);
+    I2C_CHECK_EQUAL(group.getStatus(0), I2C_OK);
+    I2C_CHECK_EQUAL(group.getStatus(1), I2C_ERROR_NACK);
+    I2C_CHECK_EQUAL(group.getStatus(2), I2C_ERROR_NO_BUS);
+    I2C_CHECK_EQUAL(group.getStatus(3), I2C_ERROR_NO_DEVICE);
+
+    // The first failure stays, the later NACK doesn't replace it.
+    I2C_CHECK_EQUAL(group.getStatus(), I2C_ERROR_NO_BUS);
+}
+
+static void testQueueFull(I2cDevice &first, I2cDevice &second)
+{
+    uint8_t data[2];
+    I2cTransactionGroup group;
+    group.setCompletionCallback(groupDone, nullptr);
+    group.add(I2cTransaction(TRANSACTION_RX, &data[0], 1, &first, 0, REGISTER_8_BITS));
+    group.add(I2cTransaction(TRANSACTION_RX, &data[1], 1, &second, 0, REGISTER_8_BITS));
+
+    uint8_t fill[8];
+    for(size_t i = 0; i < sizeof(fill); i++)
+    {
+        I2C_CHECK_EQUAL(I2C_STATUS_OF(I2cTransaction(TRANSACTION_RX, &fill[i], 1, &second, 0, REGISTER_8_BITS).send()), I2C_OK);
+    }
+
+    groupCompletions = 0;
+    I2C_CHECK_EQUAL(group.start(), I2C_OK);
+    I2cSim::runUntilIdle();
+
+    I2C_CHECK(group.isComplete());
+    I2C_CHECK_EQUAL(groupCompletions, 1);
+    I2C_CHECK_EQUAL(group.getStatus(0), I2C_OK);
+    I2C_CHECK_EQUAL(group.getStatus(1), I2C_ERROR_QUEUE_FULL);
+    I2C_CHECK_EQUAL(group.getStatus(), I2C_ERROR_QUEUE_FULL);
+}
+
+static void testBusy(I2cDevice &first, I2cDevice &second)
+{
+    uint8_t data[3];
+    I2cTransactionGroup group;
+
+    I2C_CHECK_EQUAL(I2C_STATUS_OF(group.start()), I2C_ERROR_GROUP_EMPTY);
+
+    // Transactions built from an address have no bus to be queued on.
+    uint16_t address = first.getAddress();
+    I2C_CHECK_EQUAL(I2C_STATUS_OF(group.add(I2cTransaction(TRANSACTION_RX, &data[0], 1, address, 0, REGISTER_8_BITS))), I2C_ERROR_NO_DEVICE);
+
+    group.add(I2cTransaction(TRANSACTION_RX, &data[0], 1, &first, 0, REGISTER_8_BITS));
+    group.add(I2cTransaction(TRANSACTION_RX, &data[1], 1, &second, 0, REGISTER_8_BITS));
+    I2C_CHECK_EQUAL(group.start(), I2C_OK);
+
+    // Nothing changes while the members are on the buses.
+    I2C_CHECK_EQUAL(I2C_STATUS_OF(group.start()), I2C_ERROR_GROUP_BUSY);
+    I2C_CHECK_EQUAL(I2C_STATUS_OF(group.add(I2cTransaction(TRANSACTION_RX, &data[2], 1, &first, 0, REGISTER_8_BITS))), I2C_ERROR_GROUP_BUSY);
+    group.clear();
+    I2C_CHECK_EQUAL(group.size(), 2);
+
+    I2cSim::runUntilIdle();
+
+    // A complete group starts again with the same members.
+    I2C_CHECK(group.isComplete());
+    I2C_CHECK_EQUAL(group.start(), I2C_OK);
+    I2cSim::runUntilIdle();
+    I2C_CHECK(group.isComplete());
+    I2C_CHECK_EQUAL(group.getStatus(), I2C_OK);
+
+    group.clear();
+    I2C_CHECK_EQUAL(group.size(), 0);
+}
+
+int main(void)
+{
+    I2cSim::reset();
+
+    StaticQueue<I2cTransaction, 8> queue1;
+    StaticQueue<I2cTransaction, 8> queue2;
+    StaticQueue<I2cTransaction, 8> queue3;
+    I2cBus bus1("bus1", &queue1, I2C_BUS_1, 400000);
+    I2cBus bus2("bus2", &queue2, I2C_BUS_2, 400000);
+    I2cBus bus3("bus3", &queue3, I2C_BUS_3, 400000);
+
+    // The same registers, on three buses and then all on the first one.
+    I2cSimRegisterDevice spreadSims[3] = {
+        I2cSimRegisterDevice(0x40, 16, 1),
+        I2cSimRegisterDevice(0x41, 16, 1),
+        I2cSimRegisterDevice(0x42, 16, 1)
+    };
+    I2cSimRegisterDevice serialSims[3] = {
+        I2cSimRegisterDevice(0x50, 16, 1),
+        I2cSimRegisterDevice(0x51, 16, 1),
+        I2cSimRegisterDevice(0x52, 16, 1)
+    };
+
+    I2C_TypeDef* instances[3] = {I2C1, I2C2, I2C3};
+    for(size_t i = 0; i < 3; i++)
+    {
+        spreadSims[i].setRegister(0, 0x10 * (i + 1));
+        serialSims[i].setRegister(0, 0x10 * (i + 1));
+        I2cSim::attachDevice(instances[i], &spreadSims[i]);
+        I2cSim::attachDevice(I2C1, &serialSims[i]);
+    }
+
+    I2cDevice spreadDevices[3] = {I2cDevice(0x40, &bus1), I2cDevice(0x41, &bus2), I2cDevice(0x42, &bus3)};
+    I2cDevice serialDevices[3] = {I2cDevice(0x50, &bus1), I2cDevice(0x51, &bus1), I2cDevice(0x52, &bus1)};
+    I2cDevice* spread[3] = {&spreadDevices[0], &spreadDevices[1], &spreadDevices[2]};
+    I2cDevice* serial[3] = {&serialDevices[0], &serialDevices[1], &serialDevices[2]};
+
+    I2cDevice missing(0x60, &bus3);
+    I2cDevice lone(0x61);
+
+    testAcrossBuses(serial, spread);
+    testFailures(spreadDevices[0], missing, lone);
+    testQueueFull(spreadDevices[0], spreadDevices[1]);
+    testBusy(spreadDevices[0], spreadDevices[1]);
+
+    return I2C_TEST_RESULT();
+}
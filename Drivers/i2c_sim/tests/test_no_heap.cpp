@@ -0,0 +1,175 @@
+#include "i2c_sim.hpp"
+#include "i2c_sim_ads1115.hpp"
+#include "i2c_bus.hpp"
+#include "i2c_device.hpp"
+#include "i2c_task.hpp"
+#include "ads1115.hpp"
+#include "queue.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "i2c_test.hpp"
+
+/*
+ *  Nothing of the driver allocates from the heap: constructing the buses and devices, queueing and
+ *  completing transactions, coroutines and the errors they raise. Every operator new of the process
+ *  is counted; on target the same is checked through sbrk_get_calls().
+ *
+ *  The exception object itself is allocated by the C++ runtime with malloc() when exceptions are
+ *  enabled, the count doesn't include it (see I2C_DRIVER_EXCEPTIONS).
+ */
+
+#define SENSOR_ADDRESS 0x48
+
+static size_t allocations = 0;
+
+void* operator new(size_t size)
+{
+    allocations++;
+
+    // Built without exceptions too: running out of memory ends the test.
+    void* memory = malloc(size ? size : 1);
+    if(!memory)
+        abort();
+
+    return memory;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void* memory, size_t size) noexcept
+{
+    (void)size;
+    free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void* memory, size_t size) noexcept
+{
+    (void)size;
+    free(memory);
+}
+
+static void runTransactions(I2cBus &bus, I2cDevice &sensor)
+{
+    uint8_t data[4];
+    size_t before = allocations;
+
+    for(size_t i = 0; i < 50; i++)
+    {
+        I2cTransaction read(TRANSACTION_RX, data, sizeof(data), &sensor, 0, REGISTER_8_BITS);
+        read.send();
+
+        uint8_t value = static_cast<uint8_t>(i);
+        I2cTransaction write(TRANSACTION_TX, &value, 1, &sensor, 1, REGISTER_8_BITS);
+        write.send();
+
+        I2cSim::runUntilIdle();
+        bus.poll();
+    }
+
+    I2C_CHECK_EQUAL(allocations - before, 0);
+}
+
+static bool taskDone = false;
+
+static I2cTask readTwice(I2cDevice &sensor)
+{
+    uint8_t data[2];
+
+    co_await sensor.read(data, sizeof(data), 0, REGISTER_8_BITS);
+    co_await sensor.read(data, sizeof(data), 2, REGISTER_8_BITS);
+
+    taskDone = true;
+}
+
+static void testTask(I2cDevice &sensor)
+{
+    size_t before = allocations;
+
+    // The frame comes from the pool of the scheduler.
+    I2C_CHECK_EQUAL(I2cScheduler::spawn(readTwice(sensor)), I2C_OK);
+    for(size_t i = 0; i < 10 && !taskDone; i++)
+    {
+        I2cScheduler::run();
+        I2cSim::runUntilIdle();
+    }
+
+    I2C_CHECK(taskDone);
+    I2C_CHECK_EQUAL(allocations - before, 0);
+}
+
+static void testAdc(I2cBus &bus, Ads1115 &adc)
+{
+    size_t before = allocations;
+
+    I2C_CHECK_EQUAL(adc.startContinuous(ADS1115_MUX_AIN0_GND, ADS1115_RANGE_2_048V, 100), I2C_OK);
+
+    uint64_t start = I2cSim::getTime();
+    while(I2cSim::getTime() - start < 100000000ULL)
+    {
+        I2cSim::advance(20000);
+        bus.poll();
+        adc.poll();
+    }
+
+    adc.stop();
+    I2cSim::runUntilIdle();
+
+    I2C_CHECK(adc.getChannel(0)->samples > 0);
+    I2C_CHECK_EQUAL(allocations - before, 0);
+}
+
+static void testErrors(I2cDevice &sensor)
+{
+    size_t before = allocations;
+
+    // The message is a literal, nothing is formatted.
+    uint8_t data[1];
+    I2C_CHECK_EQUAL(I2C_STATUS_OF(I2cTransaction(TRANSACTION_RX, data, 1, &sensor, 1, REGISTER_NULL).getStatus()), I2C_ERROR_INVALID_REGISTER);
+    I2C_CHECK(strcmp(i2cStatusMessage(I2C_ERROR_INVALID_REGISTER), "") != 0);
+
+    I2C_CHECK_EQUAL(allocations - before, 0);
+}
+
+int main(void)
+{
+    I2cSim::reset();
+
+    I2cSimRegisterDevice sensorSim(SENSOR_ADDRESS, 16);
+    I2cSimAds1115 adcSim;
+    adcSim.setInputVoltage(0, 1.0);
+    I2cSim::attachDevice(I2C1, &sensorSim);
+    I2cSim::attachDevice(I2C1, &adcSim);
+
+    size_t before = allocations;
+
+    // Names longer than I2C_NAME_LENGTH are cut, not allocated.
+    StaticQueue<I2cTransaction, 8> queue;
+    I2cBus bus("a rather long bus name", &queue, I2C_BUS_1, 400000);
+    I2cDevice sensor(SENSOR_ADDRESS, &bus, "a rather long device name");
+    Ads1115 adc(&bus);
+
+    I2C_CHECK_EQUAL(allocations - before, 0);
+    I2C_CHECK_EQUAL(strlen(bus.getName()), I2C_NAME_LENGTH);
+
+    runTransactions(bus, sensor);
+    testTask(sensor);
+    testAdc(bus, adc);
+    testErrors(sensor);
+
+    return I2C_TEST_RESULT();
+}
@@ -0,0 +1,157 @@
+#include "i2c_sim.hpp"
+#include "i2c_bus.hpp"
+#include "i2c_device.hpp"
+#include "i2c_periodic.hpp"
+#include "queue.hpp"
+
+#include "i2c_test.hpp"
+
+/*
+ *  Periodic table ticked by the simulated TIM2: sampling periods and jitter recorded by the
+ *  completions, and the overruns of samples still pending or that don't fit the queue.
+ */
+
+#define SENSOR_ADDRESS 0x48
+#define OTHER_ADDRESS 0x49
+#define SENSOR_REGISTERS 64
+
+#define TICK_HZ 1000
+#define TICK_NS (1000000000ULL / TICK_HZ)
+
+/*
+ *  Cycles of the cycle clock in a simulated time (see I2cSim::getCycles).
+ */
+static uint32_t toCycles(uint64_t nanoseconds)
+{
+    return static_cast<uint32_t>(nanoseconds * (I2C_SIM_CORE_CLOCK / 1000000) / 1000);
+}
+
+static void testPeriods(I2cDevice &sensor, I2cDevice &other)
+{
+    uint8_t sensorData[2] = {};
+    uint8_t otherData[2] = {};
+
+    // Every sixth tick both are due: the second one waits for the transfer of the first.
+    I2cPeriodicTable table(TICK_HZ);
+    I2C_CHECK_EQUAL(table.add(&sensor, 4, REGISTER_8_BITS, sensorData, 2, 2), I2C_OK);
+    I2C_CHECK_EQUAL(table.add(&other, 8, REGISTER_8_BITS, otherData, 2, 3), I2C_OK);
+    I2C_CHECK_EQUAL(table.start(), I2C_OK);
+
+    I2cSim::advance(21 * TICK_NS + TICK_NS / 2);
+    table.stop();
+
+    uint32_t transfer = toCycles(I2cSim::getTransferTime(400000, 1, 2, true));
+
+    // Samples at 2, 4 ... 20 ms: always the same distance apart.
+    const I2cPeriodicStats *sensorStats = table.getStats(0);
+    I2C_CHECK_EQUAL(sensorStats->period.getCount(), 9);
+    I2C_CHECK_EQUAL(sensorStats->period.getMin(), toCycles(2 * TICK_NS));
+    I2C_CHECK_EQUAL(sensorStats->period.getMax(), toCycles(2 * TICK_NS));
+    I2C_CHECK_EQUAL(sensorStats->jitter, 0);
+    I2C_CHECK_EQUAL(sensorStats->overruns, 0);
+    I2C_CHECK_EQUAL(sensorStats->errors, 0);
+
+    // Samples at 3, 6 ... 21 ms, the ones at 6, 12 and 18 ms a transfer late.
+    const I2cPeriodicStats *otherStats = table.getStats(1);
+    I2C_CHECK_EQUAL(otherStats->period.getCount(), 6);
+    I2C_CHECK_EQUAL(otherStats->period.getMin(), toCycles(3 * TICK_NS) - transfer);
+    I2C_CHECK_EQUAL(otherStats->period.getMax(), toCycles(3 * TICK_NS) + transfer);
+    I2C_CHECK_EQUAL(otherStats->period.getMean(), toCycles(3 * TICK_NS));
+    I2C_CHECK_EQUAL(otherStats->jitter, transfer);
+    I2C_CHECK_EQUAL(otherStats->overruns, 0);
+
+    I2C_CHECK_EQUAL(table.getStatus(0), I2C_OK);
+    I2C_CHECK_EQUAL(sensorData[0], 0x20 + 4);
+    I2C_CHECK_EQUAL(otherData[1], 0x20 + 9);
+    I2C_CHECK(table.getStats(2) == nullptr);
+}
+
+static void testPendingOverruns(I2cDevice &sensor)
+{
+    uint8_t data[SENSOR_REGISTERS] = {};
+
+    // Longer than a tick: every other tick finds the previous sample still pending.
+    I2C_CHECK(I2cSim::getTransferTime(400000, 1, sizeof(data), true) > TICK_NS);
+
+    I2cPeriodicTable table(TICK_HZ);
+    I2C_CHECK_EQUAL(table.add(&sensor, 0, REGISTER_8_BITS, data, sizeof(data), 1), I2C_OK);
+    I2C_CHECK_EQUAL(table.start(), I2C_OK);
+
+    I2cSim::advance(10 * TICK_NS + TICK_NS / 2);
+    table.stop();
+    I2cSim::runUntilIdle();
+
+    const I2cPeriodicStats *stats = table.getStats(0);
+    I2C_CHECK_EQUAL(stats->overruns, 5);
+    I2C_CHECK_EQUAL(stats->period.getCount(), 4);
+    I2C_CHECK_EQUAL(stats->period.getMin(), toCycles(2 * TICK_NS));
+    I2C_CHECK_EQUAL(stats->jitter, toCycles(TICK_NS));
+    I2C_CHECK_EQUAL(data[SENSOR_REGISTERS - 1], 0x20 + SENSOR_REGISTERS - 1);
+}
+
+static void testQueueFull(I2cDevice &sensor, I2cDevice &other)
+{
+    uint8_t blocking[SENSOR_REGISTERS];
+    uint8_t filler[2][2];
+    uint8_t data[2] = {};
+
+    // The bus is held past the first tick and the class queue is full by then.
+    I2cTransaction hold(TRANSACTION_RX, blocking, sizeof(blocking), &sensor, 0, REGISTER_8_BITS);
+    I2C_CHECK_EQUAL(hold.send(), I2C_OK);
+
+    other.setPriority(I2C_PRIORITY_HIGH);
+    for(uint8_t (&buffer)[2] : filler)
+    {
+        I2cTransaction transaction(TRANSACTION_RX, buffer, 2, &other, 0, REGISTER_8_BITS);
+        I2C_CHECK_EQUAL(transaction.send(), I2C_OK);
+    }
+    other.setPriority(I2C_PRIORITY_NORMAL);
+
+    I2cPeriodicTable table(TICK_HZ);
+    I2C_CHECK_EQUAL(table.add(&other, 2, REGISTER_8_BITS, data, 2, 1), I2C_OK);
+    I2C_CHECK_EQUAL(table.start(), I2C_OK);
+
+    // The first tick is an overrun, the sample isn't left pending: the next ones go out.
+    I2cSim::advance(TICK_NS + TICK_NS / 2);
+    I2C_CHECK_EQUAL(table.getStats(0)->overruns, 1);
+
+    I2cSim::advance(2 * TICK_NS);
+    table.stop();
+    I2cSim::runUntilIdle();
+
+    const I2cPeriodicStats *stats = table.getStats(0);
+    I2C_CHECK_EQUAL(stats->overruns, 1);
+    I2C_CHECK_EQUAL(stats->period.getCount(), 1);
+    I2C_CHECK_EQUAL(stats->period.getMax(), toCycles(TICK_NS));
+    I2C_CHECK_EQUAL(data[0], 0x20 + 2);
+}
+
+int main(void)
+{
+    I2cSim::reset();
+
+    I2cSimRegisterDevice sensorSim(SENSOR_ADDRESS, SENSOR_REGISTERS);
+    I2cSimRegisterDevice otherSim(OTHER_ADDRESS, SENSOR_REGISTERS);
+    for(uint16_t i = 0; i < SENSOR_REGISTERS; i++)
+    {
+        sensorSim.setRegister(i, 0x20 + i);
+        otherSim.setRegister(i, 0x20 + i);
+    }
+    I2cSim::attachDevice(I2C1, &sensorSim);
+    I2cSim::attachDevice(I2C1, &otherSim);
+
+    // The table class gets a queue of its own (see I2cPeriodicTable).
+    StaticQueue<I2cTransaction, 8> queue;
+    StaticQueue<I2cTransaction, 2> periodicQueue;
+    I2cBus bus("bus", &queue, I2C_BUS_1, 400000);
+    I2C_CHECK_EQUAL(bus.setPriorityQueue(I2C_PRIORITY_HIGH, &periodicQueue), I2C_OK);
+
+    I2cDevice sensor(SENSOR_ADDRESS, &bus, "sensor");
+    I2cDevice other(OTHER_ADDRESS, &bus, "other");
+
+    testPeriods(sensor, other);
+    testPendingOverruns(sensor);
+    testQueueFull(sensor, other);
+
+    return I2C_TEST_RESULT();
+}
@@ -0,0 +1,224 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <thread>
+
+#include "queue.hpp"
+#include "i2c_transaction.hpp"
+
+#include "i2c_test.hpp"
+
+/*
+ *  The queues behind the bus: FIFO order, bounds, in place slots, the SPSC ring under a real
+ *  concurrent producer and consumer, and the cost of an enqueue/dequeue pair of each queue.
+ */
+
+#define STRESS_ELEMENTS 200000
+
+#define BENCHMARK_PAIRS 1000000
+
+// Size of a transaction on target (see I2cTransaction).
+typedef struct
+{
+    uint32_t words[I2C_TRANSACTION_TARGET_BYTES / sizeof(uint32_t)];
+}
+BenchmarkElement;
+
+static void testFifo(Queue<uint32_t> &queue)
+{
+    I2C_CHECK(queue.isEmpty());
+    I2C_CHECK(!queue.hasData());
+
+    uint32_t value = 0;
+    I2C_CHECK(!queue.dequeue(value));
+    I2C_CHECK(queue.peek() == nullptr);
+
+    // Several laps, so the indexes wrap around the buffer.
+    uint32_t next = 0;
+    uint32_t expected = 0;
+    for(size_t lap = 0; lap < 3 * queue.capacity(); lap++)
+    {
+        while(!queue.isFull())
+        {
+            I2C_CHECK(queue.enqueue(next++));
+        }
+
+        I2C_CHECK_EQUAL(queue.size(), queue.capacity());
+        I2C_CHECK(!queue.enqueue(next));
+
+        I2C_CHECK_EQUAL(*queue.peek(), expected);
+        I2C_CHECK_EQUAL(*queue.peek(queue.capacity() - 1), expected + queue.capacity() - 1);
+        I2C_CHECK(queue.peek(queue.capacity()) == nullptr);
+
+        // Drain part of it only, the next lap starts from another position.
+        for(size_t i = 0; i <= lap % queue.capacity(); i++)
+        {
+            I2C_CHECK(queue.dequeue(value));
+            I2C_CHECK_EQUAL(value, expected++);
+        }
+    }
+
+    while(queue.dequeue(value))
+    {
+        I2C_CHECK_EQUAL(value, expected++);
+    }
+
+    I2C_CHECK_EQUAL(expected, next);
+    I2C_CHECK_EQUAL(queue.size(), 0);
+}
+
+static void testInPlace(Queue<uint32_t> &queue)
+{
+    uint32_t *slot = queue.acquire();
+    I2C_CHECK(slot != nullptr);
+
+    // Not visible until published, acquiring again gives the same slot.
+    *slot = 7;
+    I2C_CHECK(queue.isEmpty());
+    I2C_CHECK(queue.acquire() == slot);
+
+    queue.publish();
+    I2C_CHECK_EQUAL(queue.size(), 1);
+    I2C_CHECK(queue.peek() == slot);
+
+    // Completed in place: the consumer works on the slot and only then frees it.
+    *queue.peek() = 8;
+    I2C_CHECK(queue.pop());
+    I2C_CHECK(queue.isEmpty());
+    I2C_CHECK(!queue.pop());
+
+    while(!queue.isFull())
+    {
+        queue.acquire();
+        queue.publish();
+    }
+
+    I2C_CHECK(queue.acquire() == nullptr);
+
+    while(queue.pop());
+}
+
+static void testReferences(void)
+{
+    ReferenceQueue<uint32_t, 4> queue;
+    uint32_t elements[5] = {1, 2, 3, 4, 5};
+
+    I2C_CHECK(!queue.enqueue(elements[0]));
+    I2C_CHECK(queue.acquire() == nullptr);
+
+    for(size_t i = 0; i < 4; i++)
+    {
+        I2C_CHECK(queue.link(elements[i]));
+    }
+
+    I2C_CHECK(queue.isFull());
+    I2C_CHECK(!queue.link(elements[4]));
+
+    // The queue holds the elements themselves.
+    I2C_CHECK(queue.peek() == &elements[0]);
+    I2C_CHECK(queue.peek(3) == &elements[3]);
+    elements[1] = 20;
+
+    uint32_t value = 0;
+    I2C_CHECK(queue.dequeue(value));
+    I2C_CHECK_EQUAL(value, 1);
+    I2C_CHECK(queue.dequeue(value));
+    I2C_CHECK_EQUAL(value, 20);
+    I2C_CHECK(queue.pop());
+    I2C_CHECK(queue.pop());
+    I2C_CHECK(queue.isEmpty());
+}
+
+static void testSpscStress(void)
+{
+    static SpscQueue<uint32_t, 16> queue;
+
+    std::thread producer([]()
+    {
+        for(uint32_t i = 0; i < STRESS_ELEMENTS; i++)
+        {
+            // Yields instead of spinning, the test may share a single core.
+            while(!queue.enqueue(i))
+                std::this_thread::yield();
+        }
+    });
+
+    // Any slot seen before its contents were published would break the sequence.
+    uint32_t expected = 0;
+    uint32_t outOfOrder = 0;
+    while(expected < STRESS_ELEMENTS)
+    {
+        uint32_t value;
+        if(!queue.dequeue(value))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        if(value != expected)
+            outOfOrder++;
+
+        expected++;
+    }
+
+    producer.join();
+
+    I2C_CHECK_EQUAL(outOfOrder, 0);
+    I2C_CHECK(queue.isEmpty());
+}
+
+/*
+ *  Enqueue/dequeue pairs through the Queue interface, as the bus uses it. Only printed, the figures
+ *  depend on the host and the build type (configure with -DCMAKE_BUILD_TYPE=Release to compare).
+ */
+static double benchmarkQueue(Queue<BenchmarkElement> &queue)
+{
+    BenchmarkElement element = {};
+    uint32_t checksum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for(uint32_t i = 0; i < BENCHMARK_PAIRS; i++)
+    {
+        element.words[0] = i;
+        queue.enqueue(element);
+        queue.dequeue(element);
+        checksum += element.words[0];
+    }
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    // Every element came back, and the loop can't be optimized away.
+    I2C_CHECK_EQUAL(checksum, static_cast<uint32_t>(static_cast<uint64_t>(BENCHMARK_PAIRS) * (BENCHMARK_PAIRS - 1) / 2));
+
+    return std::chrono::duration<double, std::nano>(elapsed).count() / BENCHMARK_PAIRS;
+}
+
+static void testBenchmark(void)
+{
+    static StaticQueue<BenchmarkElement, 16> staticQueue;
+    static SpscQueue<BenchmarkElement, 16> spscQueue;
+
+    double staticNanoseconds = benchmarkQueue(staticQueue);
+    double spscNanoseconds = benchmarkQueue(spscQueue);
+
+    printf("%zu byte element, %d enqueue/dequeue pairs:\n", sizeof(BenchmarkElement), BENCHMARK_PAIRS);
+    printf("  StaticQueue: %6.2f ns/op\n", staticNanoseconds);
+    printf("  SpscQueue:   %6.2f ns/op\n", spscNanoseconds);
+}
+
+int main(void)
+{
+    StaticQueue<uint32_t, 5> staticQueue;
+    SpscQueue<uint32_t, 8> spscQueue;
+
+    testFifo(staticQueue);
+    testFifo(spscQueue);
+    testInPlace(staticQueue);
+    testInPlace(spscQueue);
+    testReferences();
+    testSpscStress();
+    testBenchmark();
+
+    return I2C_TEST_RESULT();
+}
@@ -0,0 +1,163 @@
+#include "i2c_sim.hpp"
+#include "i2c_bus.hpp"
+#include "i2c_device.hpp"
+#include "queue.hpp"
+
+#include "i2c_test.hpp"
+
+/*
+ *  Bus recovery after a transfer error: flagged by the error interrupt, run from the main loop,
+ *  with the SCL pulses it clocks and the time it takes.
+ */
+
+#define SENSOR_ADDRESS 0x48
+#define SENSOR_REGISTERS 16
+
+#define SCL_FREQUENCY 400000
+
+// Pulses the recovery gives a slave holding SDA before reporting the bus as stuck.
+#define RECOVERY_PULSES 9
+
+/*
+ *  Time the recovery holds the pins for: SCL and SDA released, the pulses, then the STOP. Every
+ *  pin change waits half a bit.
+ */
+static uint64_t getRecoveryTime(uint32_t pulses)
+{
+    return (2 + 2 * pulses + 4) * (1000000000ULL / SCL_FREQUENCY / 2);
+}
+
+typedef struct
+{
+    I2cStatus status;
+    uint32_t completions;
+}
+ReadResult;
+
+static void readDone(void* parameters)
+{
+    static_cast<ReadResult*>(parameters)->completions++;
+}
+
+static void queueRead(I2cDevice &sensor, uint8_t *data, ReadResult &result)
+{
+    result = {I2C_ERROR_HAL, 0};
+
+    I2cTransaction transaction(TRANSACTION_RX, data, 2, &sensor, 4, REGISTER_8_BITS);
+    transaction.setStatusOutput(&result.status);
+    transaction.setPostCallback(readDone, &result);
+    I2C_CHECK_EQUAL(transaction.send(), I2C_OK);
+}
+
+/*
+ *  Recovers from a fault on the first of two reads, the second one must go through after it.
+ */
+static void checkFault(I2cBus &bus, I2cDevice &sensor, I2cSimFault fault, I2cStatus expected)
+{
+    uint8_t data[2][2] = {};
+    ReadResult results[2];
+
+    I2cSim::injectFault(I2C1, fault);
+    queueRead(sensor, data[0], results[0]);
+    queueRead(sensor, data[1], results[1]);
+    I2cSim::runUntilIdle();
+
+    // The error interrupt only flags the recovery, nothing else goes out meanwhile.
+    I2C_CHECK_EQUAL(results[0].completions, 0);
+    I2C_CHECK(!I2cSim::isBusy(I2C1));
+
+    uint64_t pulses = I2cSim::getStats(I2C1).sclPulses;
+    uint64_t start = I2cSim::getTime();
+    I2C_CHECK(bus.runRecovery());
+    I2C_CHECK(!I2cSim::areInterruptsMasked());
+
+    // SDA was never held: no pulse before the STOP.
+    I2C_CHECK_EQUAL(I2cSim::getStats(I2C1).sclPulses - pulses, 1);
+    I2C_CHECK_EQUAL(I2cSim::getTime() - start, getRecoveryTime(0));
+    I2C_CHECK_EQUAL(results[0].completions, 1);
+    I2C_CHECK_EQUAL(results[0].status, expected);
+
+    I2C_CHECK(!bus.runRecovery());
+    I2cSim::runUntilIdle();
+    I2C_CHECK_EQUAL(results[1].status, I2C_OK);
+    I2C_CHECK_EQUAL(data[1][0], 0x60 + 4);
+}
+
+/*
+ *  A slave holds SDA through the next transfer, which never ends: the timeout recovers the bus.
+ */
+static void checkStuckSda(I2cBus &bus, I2cDevice &sensor, uint8_t heldPulses, I2cStatus expected)
+{
+    uint8_t data[2] = {};
+    ReadResult result;
+
+    I2cSim::injectFault(I2C1, I2C_SIM_FAULT_STUCK_SDA, heldPulses);
+    queueRead(sensor, data, result);
+    I2C_CHECK(I2cSim::isSdaHeld(I2C1));
+
+    I2cSim::advance((I2C_DEFAULT_TIMEOUT_MS - 1) * 1000000ULL);
+    bus.poll();
+    I2C_CHECK_EQUAL(result.completions, 0);
+    I2cSim::advance(1000000ULL);
+
+    uint64_t pulses = I2cSim::getStats(I2C1).sclPulses;
+    uint64_t start = I2cSim::getTime();
+    bus.poll();
+
+    uint32_t clocked = heldPulses == I2C_SIM_HELD_FOREVER ? RECOVERY_PULSES : heldPulses;
+    I2C_CHECK_EQUAL(I2cSim::getStats(I2C1).sclPulses - pulses, clocked + 1);
+    I2C_CHECK_EQUAL(I2cSim::getTime() - start, getRecoveryTime(clocked));
+    I2C_CHECK_EQUAL(result.completions, 1);
+    I2C_CHECK_EQUAL(result.status, expected);
+    I2C_CHECK_EQUAL(I2cSim::isSdaHeld(I2C1), heldPulses == I2C_SIM_HELD_FOREVER);
+}
+
+static void testFaults(I2cBus &bus, I2cDevice &sensor)
+{
+    checkFault(bus, sensor, I2C_SIM_FAULT_BUS_ERROR, I2C_ERROR_BUS_FAULT);
+    checkFault(bus, sensor, I2C_SIM_FAULT_ARBITRATION_LOST, I2C_ERROR_ARBITRATION_LOST);
+    checkFault(bus, sensor, I2C_SIM_FAULT_OVERRUN, I2C_ERROR_OVERRUN);
+}
+
+static void testStuckSda(I2cBus &bus, I2cDevice &sensor)
+{
+    // Released by the third pulse: the transfer still timed out, the bus works again.
+    checkStuckSda(bus, sensor, 3, I2C_ERROR_TIMEOUT);
+
+    uint8_t data[2] = {};
+    ReadResult result;
+    queueRead(sensor, data, result);
+    I2cSim::runUntilIdle();
+    I2C_CHECK_EQUAL(result.status, I2C_OK);
+
+    // Never released: the recovery gives up after its pulses.
+    checkStuckSda(bus, sensor, I2C_SIM_HELD_FOREVER, I2C_ERROR_BUS_STUCK);
+
+#if I2C_DRIVER_STATS
+    // The three faults and the two timeouts.
+    I2C_CHECK_EQUAL(bus.getRecoveryStats().getCount(), 5);
+#endif
+}
+
+int main(void)
+{
+    I2cSim::reset();
+
+    I2cSimRegisterDevice sensorSim(SENSOR_ADDRESS, SENSOR_REGISTERS);
+    for(uint16_t i = 0; i < SENSOR_REGISTERS; i++)
+    {
+        sensorSim.setRegister(i, 0x60 + i);
+    }
+    I2cSim::attachDevice(I2C1, &sensorSim);
+
+    StaticQueue<I2cTransaction, 8> queue;
+    I2cBus bus("bus", &queue, I2C_BUS_1, SCL_FREQUENCY);
+    I2C_CHECK_EQUAL(bus.getStatus(), I2C_OK);
+
+    I2cDevice sensor(SENSOR_ADDRESS, &bus, "sensor");
+
+    testFaults(bus, sensor);
+    testStuckSda(bus, sensor);
+
+    return I2C_TEST_RESULT();
+}
@@ -0,0 +1,201 @@
+#include <string.h>
+
+#include "i2c_sim.hpp"
+#include "i2c_bus.hpp"
+#include "i2c_register_file.hpp"
+#include "queue.hpp"
+
+#include "i2c_test.hpp"
+
+/*
+ *  Register files served in slave mode to the external master of the simulation: the slave
+ *  configuration handed to the HAL, host writes and reads through the pointer, and the pointer
+ *  wrapping around the end of the memory.
+ */
+
+#define OWN_ADDRESS 0x30
+#define DUAL_ADDRESS_1 0x32
+#define DUAL_ADDRESS_2 0x33
+
+#define FILE_REGISTERS 16
+#define WRAP_REGISTERS 8
+
+typedef struct
+{
+    I2cRegisterFile *file;
+    uint32_t calls;
+    uint16_t starts[2];
+    uint16_t bytes[2];
+}
+WriteLog;
+
+static void logWrite(void* parameters)
+{
+    WriteLog *log = static_cast<WriteLog*>(parameters);
+    if(log->calls < 2)
+    {
+        log->file->getLastWrite(log->starts[log->calls], log->bytes[log->calls]);
+    }
+    log->calls++;
+}
+
+static bool hostTransfer(I2C_TypeDef *instance, uint16_t address, const uint8_t *writeData, uint16_t writeBytes, uint8_t *readData = nullptr, uint16_t readBytes = 0)
+{
+    bool started = I2cSim::hostTransfer(instance, address, writeData, writeBytes, readData, readBytes);
+    I2cSim::runUntilIdle();
+
+    return started;
+}
+
+/*
+ *  Attaches a register file of no memory, which can't be constructed.
+ */
+static I2cStatus attachEmptyFile(I2cBus &bus)
+{
+    uint8_t memory[1];
+    I2cRegisterFile file(memory, 0);
+
+    return bus.setRegisterFile(&file);
+}
+
+static void testConfiguration(I2cBus &slave, I2cBus &dual)
+{
+    // OAR1 and OAR2 hold the 7 bit addresses in bits 7:1.
+    const I2C_InitTypeDef &init = slave.getHandle()->Init;
+    I2C_CHECK_EQUAL(init.OwnAddress1, OWN_ADDRESS << 1);
+    I2C_CHECK_EQUAL(init.NoStretchMode, I2C_NOSTRETCH_DISABLE);
+    I2C_CHECK_EQUAL(init.GeneralCallMode, I2C_GENERALCALL_DISABLE);
+    I2C_CHECK_EQUAL(init.DualAddressMode, I2C_DUALADDRESS_DISABLE);
+    I2C_CHECK_EQUAL(init.AddressingMode, I2C_ADDRESSINGMODE_7BIT);
+
+    const I2C_InitTypeDef &dualInit = dual.getHandle()->Init;
+    I2C_CHECK_EQUAL(dualInit.OwnAddress1, DUAL_ADDRESS_1 << 1);
+    I2C_CHECK_EQUAL(dualInit.OwnAddress2, DUAL_ADDRESS_2 << 1);
+    I2C_CHECK_EQUAL(dualInit.NoStretchMode, I2C_NOSTRETCH_ENABLE);
+    I2C_CHECK_EQUAL(dualInit.GeneralCallMode, I2C_GENERALCALL_ENABLE);
+    I2C_CHECK_EQUAL(dualInit.DualAddressMode, I2C_DUALADDRESS_ENABLE);
+}
+
+static void testWriteRead(I2cBus &bus, I2cRegisterFile &file, WriteLog &log)
+{
+    uint8_t *memory = file.getMemory();
+
+    // Pointer first, then the data in place from there.
+    const uint8_t write[] = {4, 0xA1, 0xA2, 0xA3};
+    I2C_CHECK(hostTransfer(I2C1, OWN_ADDRESS, write, sizeof(write)));
+    I2C_CHECK_EQUAL(memory[3], 0x03);
+    I2C_CHECK_EQUAL(memory[4], 0xA1);
+    I2C_CHECK_EQUAL(memory[6], 0xA3);
+    I2C_CHECK_EQUAL(memory[7], 0x07);
+    I2C_CHECK_EQUAL(file.getPointer(), 7);
+
+    I2C_CHECK_EQUAL(log.calls, 1);
+    I2C_CHECK_EQUAL(log.starts[0], 4);
+    I2C_CHECK_EQUAL(log.bytes[0], 3);
+
+    // The pointer alone, then a read after the repeated START: the read doesn't move it.
+    const uint8_t pointer[] = {5};
+    uint8_t read[3] = {};
+    I2C_CHECK(hostTransfer(I2C1, OWN_ADDRESS, pointer, sizeof(pointer), read, sizeof(read)));
+    I2C_CHECK_EQUAL(read[0], 0xA2);
+    I2C_CHECK_EQUAL(read[1], 0xA3);
+    I2C_CHECK_EQUAL(read[2], 0x07);
+    I2C_CHECK_EQUAL(file.getPointer(), 5);
+    I2C_CHECK_EQUAL(log.calls, 1);
+
+    // A read on its own starts at the pointer again.
+    I2C_CHECK(hostTransfer(I2C1, OWN_ADDRESS, nullptr, 0, read, 1));
+    I2C_CHECK_EQUAL(read[0], 0xA2);
+
+    const I2cRegisterFileStats &stats = file.getStats();
+    I2C_CHECK_EQUAL(stats.writes, 1);
+    I2C_CHECK_EQUAL(stats.bytesWritten, 3);
+    I2C_CHECK_EQUAL(stats.reads, 2);
+    I2C_CHECK_EQUAL(stats.errors, 0);
+
+    // Another address isn't answered.
+    uint64_t nacks = I2cSim::getStats(I2C1).nacks;
+    const uint8_t other[] = {0, 0xEE};
+    I2C_CHECK(hostTransfer(I2C1, OWN_ADDRESS + 1, other, sizeof(other)));
+    I2C_CHECK_EQUAL(I2cSim::getStats(I2C1).nacks - nacks, 1);
+    I2C_CHECK_EQUAL(memory[0], 0x00);
+    I2C_CHECK_EQUAL(file.getStats().writes, 1);
+
+    // A register file without memory is refused, the one attached stays.
+    I2C_CHECK_EQUAL(I2C_STATUS_OF(attachEmptyFile(bus)), I2C_ERROR_INVALID_ARGUMENT);
+    I2C_CHECK(bus.getRegisterFile() == &file);
+}
+
+static void testWrap(I2cRegisterFile &file, WriteLog &log)
+{
+    uint8_t *memory = file.getMemory();
+
+    // Answered on the second address too. The pointer is 16 bits, MSB first.
+    const uint8_t write[] = {0x00, 0x06, 0xB6, 0xB7, 0xB0, 0xB1};
+    I2C_CHECK(hostTransfer(I2C2, DUAL_ADDRESS_2, write, sizeof(write)));
+    I2C_CHECK_EQUAL(memory[6], 0xB6);
+    I2C_CHECK_EQUAL(memory[7], 0xB7);
+    I2C_CHECK_EQUAL(memory[0], 0xB0);
+    I2C_CHECK_EQUAL(memory[1], 0xB1);
+    I2C_CHECK_EQUAL(memory[2], 0x02);
+    I2C_CHECK_EQUAL(file.getPointer(), 2);
+
+    // Reported in two parts, the end of the memory first.
+    I2C_CHECK_EQUAL(log.calls, 2);
+    I2C_CHECK_EQUAL(log.starts[0], 6);
+    I2C_CHECK_EQUAL(log.bytes[0], 2);
+    I2C_CHECK_EQUAL(log.starts[1], 0);
+    I2C_CHECK_EQUAL(log.bytes[1], 2);
+    I2C_CHECK_EQUAL(file.getStats().bytesWritten, 4);
+
+    // Reads go on from register 0 as well.
+    const uint8_t pointer[] = {0x00, 0x07};
+    uint8_t read[3] = {};
+    I2C_CHECK(hostTransfer(I2C2, DUAL_ADDRESS_1, pointer, sizeof(pointer), read, sizeof(read)));
+    I2C_CHECK_EQUAL(read[0], 0xB7);
+    I2C_CHECK_EQUAL(read[1], 0xB0);
+    I2C_CHECK_EQUAL(read[2], 0xB1);
+
+    // A pointer past the end wraps modulo the size.
+    const uint8_t beyond[] = {0x00, WRAP_REGISTERS + 3, 0xC3};
+    I2C_CHECK(hostTransfer(I2C2, DUAL_ADDRESS_1, beyond, sizeof(beyond)));
+    I2C_CHECK_EQUAL(memory[3], 0xC3);
+    I2C_CHECK_EQUAL(file.getPointer(), 4);
+    I2C_CHECK_EQUAL(file.getStats().errors, 0);
+}
+
+int main(void)
+{
+    I2cSim::reset();
+
+    uint8_t memory[FILE_REGISTERS];
+    uint8_t wrapMemory[WRAP_REGISTERS];
+    for(uint8_t i = 0; i < FILE_REGISTERS; i++)
+    {
+        memory[i] = i;
+    }
+    memcpy(wrapMemory, memory, sizeof(wrapMemory));
+
+    StaticQueue<I2cTransaction, 4> queue;
+    StaticQueue<I2cTransaction, 4> dualQueue;
+    I2cBus slave("slave", &queue, I2C_BUS_1, 100000, true, I2C_DUTY_CYCLE_2, false, false, OWN_ADDRESS, 0, true, false);
+    I2cBus dual("dual", &dualQueue, I2C_BUS_2, 400000, true, I2C_DUTY_CYCLE_2, false, true, DUAL_ADDRESS_1, DUAL_ADDRESS_2, false, true);
+    I2C_CHECK_EQUAL(slave.getStatus(), I2C_OK);
+    I2C_CHECK_EQUAL(dual.getStatus(), I2C_OK);
+
+    I2cRegisterFile file(memory, FILE_REGISTERS);
+    WriteLog log = {&file, 0, {}, {}};
+    file.setWriteCallback(logWrite, &log);
+    I2C_CHECK_EQUAL(slave.setRegisterFile(&file), I2C_OK);
+
+    I2cRegisterFile wrapFile(wrapMemory, WRAP_REGISTERS, REGISTER_16_BITS);
+    WriteLog wrapLog = {&wrapFile, 0, {}, {}};
+    wrapFile.setWriteCallback(logWrite, &wrapLog);
+    I2C_CHECK_EQUAL(dual.setRegisterFile(&wrapFile), I2C_OK);
+
+    testConfiguration(slave, dual);
+    testWriteRead(slave, file, log);
+    testWrap(wrapFile, wrapLog);
+
+    return I2C_TEST_RESULT();
+}
@@ -0,0 +1,273 @@
+#include "i2c_sim.hpp"
+#include "i2c_bus.hpp"
+#include "i2c_device.hpp"
+#include "i2c_task.hpp"
+#include "queue.hpp"
+
+#include "i2c_test.hpp"
+
+/*
+ *  Retries of NACKed transactions and ACK polling, against an EEPROM that ignores its address
+ *  during the write cycle. The cycle starts at the STOP of a write with data after the pointer.
+ */
+
+#define EEPROM_ADDRESS 0x50
+#define EEPROM_WRITE_CYCLE_NS 5000000ULL
+#define SENSOR_ADDRESS 0x48
+
+class I2cSimEeprom : public I2cSimRegisterDevice
+{
+    protected:
+        uint64_t busyUntil = 0;
+        uint8_t bytesWritten = 0;
+
+    public:
+        uint32_t addressed = 0;
+
+        I2cSimEeprom(void) : I2cSimRegisterDevice(EEPROM_ADDRESS, 64, 1, 2)
+        {
+
+        }
+
+        bool start(bool read) override
+        {
+            addressed++;
+            if(isBusy())
+                return false;
+
+            bytesWritten = 0;
+
+            return I2cSimRegisterDevice::start(read);
+        }
+
+        bool writeByte(uint8_t byte) override
+        {
+            bytesWritten++;
+
+            return I2cSimRegisterDevice::writeByte(byte);
+        }
+
+        void stop(void) override
+        {
+            if(bytesWritten > pointerBytes)
+                busyUntil = I2cSim::getTime() + EEPROM_WRITE_CYCLE_NS;
+
+            bytesWritten = 0;
+            I2cSimRegisterDevice::stop();
+        }
+
+        bool isBusy(void)
+        {
+            return I2cSim::getTime() < busyUntil;
+        }
+};
+
+typedef struct
+{
+    I2cStatus status;
+    bool done;
+    uint64_t doneTime;
+}
+RetryResult;
+
+static void retryDone(void* parameters)
+{
+    RetryResult *result = static_cast<RetryResult*>(parameters);
+    result->done = true;
+    result->doneTime = I2cSim::getTime();
+}
+
+static uint8_t writeData[3] = {0x00, 0x04, 0x5A};
+static uint8_t readPointer[2] = {0x00, 0x04};
+
+/*
+ *  Writes a byte, then reads it back right away: the read hits the write cycle.
+ */
+static void writeThenRead(I2cDevice &eeprom, uint8_t &readData, RetryResult &result)
+{
+    result = {I2C_ERROR_HAL, false, 0};
+
+    I2cTransaction write(TRANSACTION_TX, writeData, sizeof(writeData), &eeprom);
+    write.send();
+
+    I2cTransaction read(TRANSACTION_RX, &readData, 1, &eeprom, (readPointer[0] << 8) | readPointer[1], REGISTER_16_BITS);
+    read.setStatusOutput(&result.status);
+    read.setPostCallback(retryDone, &result);
+    read.send();
+}
+
+static void runFor(I2cBus &bus, uint64_t nanoseconds)
+{
+    uint64_t end = I2cSim::getTime() + nanoseconds;
+    while(I2cSim::getTime() < end)
+    {
+        I2cSim::advance(100000);
+        bus.poll();
+    }
+}
+
+static void testWithoutPolicy(I2cBus &bus, I2cDevice &eeprom)
+{
+    uint8_t readData = 0;
+    RetryResult result;
+
+    writeThenRead(eeprom, readData, result);
+    runFor(bus, 1000000);
+
+    I2C_CHECK(result.done);
+    I2C_CHECK_EQUAL(result.status, I2C_ERROR_NACK);
+}
+
+static void testRetried(I2cBus &bus, I2cDevice &eeprom, I2cDevice &sensor, I2cSimEeprom &eepromSim)
+{
+    runFor(bus, EEPROM_WRITE_CYCLE_NS);
+    eeprom.setRetryPolicy(10, 1);
+
+    uint8_t readData = 0;
+    RetryResult result;
+    uint64_t start = I2cSim::getTime();
+    eepromSim.addressed = 0;
+
+    writeThenRead(eeprom, readData, result);
+
+    // The backoff leaves the bus to the other devices.
+    uint8_t sensorData[2];
+    size_t sensorReads = 0;
+    while(!result.done && I2cSim::getTime() - start < 4 * EEPROM_WRITE_CYCLE_NS)
+    {
+        if(!I2cSim::isBusy(I2C1))
+        {
+            I2cTransaction read(TRANSACTION_RX, sensorData, 2, &sensor, 0, REGISTER_8_BITS);
+            read.send();
+            sensorReads++;
+        }
+
+        runFor(bus, 100000);
+    }
+
+    I2C_CHECK(result.done);
+    I2C_CHECK_EQUAL(result.status, I2C_OK);
+    I2C_CHECK_EQUAL(readData, writeData[2]);
+    I2C_CHECK(result.doneTime - start >= EEPROM_WRITE_CYCLE_NS);
+    I2C_CHECK(eepromSim.addressed > 2);
+    I2C_CHECK(sensorReads > 10);
+}
+
+static void testExhausted(I2cBus &bus, I2cDevice &eeprom, I2cSimEeprom &eepromSim)
+{
+    runFor(bus, EEPROM_WRITE_CYCLE_NS);
+    eeprom.setRetryPolicy(2, 1);
+    eepromSim.addressed = 0;
+
+    uint8_t readData = 0;
+    RetryResult result;
+
+    writeThenRead(eeprom, readData, result);
+    runFor(bus, 3000000);
+
+    // The write, then the read and its only retry.
+    I2C_CHECK(result.done);
+    I2C_CHECK_EQUAL(result.status, I2C_ERROR_NACK);
+    I2C_CHECK_EQUAL(eepromSim.addressed, 3);
+}
+
+static void testRetriedReference(I2cBus &bus, I2cDevice &eeprom)
+{
+    runFor(bus, EEPROM_WRITE_CYCLE_NS);
+
+    // Linked rather than copied: the retries run on a copy, the outcome must reach these.
+    ReferenceQueue<I2cTransaction, 4> references;
+    I2C_CHECK_EQUAL(bus.setPriorityQueue(I2C_PRIORITY_LOW, &references), I2C_OK);
+    eeprom.setPriority(I2C_PRIORITY_LOW);
+
+    const uint8_t policies[2] = {2, 10};
+    const I2cStatus expected[2] = {I2C_ERROR_NACK, I2C_OK};
+    for(size_t i = 0; i < 2; i++)
+    {
+        eeprom.setRetryPolicy(policies[i], 1);
+
+        uint8_t readData = 0;
+        RetryResult result = {I2C_ERROR_HAL, false, 0};
+        I2cTransaction write(TRANSACTION_TX, writeData, sizeof(writeData), &eeprom);
+        I2cTransaction read(TRANSACTION_RX, &readData, 1, &eeprom, (readPointer[0] << 8) | readPointer[1], REGISTER_16_BITS);
+        read.setStatusOutput(&result.status);
+        read.setPostCallback(retryDone, &result);
+
+        I2C_CHECK_EQUAL(write.send(), I2C_OK);
+        I2C_CHECK_EQUAL(read.send(), I2C_OK);
+        runFor(bus, 2 * EEPROM_WRITE_CYCLE_NS);
+
+        I2C_CHECK(result.done);
+        I2C_CHECK_EQUAL(result.status, expected[i]);
+        I2C_CHECK_EQUAL(read.getStatus(), expected[i]);
+        if(expected[i] == I2C_OK)
+        {
+            I2C_CHECK(read.getAttempts() > 2);
+            I2C_CHECK_EQUAL(readData, writeData[2]);
+        }
+        else
+        {
+            I2C_CHECK_EQUAL(read.getAttempts(), policies[i]);
+        }
+
+        runFor(bus, EEPROM_WRITE_CYCLE_NS);
+    }
+
+    eeprom.setPriority(I2C_PRIORITY_NORMAL);
+    I2C_CHECK_EQUAL(bus.setPriorityQueue(I2C_PRIORITY_LOW, nullptr), I2C_OK);
+}
+
+static I2cStatus readyStatus = I2C_ERROR_HAL;
+static bool readyDone = false;
+
+static I2cTask pollUntilReady(I2cDevice &eeprom)
+{
+    co_await eeprom.write(writeData, sizeof(writeData));
+
+    readyStatus = co_await eeprom.waitReady();
+    readyDone = true;
+}
+
+static void testAckPolling(I2cBus &bus, I2cDevice &eeprom, I2cSimEeprom &eepromSim)
+{
+    runFor(bus, EEPROM_WRITE_CYCLE_NS);
+    eeprom.setRetryPolicy(20, 1);
+    eepromSim.addressed = 0;
+
+    I2C_CHECK_EQUAL(I2cScheduler::spawn(pollUntilReady(eeprom)), I2C_OK);
+
+    for(size_t i = 0; i < 200 && !readyDone; i++)
+    {
+        I2cScheduler::run();
+        runFor(bus, 100000);
+    }
+
+    I2C_CHECK(readyDone);
+    I2C_CHECK_EQUAL(readyStatus, I2C_OK);
+    I2C_CHECK(!eepromSim.isBusy());
+    I2C_CHECK(eepromSim.addressed > 2);
+}
+
+int main(void)
+{
+    I2cSim::reset();
+
+    I2cSimEeprom eepromSim;
+    I2cSimRegisterDevice sensorSim(SENSOR_ADDRESS, 4, 2);
+    I2cSim::attachDevice(I2C1, &eepromSim);
+    I2cSim::attachDevice(I2C1, &sensorSim);
+
+    StaticQueue<I2cTransaction, 8> queue;
+    I2cBus bus("bus", &queue, I2C_BUS_1, 400000);
+
+    I2cDevice eeprom(EEPROM_ADDRESS, &bus, "eeprom");
+    I2cDevice sensor(SENSOR_ADDRESS, &bus, "sensor");
+
+    testWithoutPolicy(bus, eeprom);
+    testRetried(bus, eeprom, sensor, eepromSim);
+    testExhausted(bus, eeprom, eepromSim);
+    testRetriedReference(bus, eeprom);
+    testAckPolling(bus, eeprom, eepromSim);
+
+    return I2C_TEST_RESULT();
+}
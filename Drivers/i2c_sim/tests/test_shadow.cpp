@@ -0,0 +1,197 @@
+#include "i2c_sim.hpp"
+#include "i2c_bus.hpp"
+#include "i2c_device.hpp"
+#include "i2c_register_shadow.hpp"
+#include "queue.hpp"
+
+#include "i2c_test.hpp"
+
+/*
+ *  Register shadow of a device with 16 bit registers: read-modify-writes served from the shadow,
+ *  values kept MSB first, and the registers forgotten when an access fails or covers them only
+ *  in part.
+ */
+
+#define CONFIG_ADDRESS 0x40
+#define CONFIG_REGISTERS 8
+
+#define CONFIG_REGISTER 2
+#define LIMIT_REGISTER 3
+#define UNTRACKED_REGISTER 6
+
+/*
+ *  Register file that can NACK its address, like a device that is powered down.
+ */
+class I2cSimConfigDevice : public I2cSimRegisterDevice
+{
+    public:
+        bool nack = false;
+
+        I2cSimConfigDevice(void) : I2cSimRegisterDevice(CONFIG_ADDRESS, CONFIG_REGISTERS, 2)
+        {
+
+        }
+
+        bool start(bool read) override
+        {
+            if(nack)
+                return false;
+
+            return I2cSimRegisterDevice::start(read);
+        }
+};
+
+static I2cStatus readRegister(I2cDevice &device, uint16_t deviceRegister, uint8_t *data, uint16_t bytes)
+{
+    I2cStatus status = I2C_ERROR_HAL;
+    I2cTransaction read(TRANSACTION_RX, data, bytes, &device, deviceRegister, REGISTER_8_BITS);
+    read.setStatusOutput(&status);
+    read.send();
+    I2cSim::runUntilIdle();
+
+    return status;
+}
+
+static void testReadModifyWrite(I2cDevice &device, I2cSimConfigDevice &deviceSim, I2cRegisterShadow &shadow)
+{
+    uint32_t value;
+    uint8_t data[2];
+
+    // Unknown until the device is read once.
+    I2C_CHECK_EQUAL(I2C_STATUS_OF(device.modifyBits(CONFIG_REGISTER, 0x00F0, 0x0050)), I2C_ERROR_NOT_SHADOWED);
+    I2C_CHECK_EQUAL(device.readShadow(CONFIG_REGISTER, value), I2C_ERROR_NOT_SHADOWED);
+
+    I2C_CHECK_EQUAL(readRegister(device, CONFIG_REGISTER, data, 2), I2C_OK);
+    I2C_CHECK_EQUAL(device.readShadow(CONFIG_REGISTER, value), I2C_OK);
+    I2C_CHECK_EQUAL(value, 0x8583);
+
+    // A single write, the current value comes from the shadow.
+    uint64_t transfers = I2cSim::getStats(I2C1).transactions;
+    uint32_t avoidedReads = shadow.getStats().avoidedReads;
+    I2C_CHECK_EQUAL(device.modifyBits(CONFIG_REGISTER, 0x00F0, 0x0050), I2C_OK);
+    I2cSim::runUntilIdle();
+
+    I2C_CHECK_EQUAL(I2cSim::getStats(I2C1).transactions - transfers, 1);
+    I2C_CHECK_EQUAL(shadow.getStats().avoidedReads - avoidedReads, 1);
+    I2C_CHECK_EQUAL(deviceSim.getRegister(CONFIG_REGISTER), 0x8553);
+    I2C_CHECK_EQUAL(device.readShadow(CONFIG_REGISTER, value), I2C_OK);
+    I2C_CHECK_EQUAL(value, 0x8553);
+
+    // The bits already hold the value: nothing is sent.
+    uint32_t suppressed = shadow.getStats().suppressedWrites;
+    I2C_CHECK_EQUAL(device.modifyBits(CONFIG_REGISTER, 0x00F0, 0x0050), I2C_OK);
+    I2cSim::runUntilIdle();
+    I2C_CHECK_EQUAL(I2cSim::getStats(I2C1).transactions - transfers, 1);
+    I2C_CHECK_EQUAL(shadow.getStats().suppressedWrites - suppressed, 1);
+
+    // Back to back modifications build on each other before either is sent.
+    I2C_CHECK_EQUAL(device.modifyBits(CONFIG_REGISTER, 0x0001, 0x0000), I2C_OK);
+    I2C_CHECK_EQUAL(device.modifyBits(CONFIG_REGISTER, 0x8000, 0x0000), I2C_OK);
+    I2cSim::runUntilIdle();
+    I2C_CHECK_EQUAL(deviceSim.getRegister(CONFIG_REGISTER), 0x0552);
+    I2C_CHECK_EQUAL(device.readShadow(CONFIG_REGISTER, value), I2C_OK);
+    I2C_CHECK_EQUAL(value, 0x0552);
+
+    // Untracked registers are never shadowed.
+    I2C_CHECK_EQUAL(readRegister(device, UNTRACKED_REGISTER, data, 2), I2C_OK);
+    I2C_CHECK_EQUAL(device.readShadow(UNTRACKED_REGISTER, value), I2C_ERROR_NOT_SHADOWED);
+}
+
+static void testMultiByte(I2cDevice &device, I2cSimConfigDevice &deviceSim)
+{
+    uint32_t value;
+    uint8_t data[2];
+
+    // Both bytes of the register, MSB first on the wire.
+    I2C_CHECK_EQUAL(device.writeRegister(LIMIT_REGISTER, 0xABCD), I2C_OK);
+    I2cSim::runUntilIdle();
+    I2C_CHECK_EQUAL(deviceSim.getRegister(LIMIT_REGISTER), 0xABCD);
+
+    deviceSim.setRegister(LIMIT_REGISTER, 0x1234);
+    I2C_CHECK_EQUAL(readRegister(device, LIMIT_REGISTER, data, 2), I2C_OK);
+    I2C_CHECK_EQUAL(data[0], 0x12);
+    I2C_CHECK_EQUAL(data[1], 0x34);
+    I2C_CHECK_EQUAL(device.readShadow(LIMIT_REGISTER, value), I2C_OK);
+    I2C_CHECK_EQUAL(value, 0x1234);
+
+    // Half a register tells nothing about its value.
+    I2C_CHECK_EQUAL(readRegister(device, LIMIT_REGISTER, data, 1), I2C_OK);
+    I2C_CHECK_EQUAL(device.readShadow(LIMIT_REGISTER, value), I2C_ERROR_NOT_SHADOWED);
+
+    // Neither does a block covering both tracked registers.
+    uint8_t block[4];
+    I2C_CHECK_EQUAL(readRegister(device, LIMIT_REGISTER, data, 2), I2C_OK);
+    I2C_CHECK_EQUAL(readRegister(device, CONFIG_REGISTER, block, sizeof(block)), I2C_OK);
+    I2C_CHECK_EQUAL(device.readShadow(CONFIG_REGISTER, value), I2C_ERROR_NOT_SHADOWED);
+    I2C_CHECK_EQUAL(device.readShadow(LIMIT_REGISTER, value), I2C_ERROR_NOT_SHADOWED);
+}
+
+static void testInvalidation(I2cDevice &device, I2cSimConfigDevice &deviceSim)
+{
+    uint32_t value;
+    uint8_t data[2];
+
+    deviceSim.setRegister(CONFIG_REGISTER, 0x1111);
+    I2C_CHECK_EQUAL(readRegister(device, CONFIG_REGISTER, data, 2), I2C_OK);
+
+    // A failed read leaves the register as it was.
+    deviceSim.nack = true;
+    I2C_CHECK_EQUAL(readRegister(device, CONFIG_REGISTER, data, 2), I2C_ERROR_NACK);
+    I2C_CHECK_EQUAL(device.readShadow(CONFIG_REGISTER, value), I2C_OK);
+    I2C_CHECK_EQUAL(value, 0x1111);
+
+    // A failed write may or may not have reached the register: it's unknown afterwards.
+    I2C_CHECK_EQUAL(device.writeRegister(CONFIG_REGISTER, 0x2222), I2C_OK);
+    I2C_CHECK_EQUAL(device.readShadow(CONFIG_REGISTER, value), I2C_OK);
+    I2C_CHECK_EQUAL(value, 0x2222);
+    I2cSim::runUntilIdle();
+    deviceSim.nack = false;
+
+    I2C_CHECK_EQUAL(device.readShadow(CONFIG_REGISTER, value), I2C_ERROR_NOT_SHADOWED);
+    I2C_CHECK_EQUAL(deviceSim.getRegister(CONFIG_REGISTER), 0x1111);
+    I2C_CHECK_EQUAL(I2C_STATUS_OF(device.modifyBits(CONFIG_REGISTER, 0x000F, 0x0003)), I2C_ERROR_NOT_SHADOWED);
+
+    // The same after a bus fault, once the bus is recovered.
+    I2C_CHECK_EQUAL(device.writeRegister(CONFIG_REGISTER, 0x3333), I2C_OK);
+    I2cSim::runUntilIdle();
+    I2C_CHECK_EQUAL(device.readShadow(CONFIG_REGISTER, value), I2C_OK);
+
+    I2cSim::injectFault(I2C1, I2C_SIM_FAULT_BUS_ERROR);
+    I2C_CHECK_EQUAL(device.writeRegister(CONFIG_REGISTER, 0x4444), I2C_OK);
+    I2cSim::runUntilIdle();
+    I2C_CHECK(device.getBus()->runRecovery());
+    I2C_CHECK_EQUAL(device.readShadow(CONFIG_REGISTER, value), I2C_ERROR_NOT_SHADOWED);
+
+    // The same value is written again, not suppressed.
+    I2C_CHECK_EQUAL(device.writeRegister(CONFIG_REGISTER, 0x4444), I2C_OK);
+    I2cSim::runUntilIdle();
+    I2C_CHECK_EQUAL(deviceSim.getRegister(CONFIG_REGISTER), 0x4444);
+    I2C_CHECK_EQUAL(device.readShadow(CONFIG_REGISTER, value), I2C_OK);
+    I2C_CHECK_EQUAL(value, 0x4444);
+}
+
+int main(void)
+{
+    I2cSim::reset();
+
+    I2cSimConfigDevice deviceSim;
+    deviceSim.setRegister(CONFIG_REGISTER, 0x8583);
+    I2cSim::attachDevice(I2C1, &deviceSim);
+
+    StaticQueue<I2cTransaction, 8> queue;
+    I2cBus bus("bus", &queue, I2C_BUS_1, 400000);
+    I2C_CHECK_EQUAL(bus.getStatus(), I2C_OK);
+
+    I2cDevice device(CONFIG_ADDRESS, &bus, "config");
+
+    I2cRegisterShadow shadow(REGISTER_8_BITS, 2);
+    I2C_CHECK_EQUAL(shadow.track(CONFIG_REGISTER), I2C_OK);
+    I2C_CHECK_EQUAL(shadow.track(LIMIT_REGISTER), I2C_OK);
+    device.setShadow(&shadow);
+
+    testReadModifyWrite(device, deviceSim, shadow);
+    testMultiByte(device, deviceSim);
+    testInvalidation(device, deviceSim);
+
+    return I2C_TEST_RESULT();
+}
@@ -0,0 +1,195 @@
+#include "i2c_sim.hpp"
+#include "i2c_bus.hpp"
+#include "i2c_device.hpp"
+#include "queue.hpp"
+
+#include "i2c_test.hpp"
+
+/*
+ *  Latency statistics of the bus (I2C_DRIVER_STATS builds only): the queue wait and wire time of
+ *  every transaction against the simulated clock, per device and per priority class.
+ */
+
+#define SENSOR_ADDRESS 0x48
+#define ALARM_ADDRESS 0x49
+#define SENSOR_REGISTERS 16
+
+#if I2C_DRIVER_STATS
+
+/*
+ *  Simulated times of one transaction, in nanoseconds.
+ */
+typedef struct
+{
+    uint64_t queued;
+    uint64_t started;
+    uint64_t completed;
+}
+TransactionTimes;
+
+static void transactionStarted(void* parameters)
+{
+    static_cast<TransactionTimes*>(parameters)->started = I2cSim::getTime();
+}
+
+static void transactionCompleted(void* parameters)
+{
+    static_cast<TransactionTimes*>(parameters)->completed = I2cSim::getTime();
+}
+
+/*
+ *  Cycle counter reading at a simulated time, as the driver timestamps see it (see
+ *  I2cSim::getCycles).
+ */
+static uint32_t cyclesAt(uint64_t nanoseconds)
+{
+    return static_cast<uint32_t>(nanoseconds * (I2C_SIM_CORE_CLOCK / 1000000) / 1000);
+}
+
+/*
+ *  Checks the statistics against the latencies measured with the simulated clock.
+ */
+static void checkLatencies(const I2cLatencyStats &stats, const uint32_t *latencies, size_t count)
+{
+    uint32_t min = UINT32_MAX;
+    uint32_t max = 0;
+    uint64_t total = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        min = std::min(min, latencies[i]);
+        max = std::max(max, latencies[i]);
+        total += latencies[i];
+    }
+
+    I2C_CHECK_EQUAL(stats.getCount(), count);
+    I2C_CHECK_EQUAL(stats.getMin(), min);
+    I2C_CHECK_EQUAL(stats.getMax(), max);
+    I2C_CHECK_EQUAL(stats.getMean(), total / count);
+}
+
+static void queueRead(I2cDevice &device, uint8_t *data, TransactionTimes &times)
+{
+    I2cTransaction transaction(TRANSACTION_RX, data, 2, &device, 0, REGISTER_8_BITS);
+    transaction.setPreCallback(transactionStarted, &times);
+    transaction.setPostCallback(transactionCompleted, &times);
+
+    times.queued = I2cSim::getTime();
+    I2C_CHECK_EQUAL(transaction.send(), I2C_OK);
+}
+
+static void testLatencies(I2cBus &bus, I2cDevice &sensor, I2cDevice &alarm)
+{
+    TransactionTimes sensorTimes[3] = {};
+    TransactionTimes alarmTimes[2] = {};
+    uint8_t data[5][2] = {};
+
+    bus.resetStats();
+
+    // The first sensor read starts right away, the high priority alarm reads overtake the others.
+    queueRead(sensor, data[0], sensorTimes[0]);
+    I2cSim::advance(20000);
+    queueRead(sensor, data[1], sensorTimes[1]);
+    queueRead(sensor, data[2], sensorTimes[2]);
+    I2cSim::advance(20000);
+    queueRead(alarm, data[3], alarmTimes[0]);
+    queueRead(alarm, data[4], alarmTimes[1]);
+    I2cSim::runUntilIdle();
+
+    I2C_CHECK(alarmTimes[1].completed <= sensorTimes[1].started);
+
+    uint32_t sensorWaits[3];
+    uint32_t sensorWires[3];
+    for(size_t i = 0; i < 3; i++)
+    {
+        sensorWaits[i] = cyclesAt(sensorTimes[i].started) - cyclesAt(sensorTimes[i].queued);
+        sensorWires[i] = cyclesAt(sensorTimes[i].completed) - cyclesAt(sensorTimes[i].started);
+    }
+
+    uint32_t alarmWaits[2];
+    uint32_t alarmWires[2];
+    for(size_t i = 0; i < 2; i++)
+    {
+        alarmWaits[i] = cyclesAt(alarmTimes[i].started) - cyclesAt(alarmTimes[i].queued);
+        alarmWires[i] = cyclesAt(alarmTimes[i].completed) - cyclesAt(alarmTimes[i].started);
+    }
+
+    // The wire time of a 2 byte register read at 400 kHz, the waits behind the transfers ahead.
+    I2C_CHECK_EQUAL(sensorWires[0], cyclesAt(I2cSim::getTransferTime(400000, 1, 2, true)));
+    I2C_CHECK_EQUAL(sensorWaits[0], 0);
+    I2C_CHECK(sensorWaits[2] > sensorWaits[1]);
+
+    const I2cDeviceStats *sensorStats = bus.getDeviceStats(SENSOR_ADDRESS);
+    const I2cDeviceStats *alarmStats = bus.getDeviceStats(ALARM_ADDRESS);
+    I2C_CHECK(sensorStats != nullptr && alarmStats != nullptr);
+    if(!sensorStats || !alarmStats)
+        return;
+
+    checkLatencies(sensorStats->queueWait, sensorWaits, 3);
+    checkLatencies(sensorStats->wireTime, sensorWires, 3);
+    checkLatencies(alarmStats->queueWait, alarmWaits, 2);
+    checkLatencies(alarmStats->wireTime, alarmWires, 2);
+
+    // One class per device here: the class statistics hold the same queue waits.
+    checkLatencies(*bus.getPriorityStats(I2C_PRIORITY_NORMAL), sensorWaits, 3);
+    checkLatencies(*bus.getPriorityStats(I2C_PRIORITY_HIGH), alarmWaits, 2);
+    I2C_CHECK_EQUAL(bus.getPriorityStats(I2C_PRIORITY_LOW)->getCount(), 0);
+    I2C_CHECK(bus.getPriorityStats(static_cast<I2cPriority>(I2C_PRIORITY_CLASSES)) == nullptr);
+}
+
+static void testPriorityCounts(I2cBus &bus, I2cDevice &sensor)
+{
+    TransactionTimes times[6] = {};
+    uint8_t data[6][2] = {};
+
+    bus.resetStats();
+
+    // The class of each transaction is counted, whichever device sent it.
+    const I2cPriority priorities[6] = {I2C_PRIORITY_LOW, I2C_PRIORITY_LOW, I2C_PRIORITY_LOW, I2C_PRIORITY_NORMAL, I2C_PRIORITY_HIGH, I2C_PRIORITY_HIGH};
+    for(size_t i = 0; i < 6; i++)
+    {
+        sensor.setPriority(priorities[i]);
+        queueRead(sensor, data[i], times[i]);
+    }
+    sensor.setPriority(I2C_PRIORITY_NORMAL);
+    I2cSim::runUntilIdle();
+
+    I2C_CHECK_EQUAL(bus.getPriorityStats(I2C_PRIORITY_HIGH)->getCount(), 2);
+    I2C_CHECK_EQUAL(bus.getPriorityStats(I2C_PRIORITY_NORMAL)->getCount(), 1);
+    I2C_CHECK_EQUAL(bus.getPriorityStats(I2C_PRIORITY_LOW)->getCount(), 3);
+    I2C_CHECK_EQUAL(bus.getDeviceStats(SENSOR_ADDRESS)->queueWait.getCount(), 6);
+
+    // The high class went right after the first read, the last low one waited for everything.
+    I2C_CHECK(bus.getPriorityStats(I2C_PRIORITY_HIGH)->getMax() < bus.getPriorityStats(I2C_PRIORITY_LOW)->getMax());
+
+    bus.resetStats();
+    I2C_CHECK_EQUAL(bus.getPriorityStats(I2C_PRIORITY_LOW)->getCount(), 0);
+    I2C_CHECK(bus.getDeviceStats(SENSOR_ADDRESS) == nullptr);
+}
+
+#endif
+
+int main(void)
+{
+#if I2C_DRIVER_STATS
+    I2cSim::reset();
+
+    I2cSimRegisterDevice sensorSim(SENSOR_ADDRESS, SENSOR_REGISTERS);
+    I2cSimRegisterDevice alarmSim(ALARM_ADDRESS, SENSOR_REGISTERS);
+    I2cSim::attachDevice(I2C1, &sensorSim);
+    I2cSim::attachDevice(I2C1, &alarmSim);
+
+    StaticQueue<I2cTransaction, 8> queue;
+    StaticQueue<I2cTransaction, 4> highQueue;
+    I2cBus bus("bus", &queue, I2C_BUS_1, 400000);
+    I2C_CHECK_EQUAL(bus.setPriorityQueue(I2C_PRIORITY_HIGH, &highQueue), I2C_OK);
+
+    I2cDevice sensor(SENSOR_ADDRESS, &bus, "sensor");
+    I2cDevice alarm(ALARM_ADDRESS, &bus, "alarm");
+    alarm.setPriority(I2C_PRIORITY_HIGH);
+
+    testLatencies(bus, sensor, alarm);
+    testPriorityCounts(bus, sensor);
+#endif
+
+    return I2C_TEST_RESULT();
+}
@@ -0,0 +1,123 @@
+#include "i2c_sim.hpp"
+#include "i2c_bus.hpp"
+#include "i2c_timing.hpp"
+#include "queue.hpp"
+
+#include "i2c_test.hpp"
+
+/*
+ *  CCR and TRISE fields computed by the driver, against what HAL_I2C_Init() programs: the values it
+ *  writes at the PCLK1 of the board, and its macros across the range of the peripheral.
+ */
+
+// PCLK1 of the board, HCLK from the PLL divided by 2 (see I2cSim::getCycles).
+#define BOARD_PCLK1 42000000
+
+/*
+ *  CCR register as HAL_I2C_Init() writes it: the CCR field, F/S and DUTY.
+ */
+static uint32_t getCcrRegister(const I2cTiming &timing)
+{
+    uint32_t value = timing.ccr;
+    if(timing.fastMode)
+    {
+        value |= I2C_CCR_FS;
+    }
+
+    if(timing.dutyCycle == I2C_DUTY_CYCLE_16_9)
+    {
+        value |= I2C_CCR_DUTY;
+    }
+
+    return value;
+}
+
+static void checkTiming(uint32_t pclk1, uint32_t clockSpeed, I2cDutyCycle dutyCycle, uint32_t ccr, uint32_t trise)
+{
+    I2cTiming timing = {};
+    I2C_CHECK_EQUAL(i2cComputeTiming(pclk1, clockSpeed, dutyCycle, timing), I2C_OK);
+    I2C_CHECK_EQUAL(getCcrRegister(timing), ccr);
+    I2C_CHECK_EQUAL(timing.trise, trise);
+    I2C_CHECK_EQUAL(timing.pclk1, pclk1);
+}
+
+static void testBoard(void)
+{
+    // Written by HAL_I2C_Init() at 42 MHz.
+    checkTiming(BOARD_PCLK1, 100000, I2C_DUTY_CYCLE_2, 210, 43);
+    checkTiming(BOARD_PCLK1, 400000, I2C_DUTY_CYCLE_2, I2C_CCR_FS | 35, 13);
+    checkTiming(BOARD_PCLK1, 400000, I2C_DUTY_CYCLE_16_9, I2C_CCR_FS | I2C_CCR_DUTY | 5, 13);
+
+    // 42 MHz divides to 100 and 400 kHz exactly, but not with duty cycle 16/9: 25 * 5 cycles.
+    I2cTiming timing = {};
+    i2cComputeTiming(BOARD_PCLK1, 100000, I2C_DUTY_CYCLE_16_9, timing);
+    I2C_CHECK(timing.exact);
+    I2C_CHECK_EQUAL(timing.dutyCycle, I2C_DUTY_CYCLE_2);
+
+    i2cComputeTiming(BOARD_PCLK1, 400000, I2C_DUTY_CYCLE_2, timing);
+    I2C_CHECK(timing.exact);
+    I2C_CHECK_EQUAL(timing.sclFrequency, 400000);
+
+    i2cComputeTiming(BOARD_PCLK1, 400000, I2C_DUTY_CYCLE_16_9, timing);
+    I2C_CHECK(!timing.exact);
+    I2C_CHECK_EQUAL(timing.sclFrequency, 336000);
+}
+
+static void testHalMacros(void)
+{
+    const uint32_t clockSpeeds[] = {10000, 50000, 88000, 100000, 100001, 250000, 384000, 400000};
+    const I2cDutyCycle dutyCycles[] = {I2C_DUTY_CYCLE_2, I2C_DUTY_CYCLE_16_9};
+
+    for(uint32_t pclk1 = I2C_PCLK1_MIN_FAST; pclk1 <= I2C_PCLK1_MAX; pclk1 += 500000)
+    {
+        for(uint32_t clockSpeed : clockSpeeds)
+        {
+            for(I2cDutyCycle dutyCycle : dutyCycles)
+            {
+                uint32_t halDutyCycle = dutyCycle == I2C_DUTY_CYCLE_16_9 ? I2C_DUTYCYCLE_16_9 : I2C_DUTYCYCLE_2;
+                uint32_t ccr = I2C_SPEED(pclk1, clockSpeed, halDutyCycle);
+                uint32_t trise = I2C_RISE_TIME(I2C_FREQRANGE(pclk1), clockSpeed);
+
+                checkTiming(pclk1, clockSpeed, dutyCycle, ccr, trise);
+            }
+        }
+    }
+
+    // Standard mode is still possible below 4 MHz.
+    checkTiming(I2C_PCLK1_MIN_STANDARD, 100000, I2C_DUTY_CYCLE_2, I2C_SPEED(I2C_PCLK1_MIN_STANDARD, 100000, I2C_DUTYCYCLE_2), 3);
+
+    I2cTiming timing = {};
+    I2C_CHECK_EQUAL(i2cComputeTiming(I2C_PCLK1_MIN_STANDARD, 400000, I2C_DUTY_CYCLE_2, timing), I2C_ERROR_INVALID_CLOCK);
+    I2C_CHECK_EQUAL(i2cComputeTiming(BOARD_PCLK1, 400001, I2C_DUTY_CYCLE_2, timing), I2C_ERROR_INVALID_CLOCK);
+    I2C_CHECK_EQUAL(i2cComputeTiming(BOARD_PCLK1, 0, I2C_DUTY_CYCLE_2, timing), I2C_ERROR_INVALID_CLOCK);
+    I2C_CHECK_EQUAL(i2cComputeTiming(I2C_PCLK1_MAX + 1, 100000, I2C_DUTY_CYCLE_2, timing), I2C_ERROR_INVALID_CLOCK);
+
+    // CCR doesn't fit its 12 bits.
+    I2C_CHECK_EQUAL(i2cComputeTiming(BOARD_PCLK1, 5000, I2C_DUTY_CYCLE_2, timing), I2C_ERROR_INVALID_CLOCK);
+}
+
+static void testBus(void)
+{
+    // The bus computes its timing from the PCLK1 of the simulation.
+    I2C_CHECK_EQUAL(HAL_RCC_GetPCLK1Freq(), BOARD_PCLK1);
+
+    StaticQueue<I2cTransaction, 4> queue;
+    I2cBus bus("bus", &queue, I2C_BUS_1, 400000, true, I2C_DUTY_CYCLE_16_9);
+    I2C_CHECK_EQUAL(bus.getStatus(), I2C_OK);
+
+    const I2cTiming &timing = bus.getTiming();
+    I2C_CHECK_EQUAL(getCcrRegister(timing), I2C_SPEED(BOARD_PCLK1, 400000, I2C_DUTYCYCLE_16_9));
+    I2C_CHECK_EQUAL(timing.trise, I2C_RISE_TIME(I2C_FREQRANGE(BOARD_PCLK1), 400000));
+    I2C_CHECK_EQUAL(bus.getHandle()->Init.DutyCycle, I2C_DUTYCYCLE_16_9);
+}
+
+int main(void)
+{
+    I2cSim::reset();
+
+    testBoard();
+    testHalMacros();
+    testBus();
+
+    return I2C_TEST_RESULT();
+}
@@ -0,0 +1,214 @@
+#include "i2c_sim.hpp"
+#include "i2c_bus.hpp"
+#include "i2c_device.hpp"
+#include "i2c_transaction_chain.hpp"
+#include "queue.hpp"
+
+#include "i2c_test.hpp"
+
+/*
+ *  Completion path of the typed buses (I2cQueuedBus): the same work, with priority classes,
+ *  coalesced reads, retries and a chain, completes in the same order with the same data whether the
+ *  queues are called through their type or through the virtual interface of Queue.
+ */
+
+#define SENSOR_ADDRESS 0x48
+#define MISSING_ADDRESS 0x50
+#define WORK_READS 8
+
+typedef SpscQueue<I2cTransaction, 16> BusQueue;
+
+/*
+ *  Tells which completion path the bus took.
+ */
+template <typename QueueType>
+class I2cTestBus : public I2cQueuedBus<QueueType>
+{
+    public:
+        using I2cQueuedBus<QueueType>::I2cQueuedBus;
+
+        bool isTyped(void)
+        {
+            return this->completeFunction == &I2cTestBus::template completeTransaction<QueueType>;
+        }
+};
+
+typedef struct
+{
+    uint8_t data[WORK_READS][4];
+    I2cStatus status[WORK_READS];
+    // Index of each read in completion order.
+    size_t order[WORK_READS];
+    size_t completed;
+}
+WorkResult;
+
+typedef struct
+{
+    WorkResult *result;
+    size_t index;
+}
+WorkRead;
+
+static void readDone(void* parameters)
+{
+    WorkRead *read = static_cast<WorkRead*>(parameters);
+    read->result->order[read->result->completed++] = read->index;
+}
+
+/*
+ *  Normal reads 0 to 3, read 0 on the wire while the others queue: 1 and 2 are contiguous and
+ *  coalesced. Read 4 goes to a missing device and is retried, read 5 is high priority and
+ *  overtakes the queued normal reads. Reads 6 and 7 are the write and read of a chain.
+ */
+static void runWork(I2cBus &bus, I2cSimRegisterDevice &sensorSim, WorkResult &result)
+{
+    for(uint16_t i = 0; i < 32; i++)
+    {
+        sensorSim.setRegister(i, 0x20 + i);
+    }
+
+    I2cDevice sensor(SENSOR_ADDRESS, &bus);
+    I2cDevice urgent(SENSOR_ADDRESS, &bus);
+    I2cDevice missing(MISSING_ADDRESS, &bus);
+    sensor.setReadCoalescing(true);
+    urgent.setPriority(I2C_PRIORITY_HIGH);
+    missing.setRetryPolicy(3, 1);
+
+    result = {};
+    WorkRead reads[WORK_READS];
+    for(size_t i = 0; i < WORK_READS; i++)
+    {
+        reads[i] = {&result, i};
+        result.status[i] = I2C_ERROR_HAL;
+    }
+
+    const uint16_t registers[4] = {0, 4, 6, 12};
+    for(size_t i = 0; i < 4; i++)
+    {
+        I2cTransaction read(TRANSACTION_RX, result.data[i], 2, &sensor, registers[i], REGISTER_8_BITS);
+        read.setStatusOutput(&result.status[i]);
+        read.setPostCallback(readDone, &reads[i]);
+        read.send();
+    }
+
+    I2cTransaction missed(TRANSACTION_RX, result.data[4], 1, &missing, 0, REGISTER_8_BITS);
+    missed.setStatusOutput(&result.status[4]);
+    missed.setPostCallback(readDone, &reads[4]);
+    missed.send();
+
+    I2cTransaction overtaking(TRANSACTION_RX, result.data[5], 3, &urgent, 20, REGISTER_8_BITS);
+    overtaking.setStatusOutput(&result.status[5]);
+    overtaking.setPostCallback(readDone, &reads[5]);
+    overtaking.send();
+
+    uint8_t chainRegister = 10;
+    I2cTransactionChain chain(&sensor);
+    chain.addWrite(&chainRegister, 1);
+    chain.addRead(result.data[7], 2);
+    chain.setStatusOutput(&result.status[7]);
+    chain.send();
+
+    for(size_t i = 0; i < 20; i++)
+    {
+        I2cSim::runUntilIdle();
+        I2cSim::advance(2000000);
+        bus.poll();
+    }
+}
+
+static void checkWork(WorkResult &result)
+{
+    const uint16_t registers[4] = {0, 4, 6, 12};
+    for(size_t i = 0; i < 4; i++)
+    {
+        I2C_CHECK_EQUAL(result.status[i], I2C_OK);
+        I2C_CHECK_EQUAL(result.data[i][0], 0x20 + registers[i]);
+        I2C_CHECK_EQUAL(result.data[i][1], 0x21 + registers[i]);
+    }
+
+    I2C_CHECK_EQUAL(result.status[4], I2C_ERROR_NACK);
+    I2C_CHECK_EQUAL(result.status[5], I2C_OK);
+    I2C_CHECK_EQUAL(result.data[5][2], 0x20 + 22);
+    I2C_CHECK_EQUAL(result.status[7], I2C_OK);
+    I2C_CHECK_EQUAL(result.data[7][0], 0x20 + 10);
+
+    // The high priority read goes right after the one on the wire, the retried read last.
+    const size_t expectedOrder[6] = {0, 5, 1, 2, 3, 4};
+    I2C_CHECK_EQUAL(result.completed, 6);
+    for(size_t i = 0; i < 6; i++)
+    {
+        I2C_CHECK_EQUAL(result.order[i], expectedOrder[i]);
+    }
+}
+
+static void testTypedBus(I2cSimRegisterDevice &sensorSim)
+{
+    BusQueue queue;
+    BusQueue highQueue;
+    I2cQueuedBus<BusQueue> bus("typed", &queue, I2C_BUS_1, 400000);
+    I2C_CHECK_EQUAL(bus.setPriorityQueue(I2C_PRIORITY_HIGH, &highQueue), I2C_OK);
+
+    WorkResult result;
+    runWork(bus, sensorSim, result);
+    checkWork(result);
+}
+
+static void testMixedQueues(I2cSimRegisterDevice &sensorSim)
+{
+    BusQueue queue;
+    BusQueue highQueue;
+    StaticQueue<I2cTransaction, 4> otherQueue;
+    I2cTestBus<BusQueue> bus("mixed", &queue, I2C_BUS_2, 400000);
+    I2C_CHECK(bus.isTyped());
+
+    // A queue of another type falls back to the virtual calls.
+    I2C_CHECK_EQUAL(bus.I2cBus::setPriorityQueue(I2C_PRIORITY_HIGH, &otherQueue), I2C_OK);
+    I2C_CHECK(!bus.isTyped());
+
+    WorkResult result;
+    runWork(bus, sensorSim, result);
+    checkWork(result);
+
+    I2C_CHECK_EQUAL(bus.setPriorityQueue(I2C_PRIORITY_HIGH, &highQueue), I2C_OK);
+    I2C_CHECK(bus.isTyped());
+
+    runWork(bus, sensorSim, result);
+    checkWork(result);
+
+    I2C_CHECK_EQUAL(bus.I2cBus::setPriorityQueue(I2C_PRIORITY_HIGH, &otherQueue), I2C_OK);
+    I2C_CHECK_EQUAL(bus.setPriorityQueue(I2C_PRIORITY_HIGH, nullptr), I2C_OK);
+    I2C_CHECK(bus.isTyped());
+}
+
+static void testErasedBus(I2cSimRegisterDevice &sensorSim)
+{
+    BusQueue queue;
+    BusQueue highQueue;
+    I2cBus bus("erased", &queue, I2C_BUS_3, 400000);
+    I2C_CHECK_EQUAL(bus.setPriorityQueue(I2C_PRIORITY_HIGH, &highQueue), I2C_OK);
+
+    WorkResult result;
+    runWork(bus, sensorSim, result);
+    checkWork(result);
+}
+
+int main(void)
+{
+    I2cSim::reset();
+
+    I2cSimRegisterDevice sensorSims[3] = {
+        I2cSimRegisterDevice(SENSOR_ADDRESS, 32),
+        I2cSimRegisterDevice(SENSOR_ADDRESS, 32),
+        I2cSimRegisterDevice(SENSOR_ADDRESS, 32)
+    };
+    I2cSim::attachDevice(I2C1, &sensorSims[0]);
+    I2cSim::attachDevice(I2C2, &sensorSims[1]);
+    I2cSim::attachDevice(I2C3, &sensorSims[2]);
+
+    testTypedBus(sensorSims[0]);
+    testMixedQueues(sensorSims[1]);
+    testErasedBus(sensorSims[2]);
+
+    return I2C_TEST_RESULT();
+}
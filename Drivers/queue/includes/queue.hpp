@@ -1,18 +1,78 @@
 #pragma once
 
 #include <array>
-#include <stdexcept>
+#include <atomic>
+#include <cstddef>
 
 template <typename ElementType>
 class Queue
 {
     public:
-        virtual void enqueue(const ElementType& element) = 0;
-
-        virtual ElementType dequeue() = 0;
+        /*
+         *  @brief Adds an element at the back of the queue.
+         *
+         *  @return False if the queue is full.
+         */
+        virtual bool enqueue(const ElementType& element) = 0;
+
+        /*
+         *  @brief Removes the element at the front of the queue and copies it into element.
+         *
+         *  @return False if the queue is empty.
+         */
+        virtual bool dequeue(ElementType& element) = 0;
 
         virtual ElementType* peek() = 0;
 
+        /*
+         *  @brief Returns the element index positions behind the front, without removing anything.
+         *  Consumer side, like peek().
+         *
+         *  @return nullptr if the queue holds index elements or less.
+         */
+        virtual ElementType* peek(size_t index) = 0;
+
+        /*
+         *  @brief Returns the free slot at the back of the queue so an element can be built in
+         *  place. The slot only becomes part of the queue once publish() is called.
+         *
+         *  @return nullptr if the queue is full or has no storage of its own.
+         */
+        virtual ElementType* acquire() = 0;
+
+        /*
+         *  @brief Adds the slot returned by acquire() at the back of the queue.
+         */
+        virtual void publish() = 0;
+
+        /*
+         *  @brief Removes the element at the front of the queue without copying it out.
+         *
+         *  @return False if the queue is empty.
+         */
+        virtual bool pop() = 0;
+
+        /*
+         *  @brief Adds the element at the back of the queue. Queues with storage copy it like
+         *  enqueue(); queues of references keep the element itself, which must then stay alive
+         *  and untouched until it is removed.
+         *
+         *  @return False if the queue is full.
+         */
+        virtual bool link(ElementType& element)
+        {
+            return enqueue(element);
+        }
+
+        /*
+         *  @brief True if the queue only keeps references to linked elements, so acquire() and
+         *  enqueue() always fail.
+         */
+        virtual bool holdsReferences() const
+        {
+            return false;
+        }
+
         virtual bool isEmpty() const = 0;
 
         virtual bool hasData() const = 0;
@@ -20,10 +80,12 @@ class Queue
         virtual bool isFull() const = 0;
 
         virtual size_t size() const = 0;
+
+        virtual size_t capacity() const = 0;
 };
 
 template <typename ElementType, size_t BufferSize>
-class StaticQueue : public Queue<ElementType>
+class StaticQueue final : public Queue<ElementType>
 {
     private:
         std::array<ElementType, BufferSize> buffer;
@@ -32,12 +94,20 @@ class StaticQueue : public Queue<ElementType>
         size_t count = 0;
 
     public:
-        void enqueue(const ElementType& element);
+        bool enqueue(const ElementType& element);
 
-        ElementType dequeue();
+        bool dequeue(ElementType& element);
 
         ElementType* peek();
 
+        ElementType* peek(size_t index);
+
+        ElementType* acquire();
+
+        void publish();
+
+        bool pop();
+
         bool isEmpty() const;
 
         bool hasData() const;
@@ -45,5 +115,102 @@ class StaticQueue : public Queue<ElementType>
         bool isFull() const;
 
         size_t size() const;
+
+        size_t capacity() const;
 };
+/*
+ *  @brief Lock-free single-producer/single-consumer ring buffer.
+ *
+ *  Meant to be filled from one context (e.g. the main loop) and drained from another one (e.g. an
+ *  interrupt handler) without disabling interrupts. Each index is only written by its owner and
+ *  published with release semantics, so the other side never observes a slot before its contents.
+ *  Indexes run freely and are wrapped with a mask, which requires a power-of-two capacity.
+ *
+ *  enqueue() may only be called by the producer; dequeue() and peek() only by the consumer.
+ */
+template <typename ElementType, size_t BufferSize>
+class SpscQueue final : public Queue<ElementType>
+{
+    static_assert(BufferSize > 0 && (BufferSize & (BufferSize - 1)) == 0, "SpscQueue size must be a power of two");
+
+    private:
+        static constexpr size_t mask = BufferSize - 1;
+
+        std::array<ElementType, BufferSize> buffer;
+
+        // Only written by the consumer.
+        std::atomic<size_t> head = 0;
+
+        // Only written by the producer.
+        std::atomic<size_t> tail = 0;
+
+    public:
+        bool enqueue(const ElementType& element);
+
+        bool dequeue(ElementType& element);
+
+        ElementType* peek();
+
+        ElementType* peek(size_t index);
+
+        ElementType* acquire();
+
+        void publish();
+
+        bool pop();
+
+        bool isEmpty() const;
+
+        bool hasData() const;
+
+        bool isFull() const;
+
+        size_t size() const;
+
+        size_t capacity() const;
+};
+
+/*
+ *  @brief Queue of references to caller-owned elements.
+ *
+ *  Elements are added with link() and are never copied: the queue only stores their address in a
+ *  lock-free ring (see SpscQueue), so the same single-producer/single-consumer rules apply. It has
+ *  no storage for elements of its own, enqueue() and acquire() always fail.
+ */
+template <typename ElementType, size_t BufferSize>
+class ReferenceQueue final : public Queue<ElementType>
+{
+    private:
+        SpscQueue<ElementType*, BufferSize> references;
+
+    public:
+        bool enqueue(const ElementType& element);
+
+        bool dequeue(ElementType& element);
+
+        ElementType* peek();
+
+        ElementType* peek(size_t index);
+
+        ElementType* acquire();
+
+        void publish();
+
+        bool pop();
+
+        bool link(ElementType& element);
+
+        bool holdsReferences() const;
+
+        bool isEmpty() const;
+
+        bool hasData() const;
+
+        bool isFull() const;
+
+        size_t size() const;
+
+        size_t capacity() const;
+};
+
 #include "queue.tpp"
\ No newline at end of file
@@ -1,30 +1,32 @@
 #include "queue.hpp"
 
 template <typename ElementType, size_t BufferSize>
-void StaticQueue<ElementType, BufferSize>::enqueue(const ElementType& element)
+bool StaticQueue<ElementType, BufferSize>::enqueue(const ElementType& element)
 {
     if (isFull())
     {
-        throw std::overflow_error("Queue is full");
+        return false;
     }
     buffer[rear] = element;
     rear = (rear + 1) % BufferSize;
     ++count;
+
+    return true;
 }
 
 template <typename ElementType, size_t BufferSize>
-ElementType StaticQueue<ElementType, BufferSize>::dequeue()
+bool StaticQueue<ElementType, BufferSize>::dequeue(ElementType& element)
 {
     if(isEmpty())
     {
-        throw std::underflow_error("Queue is empty");
+        return false;
     }
 
-    size_t position = front;
+    element = buffer[front];
     front = (front + 1) % BufferSize;
     --count;
 
-    return buffer[position];
+    return true;
 }
 
 template <typename ElementType, size_t BufferSize>
@@ -38,6 +40,49 @@ ElementType* StaticQueue<ElementType, BufferSize>::peek()
     return &buffer[front];
 }
 
+template <typename ElementType, size_t BufferSize>
+ElementType* StaticQueue<ElementType, BufferSize>::peek(size_t index)
+{
+    if(index >= count)
+    {
+        return nullptr;
+    }
+
+    return &buffer[(front + index) % BufferSize];
+}
+
+template <typename ElementType, size_t BufferSize>
+ElementType* StaticQueue<ElementType, BufferSize>::acquire()
+{
+    if(isFull())
+    {
+        return nullptr;
+    }
+
+    return &buffer[rear];
+}
+
+template <typename ElementType, size_t BufferSize>
+void StaticQueue<ElementType, BufferSize>::publish()
+{
+    rear = (rear + 1) % BufferSize;
+    ++count;
+}
+
+template <typename ElementType, size_t BufferSize>
+bool StaticQueue<ElementType, BufferSize>::pop()
+{
+    if(isEmpty())
+    {
+        return false;
+    }
+
+    front = (front + 1) % BufferSize;
+    --count;
+
+    return true;
+}
+
 template <typename ElementType, size_t BufferSize>
 bool StaticQueue<ElementType, BufferSize>::isEmpty() const
 {
@@ -60,4 +105,231 @@ template <typename ElementType, size_t BufferSize>
 size_t StaticQueue<ElementType, BufferSize>::size() const
 {
     return count;
+}
+
+template <typename ElementType, size_t BufferSize>
+size_t StaticQueue<ElementType, BufferSize>::capacity() const
+{
+    return BufferSize;
+}
+
+template <typename ElementType, size_t BufferSize>
+bool SpscQueue<ElementType, BufferSize>::enqueue(const ElementType& element)
+{
+    size_t currentTail = tail.load(std::memory_order_relaxed);
+    if(currentTail - head.load(std::memory_order_acquire) == BufferSize)
+    {
+        return false;
+    }
+
+    buffer[currentTail & mask] = element;
+    tail.store(currentTail + 1, std::memory_order_release);
+
+    return true;
+}
+
+template <typename ElementType, size_t BufferSize>
+bool SpscQueue<ElementType, BufferSize>::dequeue(ElementType& element)
+{
+    size_t currentHead = head.load(std::memory_order_relaxed);
+    if(currentHead == tail.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+
+    element = buffer[currentHead & mask];
+    head.store(currentHead + 1, std::memory_order_release);
+
+    return true;
+}
+
+template <typename ElementType, size_t BufferSize>
+ElementType* SpscQueue<ElementType, BufferSize>::peek()
+{
+    size_t currentHead = head.load(std::memory_order_relaxed);
+    if(currentHead == tail.load(std::memory_order_acquire))
+    {
+        return nullptr;
+    }
+
+    return &buffer[currentHead & mask];
+}
+
+template <typename ElementType, size_t BufferSize>
+ElementType* SpscQueue<ElementType, BufferSize>::peek(size_t index)
+{
+    size_t currentHead = head.load(std::memory_order_relaxed);
+    if(tail.load(std::memory_order_acquire) - currentHead <= index)
+    {
+        return nullptr;
+    }
+
+    return &buffer[(currentHead + index) & mask];
+}
+
+template <typename ElementType, size_t BufferSize>
+ElementType* SpscQueue<ElementType, BufferSize>::acquire()
+{
+    size_t currentTail = tail.load(std::memory_order_relaxed);
+    if(currentTail - head.load(std::memory_order_acquire) == BufferSize)
+    {
+        return nullptr;
+    }
+
+    return &buffer[currentTail & mask];
+}
+
+template <typename ElementType, size_t BufferSize>
+void SpscQueue<ElementType, BufferSize>::publish()
+{
+    tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+template <typename ElementType, size_t BufferSize>
+bool SpscQueue<ElementType, BufferSize>::pop()
+{
+    size_t currentHead = head.load(std::memory_order_relaxed);
+    if(currentHead == tail.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+
+    head.store(currentHead + 1, std::memory_order_release);
+
+    return true;
+}
+
+template <typename ElementType, size_t BufferSize>
+bool SpscQueue<ElementType, BufferSize>::isEmpty() const
+{
+    return size() == 0;
+}
+
+template <typename ElementType, size_t BufferSize>
+bool SpscQueue<ElementType, BufferSize>::hasData() const
+{
+    return size() > 0;
+}
+
+template <typename ElementType, size_t BufferSize>
+bool SpscQueue<ElementType, BufferSize>::isFull() const
+{
+    return size() == BufferSize;
+}
+
+template <typename ElementType, size_t BufferSize>
+size_t SpscQueue<ElementType, BufferSize>::size() const
+{
+    return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+}
+
+template <typename ElementType, size_t BufferSize>
+size_t SpscQueue<ElementType, BufferSize>::capacity() const
+{
+    return BufferSize;
+}
+
+template <typename ElementType, size_t BufferSize>
+bool ReferenceQueue<ElementType, BufferSize>::enqueue(const ElementType& element)
+{
+    (void)element;
+    return false;
+}
+
+template <typename ElementType, size_t BufferSize>
+bool ReferenceQueue<ElementType, BufferSize>::dequeue(ElementType& element)
+{
+    ElementType* front = peek();
+    if(!front)
+    {
+        return false;
+    }
+
+    element = *front;
+
+    return references.pop();
+}
+
+template <typename ElementType, size_t BufferSize>
+ElementType* ReferenceQueue<ElementType, BufferSize>::peek()
+{
+    ElementType** front = references.peek();
+    if(!front)
+    {
+        return nullptr;
+    }
+
+    return *front;
+}
+
+template <typename ElementType, size_t BufferSize>
+ElementType* ReferenceQueue<ElementType, BufferSize>::peek(size_t index)
+{
+    ElementType** element = references.peek(index);
+    if(!element)
+    {
+        return nullptr;
+    }
+
+    return *element;
+}
+
+template <typename ElementType, size_t BufferSize>
+ElementType* ReferenceQueue<ElementType, BufferSize>::acquire()
+{
+    return nullptr;
+}
+
+template <typename ElementType, size_t BufferSize>
+void ReferenceQueue<ElementType, BufferSize>::publish()
+{
+
+}
+
+template <typename ElementType, size_t BufferSize>
+bool ReferenceQueue<ElementType, BufferSize>::pop()
+{
+    return references.pop();
+}
+
+template <typename ElementType, size_t BufferSize>
+bool ReferenceQueue<ElementType, BufferSize>::link(ElementType& element)
+{
+    return references.enqueue(&element);
+}
+
+template <typename ElementType, size_t BufferSize>
+bool ReferenceQueue<ElementType, BufferSize>::holdsReferences() const
+{
+    return true;
+}
+
+template <typename ElementType, size_t BufferSize>
+bool ReferenceQueue<ElementType, BufferSize>::isEmpty() const
+{
+    return references.isEmpty();
+}
+
+template <typename ElementType, size_t BufferSize>
+bool ReferenceQueue<ElementType, BufferSize>::hasData() const
+{
+    return references.hasData();
+}
+
+template <typename ElementType, size_t BufferSize>
+bool ReferenceQueue<ElementType, BufferSize>::isFull() const
+{
+    return references.isFull();
+}
+
+template <typename ElementType, size_t BufferSize>
+size_t ReferenceQueue<ElementType, BufferSize>::size() const
+{
+    return references.size();
+}
+
+template <typename ElementType, size_t BufferSize>
+size_t ReferenceQueue<ElementType, BufferSize>::capacity() const
+{
+    return references.capacity();
 }
\ No newline at end of file